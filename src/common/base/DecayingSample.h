@@ -20,8 +20,11 @@
 #ifndef SKYWELL_BASICS_DECAYINGSAMPLE_H_INCLUDED
 #define SKYWELL_BASICS_DECAYINGSAMPLE_H_INCLUDED
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
 
 namespace skywell {
 
@@ -103,6 +106,125 @@ private:
 
 //------------------------------------------------------------------------------
 
+/** A DecayingSample which may be shared between threads without a lock.
+
+    The value and the second it was last aged are packed into one atomic
+    word, which is aged and stored back with a compare and swap. As with
+    DecayingSample, reading the value also stores the aged value, so the
+    results are the same; within one second a read is a plain load.
+    Values saturate at 2^32-1 exponential units.
+
+    @tparam The number of seconds in the decay window.
+*/
+template <int Window, typename Clock>
+class AtomicDecayingSample
+{
+public:
+    typedef typename Clock::duration::rep value_type;
+    typedef typename Clock::time_point time_point;
+
+    AtomicDecayingSample () = delete;
+    AtomicDecayingSample (AtomicDecayingSample const&) = delete;
+    AtomicDecayingSample& operator= (AtomicDecayingSample const&) = delete;
+
+    /**
+        @param now Start time of AtomicDecayingSample.
+    */
+    explicit AtomicDecayingSample (time_point now)
+        : m_state (pack (0, seconds (now)))
+    {
+    }
+
+    /** Add a new sample.
+        The value is first aged according to the specified time.
+    */
+    value_type add (value_type value, time_point now)
+    {
+        return update (value, seconds (now)) / Window;
+    }
+
+    /** Retrieve the current value in normalized units.
+        The samples are first aged according to the specified time.
+    */
+    value_type value (time_point now) const
+    {
+        std::uint32_t const when (seconds (now));
+        std::uint64_t const state (m_state.load ());
+
+        if (static_cast <std::int32_t> (when - whenOf (state)) <= 0)
+            return valueOf (state) / Window;
+
+        return update (0, when) / Window;
+    }
+
+private:
+    static std::uint64_t const maxValue = 0xffffffff;
+
+    // Age the value to the specified second, add to it and store it.
+    // Returns the new value in exponential units.
+    std::uint32_t update (value_type value, std::uint32_t when) const
+    {
+        std::uint64_t state (m_state.load ());
+        std::uint64_t next;
+
+        do
+        {
+            std::uint64_t const sum (decay (state, when) + value);
+            next = pack (std::min <std::uint64_t> (sum, maxValue),
+                std::max (when, whenOf (state)));
+        }
+        while (! m_state.compare_exchange_weak (state, next));
+
+        return valueOf (next);
+    }
+
+    static std::uint32_t seconds (time_point now)
+    {
+        return static_cast <std::uint32_t> (std::chrono::duration_cast <
+            std::chrono::seconds> (now.time_since_epoch ()).count ());
+    }
+
+    static std::uint64_t pack (std::uint64_t value, std::uint32_t when)
+    {
+        return (std::uint64_t (when) << 32) | value;
+    }
+
+    static std::uint32_t whenOf (std::uint64_t state)
+    {
+        return static_cast <std::uint32_t> (state >> 32);
+    }
+
+    static std::uint32_t valueOf (std::uint64_t state)
+    {
+        return static_cast <std::uint32_t> (state & maxValue);
+    }
+
+    // The value of state aged to the specified second, computed the same
+    // way as DecayingSample. A time before the last aging leaves it as is.
+    static std::uint64_t decay (std::uint64_t state, std::uint32_t when)
+    {
+        std::uint64_t value (valueOf (state));
+        std::int32_t elapsed (static_cast <std::int32_t> (
+            when - whenOf (state)));
+
+        if (value == 0 || elapsed <= 0)
+            return value;
+
+        if (elapsed > 4 * Window)
+            return 0;
+
+        while (elapsed--)
+            value -= (value + Window - 1) / Window;
+
+        return value;
+    }
+
+    // Reads age the value too, see value()
+    std::atomic <std::uint64_t> mutable m_state;
+};
+
+//------------------------------------------------------------------------------
+
 /** Sampling function using exponential decay to provide a continuous value.
     @tparam HalfLife The half life of a sample, in seconds.
 */
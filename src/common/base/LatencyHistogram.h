@@ -0,0 +1,72 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef SKYWELL_BASICS_LATENCYHISTOGRAM_H_INCLUDED
+#define SKYWELL_BASICS_LATENCYHISTOGRAM_H_INCLUDED
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace skywell {
+
+namespace tests {
+class LatencyHistogram_test;
+}
+
+/** Latency histogram with logarithmic buckets.
+
+    Values are microseconds. Each power of two is split into eight
+    buckets, so a reported percentile is within 12.5% of the true value,
+    whatever its magnitude. Recording is a relaxed atomic increment and
+    may be done from any thread.
+*/
+class LatencyHistogram
+{
+public:
+    using duration = std::chrono::microseconds;
+
+    LatencyHistogram ();
+
+    void record (duration value);
+
+    /** Returns the value below which `fraction` of the samples lie. */
+    duration percentile (double fraction) const;
+
+    std::uint64_t count () const;
+
+private:
+    friend class tests::LatencyHistogram_test;
+
+    static int const subBits = 3;
+    static int const subCount = 1 << subBits;
+
+    // Enough for values up to 2^40 microseconds, about twelve days
+    static int const bucketCount = (40 - subBits + 1) * subCount;
+
+    static int index (std::uint64_t value);
+    static std::uint64_t upper (int index);
+
+    std::array <std::atomic <std::uint64_t>, bucketCount> buckets_;
+};
+
+} // skywell
+
+#endif
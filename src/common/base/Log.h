@@ -20,9 +20,16 @@
 #ifndef SKYWELL_BASICS_LOG_H_INCLUDED
 #define SKYWELL_BASICS_LOG_H_INCLUDED
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <thread>
 #include <utility>
+#include <vector>
 #include <beast/utility/Journal.h>
 #include <boost/filesystem.hpp>
 #include <common/base/UnorderedContainers.h>
@@ -116,6 +123,9 @@ private:
         /** Close the system file if it is open. */
         void close ();
 
+        /** Flush buffered output to the system file. */
+        void flush ();
+
         /** write to the log file.
             Does nothing if there is no associated system file.
         */
@@ -144,14 +154,39 @@ private:
         boost::filesystem::path m_path;
     };
 
-    std::mutex mutable mutex_;
+    /** Lines waiting to be written by the flusher thread.
+        Each thread that logs while asynchronous writing is on owns one,
+        so queueing a line takes no lock.
+    */
+    class Buffer;
+
+    std::mutex mutable mutex_;          // Protects sinks_ and level_
     std::map <std::string, Sink> sinks_;
     beast::Journal::Severity level_;
+
+    std::mutex writeMutex_;             // Protects file_ and the console
     File file_;
 
+    // Asynchronous writing
+    std::atomic <std::size_t> bufferLines_;
+    std::atomic <std::uint64_t> dropped_;
+    std::mutex buffersMutex_;
+    std::vector <std::shared_ptr <Buffer>> buffers_;
+    std::mutex flushMutex_;
+    std::condition_variable flushCond_;
+    std::atomic <bool> wake_;
+    bool stop_;
+    std::uint64_t flushRequested_;
+    std::uint64_t flushed_;
+    std::uint64_t dropReported_;
+    std::string batch_;
+    std::thread flusher_;
+
 public:
     Logs();
 
+    ~Logs();
+
     Logs (Logs const&) = delete;
     Logs& operator= (Logs const&) = delete;
 
@@ -183,6 +218,29 @@ public:
     std::string
     rotate();
 
+    /** Write log lines from a background thread.
+
+        Logging a line then only copies its text into a buffer owned by
+        the calling thread; the flusher thread formats the lines and
+        writes them to the file in batches. Each thread buffers at most
+        `lines` lines, more are dropped and counted. Lines from different
+        threads may be written slightly out of order. Fatal lines are
+        always written before the call that logs them returns.
+
+        Zero writes the lines still queued, stops the flusher, and then
+        writes each line as it is logged.
+    */
+    void
+    async (std::size_t lines);
+
+    /** Wait until every line queued so far has been written. */
+    void
+    flush();
+
+    /** Returns the number of lines dropped because a buffer was full. */
+    std::uint64_t
+    dropped() const;
+
 public:
     static
     LogSeverity
@@ -216,6 +274,22 @@ private:
     void
     format (std::string& output, std::string const& message,
         beast::Journal::Severity severity, std::string const& partition);
+
+    static
+    void
+    format (std::string& output, std::string const& message,
+        beast::Journal::Severity severity, std::string const& partition,
+        std::time_t when);
+
+    bool
+    enqueue (beast::Journal::Severity level, std::string const& partition,
+        std::string const& text);
+
+    void
+    run();
+
+    void
+    writeQueued();
 };
 
 //------------------------------------------------------------------------------
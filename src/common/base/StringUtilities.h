@@ -33,12 +33,16 @@ namespace skywell {
 // NIKB TODO Remove the need for all these overloads. Move them out of here.
 inline const std::string strHex (std::string const& strSrc)
 {
-    return strHex (strSrc.begin (), strSrc.size ());
+    std::string strDst;
+    appendHex (strDst, strSrc.data (), strSrc.size ());
+    return strDst;
 }
 
 inline std::string strHex (Blob const& vucData)
 {
-    return strHex (vucData.begin (), vucData.size ());
+    std::string strDst;
+    appendHex (strDst, vucData.data (), vucData.size ());
+    return strDst;
 }
 
 inline std::string strHex (const std::uint64_t uiHost)
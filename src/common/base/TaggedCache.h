@@ -496,6 +496,26 @@ public:
         return v;
     }
 
+    /** Returns the objects the cache holds strongly.
+        Unlike fetch, this does not count as an access.
+    */
+    std::vector <mapped_ptr> getCachedObjects ()
+    {
+        std::vector <mapped_ptr> v;
+
+        {
+            lock_guard lock (m_mutex);
+            v.reserve (m_cache_count);
+            for (auto const& _ : m_cache)
+            {
+                if (_.second.isCached ())
+                    v.push_back (_.second.ptr);
+            }
+        }
+
+        return v;
+    }
+
 private:
     void collect_metrics ()
     {
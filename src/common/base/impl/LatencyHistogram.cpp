@@ -0,0 +1,118 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <common/base/LatencyHistogram.h>
+#include <algorithm>
+#include <cmath>
+
+#if defined (_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace skywell {
+
+// Position of the highest set bit; value must not be zero
+static int highestBit (std::uint64_t value)
+{
+#if defined (_MSC_VER)
+    unsigned long bit;
+    _BitScanReverse64 (&bit, value);
+    return static_cast <int> (bit);
+#elif defined (__GNUC__)
+    return 63 - __builtin_clzll (value);
+#else
+    int bit = 0;
+    while (value >>= 1)
+        ++bit;
+    return bit;
+#endif
+}
+
+LatencyHistogram::LatencyHistogram ()
+{
+    for (auto& bucket : buckets_)
+        bucket.store (0, std::memory_order_relaxed);
+}
+
+int LatencyHistogram::index (std::uint64_t value)
+{
+    if (value < subCount)
+        return static_cast <int> (value);
+
+    int const msb = highestBit (value);
+    int const sub = static_cast <int> (
+        (value >> (msb - subBits)) & (subCount - 1));
+
+    return std::min ((msb - subBits + 1) * subCount + sub, bucketCount - 1);
+}
+
+std::uint64_t LatencyHistogram::upper (int index)
+{
+    if (index < subCount)
+        return index + 1;
+
+    int const msb = index / subCount + subBits - 1;
+    std::uint64_t const width = std::uint64_t (1) << (msb - subBits);
+
+    return (subCount + index % subCount) * width + width;
+}
+
+void LatencyHistogram::record (duration value)
+{
+    auto const micros = std::max <duration::rep> (value.count (), 0);
+
+    buckets_[index (static_cast <std::uint64_t> (micros))].fetch_add (
+        1, std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::count () const
+{
+    std::uint64_t total = 0;
+    for (auto const& bucket : buckets_)
+        total += bucket.load (std::memory_order_relaxed);
+    return total;
+}
+
+LatencyHistogram::duration LatencyHistogram::percentile (double fraction) const
+{
+    std::array <std::uint64_t, bucketCount> counts;
+    std::uint64_t total = 0;
+
+    for (int i = 0; i < bucketCount; ++i)
+        total += (counts[i] = buckets_[i].load (std::memory_order_relaxed));
+
+    if (total == 0)
+        return duration::zero ();
+
+    auto const target = std::max <std::uint64_t> (1,
+        static_cast <std::uint64_t> (std::ceil (fraction * total)));
+
+    std::uint64_t seen = 0;
+    for (int i = 0; i < bucketCount; ++i)
+    {
+        seen += counts[i];
+        if (seen >= target)
+            return duration (upper (i) - 1);
+    }
+
+    return duration (upper (bucketCount - 1) - 1);
+}
+
+} // skywell
@@ -22,11 +22,115 @@
 #include <boost/algorithm/string.hpp>
 //  TODO Use std::chrono
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <fstream>
 
 namespace skywell {
 
+class Logs::Buffer
+{
+public:
+    struct Line
+    {
+        beast::Journal::Severity severity;
+        std::time_t when;
+        std::string partition;
+        std::string text;
+    };
+
+    explicit Buffer (std::size_t lines)
+    {
+        std::size_t size = 2;
+        while (size < lines)
+            size *= 2;
+        lines_.resize (size);
+        mask_ = size - 1;
+    }
+
+    std::size_t
+    capacity () const
+    {
+        return lines_.size ();
+    }
+
+    // Called only by the owning thread. Returns the number of lines
+    // queued including this one, or zero if the buffer is full.
+    std::size_t
+    push (beast::Journal::Severity severity, std::string const& partition,
+        std::string const& text)
+    {
+        auto const head = head_.load (std::memory_order_relaxed);
+        auto const tail = tail_.load (std::memory_order_acquire);
+
+        if (head - tail >= lines_.size ())
+            return 0;
+
+        // The slots keep their storage, so this does not usually allocate
+        Line& line = lines_[head & mask_];
+        line.severity = severity;
+        line.when = std::time (nullptr);
+        line.partition.assign (partition);
+        line.text.assign (text);
+
+        head_.store (head + 1, std::memory_order_release);
+        return head + 1 - tail;
+    }
+
+    // Called by the owning thread around a push. While it is set, the
+    // thread may still queue a line after writing has become synchronous.
+    void
+    busy (bool b)
+    {
+        busy_.store (b);
+    }
+
+    bool
+    busy () const
+    {
+        return busy_.load ();
+    }
+
+    // Called only by the thread that writes the queued lines
+    template <class Function>
+    void
+    drain (Function&& f)
+    {
+        auto tail = tail_.load (std::memory_order_relaxed);
+        auto const head = head_.load (std::memory_order_acquire);
+
+        for (; tail != head; ++tail)
+        {
+            Line& line = lines_[tail & mask_];
+            f (line);
+
+            // Don't let one long line pin its memory forever
+            if (line.text.capacity () > 4096)
+                std::string ().swap (line.text);
+        }
+
+        tail_.store (tail, std::memory_order_release);
+    }
+
+    bool
+    empty () const
+    {
+        return head_.load (std::memory_order_acquire) ==
+            tail_.load (std::memory_order_acquire);
+    }
+
+private:
+    std::vector <Line> lines_;
+    std::size_t mask_;
+    std::atomic <std::size_t> head_ {0};
+    std::atomic <bool> busy_ {false};
+    char pad_[64];  // Keep the producer and consumer indexes apart
+    std::atomic <std::size_t> tail_ {0};
+};
+
+//------------------------------------------------------------------------------
+
 Logs::Sink::Sink (std::string const& partition,
     beast::Journal::Severity severity, Logs& logs)
     : logs_(logs)
@@ -97,6 +201,12 @@ void Logs::File::write (char const* text)
         (*m_stream) << text;
 }
 
+void Logs::File::flush ()
+{
+    if (m_stream != nullptr)
+        m_stream->flush ();
+}
+
 void Logs::File::writeln (char const* text)
 {
     if (m_stream != nullptr)
@@ -110,9 +220,21 @@ void Logs::File::writeln (char const* text)
 
 Logs::Logs()
     : level_ (beast::Journal::kWarning) // default severity
+    , bufferLines_ (0)
+    , dropped_ (0)
+    , wake_ (false)
+    , stop_ (false)
+    , flushRequested_ (0)
+    , flushed_ (0)
+    , dropReported_ (0)
 {
 }
 
+Logs::~Logs()
+{
+    async (0);
+}
+
 bool
 Logs::open (boost::filesystem::path const& pathToLogFile)
 {
@@ -172,9 +294,19 @@ void
 Logs::write (beast::Journal::Severity level, std::string const& partition,
     std::string const& text, bool console)
 {
+    if (bufferLines_.load (std::memory_order_relaxed) != 0)
+    {
+        if (level < beast::Journal::kFatal &&
+                enqueue (level, partition, text))
+            return;
+
+        // Keep the fatal line after everything logged before it
+        flush ();
+    }
+
     std::string s;
     format (s, text, level, partition);
-    std::lock_guard <std::mutex> lock (mutex_);
+    std::lock_guard <std::mutex> lock (writeMutex_);
     file_.writeln (s);
     std::cerr << s << '\n';
     //  TODO Fix console output
@@ -182,10 +314,207 @@ Logs::write (beast::Journal::Severity level, std::string const& partition,
     //    out_.write_console(s);
 }
 
+bool
+Logs::enqueue (beast::Journal::Severity level, std::string const& partition,
+    std::string const& text)
+{
+    struct Local
+    {
+        Logs* owner = nullptr;
+        std::shared_ptr <Buffer> buffer;
+    };
+
+    static thread_local Local local;
+
+    if (local.owner != this)
+    {
+        std::lock_guard <std::mutex> lock (buffersMutex_);
+
+        auto const lines = bufferLines_.load ();
+        if (lines == 0)
+            return false;
+
+        local.buffer = std::make_shared <Buffer> (lines);
+        local.owner = this;
+        buffers_.push_back (local.buffer);
+    }
+
+    // async(0) waits for this flag to clear before the last drain, so a
+    // line pushed after it turned writing synchronous is not lost
+    local.buffer->busy (true);
+    if (bufferLines_.load () == 0)
+    {
+        local.buffer->busy (false);
+        return false;
+    }
+
+    auto const queued = local.buffer->push (level, partition, text);
+    local.buffer->busy (false);
+
+    if (queued == 0)
+    {
+        dropped_.fetch_add (1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Don't wait for the timer once the buffer is half full
+    if (queued == local.buffer->capacity () / 2)
+    {
+        wake_.store (true);
+        flushCond_.notify_one ();
+    }
+
+    return true;
+}
+
+void
+Logs::async (std::size_t lines)
+{
+    if (lines != 0)
+    {
+        if (flusher_.joinable ())
+            return;
+
+        stop_ = false;
+        bufferLines_.store (lines);
+        flusher_ = std::thread (&Logs::run, this);
+        return;
+    }
+
+    if (! flusher_.joinable ())
+        return;
+
+    bufferLines_.store (0);
+    {
+        std::lock_guard <std::mutex> lock (flushMutex_);
+        stop_ = true;
+    }
+    flushCond_.notify_all ();
+    flusher_.join ();
+
+    // Threads that saw asynchronous writing still on may have queued
+    // lines after the flusher's last pass
+    {
+        std::lock_guard <std::mutex> lock (buffersMutex_);
+        for (auto const& buffer : buffers_)
+        {
+            while (buffer->busy ())
+                std::this_thread::yield ();
+        }
+    }
+    writeQueued ();
+}
+
+void
+Logs::flush()
+{
+    std::unique_lock <std::mutex> lock (flushMutex_);
+
+    if (! flusher_.joinable ())
+        return;
+
+    auto const request = ++flushRequested_;
+    flushCond_.notify_all ();
+    flushCond_.wait (lock, [&]
+        {
+            return flushed_ >= request || stop_;
+        });
+}
+
+std::uint64_t
+Logs::dropped() const
+{
+    return dropped_.load ();
+}
+
+void
+Logs::run()
+{
+    std::unique_lock <std::mutex> lock (flushMutex_);
+
+    for (;;)
+    {
+        flushCond_.wait_for (lock, std::chrono::milliseconds (100), [this]
+            {
+                return stop_ || flushRequested_ != flushed_ ||
+                    wake_.exchange (false);
+            });
+
+        auto const request = flushRequested_;
+        bool const stop = stop_;
+
+        lock.unlock ();
+        writeQueued ();
+        lock.lock ();
+
+        flushed_ = request;
+        flushCond_.notify_all ();
+
+        if (stop)
+            break;
+    }
+}
+
+void
+Logs::writeQueued()
+{
+    std::vector <std::shared_ptr <Buffer>> buffers;
+    {
+        std::lock_guard <std::mutex> lock (buffersMutex_);
+        buffers = buffers_;
+    }
+
+    std::string line;
+    batch_.clear ();
+
+    for (auto const& buffer : buffers)
+    {
+        buffer->drain ([&](Buffer::Line const& l)
+            {
+                format (line, l.text, l.severity, l.partition, l.when);
+                batch_ += line;
+                batch_ += '\n';
+            });
+    }
+
+    auto const dropped = dropped_.load ();
+    if (dropped != dropReported_)
+    {
+        format (line, std::to_string (dropped - dropReported_) +
+            " lines dropped, the log buffers were full",
+                beast::Journal::kWarning, "Logs");
+        batch_ += line;
+        batch_ += '\n';
+        dropReported_ = dropped;
+    }
+
+    // Forget the buffers of threads that have exited
+    buffers.clear ();
+    {
+        std::lock_guard <std::mutex> lock (buffersMutex_);
+        buffers_.erase (std::remove_if (buffers_.begin (), buffers_.end (),
+            [](std::shared_ptr <Buffer> const& b)
+            {
+                return b.use_count () == 1 && b->empty ();
+            }), buffers_.end ());
+    }
+
+    if (batch_.empty ())
+        return;
+
+    std::lock_guard <std::mutex> lock (writeMutex_);
+    file_.write (batch_);
+    file_.flush ();
+    std::cerr << batch_;
+
+    if (batch_.capacity () > 1024 * 1024)
+        std::string ().swap (batch_);
+}
+
 std::string
 Logs::rotate()
 {
-    std::lock_guard <std::mutex> lock (mutex_);
+    std::lock_guard <std::mutex> lock (writeMutex_);
     bool const wasOpened = file_.closeAndReopen ();
     if (wasOpened)
         return "The log file was closed and reopened.";
@@ -298,10 +627,28 @@ void
 Logs::format (std::string& output, std::string const& message,
     beast::Journal::Severity severity, std::string const& partition)
 {
+    format (output, message, severity, partition, std::time (nullptr));
+}
+
+void
+Logs::format (std::string& output, std::string const& message,
+    beast::Journal::Severity severity, std::string const& partition,
+    std::time_t when)
+{
+    // Rendering the time is costly and it only changes once a second
+    static thread_local std::time_t lastWhen = 0;
+    static thread_local std::string lastTime;
+
+    if (when != lastWhen || lastTime.empty ())
+    {
+        lastTime = boost::posix_time::to_simple_string (
+            boost::posix_time::from_time_t (when));
+        lastWhen = when;
+    }
+
     output.reserve (message.size() + partition.size() + 100);
 
-    output = boost::posix_time::to_simple_string (
-        boost::posix_time::second_clock::universal_time ());
+    output = lastTime;
 
     output += " ";
     if (! partition.empty ())
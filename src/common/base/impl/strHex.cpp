@@ -19,9 +19,104 @@
 
 #include <BeastConfig.h>
 #include <algorithm>
+#include <cstdint>
+#include <string>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SKYWELL_HEX_SSSE3 1
+#include <tmmintrin.h>
+#else
+#define SKYWELL_HEX_SSSE3 0
+#endif
 
 namespace skywell {
 
+namespace {
+
+// Both hex digits of every byte value
+struct HexPairs
+{
+    char pair[256][2];
+
+    HexPairs ()
+    {
+        static char const digits[] = "0123456789ABCDEF";
+
+        for (int i = 0; i < 256; ++i)
+        {
+            pair[i][0] = digits[i >> 4];
+            pair[i][1] = digits[i & 15];
+        }
+    }
+};
+
+void
+encodeHex (char* out, std::uint8_t const* in, std::size_t size)
+{
+    static HexPairs const tab;
+
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        out[2 * i] = tab.pair[in[i]][0];
+        out[2 * i + 1] = tab.pair[in[i]][1];
+    }
+}
+
+#if SKYWELL_HEX_SSSE3
+
+// Looks up the digits of sixteen nibbles at once with pshufb
+__attribute__ ((target ("ssse3")))
+std::size_t
+encodeHexSSSE3 (char* out, std::uint8_t const* in, std::size_t size)
+{
+    __m128i const digits = _mm_setr_epi8 ('0', '1', '2', '3', '4', '5',
+        '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F');
+    __m128i const mask = _mm_set1_epi8 (0x0f);
+
+    std::size_t i = 0;
+
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i const v = _mm_loadu_si128 (
+            reinterpret_cast<__m128i const*> (in + i));
+        __m128i const hi = _mm_shuffle_epi8 (digits,
+            _mm_and_si128 (_mm_srli_epi16 (v, 4), mask));
+        __m128i const lo = _mm_shuffle_epi8 (digits,
+            _mm_and_si128 (v, mask));
+
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (out + 2 * i),
+            _mm_unpacklo_epi8 (hi, lo));
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (out + 2 * i + 16),
+            _mm_unpackhi_epi8 (hi, lo));
+    }
+
+    return i;
+}
+
+#endif
+
+}
+
+void
+appendHex (std::string& out, void const* data, std::size_t size)
+{
+    std::size_t const offset = out.size ();
+    out.resize (offset + 2 * size);
+
+    char* dst = &out[offset];
+    auto src = static_cast<std::uint8_t const*> (data);
+    std::size_t done = 0;
+
+#if SKYWELL_HEX_SSSE3
+    static bool const ssse3 = __builtin_cpu_supports ("ssse3");
+
+    if (ssse3)
+        done = encodeHexSSSE3 (dst, src, size);
+#endif
+
+    encodeHex (dst + 2 * done, src + done, size - done);
+}
+
 int charUnHex (unsigned char c)
 {
     struct HexTab
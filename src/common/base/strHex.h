@@ -25,6 +25,8 @@
 #ifndef SKYWELL_BASICS_STRHEX_H_INCLUDED
 #define SKYWELL_BASICS_STRHEX_H_INCLUDED
 
+#include <cassert>
+#include <cstddef>
 #include <string>
 
 namespace skywell {
@@ -61,6 +63,14 @@ charUnHex (char c)
 }
 /** @} */
 
+/** Append the upper case hex encoding of a buffer to a string.
+
+    Sixteen bytes are encoded at a time on processors with SSSE3, so large
+    blobs (raw transactions and metadata) encode at close to memory speed.
+*/
+void
+appendHex (std::string& out, void const* data, std::size_t size);
+
 // NIKB TODO cleanup this function and reduce the need for the many overloads
 //           it has in various places.
 template<class Iterator>
@@ -0,0 +1,129 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <common/base/DecayingSample.h>
+#include <beast/chrono/manual_clock.h>
+#include <beast/unit_test/suite.h>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace skywell {
+namespace tests {
+
+class DecayingSample_test : public beast::unit_test::suite
+{
+public:
+    using clock_type = beast::manual_clock <std::chrono::steady_clock>;
+
+    // Random adds, reads and clock steps, mostly a few seconds and
+    // sometimes past the point where the value resets. The clock moves
+    // in whole seconds, as the seconds clock the resource manager uses.
+    template <int Window>
+    void
+    testMatches (std::size_t operations, std::uint32_t seed)
+    {
+        std::stringstream ss;
+        ss << "AtomicDecayingSample matches DecayingSample, window " << Window;
+        testcase (ss.str ());
+
+        clock_type clock;
+        clock.set (1000);
+
+        DecayingSample <Window, clock_type> plain (clock.now ());
+        AtomicDecayingSample <Window, clock_type> atomic (clock.now ());
+
+        std::mt19937 rng (seed);
+        std::size_t mismatches = 0;
+
+        for (std::size_t i = 0; i < operations; ++i)
+        {
+            auto const op = rng () % 100;
+
+            if (op < 60)
+            {
+                auto const amount = rng () % 2000;
+                if (plain.add (amount, clock.now ()) !=
+                        atomic.add (amount, clock.now ()))
+                    ++mismatches;
+            }
+            else if (op < 90)
+            {
+                if (plain.value (clock.now ()) != atomic.value (clock.now ()))
+                    ++mismatches;
+            }
+            else if (op < 99)
+            {
+                clock.advance (std::chrono::seconds (rng () % 4));
+            }
+            else
+            {
+                clock.advance (std::chrono::seconds (
+                    rng () % (8 * Window)));
+            }
+        }
+
+        expect (mismatches == 0, std::to_string (mismatches) + " mismatches");
+    }
+
+    void
+    testConcurrentAdds ()
+    {
+        testcase ("concurrent adds");
+
+        clock_type clock;
+        clock.set (1000);
+
+        AtomicDecayingSample <32, clock_type> sample (clock.now ());
+        auto const now = clock.now ();
+
+        int const threads = 8;
+        int const adds = 10000;
+
+        std::vector <std::thread> workers;
+        for (int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back ([&]
+            {
+                for (int i = 0; i < adds; ++i)
+                    sample.add (32, now);
+            });
+        }
+        for (auto& w : workers)
+            w.join ();
+
+        expect (sample.value (now) == threads * adds, "lost updates");
+    }
+
+    void
+    run ()
+    {
+        testMatches <32> (1000000, 1);
+        testMatches <5> (200000, 2);
+        testMatches <1> (200000, 3);
+        testConcurrentAdds ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(DecayingSample,base,skywell);
+
+}
+}
@@ -0,0 +1,151 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <common/base/LatencyHistogram.h>
+#include <beast/unit_test/suite.h>
+#include <cmath>
+#include <string>
+
+namespace skywell {
+namespace tests {
+
+class LatencyHistogram_test : public beast::unit_test::suite
+{
+public:
+    using duration = LatencyHistogram::duration;
+
+    // The bucket holding a value starts at or below it and ends above it
+    bool
+    checkBucket (std::uint64_t value)
+    {
+        int const i = LatencyHistogram::index (value);
+
+        if (value >= LatencyHistogram::upper (i) ||
+            (i > 0 && value < LatencyHistogram::upper (i - 1)))
+        {
+            log << "value " << value << " in bucket " << i;
+            return false;
+        }
+        return true;
+    }
+
+    void
+    testBuckets ()
+    {
+        testcase ("buckets");
+
+        int failures = 0;
+
+        for (std::uint64_t value = 0; value < 100000; ++value)
+        {
+            if (!checkBucket (value))
+                ++failures;
+        }
+
+        // Both sides of every power of two the buckets cover
+        for (int bit = 17; bit < 40; ++bit)
+        {
+            std::uint64_t const power = std::uint64_t (1) << bit;
+            for (std::uint64_t value : {power - 1, power, power + 1,
+                    power + power / 3})
+            {
+                if (!checkBucket (value))
+                    ++failures;
+            }
+        }
+
+        expect (failures == 0, std::to_string (failures) + " failures");
+
+        // A bucket is never wider than an eighth of its lower bound
+        for (int i = 8; i < LatencyHistogram::bucketCount; ++i)
+        {
+            auto const lower = LatencyHistogram::upper (i - 1);
+            auto const width = LatencyHistogram::upper (i) - lower;
+            if (width * 8 > lower)
+                ++failures;
+        }
+        expect (failures == 0, "bucket too wide");
+
+        // Values past the last bucket are counted in it
+        expect (LatencyHistogram::index (std::uint64_t (1) << 50) ==
+            LatencyHistogram::bucketCount - 1);
+        expect (LatencyHistogram::index (~std::uint64_t (0)) ==
+            LatencyHistogram::bucketCount - 1);
+    }
+
+    void
+    testPercentile ()
+    {
+        testcase ("percentile");
+
+        LatencyHistogram h;
+        for (int i = 1; i <= 1000; ++i)
+            h.record (duration (i));
+        expect (h.count () == 1000);
+
+        // Within 12.5% above the exact answer, never below it
+        for (double fraction : {0.001, 0.1, 0.5, 0.9, 0.99, 1.0})
+        {
+            auto const exact = static_cast <duration::rep> (
+                std::ceil (fraction * 1000));
+            auto const p = h.percentile (fraction).count ();
+            expect (p >= exact && p <= exact + exact / 8,
+                std::to_string (fraction) + " gave " + std::to_string (p));
+        }
+
+        // Small values are exact
+        LatencyHistogram small;
+        small.record (duration (3));
+        small.record (duration (5));
+        expect (small.percentile (0.5) == duration (3));
+        expect (small.percentile (1.0) == duration (5));
+
+        // Negative durations count as zero
+        LatencyHistogram negative;
+        negative.record (duration (-7));
+        expect (negative.count () == 1);
+        expect (negative.percentile (1.0) == duration (0));
+    }
+
+    void
+    testEmpty ()
+    {
+        testcase ("empty");
+
+        LatencyHistogram h;
+        expect (h.count () == 0);
+        expect (h.percentile (0.0) == duration::zero ());
+        expect (h.percentile (0.5) == duration::zero ());
+        expect (h.percentile (1.0) == duration::zero ());
+    }
+
+    void
+    run ()
+    {
+        testBuckets ();
+        testPercentile ();
+        testEmpty ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(LatencyHistogram,base,skywell);
+
+}
+}
@@ -0,0 +1,255 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <common/base/Log.h>
+#include <beast/unit_test/suite.h>
+#include <boost/filesystem.hpp>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+namespace skywell {
+namespace tests {
+
+// Logs also writes every line to std::cerr; swallow it while a test runs
+class QuietConsole
+{
+public:
+    QuietConsole ()
+        : saved_ (std::cerr.rdbuf (&null_))
+    {
+    }
+
+    ~QuietConsole ()
+    {
+        std::cerr.rdbuf (saved_);
+    }
+
+private:
+    class NullBuffer : public std::streambuf
+    {
+    protected:
+        int_type
+        overflow (int_type c) override
+        {
+            return traits_type::not_eof (c);
+        }
+
+        std::streamsize
+        xsputn (char const*, std::streamsize n) override
+        {
+            return n;
+        }
+    };
+
+    NullBuffer null_;
+    std::streambuf* saved_;
+};
+
+class TempLogFile
+{
+public:
+    TempLogFile ()
+        : path_ (boost::filesystem::temp_directory_path () /
+            boost::filesystem::unique_path ("logs-%%%%-%%%%.txt"))
+    {
+    }
+
+    ~TempLogFile ()
+    {
+        boost::system::error_code ec;
+        boost::filesystem::remove (path_, ec);
+    }
+
+    boost::filesystem::path const&
+    path () const
+    {
+        return path_;
+    }
+
+    std::size_t
+    lines () const
+    {
+        std::ifstream in (path_.c_str ());
+        std::size_t n = 0;
+        std::string line;
+        while (std::getline (in, line))
+            ++n;
+        return n;
+    }
+
+private:
+    boost::filesystem::path path_;
+};
+
+class Logs_test : public beast::unit_test::suite
+{
+public:
+    // Threads keep logging while asynchronous writing is turned off
+    void
+    testAsyncOff ()
+    {
+        testcase ("async off while logging");
+
+        int const threads = 4;
+        int const lines = 2000;
+
+        TempLogFile file;
+        {
+            QuietConsole quiet;
+            Logs logs;
+            expect (logs.open (file.path ()));
+            logs.async (4 * lines);
+
+            std::atomic <int> written (0);
+            std::vector <std::thread> workers;
+            for (int t = 0; t < threads; ++t)
+            {
+                workers.emplace_back ([&]
+                {
+                    for (int i = 0; i < lines; ++i)
+                    {
+                        logs.write (beast::Journal::kInfo, "Test",
+                            "line " + std::to_string (i), false);
+                        ++written;
+                    }
+                });
+            }
+
+            while (written.load () < threads * lines / 2)
+                std::this_thread::yield ();
+            logs.async (0);
+
+            for (auto& w : workers)
+                w.join ();
+
+            expect (logs.dropped () == 0);
+        }
+
+        expect (file.lines () == threads * lines, "lines were lost");
+    }
+
+    void
+    testFlush ()
+    {
+        testcase ("flush");
+
+        TempLogFile file;
+        QuietConsole quiet;
+        Logs logs;
+        expect (logs.open (file.path ()));
+        logs.async (64);
+
+        for (int i = 0; i < 10; ++i)
+            logs.write (beast::Journal::kInfo, "Test",
+                "line " + std::to_string (i), false);
+
+        logs.flush ();
+        expect (file.lines () == 10);
+
+        logs.async (0);
+    }
+
+    void
+    run ()
+    {
+        testAsyncOff ();
+        testFlush ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(Logs,base,skywell);
+
+//------------------------------------------------------------------------------
+
+// Writes debug lines to a file from 32 threads, synchronously and with
+// asynchronous writing on. Run with
+// --unittest=Logs_bench --unittest-arg=<lines per thread>
+class Logs_bench_test : public beast::unit_test::suite
+{
+public:
+    void
+    run ()
+    {
+        using clock_type = std::chrono::steady_clock;
+
+        int const threads = 32;
+        std::size_t lines = 50000;
+        if (! arg ().empty ())
+            lines = std::stoul (arg ());
+
+        for (std::size_t buffer : {std::size_t (0), std::size_t (65536)})
+        {
+            TempLogFile file;
+            QuietConsole quiet;
+            Logs logs;
+            expect (logs.open (file.path ()));
+            logs.async (buffer);
+
+            auto const start = clock_type::now ();
+
+            std::vector <std::thread> workers;
+            for (int t = 0; t < threads; ++t)
+            {
+                workers.emplace_back ([&, t]
+                {
+                    std::string const text = "Thread " + std::to_string (t) +
+                        " reporting a debug line of typical length, "
+                        "ledger 1234567";
+                    for (std::size_t i = 0; i < lines; ++i)
+                        logs.write (beast::Journal::kDebug, "Bench", text,
+                            false);
+                });
+            }
+            for (auto& w : workers)
+                w.join ();
+
+            auto const logged = clock_type::now () - start;
+            logs.async (0);
+            auto const written = clock_type::now () - start;
+
+            auto const ms = [](clock_type::duration d)
+            {
+                return std::max <long long> (1, std::chrono::duration_cast <
+                    std::chrono::milliseconds> (d).count ());
+            };
+
+            std::size_t const total = threads * lines;
+            std::stringstream ss;
+            ss << (buffer ? "async " : "synchronous ") << threads <<
+                " threads: " << (total * 1000 / ms (logged)) <<
+                " lines/s logged, " << ms (written) << " ms to disk, " <<
+                logs.dropped () << " dropped";
+            log << ss.str ();
+
+            expect (file.lines () + logs.dropped () == total);
+        }
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(Logs_bench,base,skywell);
+
+}
+}
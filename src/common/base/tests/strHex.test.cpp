@@ -0,0 +1,90 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <common/base/strHex.h>
+#include <beast/unit_test/suite.h>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace skywell {
+namespace tests {
+
+class strHex_test : public beast::unit_test::suite
+{
+public:
+    // Every length up to 64 covers zero to four vector blocks, each
+    // followed by every possible scalar tail.
+    void
+    testLengths (std::string const& prefix)
+    {
+        std::mt19937 rng (static_cast<std::uint32_t> (prefix.size ()) + 1);
+        int mismatches = 0;
+
+        for (int size = 0; size <= 64; ++size)
+        {
+            std::vector <unsigned char> data (size);
+            for (auto& c : data)
+                c = static_cast<unsigned char> (rng ());
+
+            std::string out = prefix;
+            appendHex (out, data.data (), data.size ());
+
+            if (out != prefix + strHex (data.begin (), size))
+            {
+                ++mismatches;
+                log << "length " << size << ": " << out;
+            }
+        }
+
+        expect (mismatches == 0, std::to_string (mismatches) + " mismatches");
+    }
+
+    void
+    testAllBytes ()
+    {
+        testcase ("all byte values");
+
+        std::vector <unsigned char> data (256);
+        for (int i = 0; i < 256; ++i)
+            data[i] = static_cast<unsigned char> (i);
+
+        std::string out;
+        appendHex (out, data.data (), data.size ());
+        expect (out == strHex (data.begin (), 256));
+    }
+
+    void
+    run ()
+    {
+        testcase ("empty output");
+        testLengths ("");
+
+        testcase ("after a prefix");
+        testLengths ("ABC:");
+
+        testAllBytes ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(strHex,base,skywell);
+
+}
+}
@@ -109,7 +109,11 @@ template <class>
 void
 body::clear()
 {
-    buf_ = beast::make_unique <buffer_type>();
+    // Keep-alive connections reuse the storage of small bodies
+    if (buf_ && buf_->size() <= 65536)
+        buf_->consume (buf_->size());
+    else
+        buf_ = beast::make_unique <buffer_type>();
 }
 
 inline
@@ -0,0 +1,62 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of Beast: https://github.com/vinniefalco/Beast
+    Copyright 2013, Vinnie Falco <vinnie.falco@gmail.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef BEAST_INSIGHT_PROMETHEUSCOLLECTOR_H_INCLUDED
+#define BEAST_INSIGHT_PROMETHEUSCOLLECTOR_H_INCLUDED
+
+#include <beast/insight/Collector.h>
+
+#include <beast/utility/Journal.h>
+
+namespace beast {
+namespace insight {
+
+/** A Collector that keeps its metrics for a Prometheus server to scrape.
+
+    Counters and meters are split over several cells so that threads
+    updating the same metric rarely touch the same cache line. Gauges and
+    events are plain atomics. Hooks are called once a second on the
+    collector's own thread. A scrape only reads the current values, so
+    its cost does not depend on how often it happens.
+
+    Reference:
+        https://prometheus.io/docs/instrumenting/exposition_formats/
+*/
+class PrometheusCollector : public Collector
+{
+public:
+    /** Create a Prometheus collector.
+        @param prefix A string pre-pended before each metric name.
+        @param journal Destination for logging output.
+    */
+    static
+    std::shared_ptr <PrometheusCollector>
+    New (std::string const& prefix, Journal journal);
+
+    /** Append every metric in the text exposition format, version 0.0.4.
+        Counter and meter names end in _total, and events are reported
+        as histograms of milliseconds.
+    */
+    virtual void write (std::string& text) = 0;
+};
+
+}
+}
+
+#endif
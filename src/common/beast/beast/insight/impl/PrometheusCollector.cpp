@@ -0,0 +1,653 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of Beast: https://github.com/vinniefalco/Beast
+    Copyright 2013, Vinnie Falco <vinnie.falco@gmail.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <beast/intrusive/List.h>
+#include <beast/threads/SharedData.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <beast/insight/PrometheusCollector.h>
+#include <beast/insight/CounterImpl.h>
+#include <beast/insight/EventImpl.h>
+#include <beast/insight/GaugeImpl.h>
+#include <beast/insight/HookImpl.h>
+#include <beast/insight/MeterImpl.h>
+
+namespace beast {
+namespace insight {
+
+namespace detail {
+
+class PrometheusCollectorImp;
+
+//------------------------------------------------------------------------------
+
+// Samples of one metric name, merged across metric objects sharing it
+struct PrometheusFamily
+{
+    char const* type;
+    std::vector <std::pair <std::string, std::int64_t>> samples;
+
+    void add (std::string const& sample, std::int64_t value, bool replace)
+    {
+        for (auto& s : samples)
+        {
+            if (s.first == sample)
+            {
+                s.second = replace ? value : s.second + value;
+                return;
+            }
+        }
+        samples.emplace_back (sample, value);
+    }
+};
+
+typedef std::vector <std::pair <std::string, PrometheusFamily>>
+    PrometheusFamilies;
+
+inline
+PrometheusFamily& family (PrometheusFamilies& families,
+    std::string const& name, char const* type)
+{
+    for (auto& f : families)
+    {
+        if (f.first == name)
+            return f.second;
+    }
+    families.emplace_back (name, PrometheusFamily {type, {}});
+    return families.back ().second;
+}
+
+//------------------------------------------------------------------------------
+
+// A counter split over cells on separate cache lines. Each thread adds to
+// the cell its id hashes to; reading sums the cells.
+class PrometheusCells
+{
+public:
+    PrometheusCells ()
+    {
+        for (auto& cell : m_cells)
+            cell.value.store (0, std::memory_order_relaxed);
+    }
+
+    void add (std::int64_t amount)
+    {
+        m_cells[index ()].value.fetch_add (amount, std::memory_order_relaxed);
+    }
+
+    std::int64_t sum () const
+    {
+        std::int64_t total (0);
+        for (auto const& cell : m_cells)
+            total += cell.value.load (std::memory_order_relaxed);
+        return total;
+    }
+
+private:
+    enum
+    {
+        cellCount = 16,
+        cacheLineSize = 64
+    };
+
+    struct alignas (cacheLineSize) Cell
+    {
+        std::atomic <std::int64_t> value;
+    };
+
+    static std::size_t index ()
+    {
+        static thread_local std::size_t const i (std::hash <std::thread::id> () (
+            std::this_thread::get_id ()) % cellCount);
+        return i;
+    }
+
+    std::array <Cell, cellCount> m_cells;
+};
+
+//------------------------------------------------------------------------------
+
+class PrometheusMetricBase : public List <PrometheusMetricBase>::Node
+{
+public:
+    virtual void do_write (PrometheusFamilies& families) = 0;
+};
+
+//------------------------------------------------------------------------------
+
+class PrometheusHookImpl
+    : public HookImpl
+    , public List <PrometheusHookImpl>::Node
+{
+public:
+    PrometheusHookImpl (HandlerType const& handler,
+        std::shared_ptr <PrometheusCollectorImp> const& impl);
+
+    ~PrometheusHookImpl ();
+
+    void do_process ();
+
+private:
+    PrometheusHookImpl& operator= (PrometheusHookImpl const&);
+
+    std::shared_ptr <PrometheusCollectorImp> m_impl;
+    HandlerType m_handler;
+};
+
+//------------------------------------------------------------------------------
+
+class PrometheusCounterImpl
+    : public CounterImpl
+    , public PrometheusMetricBase
+{
+public:
+    PrometheusCounterImpl (std::string const& name,
+        std::shared_ptr <PrometheusCollectorImp> const& impl);
+
+    ~PrometheusCounterImpl ();
+
+    void increment (CounterImpl::value_type amount);
+
+    void do_write (PrometheusFamilies& families);
+
+private:
+    PrometheusCounterImpl& operator= (PrometheusCounterImpl const&);
+
+    std::shared_ptr <PrometheusCollectorImp> m_impl;
+    std::string m_name;
+    PrometheusCells m_value;
+};
+
+//------------------------------------------------------------------------------
+
+class PrometheusEventImpl
+    : public EventImpl
+    , public PrometheusMetricBase
+{
+public:
+    PrometheusEventImpl (std::string const& name,
+        std::shared_ptr <PrometheusCollectorImp> const& impl);
+
+    ~PrometheusEventImpl ();
+
+    void notify (EventImpl::value_type const& value);
+
+    void do_write (PrometheusFamilies& families);
+
+private:
+    PrometheusEventImpl& operator= (PrometheusEventImpl const&);
+
+    enum
+    {
+        boundCount = 15
+    };
+
+    // Upper bounds of the histogram buckets, in milliseconds
+    static std::array <std::int64_t, boundCount> const bounds;
+
+    std::shared_ptr <PrometheusCollectorImp> m_impl;
+    std::string m_name;
+    std::array <std::atomic <std::int64_t>, boundCount + 1> m_buckets;
+    std::atomic <std::int64_t> m_sum;
+};
+
+//------------------------------------------------------------------------------
+
+class PrometheusGaugeImpl
+    : public GaugeImpl
+    , public PrometheusMetricBase
+{
+public:
+    PrometheusGaugeImpl (std::string const& name,
+        std::shared_ptr <PrometheusCollectorImp> const& impl);
+
+    ~PrometheusGaugeImpl ();
+
+    void set (GaugeImpl::value_type value);
+    void increment (GaugeImpl::difference_type amount);
+
+    void do_write (PrometheusFamilies& families);
+
+private:
+    PrometheusGaugeImpl& operator= (PrometheusGaugeImpl const&);
+
+    std::shared_ptr <PrometheusCollectorImp> m_impl;
+    std::string m_name;
+    std::atomic <GaugeImpl::value_type> m_value;
+};
+
+//------------------------------------------------------------------------------
+
+class PrometheusMeterImpl
+    : public MeterImpl
+    , public PrometheusMetricBase
+{
+public:
+    explicit PrometheusMeterImpl (std::string const& name,
+        std::shared_ptr <PrometheusCollectorImp> const& impl);
+
+    ~PrometheusMeterImpl ();
+
+    void increment (MeterImpl::value_type amount);
+
+    void do_write (PrometheusFamilies& families);
+
+private:
+    PrometheusMeterImpl& operator= (PrometheusMeterImpl const&);
+
+    std::shared_ptr <PrometheusCollectorImp> m_impl;
+    std::string m_name;
+    PrometheusCells m_value;
+};
+
+//------------------------------------------------------------------------------
+
+class PrometheusCollectorImp
+    : public PrometheusCollector
+    , public std::enable_shared_from_this <PrometheusCollectorImp>
+{
+private:
+    struct StateType
+    {
+        List <PrometheusMetricBase> metrics;
+    };
+
+    struct HookStateType
+    {
+        List <PrometheusHookImpl> hooks;
+    };
+
+    typedef SharedData <StateType> State;
+    typedef SharedData <HookStateType> HookState;
+
+    Journal m_journal;
+    std::string m_prefix;
+    State m_state;
+    HookState m_hookState;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_stop;
+
+    // Must come last for order of init
+    std::thread m_thread;
+
+public:
+    PrometheusCollectorImp (std::string const& prefix, Journal journal)
+        : m_journal (journal)
+        , m_prefix (sanitize (prefix))
+        , m_stop (false)
+        , m_thread (&PrometheusCollectorImp::run, this)
+    {
+    }
+
+    ~PrometheusCollectorImp ()
+    {
+        {
+            std::lock_guard <std::mutex> lock (m_mutex);
+            m_stop = true;
+        }
+        m_cond.notify_all ();
+        m_thread.join ();
+    }
+
+    Hook make_hook (HookImpl::HandlerType const& handler)
+    {
+        return Hook (std::make_shared <detail::PrometheusHookImpl> (
+            handler, shared_from_this ()));
+    }
+
+    Counter make_counter (std::string const& name)
+    {
+        return Counter (std::make_shared <detail::PrometheusCounterImpl> (
+            name, shared_from_this ()));
+    }
+
+    Event make_event (std::string const& name)
+    {
+        return Event (std::make_shared <detail::PrometheusEventImpl> (
+            name, shared_from_this ()));
+    }
+
+    Gauge make_gauge (std::string const& name)
+    {
+        return Gauge (std::make_shared <detail::PrometheusGaugeImpl> (
+            name, shared_from_this ()));
+    }
+
+    Meter make_meter (std::string const& name)
+    {
+        return Meter (std::make_shared <detail::PrometheusMeterImpl> (
+            name, shared_from_this ()));
+    }
+
+    //--------------------------------------------------------------------------
+
+    void add (PrometheusMetricBase& metric)
+    {
+        State::Access state (m_state);
+        state->metrics.push_back (metric);
+    }
+
+    void remove (PrometheusMetricBase& metric)
+    {
+        State::Access state (m_state);
+        state->metrics.erase (state->metrics.iterator_to (metric));
+    }
+
+    void add (PrometheusHookImpl& hook)
+    {
+        HookState::Access state (m_hookState);
+        state->hooks.push_back (hook);
+    }
+
+    void remove (PrometheusHookImpl& hook)
+    {
+        HookState::Access state (m_hookState);
+        state->hooks.erase (state->hooks.iterator_to (hook));
+    }
+
+    //--------------------------------------------------------------------------
+
+    // Metric names may only hold letters, digits, underscores and colons
+    static std::string sanitize (std::string name)
+    {
+        for (auto& c : name)
+        {
+            if (! ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                    (c >= '0' && c <= '9') || c == '_' || c == ':'))
+                c = '_';
+        }
+        if (! name.empty () && name[0] >= '0' && name[0] <= '9')
+            name.insert (name.begin (), '_');
+        return name;
+    }
+
+    std::string name (std::string const& metric) const
+    {
+        if (m_prefix.empty ())
+            return sanitize (metric);
+        return m_prefix + "_" + sanitize (metric);
+    }
+
+    // Counters end in _total, as the exposition format asks
+    std::string counterName (std::string const& metric) const
+    {
+        std::string result (name (metric));
+        std::string const suffix ("_total");
+        if (result.size () < suffix.size () || result.compare (
+                result.size () - suffix.size (), suffix.size (), suffix) != 0)
+            result += suffix;
+        return result;
+    }
+
+    void write (std::string& text)
+    {
+        PrometheusFamilies families;
+        {
+            State::Access state (m_state);
+            for (auto& metric : state->metrics)
+                metric.do_write (families);
+        }
+
+        std::sort (families.begin (), families.end (),
+            [](PrometheusFamilies::value_type const& lhs,
+               PrometheusFamilies::value_type const& rhs)
+            {
+                return lhs.first < rhs.first;
+            });
+
+        for (auto const& f : families)
+        {
+            text += "# TYPE ";
+            text += f.first;
+            text += ' ';
+            text += f.second.type;
+            text += '\n';
+
+            for (auto const& sample : f.second.samples)
+            {
+                text += sample.first;
+                text += ' ';
+                text += std::to_string (sample.second);
+                text += '\n';
+            }
+        }
+    }
+
+    // Call the hooks once a second, like StatsDCollector, so that scraping
+    // costs nothing more than reading the values
+    void run ()
+    {
+        std::unique_lock <std::mutex> lock (m_mutex);
+
+        while (! m_cond.wait_for (lock, std::chrono::seconds (1),
+            [this] { return m_stop; }))
+        {
+            lock.unlock ();
+            {
+                HookState::Access state (m_hookState);
+                for (auto& hook : state->hooks)
+                    hook.do_process ();
+            }
+            lock.lock ();
+        }
+    }
+};
+
+//------------------------------------------------------------------------------
+
+PrometheusHookImpl::PrometheusHookImpl (HandlerType const& handler,
+    std::shared_ptr <PrometheusCollectorImp> const& impl)
+    : m_impl (impl)
+    , m_handler (handler)
+{
+    m_impl->add (*this);
+}
+
+PrometheusHookImpl::~PrometheusHookImpl ()
+{
+    m_impl->remove (*this);
+}
+
+void PrometheusHookImpl::do_process ()
+{
+    m_handler ();
+}
+
+//------------------------------------------------------------------------------
+
+PrometheusCounterImpl::PrometheusCounterImpl (std::string const& name,
+    std::shared_ptr <PrometheusCollectorImp> const& impl)
+    : m_impl (impl)
+    , m_name (impl->counterName (name))
+{
+    m_impl->add (*this);
+}
+
+PrometheusCounterImpl::~PrometheusCounterImpl ()
+{
+    m_impl->remove (*this);
+}
+
+void PrometheusCounterImpl::increment (CounterImpl::value_type amount)
+{
+    m_value.add (amount);
+}
+
+void PrometheusCounterImpl::do_write (PrometheusFamilies& families)
+{
+    family (families, m_name, "counter").add (m_name, m_value.sum (), false);
+}
+
+//------------------------------------------------------------------------------
+
+std::array <std::int64_t, PrometheusEventImpl::boundCount> const
+    PrometheusEventImpl::bounds = {{
+    1, 2, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000, 60000 }};
+
+PrometheusEventImpl::PrometheusEventImpl (std::string const& name,
+    std::shared_ptr <PrometheusCollectorImp> const& impl)
+    : m_impl (impl)
+    , m_name (impl->name (name))
+    , m_sum (0)
+{
+    for (auto& bucket : m_buckets)
+        bucket.store (0, std::memory_order_relaxed);
+
+    m_impl->add (*this);
+}
+
+PrometheusEventImpl::~PrometheusEventImpl ()
+{
+    m_impl->remove (*this);
+}
+
+void PrometheusEventImpl::notify (EventImpl::value_type const& value)
+{
+    std::int64_t const ms (value.count ());
+    auto const iter (std::lower_bound (bounds.begin (), bounds.end (), ms));
+
+    m_buckets[iter - bounds.begin ()].fetch_add (1, std::memory_order_relaxed);
+    m_sum.fetch_add (ms, std::memory_order_relaxed);
+}
+
+void PrometheusEventImpl::do_write (PrometheusFamilies& families)
+{
+    PrometheusFamily& f (family (families, m_name, "histogram"));
+
+    // Buckets are reported cumulatively
+    std::int64_t count (0);
+    for (std::size_t i = 0; i < m_buckets.size (); ++i)
+    {
+        count += m_buckets[i].load (std::memory_order_relaxed);
+        std::string const le ((i < bounds.size ())
+            ? std::to_string (bounds[i]) : std::string ("+Inf"));
+        f.add (m_name + "_bucket{le=\"" + le + "\"}", count, false);
+    }
+
+    f.add (m_name + "_sum", m_sum.load (std::memory_order_relaxed), false);
+    f.add (m_name + "_count", count, false);
+}
+
+//------------------------------------------------------------------------------
+
+PrometheusGaugeImpl::PrometheusGaugeImpl (std::string const& name,
+    std::shared_ptr <PrometheusCollectorImp> const& impl)
+    : m_impl (impl)
+    , m_name (impl->name (name))
+    , m_value (0)
+{
+    m_impl->add (*this);
+}
+
+PrometheusGaugeImpl::~PrometheusGaugeImpl ()
+{
+    m_impl->remove (*this);
+}
+
+void PrometheusGaugeImpl::set (GaugeImpl::value_type value)
+{
+    m_value.store (value, std::memory_order_relaxed);
+}
+
+void PrometheusGaugeImpl::increment (GaugeImpl::difference_type amount)
+{
+    // Saturate at zero and the maximum, as StatsDGaugeImpl does
+    GaugeImpl::value_type value (m_value.load (std::memory_order_relaxed));
+    GaugeImpl::value_type next;
+    do
+    {
+        next = value;
+        if (amount > 0)
+        {
+            GaugeImpl::value_type const d (
+                static_cast <GaugeImpl::value_type> (amount));
+            GaugeImpl::value_type const room (
+                std::numeric_limits <GaugeImpl::value_type>::max () - value);
+            next += (d >= room) ? room : d;
+        }
+        else if (amount < 0)
+        {
+            GaugeImpl::value_type const d (
+                static_cast <GaugeImpl::value_type> (-amount));
+            next = (d >= value) ? 0 : value - d;
+        }
+    }
+    while (! m_value.compare_exchange_weak (value, next,
+        std::memory_order_relaxed));
+}
+
+void PrometheusGaugeImpl::do_write (PrometheusFamilies& families)
+{
+    // Samples are signed, so a gauge past the largest one is reported as it
+    GaugeImpl::value_type const value (std::min <GaugeImpl::value_type> (
+        m_value.load (std::memory_order_relaxed),
+        std::numeric_limits <std::int64_t>::max ()));
+
+    family (families, m_name, "gauge").add (m_name,
+        static_cast <std::int64_t> (value), true);
+}
+
+//------------------------------------------------------------------------------
+
+PrometheusMeterImpl::PrometheusMeterImpl (std::string const& name,
+    std::shared_ptr <PrometheusCollectorImp> const& impl)
+    : m_impl (impl)
+    , m_name (impl->counterName (name))
+{
+    m_impl->add (*this);
+}
+
+PrometheusMeterImpl::~PrometheusMeterImpl ()
+{
+    m_impl->remove (*this);
+}
+
+void PrometheusMeterImpl::increment (MeterImpl::value_type amount)
+{
+    m_value.add (static_cast <std::int64_t> (amount));
+}
+
+void PrometheusMeterImpl::do_write (PrometheusFamilies& families)
+{
+    family (families, m_name, "counter").add (m_name, m_value.sum (), false);
+}
+
+}
+
+//------------------------------------------------------------------------------
+
+std::shared_ptr <PrometheusCollector> PrometheusCollector::New (
+    std::string const& prefix, Journal journal)
+{
+    return std::make_shared <detail::PrometheusCollectorImp> (
+        prefix, journal);
+}
+
+}
+}
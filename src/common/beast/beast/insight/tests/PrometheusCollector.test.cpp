@@ -0,0 +1,176 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of Beast: https://github.com/vinniefalco/Beast
+    Copyright 2013, Vinnie Falco <vinnie.falco@gmail.com>
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <beast/insight/PrometheusCollector.h>
+#include <beast/insight/Counter.h>
+#include <beast/insight/Event.h>
+#include <beast/insight/Gauge.h>
+#include <beast/insight/Meter.h>
+#include <beast/unit_test/suite.h>
+#include <limits>
+#include <string>
+
+namespace beast {
+namespace insight {
+
+class PrometheusCollector_test : public unit_test::suite
+{
+public:
+    std::string
+    scrape (std::shared_ptr <PrometheusCollector> const& collector)
+    {
+        std::string text;
+        collector->write (text);
+        return text;
+    }
+
+    bool
+    contains (std::string const& text, std::string const& line)
+    {
+        if (text.find (line + "\n") != std::string::npos)
+            return true;
+        log << "missing: " << line;
+        return false;
+    }
+
+    void
+    testExposition ()
+    {
+        testcase ("exposition");
+
+        auto const collector = PrometheusCollector::New ("skywell", Journal ());
+
+        {
+            Counter accepted (collector->make_counter ("ledger.accepted"));
+            Counter again (collector->make_counter ("ledger.accepted"));
+            Counter requests (collector->make_counter ("rpc_total"));
+            Meter bytes (collector->make_meter ("peer.bytes-in"));
+            Gauge jobs (collector->make_gauge ("jobs"));
+            Event close (collector->make_event ("close"));
+
+            accepted.increment (3);
+            again.increment (4);
+            ++requests;
+            bytes.increment (100);
+            jobs.set (12);
+            close.notify (std::chrono::milliseconds (3));
+            close.notify (std::chrono::milliseconds (70));
+            close.notify (std::chrono::milliseconds (100000));
+
+            // Families are sorted by name, buckets are cumulative, and
+            // metrics sharing a name are merged
+            std::string const expected =
+                "# TYPE skywell_close histogram\n"
+                "skywell_close_bucket{le=\"1\"} 0\n"
+                "skywell_close_bucket{le=\"2\"} 0\n"
+                "skywell_close_bucket{le=\"5\"} 1\n"
+                "skywell_close_bucket{le=\"10\"} 1\n"
+                "skywell_close_bucket{le=\"25\"} 1\n"
+                "skywell_close_bucket{le=\"50\"} 1\n"
+                "skywell_close_bucket{le=\"100\"} 2\n"
+                "skywell_close_bucket{le=\"250\"} 2\n"
+                "skywell_close_bucket{le=\"500\"} 2\n"
+                "skywell_close_bucket{le=\"1000\"} 2\n"
+                "skywell_close_bucket{le=\"2500\"} 2\n"
+                "skywell_close_bucket{le=\"5000\"} 2\n"
+                "skywell_close_bucket{le=\"10000\"} 2\n"
+                "skywell_close_bucket{le=\"30000\"} 2\n"
+                "skywell_close_bucket{le=\"60000\"} 2\n"
+                "skywell_close_bucket{le=\"+Inf\"} 3\n"
+                "skywell_close_sum 100073\n"
+                "skywell_close_count 3\n"
+                "# TYPE skywell_jobs gauge\n"
+                "skywell_jobs 12\n"
+                "# TYPE skywell_ledger_accepted_total counter\n"
+                "skywell_ledger_accepted_total 7\n"
+                "# TYPE skywell_peer_bytes_in_total counter\n"
+                "skywell_peer_bytes_in_total 100\n"
+                "# TYPE skywell_rpc_total counter\n"
+                "skywell_rpc_total 1\n";
+
+            std::string const text (scrape (collector));
+            expect (text == expected);
+            if (text != expected)
+                log << text;
+        }
+
+        // Metrics that are gone are no longer written
+        expect (scrape (collector).empty ());
+    }
+
+    void
+    testNames ()
+    {
+        testcase ("names");
+
+        auto const collector = PrometheusCollector::New ("9 lives", Journal ());
+        Counter counter (collector->make_counter ("a.b-c/d"));
+        Gauge gauge (collector->make_gauge ("x:y z"));
+
+        auto const text (scrape (collector));
+        expect (contains (text, "# TYPE _9_lives_a_b_c_d_total counter"));
+        expect (contains (text, "_9_lives_a_b_c_d_total 0"));
+        expect (contains (text, "# TYPE _9_lives_x:y_z gauge"));
+
+        // Without a prefix the metric name itself is checked
+        auto const bare = PrometheusCollector::New ("", Journal ());
+        Counter leading (bare->make_counter ("2xx"));
+        Meter total (bare->make_meter ("bytes_total"));
+        auto const bareText (scrape (bare));
+        expect (contains (bareText, "_2xx_total 0"));
+        expect (contains (bareText, "# TYPE bytes_total counter"));
+        expect (bareText.find ("_total_total") == std::string::npos);
+    }
+
+    void
+    testGaugeSaturation ()
+    {
+        testcase ("gauge saturation");
+
+        auto const collector = PrometheusCollector::New ("", Journal ());
+        Gauge gauge (collector->make_gauge ("g"));
+
+        gauge.set (5);
+        gauge.increment (-10);
+        expect (contains (scrape (collector), "g 0"));
+
+        gauge.set (std::numeric_limits <std::uint64_t>::max () - 1);
+        gauge.increment (10);
+        expect (contains (scrape (collector), "g " + std::to_string (
+            std::numeric_limits <std::int64_t>::max ())));
+
+        gauge.set (7);
+        gauge += 3;
+        --gauge;
+        expect (contains (scrape (collector), "g 9"));
+    }
+
+    void
+    run ()
+    {
+        testExposition ();
+        testNames ();
+        testGaugeSaturation ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(PrometheusCollector,insight,beast);
+
+}
+}
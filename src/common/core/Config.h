@@ -64,6 +64,7 @@ enum SizedItemName
     siSLECacheAge,
     siLedgerSize,
     siLedgerAge,
+    siLedgerMemory,     // Megabytes of tree nodes held only by old ledgers
     siLedgerFetch,
     siHashNodeDBCache,
     siTxnDBCache,
@@ -116,15 +117,23 @@ public:
     /** Returns the full path and filename of the entropy seed file. */
     boost::filesystem::path getEntropyFile () const;
 
+    /** Returns the directory ledger_snapshot writes to, empty if unset. */
+    boost::filesystem::path getLedgerSnapshotDir () const;
+
     // DEPRECATED
     boost::filesystem::path CONFIG_FILE; // used by UniqueNodeList
 private:
     boost::filesystem::path CONFIG_DIR;
     boost::filesystem::path DEBUG_LOGFILE;
+    boost::filesystem::path LEDGER_SNAPSHOT_DIR;
 
     void load ();
 public:
 
+    // Lines each thread may queue for the log writer thread, zero to write
+    // every line as it is logged
+    std::size_t                 DEBUG_LOG_ASYNC;
+
     //--------------------------------------------------------------------------
 
     // Settings related to validators
@@ -201,6 +210,11 @@ public:
     */
     bool                        RUN_STANDALONE;
 
+    /** Open no listening ports. Used by offline tools such as
+        --replay_bench, which need a set up Application but no server.
+    */
+    bool                        NO_LISTEN;
+
     // Note: The following parameters do not relate to the UNL or trust at all
     std::size_t                 NETWORK_QUORUM;         // Minimum number of nodes to consider the network present
     int                         VALIDATION_QUORUM;      // Minimum validations to consider ledger authoritative
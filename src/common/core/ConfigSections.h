@@ -30,6 +30,7 @@ struct ConfigSection
     static std::string nodeDatabase ()       { return "node_db"; }
     static std::string tempNodeDatabase ()   { return "temp_db"; }
     static std::string importNodeDatabase () { return "import_db"; }
+    static std::string accountHistory ()     { return "account_history"; }
 };
 
 //  TODO Rename and replace these macros with variables.
@@ -37,6 +38,7 @@ struct ConfigSection
 #define SECTION_AMENDMENTS              "amendments"
 #define SECTION_CLUSTER_NODES           "cluster_nodes"
 #define SECTION_DEBUG_LOGFILE           "debug_logfile"
+#define SECTION_DEBUG_LOG_ASYNC         "debug_log_async"
 #define SECTION_ELB_SUPPORT             "elb_support"
 #define SECTION_FEE_DEFAULT             "fee_default"
 #define SECTION_FEE_ACCOUNTID             "fee_accountid"
@@ -48,6 +50,7 @@ struct ConfigSection
 #define SECTION_FEE_OWNER_RESERVE       "fee_owner_reserve"
 #define SECTION_FETCH_DEPTH             "fetch_depth"
 #define SECTION_LEDGER_HISTORY          "ledger_history"
+#define SECTION_LEDGER_SNAPSHOT_DIR     "ledger_snapshot_dir"
 #define SECTION_INSIGHT                 "insight"
 #define SECTION_IPS                     "ips"
 #define SECTION_IPS_FIXED               "ips_fixed"
@@ -37,7 +37,9 @@ enum JobType
     // earlier jobs having lower priority than later jobs. If you wish to
     // insert a job at a specific priority, simply add it at the right location.
 
+    jtPACK_PREPARE,  // Build a fetch pack step ahead of requests
     jtPACK,          // Make a fetch pack for a peer
+    jtPACK_BRANCH,   // Walk a branch of a fetch pack step
     jtPUBOLDLEDGER,  // An old ledger has been accepted
     jtVALIDATION_ut, // A validation from an untrusted source
     jtTRANSACTION_l, // A local transaction
@@ -21,6 +21,7 @@
 #define SKYWELL_CORE_JOBTYPEDATA_H_INCLUDED
 
 #include <common/core/JobTypeInfo.h>
+#include <common/base/LatencyHistogram.h>
 
 namespace skywell
 {
@@ -46,10 +47,22 @@ public:
     /* And the number we deferred executing because of job limits */
     int deferred;
 
+    /* The number of jobs ever deferred */
+    std::uint64_t deferredTotal;
+
+    /* Time from being queued to starting, and time spent running */
+    LatencyHistogram queueTime;
+    LatencyHistogram runTime;
+
     /* Notification callbacks */
     beast::insight::Event dequeue;
     beast::insight::Event execute;
 
+    /* Sampled once a second by JobQueue::collect */
+    beast::insight::Gauge waitingGauge;
+    beast::insight::Gauge runningGauge;
+    beast::insight::Gauge deferredGauge;
+
     explicit JobTypeData (JobTypeInfo const& info_,
             beast::insight::Collector::ptr const& collector) noexcept
         : m_collector (collector)
@@ -57,6 +70,7 @@ public:
         , waiting (0)
         , running (0)
         , deferred (0)
+        , deferredTotal (0)
     {
         m_load.setTargetLatency (
             info.getAverageLatency (),
@@ -66,6 +80,9 @@ public:
         {
             dequeue = m_collector->make_event (info.name () + "_q");
             execute = m_collector->make_event (info.name ());
+            waitingGauge = m_collector->make_gauge (info.name () + "_waiting");
+            runningGauge = m_collector->make_gauge (info.name () + "_running");
+            deferredGauge = m_collector->make_gauge (info.name () + "_deferred");
         }
     }
 
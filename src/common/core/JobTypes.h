@@ -38,10 +38,18 @@ public:
     {
         int maxLimit = std::numeric_limits <int>::max ();
 
+        // Build a fetch pack step ahead of requests
+        add (jtPACK_PREPARE,  "prepareFetchPack",
+            1,        true,   false, 0,     0);
+
         // Make a fetch pack for a peer
         add (jtPACK,          "makeFetchPack",
             1,        true,   false, 0,     0);
 
+        // Walk a branch of a fetch pack step
+        add (jtPACK_BRANCH,   "fetchPackBranch",
+            3,        true,   false, 0,     0);
+
         // An old ledger has been accepted
         add (jtPUBOLDLEDGER,  "publishAcqLedger",
             2,        true,   false, 10000, 15000);
@@ -239,12 +239,15 @@ Config::Config ()
 
     ACCOUNT_PROBE_MAX       = 10;
 
+    DEBUG_LOG_ASYNC         = 0;
+
     VALIDATORS_SITE         = "";
 
     SSL_VERIFY              = true;
 
     ELB_SUPPORT             = false;
     RUN_STANDALONE          = false;
+    NO_LISTEN               = false;
     doImport                = false;
     START_UP                = NORMAL;
 }
@@ -581,6 +584,12 @@ void Config::loadFromString (std::string const& fileContents)
 
     if (getSingleSection (secConfig, SECTION_DEBUG_LOGFILE, strTemp))
         DEBUG_LOGFILE       = strTemp;
+
+    if (getSingleSection (secConfig, SECTION_LEDGER_SNAPSHOT_DIR, strTemp))
+        LEDGER_SNAPSHOT_DIR = strTemp;
+
+    if (getSingleSection (secConfig, SECTION_DEBUG_LOG_ASYNC, strTemp))
+        DEBUG_LOG_ASYNC     = boost::lexical_cast<std::size_t> (strTemp);
 }
 
 int Config::getSize (SizedItemName item) const
@@ -606,6 +615,7 @@ int Config::getSize (SizedItemName item) const
 
         { siLedgerSize,         {   32,     128,    256,    384,        768     } },
         { siLedgerAge,          {   30,     90,     180,    240,        900     } },
+        { siLedgerMemory,       {   32,     128,    256,    512,        1024    } },
 
         { siHashNodeDBCache,    {   4,      12,     24,     64,         128      } },
         { siTxnDBCache,         {   4,      12,     24,     64,         128      } },
@@ -622,6 +632,17 @@ int Config::getSize (SizedItemName item) const
     return -1;
 }
 
+boost::filesystem::path Config::getLedgerSnapshotDir () const
+{
+    auto dir = LEDGER_SNAPSHOT_DIR;
+
+    // Relative to the config file directory, like the debug log
+    if (!dir.empty () && !dir.is_absolute ())
+        dir = boost::filesystem::absolute (dir, CONFIG_DIR);
+
+    return dir;
+}
+
 boost::filesystem::path Config::getDebugLogFile () const
 {
     auto log_file = DEBUG_LOGFILE;
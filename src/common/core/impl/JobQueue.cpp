@@ -114,6 +114,17 @@ public:
     {
         ScopedLock lock (m_mutex);
         job_count = m_jobSet.size ();
+
+        for (auto& x : m_jobData)
+        {
+            JobTypeData& data (x.second);
+            if (data.info.special ())
+                continue;
+
+            data.waitingGauge = data.waiting;
+            data.runningGauge = data.running;
+            data.deferredGauge = data.deferred;
+        }
     }
 
     void addJob (JobType type, std::string const& name,
@@ -309,7 +320,8 @@ public:
             int running (data.running);
 
             if ((stats.count != 0) || (waiting != 0) ||
-                (stats.latencyPeak != 0) || (running != 0))
+                (stats.latencyPeak != 0) || (running != 0) ||
+                (data.runTime.count () != 0))
             {
                 Json::Value& pri = priorities.append (Json::objectValue);
 
@@ -332,6 +344,19 @@ public:
 
                 if (running != 0)
                     pri["in_progress"] = running;
+
+                if (data.deferred != 0)
+                    pri["deferred"] = data.deferred;
+
+                if (data.deferredTotal != 0)
+                    pri["deferred_total"] = static_cast<Json::UInt> (
+                        data.deferredTotal);
+
+                if (data.runTime.count () != 0)
+                {
+                    pri["queue_ms"] = getHistogramJson (data.queueTime);
+                    pri["run_ms"] = getHistogramJson (data.runTime);
+                }
             }
         }
 
@@ -340,6 +365,21 @@ public:
         return ret;
     }
 
+    static Json::Value getHistogramJson (LatencyHistogram const& h)
+    {
+        auto ms = [](LatencyHistogram::duration d)
+        {
+            return d.count () / 1000.0;
+        };
+
+        Json::Value ret (Json::objectValue);
+        ret["count"] = static_cast<Json::UInt> (h.count ());
+        ret["p50"] = ms (h.percentile (0.50));
+        ret["p90"] = ms (h.percentile (0.90));
+        ret["p99"] = ms (h.percentile (0.99));
+        return ret;
+    }
+
     Job* getJobForThread (std::thread::id const& id) const override
     {
         auto tid = (id == std::thread::id()) ? std::this_thread::get_id() : id;
@@ -419,6 +459,7 @@ private:
             // defer the task until we go below the limit
             //
             ++data.deferred;
+            ++data.deferredTotal;
         }
         ++data.waiting;
     }
@@ -521,23 +562,29 @@ private:
 
     //--------------------------------------------------------------------------
     template <class Rep, class Period>
-    void on_dequeue (JobType type,
+    void on_dequeue (JobTypeData& data,
         std::chrono::duration <Rep, Period> const& value)
     {
+        data.queueTime.record (std::chrono::duration_cast <
+            LatencyHistogram::duration> (value));
+
         auto const ms (ceil <std::chrono::milliseconds> (value));
 
         if (ms.count() >= 10)
-            getJobTypeData (type).dequeue.notify (ms);
+            data.dequeue.notify (ms);
     }
 
     template <class Rep, class Period>
-    void on_execute (JobType type,
+    void on_execute (JobTypeData& data,
         std::chrono::duration <Rep, Period> const& value)
     {
+        data.runTime.record (std::chrono::duration_cast <
+            LatencyHistogram::duration> (value));
+
         auto const ms (ceil <std::chrono::milliseconds> (value));
 
         if (ms.count() >= 10)
-            getJobTypeData (type).execute.notify (ms);
+            data.execute.notify (ms);
     }
 
     //--------------------------------------------------------------------------
@@ -577,9 +624,9 @@ private:
             Job::clock_type::time_point const start_time (
                 Job::clock_type::now());
 
-            on_dequeue (job.getType (), start_time - job.queue_time ());
+            on_dequeue (data, start_time - job.queue_time ());
             job.doJob ();
-            on_execute (job.getType (), Job::clock_type::now() - start_time);
+            on_execute (data, Job::clock_type::now() - start_time);
         }
         else
         {
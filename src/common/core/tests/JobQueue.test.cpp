@@ -0,0 +1,257 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <common/core/JobQueue.h>
+#include <beast/insight/GaugeImpl.h>
+#include <beast/insight/HookImpl.h>
+#include <beast/insight/NullCollector.h>
+#include <beast/unit_test/suite.h>
+#include <chrono>
+#include <future>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace skywell {
+namespace tests {
+
+// Keeps the last value of each gauge, and calls the hooks on demand
+class TestCollector : public beast::insight::Collector
+{
+public:
+    class GaugeImpl : public beast::insight::GaugeImpl
+    {
+    public:
+        std::atomic <value_type> value {0};
+
+        void set (value_type v) override { value = v; }
+        void increment (difference_type amount) override { value += amount; }
+    };
+
+    class HookImpl : public beast::insight::HookImpl
+    {
+    public:
+        explicit HookImpl (HandlerType const& handler)
+            : handler (handler)
+        {
+        }
+
+        HandlerType const handler;
+    };
+
+    beast::insight::Hook
+    make_hook (beast::insight::HookImpl::HandlerType const& handler) override
+    {
+        auto const hook = std::make_shared <HookImpl> (handler);
+        std::lock_guard <std::mutex> lock (mutex_);
+        hooks_.push_back (hook);
+        return beast::insight::Hook (hook);
+    }
+
+    beast::insight::Counter
+    make_counter (std::string const& name) override
+    {
+        return null_->make_counter (name);
+    }
+
+    beast::insight::Event
+    make_event (std::string const& name) override
+    {
+        return null_->make_event (name);
+    }
+
+    beast::insight::Gauge
+    make_gauge (std::string const& name) override
+    {
+        auto const gauge = std::make_shared <GaugeImpl> ();
+        std::lock_guard <std::mutex> lock (mutex_);
+        gauges_[name] = gauge;
+        return beast::insight::Gauge (gauge);
+    }
+
+    beast::insight::Meter
+    make_meter (std::string const& name) override
+    {
+        return null_->make_meter (name);
+    }
+
+    // What a collector does once a second
+    void
+    collect ()
+    {
+        std::vector <std::shared_ptr <HookImpl>> hooks;
+        {
+            std::lock_guard <std::mutex> lock (mutex_);
+            for (auto const& hook : hooks_)
+                if (auto const p = hook.lock ())
+                    hooks.push_back (p);
+        }
+
+        for (auto const& hook : hooks)
+            hook->handler ();
+    }
+
+    std::uint64_t
+    gauge (std::string const& name)
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        auto const iter = gauges_.find (name);
+        return (iter == gauges_.end ()) ? 0 : iter->second->value.load ();
+    }
+
+private:
+    beast::insight::Collector::ptr const null_ =
+        beast::insight::NullCollector::New ();
+    std::mutex mutex_;
+    std::map <std::string, std::shared_ptr <GaugeImpl>> gauges_;
+    std::vector <std::weak_ptr <HookImpl>> hooks_;
+};
+
+class JobQueue_test : public beast::unit_test::suite
+{
+public:
+    static Json::Value
+    jobType (JobQueue& jobQueue, std::string const& name)
+    {
+        Json::Value const json = jobQueue.getJson ();
+
+        for (auto const& pri : json["job_types"])
+            if (pri["job_type"].asString () == name)
+                return pri;
+        return Json::Value ();
+    }
+
+    // Waits until no job of the type is waiting or running
+    bool
+    drain (JobQueue& jobQueue, JobType type)
+    {
+        auto const end = std::chrono::steady_clock::now () +
+            std::chrono::seconds (10);
+
+        while (jobQueue.getJobCountTotal (type) != 0)
+        {
+            if (std::chrono::steady_clock::now () > end)
+                return false;
+            std::this_thread::sleep_for (std::chrono::milliseconds (1));
+        }
+
+        return true;
+    }
+
+    // fetch packs are made one at a time, so the second and third
+    // jobs are deferred until the first finishes
+    void
+    testMetrics ()
+    {
+        testcase ("metrics");
+
+        auto const collector = std::make_shared <TestCollector> ();
+        beast::RootStoppable root ("root");
+        auto const jobQueue = make_JobQueue (collector, root, beast::Journal ());
+        jobQueue->setThreadCount (2, false);
+        root.start ();
+
+        std::promise <void> started;
+        std::promise <void> gate;
+        std::shared_future <void> const open = gate.get_future ().share ();
+
+        jobQueue->addJob (jtPACK, "first", [&] (Job&)
+            {
+                started.set_value ();
+                open.wait ();
+            });
+
+        for (auto name : {"second", "third"})
+            jobQueue->addJob (jtPACK, name, [] (Job&) { });
+
+        started.get_future ().wait ();
+
+        collector->collect ();
+        expect (collector->gauge ("makeFetchPack_running") == 1,
+            "running gauge");
+        expect (collector->gauge ("makeFetchPack_waiting") == 2,
+            "waiting gauge");
+        expect (collector->gauge ("makeFetchPack_deferred") == 2,
+            "deferred gauge");
+        expect (collector->gauge ("job_count") == 2, "job count gauge");
+
+        {
+            auto const pri = jobType (*jobQueue, "makeFetchPack");
+            expect (pri["deferred"].asInt () == 2, "deferred");
+            expect (pri["deferred_total"].asUInt () == 2, "deferred total");
+            expect (! pri.isMember ("run_ms"), "run time before a job ran");
+        }
+
+        std::this_thread::sleep_for (std::chrono::milliseconds (20));
+        gate.set_value ();
+
+        expect (drain (*jobQueue, jtPACK), "jobs did not finish");
+
+        collector->collect ();
+        expect (collector->gauge ("makeFetchPack_running") == 0,
+            "running gauge after");
+        expect (collector->gauge ("makeFetchPack_waiting") == 0,
+            "waiting gauge after");
+        expect (collector->gauge ("makeFetchPack_deferred") == 0,
+            "deferred gauge after");
+
+        {
+            auto const pri = jobType (*jobQueue, "makeFetchPack");
+            expect (! pri.isMember ("deferred"), "deferred after");
+            expect (pri["deferred_total"].asUInt () == 2,
+                "deferred total after");
+
+            // The first job ran for 20ms and the others waited for it;
+            // percentiles are within 12.5%
+            expect (pri["run_ms"]["count"].asUInt () == 3, "run count");
+            expect (pri["queue_ms"]["count"].asUInt () == 3, "queue count");
+            expect (pri["run_ms"]["p99"].asDouble () >= 17.5, "run time");
+            expect (pri["queue_ms"]["p99"].asDouble () >= 17.5,
+                "queue time");
+        }
+
+        // A type with no limit is never deferred
+        for (int i = 0; i < 10; ++i)
+            jobQueue->addJob (jtADMIN, "admin", [] (Job&) { });
+
+        expect (drain (*jobQueue, jtADMIN), "admin jobs did not finish");
+
+        {
+            auto const pri = jobType (*jobQueue, "administration");
+            expect (! pri.isMember ("deferred_total"), "admin deferred");
+            expect (pri["run_ms"]["count"].asUInt () == 10,
+                "admin run count");
+        }
+
+        root.stop (beast::Journal ());
+    }
+
+    void
+    run ()
+    {
+        testMetrics ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(JobQueue,core,skywell);
+
+}
+}
@@ -0,0 +1,104 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef SKYWELL_APP_MISC_ACCOUNTHISTORY_H_INCLUDED
+#define SKYWELL_APP_MISC_ACCOUNTHISTORY_H_INCLUDED
+
+#include <beast/threads/Stoppable.h>
+#include <ledger/Ledger.h>
+#include <common/core/Config.h>
+#include <data/nodestore/Scheduler.h>
+#include <common/json/json_value.h>
+#include <functional>
+
+namespace skywell {
+
+/** Per-account transaction history kept outside the SQL databases.
+
+    Every validated ledger is indexed, in order, into a log of postings for
+    each account it affects. Posting n of an account records
+    (ledgerSeq, txnSeq) and the hash of the transaction tree leaf, so the
+    raw transaction and metadata are read back from the node store. A page
+    of history costs one lookup per posting returned, plus a logarithmic
+    search to position the page.
+
+    The store is optional; it is enabled by an [account_history] section
+    holding node store backend parameters (type=NuDB or RocksDB, path=...).
+    Setting backfill_from=<seq> makes the store reach back to that ledger:
+    an empty store starts there, and a store that starts later indexes the
+    older ledgers in the background, newest first, between new ledgers.
+*/
+class AccountHistory
+    : public beast::Stoppable
+{
+public:
+    struct Setup
+    {
+        Section backend;
+        LedgerIndex backfillFrom = 0;
+    };
+
+    using TransactionCallback = std::function<void (std::uint32_t,
+        std::string const&, std::string const&, std::string const&)>;
+
+    AccountHistory (Stoppable& parent) : Stoppable ("AccountHistory", parent) {}
+
+    /** Returns `true` if a backend is configured. */
+    virtual bool enabled () const = 0;
+
+    /** Called by LedgerMaster every time a ledger validates. */
+    virtual void onLedgerValidated (Ledger::ref ledger) = 0;
+
+    /** Read a page of an account's history.
+
+        The arguments have the meaning they have for accountTxPage; offset
+        skips that many transactions from the start of the range when no
+        marker is given. Nothing is reported, and `false` is returned, if
+        the store does not cover [minLedger, maxLedger] or a transaction
+        could not be loaded; the caller should then use the SQL tables.
+    */
+    virtual bool getPage (
+        TransactionCallback const& onTransaction,
+        SkywellAddress const& account,
+        std::uint32_t minLedger,
+        std::uint32_t maxLedger,
+        bool forward,
+        std::uint32_t offset,
+        Json::Value& token,
+        int limit,
+        bool bAdmin,
+        std::uint32_t pageLength) = 0;
+
+    virtual Json::Value getJson () const = 0;
+};
+
+//------------------------------------------------------------------------------
+
+AccountHistory::Setup
+setup_AccountHistory (Config const& c);
+
+std::unique_ptr<AccountHistory>
+make_AccountHistory (AccountHistory::Setup const& s,
+    beast::Stoppable& parent,
+    NodeStore::Scheduler& scheduler,
+    beast::Journal journal);
+
+}
+
+#endif
@@ -0,0 +1,502 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <common/misc/AccountHistory.h>
+#include <common/misc/impl/AccountHistoryLog.h>
+#include <common/core/ConfigSections.h>
+#include <common/json/json_value.h>
+#include <data/nodestore/Manager.h>
+#include <ledger/AcceptedLedger.h>
+#include <ledger/LedgerMaster.h>
+#include <main/Application.h>
+#include <protocol/HashPrefix.h>
+#include <protocol/JsonFields.h>
+#include <protocol/Serializer.h>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace skywell {
+
+class AccountHistoryImp : public AccountHistory
+{
+private:
+    // Validated ledgers held while the indexer catches up
+    static std::size_t const maxPendingLedgers = 256;
+
+    // Older ledgers indexed between checks for new ones
+    static std::size_t const backfillChunk = 256;
+
+    using Posting = AccountHistoryLog::Posting;
+
+    Setup setup_;
+    beast::Journal journal_;
+    std::unique_ptr <NodeStore::Backend> backend_;
+    std::unique_ptr <AccountHistoryLog> log_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool stop_ = false;
+    bool signaled_ = false;
+    LedgerIndex target_ = 0;
+    std::map <LedgerIndex, Ledger::pointer> pending_;
+
+public:
+    AccountHistoryImp (Setup const& setup, Stoppable& parent,
+            NodeStore::Scheduler& scheduler, beast::Journal journal)
+        : AccountHistory (parent)
+        , setup_ (setup)
+        , journal_ (journal)
+    {
+        if (setup_.backend.size () == 0)
+            return;
+
+        backend_ = NodeStore::Manager::instance ().make_Backend (
+            setup_.backend, scheduler, journal_);
+        log_ = std::make_unique <AccountHistoryLog> (*backend_);
+
+        log_->load ();
+
+        if (log_->first () != 0)
+            journal_.info << "Indexed ledgers " << log_->first ()
+                          << " through " << log_->last ();
+    }
+
+    ~AccountHistoryImp ()
+    {
+        if (thread_.joinable ())
+            thread_.join ();
+    }
+
+    bool
+    enabled () const override
+    {
+        return backend_ != nullptr;
+    }
+
+    void
+    onLedgerValidated (Ledger::ref ledger) override
+    {
+        if (! backend_)
+            return;
+
+        {
+            std::lock_guard <std::mutex> lock (mutex_);
+
+            LedgerIndex const seq = ledger->getLedgerSeq ();
+
+            if (seq > log_->last () && pending_.size () < maxPendingLedgers)
+                pending_[seq] = ledger;
+
+            target_ = std::max (target_, seq);
+            signaled_ = true;
+        }
+        cond_.notify_one ();
+    }
+
+    bool getPage (
+        TransactionCallback const& onTransaction,
+        SkywellAddress const& account,
+        std::uint32_t minLedger,
+        std::uint32_t maxLedger,
+        bool forward,
+        std::uint32_t offset,
+        Json::Value& token,
+        int limit,
+        bool bAdmin,
+        std::uint32_t pageLength) override;
+
+    Json::Value
+    getJson () const override
+    {
+        Json::Value ret (Json::objectValue);
+
+        if (backend_)
+        {
+            ret[jss::type] = backend_->getName ();
+
+            if (log_->first () != 0)
+            {
+                ret["first"] = log_->first ();
+                ret["last"] = log_->last ();
+            }
+        }
+
+        return ret;
+    }
+
+private:
+    // Older ledgers remain to be indexed
+    bool
+    backfillPending () const
+    {
+        return setup_.backfillFrom != 0 &&
+            log_->first () > setup_.backfillFrom;
+    }
+
+    bool
+    indexLedger (Ledger::ref ledger, bool back);
+
+    void
+    catchUp (LedgerIndex target);
+
+    bool
+    backfill ();
+
+    void
+    run ();
+
+    //
+    // Stoppable
+    //
+    void
+    onPrepare () override
+    {
+    }
+
+    void
+    onStart () override
+    {
+        if (backend_)
+            thread_ = std::thread (&AccountHistoryImp::run, this);
+    }
+
+    void
+    onStop () override
+    {
+        if (backend_)
+        {
+            {
+                std::lock_guard <std::mutex> lock (mutex_);
+                stop_ = true;
+            }
+            cond_.notify_one ();
+        }
+        else
+        {
+            stopped ();
+        }
+    }
+};
+
+//------------------------------------------------------------------------------
+
+bool
+AccountHistoryImp::indexLedger (Ledger::ref ledger, bool back)
+{
+    AcceptedLedger::pointer accepted;
+
+    try
+    {
+        accepted = AcceptedLedger::makeAcceptedLedger (ledger);
+    }
+    catch (...)
+    {
+        journal_.warning << "Ledger " << ledger->getLedgerSeq ()
+                         << " is missing nodes";
+        return false;
+    }
+
+    SHAMap const& txMap = *ledger->peekTransactionMap ();
+
+    std::vector <AccountHistoryLog::Entry> entries;
+    entries.reserve (accepted->getMap ().size ());
+
+    for (auto const& vt : accepted->getMap ())
+    {
+        AccountHistoryLog::Entry entry;
+
+        if (! txMap.peekItem (vt.second->getTransactionID (), entry.node))
+            return false;
+
+        entry.txnSeq = vt.second->getTxnSeq ();
+
+        for (auto const& affected : vt.second->getAffected ())
+            entry.accounts.push_back (affected.getAccountID ());
+
+        entries.push_back (std::move (entry));
+    }
+
+    if (back)
+        log_->prepend (ledger->getLedgerSeq (), ledger->getHash (), entries);
+    else
+        log_->append (ledger->getLedgerSeq (), ledger->getHash (), entries);
+
+    return true;
+}
+
+void
+AccountHistoryImp::catchUp (LedgerIndex target)
+{
+    LedgerMaster& ledgerMaster = getApp ().getLedgerMaster ();
+
+    while (true)
+    {
+        LedgerIndex next;
+
+        if (log_->first () != 0)
+            next = log_->last () + 1;
+        else if (setup_.backfillFrom != 0)
+            next = setup_.backfillFrom;
+        else
+            next = target;
+
+        if (next == 0 || next > target)
+            break;
+
+        Ledger::pointer ledger;
+        {
+            std::lock_guard <std::mutex> lock (mutex_);
+
+            if (stop_)
+                break;
+
+            auto const iter = pending_.find (next);
+
+            if (iter != pending_.end ())
+                ledger = iter->second;
+
+            pending_.erase (pending_.begin (), pending_.upper_bound (next));
+        }
+
+        // Catching up from the ledger database
+        if (! ledger)
+            ledger = ledgerMaster.getLedgerBySeq (next);
+
+        if (! ledger || ! indexLedger (ledger, false))
+        {
+            // Try again when the next ledger validates
+            journal_.debug << "Unable to index ledger " << next;
+            break;
+        }
+
+        if ((next % 10000) == 0 || next == target)
+            journal_.trace << "Indexed ledger " << next;
+    }
+}
+
+// Index a chunk of the ledgers between backfill_from and the first indexed
+// ledger, newest first. Returns false if a ledger is not available.
+bool
+AccountHistoryImp::backfill ()
+{
+    LedgerMaster& ledgerMaster = getApp ().getLedgerMaster ();
+
+    for (std::size_t i = 0; i < backfillChunk && backfillPending (); ++i)
+    {
+        {
+            std::lock_guard <std::mutex> lock (mutex_);
+
+            // New ledgers go first
+            if (stop_ || signaled_)
+                break;
+        }
+
+        LedgerIndex const seq = log_->first () - 1;
+        Ledger::pointer ledger = ledgerMaster.getLedgerBySeq (seq);
+
+        if (! ledger || ! indexLedger (ledger, true))
+        {
+            journal_.debug << "Unable to backfill ledger " << seq;
+            return false;
+        }
+
+        if ((seq % 10000) == 0 || seq == setup_.backfillFrom)
+            journal_.trace << "Backfilled ledger " << seq;
+    }
+
+    return true;
+}
+
+void
+AccountHistoryImp::run ()
+{
+    // A ledger missing from the database stops the backfill until the
+    // next ledger validates, rather than spinning on it.
+    bool stalled = false;
+
+    while (1)
+    {
+        LedgerIndex target;
+        {
+            std::unique_lock <std::mutex> lock (mutex_);
+
+            while (! stop_ && ! signaled_ && (stalled || ! backfillPending ()))
+                cond_.wait (lock);
+
+            if (stop_)
+            {
+                stopped ();
+                return;
+            }
+
+            if (signaled_)
+                stalled = false;
+
+            signaled_ = false;
+            target = target_;
+        }
+
+        catchUp (target);
+
+        if (! stalled && backfillPending ())
+            stalled = ! backfill ();
+    }
+}
+
+bool
+AccountHistoryImp::getPage (
+    TransactionCallback const& onTransaction,
+    SkywellAddress const& address,
+    std::uint32_t minLedger,
+    std::uint32_t maxLedger,
+    bool forward,
+    std::uint32_t offset,
+    Json::Value& token,
+    int limit,
+    bool bAdmin,
+    std::uint32_t pageLength)
+{
+    if (! backend_)
+        return false;
+
+    LedgerIndex const first = log_->first ();
+
+    if (first == 0 || minLedger < first ||
+            maxLedger > log_->last () || minLedger > maxLedger)
+        return false;
+
+    std::uint32_t numberOfResults;
+
+    if (limit <= 0 ||
+            (static_cast<std::uint32_t> (limit) > pageLength && !bAdmin))
+        numberOfResults = pageLength;
+    else
+        numberOfResults = limit;
+
+    bool const hasMarker = ! token.isNull () && token.isObject ();
+    std::uint64_t marker = 0;
+
+    if (hasMarker)
+    {
+        try
+        {
+            if (!token.isMember (jss::ledger) || !token.isMember (jss::seq))
+                return false;
+            marker = (std::uint64_t (token[jss::ledger].asUInt ()) << 32) |
+                token[jss::seq].asUInt ();
+        }
+        catch (...)
+        {
+            return false;
+        }
+    }
+
+    AccountHistoryLog::Page page;
+    bool const ok = log_->getPage (address.getAccountID (),
+        minLedger, maxLedger, forward, hasMarker, marker, offset,
+        numberOfResults, page);
+
+    std::vector <Posting> const& postings = page.postings;
+
+    if (! ok)
+        return false;
+
+    // Load every transaction before reporting any, so the caller can
+    // still fall back to the SQL tables.
+    std::vector <std::pair <std::string, std::string>> blobs;
+    blobs.reserve (postings.size ());
+
+    NodeStore::Database& nodeStore = getApp ().getNodeStore ();
+
+    for (auto const& posting : postings)
+    {
+        NodeObject::pointer object = nodeStore.fetch (posting.node);
+
+        if (! object)
+        {
+            journal_.debug << "Missing transaction node " << posting.node;
+            return false;
+        }
+
+        // A transaction tree leaf is prefix | VL txn | VL meta | txID
+        Blob const& data = object->getData ();
+
+        if (data.size () < 4 + 32)
+            return false;
+
+        try
+        {
+            SerialIter sit (data.data () + 4, data.size () - 4 - 32);
+            Blob const txn (sit.getVL ());
+            Blob const meta (sit.getVL ());
+            blobs.emplace_back (std::string (txn.begin (), txn.end ()),
+                std::string (meta.begin (), meta.end ()));
+        }
+        catch (std::exception const&)
+        {
+            return false;
+        }
+    }
+
+    std::string const status (1, TXN_SQL_VALIDATED);
+
+    for (std::size_t i = 0; i < postings.size (); ++i)
+        onTransaction (postings[i].ledgerSeq, status,
+            blobs[i].first, blobs[i].second);
+
+    token = Json::nullValue;
+
+    if (page.more)
+    {
+        token = Json::objectValue;
+        token[jss::ledger] = page.next.ledgerSeq;
+        token[jss::seq] = page.next.txnSeq;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+AccountHistory::Setup
+setup_AccountHistory (Config const& c)
+{
+    AccountHistory::Setup setup;
+
+    setup.backend = c[ConfigSection::accountHistory ()];
+    get_if_exists (setup.backend, "backfill_from", setup.backfillFrom);
+
+    return setup;
+}
+
+std::unique_ptr<AccountHistory>
+make_AccountHistory (AccountHistory::Setup const& s,
+    beast::Stoppable& parent,
+    NodeStore::Scheduler& scheduler,
+    beast::Journal journal)
+{
+    return std::make_unique<AccountHistoryImp> (s, parent, scheduler, journal);
+}
+
+}
@@ -570,7 +570,7 @@ AmendmentTableImpl<AppApiFacade>::doVoting (Ledger::ref lastClosedLedger,
         Serializer s;
         trans.add (s, true);
 #if SKYWELL_PROPOSE_AMENDMENTS
-        auto tItem = std::make_shared<SHAMapItem> (txID, s.peekData ());
+        auto tItem = std::make_shared<SHAMapItem> (txID, std::move (s));
         if (!initialPosition->addGiveItem (tItem, true, false))
         {
             if (m_journal.warning) m_journal.warning <<
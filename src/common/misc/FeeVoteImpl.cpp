@@ -230,7 +230,7 @@ FeeVoteImpl::doVoting (Ledger::ref lastClosedLedger,
         Serializer s;
         trans.add (s, true);
 
-        auto tItem = std::make_shared<SHAMapItem> (txID, s.peekData ());
+        auto tItem = std::make_shared<SHAMapItem> (txID, std::move (s));
 
         if (!initialPosition->addGiveItem (tItem, true, false))
         {
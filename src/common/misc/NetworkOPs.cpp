@@ -37,6 +37,7 @@
 #include <transaction/book/Quality.h>
 #include <common/misc/IHashRouter.h>
 #include <common/misc/NetworkOPs.h>
+#include <common/misc/AccountHistory.h>
 #include <common/misc/Validations.h>
 #include <common/misc/impl/AccountTxPaging.h>
 #include <common/misc/FeeVote.h>
@@ -87,6 +88,7 @@ public:
     NetworkOPsImp (
             clock_type& clock, bool standalone, std::size_t network_quorum,
             JobQueue& job_queue, LedgerMaster& ledgerMaster, Stoppable& parent,
+            beast::insight::Collector::ptr const& collector,
             beast::Journal journal)
         : NetworkOPs (parent)
         , m_clock (clock)
@@ -110,6 +112,11 @@ public:
         , mFetchPack ("FetchPack", 65536, 45, clock,
             deprecatedLogs().journal("TaggedCache"))
         , mFetchSeq (0)
+        , mFetchPackSteps ("FetchPackSteps", 16, 60, clock,
+            deprecatedLogs().journal("TaggedCache"), collector)
+        , m_fetchPackBuild (collector->make_event ("fetch_pack_build"))
+        , m_fetchPackThreads (std::max (1, std::min (4,
+            static_cast<int> (std::thread::hardware_concurrency ()) / 2)))
         , mLastLoadBase (256)
         , mLastLoadFactor (256)
         , m_job_queue (job_queue)
@@ -300,6 +307,17 @@ public:
         std::shared_ptr<protocol::TMGetObjectByHash> request,
         uint256 haveLedger, std::uint32_t uUptime);
 
+    /** Returns the objects that take a peer holding haveLedger to
+        wantLedger, its parent: the parent's header, the state tree nodes
+        the peer lacks and the parent's transaction tree. Steps are cached,
+        so peers syncing past the same ledgers share the work.
+    */
+    std::shared_ptr<protocol::TMGetObjectByHash> getFetchPackStep (
+        Ledger::ref haveLedger, Ledger::ref wantLedger);
+
+    /** Build the fetch pack step for a newly validated ledger. */
+    void prepareFetchPack (Job&, uint256 const& haveLedgerHash);
+
     bool shouldFetchPack (std::uint32_t seq);
     void gotFetchPack (bool progress, std::uint32_t seq);
     void addFetchPack (uint256 const& hash, std::shared_ptr< Blob >& data);
@@ -411,13 +429,6 @@ public:
         return m_localTX->size ();
     }
 
-    //Helper function to generate SQL query to get transactions
-    std::string transactionsSQL (
-        std::string selection, SkywellAddress const& account,
-        std::int32_t minLedger, std::int32_t maxLedger,
-        bool descending, std::uint32_t offset, int limit,
-        bool binary, bool count, bool bAdmin);
-
     // client information retrieval functions
     using NetworkOPs::AccountTxs;
     AccountTxs getAccountTxs (
@@ -445,6 +456,12 @@ public:
         std::int32_t maxLedger,  bool forward, Json::Value& token,
         int limit, bool bAdmin);
 
+    void
+    visitTxsAccountB (
+        SkywellAddress const& account, std::int32_t minLedger,
+        std::int32_t maxLedger,  bool forward, Json::Value& token,
+        int limit, bool bAdmin, RawTxCallback const& onTransaction);
+
     std::vector<SkywellAddress> getLedgerAffectedAccounts (
         std::uint32_t ledgerSeq);
 
@@ -598,6 +615,13 @@ private:
     TaggedCache<uint256, Blob>  mFetchPack;
     std::uint32_t mFetchSeq;
 
+    // Fetch pack steps we built, by the hash of the ledger the peer has.
+    // A step holds up to 16384 state nodes and 512 transaction nodes, so
+    // only the few recent ledgers that peers sync past are kept.
+    TaggedCache<uint256, protocol::TMGetObjectByHash> mFetchPackSteps;
+    beast::insight::Event m_fetchPackBuild;
+    int const m_fetchPackThreads;
+
     std::uint32_t mLastLoadBase;
     std::uint32_t mLastLoadFactor;
 
@@ -1774,149 +1798,54 @@ void NetworkOPsImp::setMode (OperatingMode om)
 }
 
 
-std::string
-NetworkOPsImp::transactionsSQL (
-    std::string selection, SkywellAddress const& account,
-    std::int32_t minLedger, std::int32_t maxLedger, bool descending,
-    std::uint32_t offset, int limit,
-    bool binary, bool count, bool bAdmin)
-{
-    std::uint32_t NONBINARY_PAGE_LENGTH = 200;
-    std::uint32_t BINARY_PAGE_LENGTH = 500;
-
-    std::uint32_t numberOfResults;
-
-    if (count)
-    {
-        numberOfResults = 1000000000;
-    }
-    else if (limit < 0)
-    {
-        numberOfResults = binary ? BINARY_PAGE_LENGTH : NONBINARY_PAGE_LENGTH;
-    }
-    else if (!bAdmin)
-    {
-        numberOfResults = std::min (
-            binary ? BINARY_PAGE_LENGTH : NONBINARY_PAGE_LENGTH,
-            static_cast<std::uint32_t> (limit));
-    }
-    else
-    {
-        numberOfResults = limit;
-    }
-
-    std::string maxClause = "";
-    std::string minClause = "";
-
-    if (maxLedger != -1)
-    {
-        maxClause = boost::str (boost::format (
-            "AND AccountTransactions.LedgerSeq <= '%u'") % maxLedger);
-    }
-
-    if (minLedger != -1)
-    {
-        minClause = boost::str (boost::format (
-            "AND AccountTransactions.LedgerSeq >= '%u'") % minLedger);
-    }
-
-    std::string sql;
-
-    if (count)
-        sql =
-            boost::str (boost::format (
-                "SELECT %s FROM AccountTransactions "
-                "WHERE Account = '%s' %s %s LIMIT %u, %u;")
-            % selection
-            % account.humanAccountID ()
-            % maxClause
-            % minClause
-            % boost::lexical_cast <std::string> (offset)
-            % boost::lexical_cast <std::string> (numberOfResults)
-        );
-    else
-        sql =
-            boost::str (boost::format (
-                "SELECT %s FROM "
-                "AccountTransactions INNER JOIN Transactions "
-                "ON Transactions.TransID = AccountTransactions.TransID "
-                "WHERE Account = '%s' %s %s "
-                "ORDER BY AccountTransactions.LedgerSeq %s, "
-                "AccountTransactions.TxnSeq %s, AccountTransactions.TransID %s "
-                "LIMIT %u, %u;")
-                    % selection
-                    % account.humanAccountID ()
-                    % maxClause
-                    % minClause
-                    % (descending ? "DESC" : "ASC")
-                    % (descending ? "DESC" : "ASC")
-                    % (descending ? "DESC" : "ASC")
-                    % boost::lexical_cast <std::string> (offset)
-                    % boost::lexical_cast <std::string> (numberOfResults)
-                   );
-    m_journal.trace << "txSQL query: " << sql;
-    return sql;
-}
-
 NetworkOPs::AccountTxs NetworkOPsImp::getAccountTxs (
     SkywellAddress const& account,
     std::int32_t minLedger, std::int32_t maxLedger, bool descending,
     std::uint32_t offset, int limit, bool bAdmin)
 {
+    static std::uint32_t const page_length (200);
+
     // can be called with no locks
     AccountTxs ret;
 
-    std::string sql = NetworkOPsImp::transactionsSQL (
-        "AccountTransactions.LedgerSeq,Status,RawTxn,TxnMeta", account,
-        minLedger, maxLedger, descending, offset, limit, false, false, bAdmin);
+    // Without the account history store, the offset is turned into a
+    // marker so that the page itself is read with the same seek query as
+    // marker based requests.
+    Json::Value token;
 
+    if (limit == 0)
+        return ret;
+
+    auto bound = [&ret](
+        std::uint32_t ledger_index,
+        std::string const& status,
+        std::string const& rawTxn,
+        std::string const& rawMeta)
     {
-        auto db = getApp().getTxnDB ().checkoutDb ();
+        convertBlobsToTxResult (ret, ledger_index, status, rawTxn, rawMeta);
+    };
 
-        boost::optional<std::uint64_t> ledgerSeq;
-        boost::optional<std::string> status;
-        boost::optional<std::string> sociTxnBlob, sociTxnMetaBlob;
-        soci::indicator rti, tmi;
-        std::string rawTxn, txnMeta;
+    if (getApp().getAccountHistory ().getPage (bound, account, minLedger,
+            maxLedger, !descending, offset, token, limit, bAdmin, page_length))
+        return ret;
 
-        soci::statement st =
-                (db->prepare << sql,
-                 soci::into(ledgerSeq),
-                 soci::into(status),
-                 soci::into(sociTxnBlob, rti),
-                 soci::into(sociTxnMetaBlob, tmi));
+    if (!accountTxIndexReady ())
+    {
+        // Without the index, seeking to the offset would scan the table
+        // twice; the single offset query scans it once.
+        accountTxOffsetPage (getApp().getTxnDB (), saveLedgerAsync, bound,
+            account, minLedger, maxLedger, !descending, offset, limit,
+            bAdmin, page_length);
+        return ret;
+    }
 
-        st.execute ();
-        while (st.fetch ())
-        {
-            if (soci::i_ok == rti)
-                rawTxn = *sociTxnBlob;
-            else
-                rawTxn.clear ();
+    if (offset != 0 && !accountTxOffsetToken (
+            getApp().getTxnDB (), account, minLedger, maxLedger,
+            !descending, offset, token))
+        return ret;
 
-            if (soci::i_ok == tmi)
-                txnMeta = *sociTxnMetaBlob;
-            else
-                txnMeta.clear ();
-
-            auto txn = Transaction::transactionFromSQL (
-                ledgerSeq, status, rawTxn, Validate::NO);
-
-            if (txnMeta.empty ())
-            { // Work around a bug that could leave the metadata missing
-                auto const seq = rangeCheckedCast<std::uint32_t>(
-                    ledgerSeq.value_or (0));
-                m_journal.warning << "Recovering ledger " << seq
-                                  << ", txn " << txn->getID();
-                Ledger::pointer ledger = getLedgerBySeq(seq);
-                if (ledger)
-                    ledger->pendSaveValidated(false, false);
-            }
-
-            ret.emplace_back (txn, std::make_shared<TransactionMetaSet> (
-                txn->getID (), txn->getLedger (), txnMeta));
-        }
-    }
+    accountTxPage(getApp().getTxnDB (), saveLedgerAsync, bound, account,
+        minLedger, maxLedger, !descending, token, limit, bAdmin, page_length);
 
     return ret;
 }
@@ -1926,47 +1855,47 @@ std::vector<NetworkOPsImp::txnMetaLedgerType> NetworkOPsImp::getAccountTxsB (
     std::int32_t minLedger, std::int32_t maxLedger, bool descending,
     std::uint32_t offset, int limit, bool bAdmin)
 {
+    static std::uint32_t const page_length (500);
+
     // can be called with no locks
     std::vector<txnMetaLedgerType> ret;
 
-    std::string sql = NetworkOPsImp::transactionsSQL (
-        "AccountTransactions.LedgerSeq,Status,RawTxn,TxnMeta", account,
-        minLedger, maxLedger, descending, offset, limit, true/*binary*/, false,
-        bAdmin);
+    Json::Value token;
 
-    {
-        auto db = getApp().getTxnDB ().checkoutDb ();
+    if (limit == 0)
+        return ret;
 
-        boost::optional<std::uint64_t> ledgerSeq;
-        boost::optional<std::string> status;
-        boost::optional<std::string> sociTxnBlob, sociTxnMetaBlob;
-        soci::indicator rti, tmi;
+    auto bound = [&ret](
+        std::uint32_t ledgerIndex,
+        std::string const& status,
+        std::string const& rawTxn,
+        std::string const& rawMeta)
+    {
+        ret.emplace_back (strHex(rawTxn), strHex (rawMeta), ledgerIndex);
+    };
 
-        soci::statement st =
-                (db->prepare << sql,
-                 soci::into(ledgerSeq),
-                 soci::into(status),
-                 soci::into(sociTxnBlob, rti),
-                 soci::into(sociTxnMetaBlob, tmi));
+    if (getApp().getAccountHistory ().getPage (bound, account, minLedger,
+            maxLedger, !descending, offset, token, limit, bAdmin, page_length))
+        return ret;
 
-        st.execute ();
-        while (st.fetch ())
-        {
-            std::string rawTxn;
-            if (soci::i_ok == rti)
-                rawTxn = *sociTxnBlob;
-            std::string txnMeta;
-            if (soci::i_ok == tmi)
-                txnMeta = *sociTxnMetaBlob;
-
-            auto const seq =
-                rangeCheckedCast<std::uint32_t>(ledgerSeq.value_or (0));
-
-            ret.emplace_back (
-                strHex (rawTxn), strHex (txnMeta), seq);
-        }
+    if (!accountTxIndexReady ())
+    {
+        // Without the index, seeking to the offset would scan the table
+        // twice; the single offset query scans it once.
+        accountTxOffsetPage (getApp().getTxnDB (), saveLedgerAsync, bound,
+            account, minLedger, maxLedger, !descending, offset, limit,
+            bAdmin, page_length);
+        return ret;
     }
 
+    if (offset != 0 && !accountTxOffsetToken (
+            getApp().getTxnDB (), account, minLedger, maxLedger,
+            !descending, offset, token))
+        return ret;
+
+    accountTxPage(getApp().getTxnDB (), saveLedgerAsync, bound, account,
+        minLedger, maxLedger, !descending, token, limit, bAdmin, page_length);
+
     return ret;
 }
 
@@ -1989,6 +1918,10 @@ NetworkOPsImp::getTxsAccount (
         convertBlobsToTxResult (ret, ledger_index, status, rawTxn, rawMeta);
     };
 
+    if (getApp().getAccountHistory ().getPage (bound, account, minLedger,
+            maxLedger, forward, 0, token, limit, bAdmin, page_length))
+        return ret;
+
     accountTxPage(getApp().getTxnDB (), saveLedgerAsync, bound, account,
         minLedger, maxLedger, forward, token, limit, bAdmin, page_length);
 
@@ -2001,22 +1934,43 @@ NetworkOPsImp::getTxsAccountB (
     std::int32_t maxLedger,  bool forward, Json::Value& token,
     int limit, bool bAdmin)
 {
-    static const std::uint32_t page_length (500);
-
     MetaTxsList ret;
 
-    auto bound = [&ret](
+    visitTxsAccountB (account, minLedger, maxLedger, forward, token,
+        limit, bAdmin, [&ret](
+            std::uint32_t ledgerIndex,
+            std::string const& rawTxn,
+            std::string const& rawMeta)
+        {
+            ret.emplace_back (strHex(rawTxn), strHex (rawMeta), ledgerIndex);
+        });
+
+    return ret;
+}
+
+void
+NetworkOPsImp::visitTxsAccountB (
+    SkywellAddress const& account, std::int32_t minLedger,
+    std::int32_t maxLedger,  bool forward, Json::Value& token,
+    int limit, bool bAdmin, RawTxCallback const& onTransaction)
+{
+    static const std::uint32_t page_length (500);
+
+    auto bound = [&onTransaction](
         std::uint32_t ledgerIndex,
         std::string const& status,
-		std::string const& rawTxn,
-		std::string const& rawMeta)
+        std::string const& rawTxn,
+        std::string const& rawMeta)
     {
-        ret.emplace_back (strHex(rawTxn), strHex (rawMeta), ledgerIndex);
+        onTransaction (ledgerIndex, rawTxn, rawMeta);
     };
 
+    if (getApp().getAccountHistory ().getPage (bound, account, minLedger,
+            maxLedger, forward, 0, token, limit, bAdmin, page_length))
+        return;
+
     accountTxPage(getApp().getTxnDB (), saveLedgerAsync, bound, account,
         minLedger, maxLedger, forward, token, limit, bAdmin, page_length);
-    return ret;
 }
 
 std::vector<SkywellAddress>
@@ -2140,6 +2094,9 @@ Json::Value NetworkOPsImp::getServerInfo (bool human, bool admin)
     if (admin)
         info[jss::load] = m_job_queue.getJson ();
 
+    if (admin && getApp().getAccountHistory ().enabled ())
+        info[jss::account_history] = getApp().getAccountHistory ().getJson ();
+
     if (!human)
     {
         info[jss::load_base] = getApp().getFeeTrack ().getLoadBase ();
@@ -2312,6 +2269,9 @@ void NetworkOPsImp::pubProposedTransaction (
 
 void NetworkOPsImp::pubLedger (Ledger::ref accepted)
 {
+    CloseTracer::Span span (m_ledgerMaster.getCloseTracer (),
+        CloseTracer::publish, accepted->getLedgerSeq ());
+
     // Ledgers are published only when they acquire sufficient validations
     // Holes are filled across connection loss or other catastrophe
 
@@ -2366,6 +2326,12 @@ void NetworkOPsImp::pubLedger (Ledger::ref accepted)
         m_journal.trace << "pubAccepted: " << vt.second->getJson ();
         pubValidatedTransaction (lpAccepted, *vt.second);
     }
+
+    // Peers catching up will ask for the step back from this ledger
+    if (! m_standalone)
+        m_job_queue.addJob (jtPACK_PREPARE, "prepareFetchPack",
+            std::bind (&NetworkOPsImp::prepareFetchPack, this,
+                std::placeholders::_1, lpAccepted->getHash ()));
 }
 
 void NetworkOPsImp::reportFeeChange ()
@@ -3262,36 +3228,16 @@ void NetworkOPsImp::makeFetchPack (
         reply.set_type (protocol::TMGetObjectByHash::otFETCH_PACK);
 
         // Building a fetch pack:
-        //  1. Add the header for the requested ledger.
-        //  2. Add the nodes for the AccountStateMap of that ledger.
-        //  3. If there are transactions, add the nodes for the
-        //     transactions of the ledger.
-        //  4. If the FetchPack now contains greater than or equal to
-        //     256 entries then stop.
-        //  5. If not very much time has elapsed, then loop back and repeat
+        //  1. Add the step from the ledger the peer has to its parent
+        //     (see getFetchPackStep).
+        //  2. If the FetchPack now contains greater than or equal to
+        //     512 entries then stop.
+        //  3. If not very much time has elapsed, then loop back and repeat
         //     the same process adding the previous ledger to the FetchPack.
         do
         {
-            std::uint32_t lSeq = wantLedger->getLedgerSeq ();
-
-            protocol::TMIndexedObject& newObj = *reply.add_objects ();
-            newObj.set_hash (wantLedger->getHash ().begin (), 256 / 8);
-            Serializer s (256);
-            s.add32 (HashPrefix::ledgerMaster);
-            wantLedger->addRaw (s);
-            newObj.set_data (s.getDataPtr (), s.getLength ());
-            newObj.set_ledgerseq (lSeq);
-
-            wantLedger->peekAccountStateMap ()->getFetchPack
-                (haveLedger->peekAccountStateMap ().get (), true, 16384,
-                    std::bind (fpAppender, &reply, lSeq, std::placeholders::_1,
-                               std::placeholders::_2));
-
-            if (wantLedger->getTransHash ().isNonZero ())
-                wantLedger->peekTransactionMap ()->getFetchPack (
-                    nullptr, true, 512,
-                    std::bind (fpAppender, &reply, lSeq, std::placeholders::_1,
-                               std::placeholders::_2));
+            auto const step = getFetchPackStep (haveLedger, wantLedger);
+            reply.mutable_objects ()->MergeFrom (step->objects ());
 
             if (reply.objects ().size () >= 512)
                 break;
@@ -3314,9 +3260,84 @@ void NetworkOPsImp::makeFetchPack (
     }
 }
 
+std::shared_ptr<protocol::TMGetObjectByHash>
+NetworkOPsImp::getFetchPackStep (Ledger::ref haveLedger, Ledger::ref wantLedger)
+{
+    uint256 const haveLedgerHash = haveLedger->getHash ();
+
+    auto step = mFetchPackSteps.fetch (haveLedgerHash);
+
+    if (step)
+        return step;
+
+    auto const start = std::chrono::steady_clock::now ();
+
+    step = std::make_shared<protocol::TMGetObjectByHash> ();
+    std::uint32_t lSeq = wantLedger->getLedgerSeq ();
+
+    protocol::TMIndexedObject& newObj = *step->add_objects ();
+    newObj.set_hash (wantLedger->getHash ().begin (), 256 / 8);
+    Serializer s (256);
+    s.add32 (HashPrefix::ledgerMaster);
+    wantLedger->addRaw (s);
+    newObj.set_data (s.getDataPtr (), s.getLength ());
+    newObj.set_ledgerseq (lSeq);
+
+    wantLedger->peekAccountStateMap ()->getFetchPack
+        (haveLedger->peekAccountStateMap ().get (), true, 16384,
+            m_fetchPackThreads - 1,
+            [this](std::function<void ()> work)
+            {
+                m_job_queue.addJob (jtPACK_BRANCH, "fetchPackBranch",
+                    [work](Job&) { work (); });
+            },
+            std::bind (fpAppender, step.get (), lSeq, std::placeholders::_1,
+                       std::placeholders::_2));
+
+    if (wantLedger->getTransHash ().isNonZero ())
+        wantLedger->peekTransactionMap ()->getFetchPack (
+            nullptr, true, 512,
+            std::bind (fpAppender, step.get (), lSeq, std::placeholders::_1,
+                       std::placeholders::_2));
+
+    m_fetchPackBuild.notify (
+        std::chrono::duration_cast <beast::insight::Event::value_type> (
+            std::chrono::steady_clock::now () - start));
+
+    mFetchPackSteps.canonicalize (haveLedgerHash, step);
+    return step;
+}
+
+void NetworkOPsImp::prepareFetchPack (Job&, uint256 const& haveLedgerHash)
+{
+    if (getApp().getFeeTrack ().isLoadedLocal () ||
+        getApp().overlay ().size () == 0)
+        return;
+
+    Ledger::pointer haveLedger = getLedgerByHash (haveLedgerHash);
+
+    if (!haveLedger)
+        return;
+
+    Ledger::pointer wantLedger = getLedgerByHash (haveLedger->getParentHash ());
+
+    if (!wantLedger)
+        return;
+
+    try
+    {
+        getFetchPackStep (haveLedger, wantLedger);
+    }
+    catch (...)
+    {
+        m_journal.warning << "Exception preparing fetch pack";
+    }
+}
+
 void NetworkOPsImp::sweepFetchPack ()
 {
     mFetchPack.sweep ();
+    mFetchPackSteps.sweep ();
 }
 
 void NetworkOPsImp::addFetchPack (
@@ -3426,10 +3447,11 @@ NetworkOPs::~NetworkOPs ()
 std::unique_ptr<NetworkOPs>
 make_NetworkOPs (NetworkOPs::clock_type& clock, bool standalone,
     std::size_t network_quorum, JobQueue& job_queue, LedgerMaster& ledgerMaster,
-    beast::Stoppable& parent, beast::Journal journal)
+    beast::Stoppable& parent, beast::insight::Collector::ptr const& collector,
+    beast::Journal journal)
 {
     return std::make_unique<NetworkOPsImp> (clock, standalone, network_quorum,
-        job_queue, ledgerMaster, parent, journal);
+        job_queue, ledgerMaster, parent, collector, journal);
 }
 
 } // skywell
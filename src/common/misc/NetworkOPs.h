@@ -22,6 +22,7 @@
 
 #include <deque>
 #include <tuple>
+#include <beast/Insight.h>
 #include <beast/threads/Stoppable.h>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <common/misc/Utility.h>
@@ -273,12 +274,6 @@ public:
     virtual void addLocalTx (Ledger::ref openLedger, STTx::ref txn) = 0;
     virtual std::size_t getLocalTxCount () = 0;
 
-    //Helper function to generate SQL query to get transactions
-    virtual std::string transactionsSQL (std::string selection,
-        SkywellAddress const& account, std::int32_t minLedger, std::int32_t maxLedger,
-        bool descending, std::uint32_t offset, int limit, bool binary,
-            bool count, bool bAdmin) = 0;
-
     // client information retrieval functions
     typedef std::pair<Transaction::pointer, TransactionMetaSet::pointer>
     AccountTx;
@@ -308,6 +303,19 @@ public:
         std::int32_t minLedger, std::int32_t maxLedger,  bool forward,
         Json::Value& token, int limit, bool bAdmin) = 0;
 
+    /** Called with the ledger index, raw transaction and raw metadata. */
+    typedef std::function<void (std::uint32_t,
+        std::string const&, std::string const&)> RawTxCallback;
+
+    /** Page through an account's transactions like getTxsAccountB.
+        Each transaction is passed on as it is read, without collecting
+        the page; the blobs are only valid for the duration of the call.
+    */
+    virtual void visitTxsAccountB (SkywellAddress const& account,
+        std::int32_t minLedger, std::int32_t maxLedger,  bool forward,
+        Json::Value& token, int limit, bool bAdmin,
+        RawTxCallback const& onTransaction) = 0;
+
     virtual std::vector<SkywellAddress> getLedgerAffectedAccounts (
         std::uint32_t ledgerSeq) = 0;
 
@@ -325,7 +333,8 @@ public:
 std::unique_ptr<NetworkOPs>
 make_NetworkOPs (NetworkOPs::clock_type& clock, bool standalone,
     std::size_t network_quorum, JobQueue& job_queue, LedgerMaster& ledgerMaster,
-    beast::Stoppable& parent, beast::Journal journal);
+    beast::Stoppable& parent, beast::insight::Collector::ptr const& collector,
+    beast::Journal journal);
 
 } // skywell
 
@@ -0,0 +1,492 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <common/misc/impl/AccountHistoryLog.h>
+#include <protocol/SHA512Half.h>
+#include <protocol/Serializer.h>
+#include <algorithm>
+#include <cassert>
+
+namespace skywell {
+
+// Keys of the objects kept in the backend
+enum : std::uint32_t
+{
+    postingKey = 0x41485000,    // 'A', 'H', 'P', account | index
+    ledgerKey  = 0x41484C00,    // 'A', 'H', 'L', ledger seq
+    firstKey   = 0x41484600     // 'A', 'H', 'F'
+};
+
+// Size of a posting: ledgerSeq | txnSeq | leaf node hash
+static std::size_t const postingBytes = 4 + 4 + 32;
+
+// Ranges are rediscovered from the backend when not cached
+static std::size_t const maxCachedRanges = 131072;
+
+AccountHistoryLog::AccountHistoryLog (NodeStore::Backend& backend)
+    : backend_ (backend)
+    , first_ (0)
+    , last_ (0)
+{
+}
+
+uint256
+AccountHistoryLog::makeKey (std::uint32_t type, std::uint32_t value)
+{
+    sha512_half_hasher h;
+    h.add32 (type);
+    h.add32 (value);
+    return static_cast<uint256> (h);
+}
+
+uint256
+AccountHistoryLog::makePostingKey (Account const& account, std::int64_t index)
+{
+    // Negative indexes hash as their two's complement
+    std::uint64_t const i = static_cast<std::uint64_t> (index);
+
+    sha512_half_hasher h;
+    h.add32 (postingKey);
+    h.append (account.begin (), account.size ());
+    h.add32 (static_cast<std::uint32_t> (i >> 32));
+    h.add32 (static_cast<std::uint32_t> (i));
+    return static_cast<uint256> (h);
+}
+
+bool
+AccountHistoryLog::exists (uint256 const& key)
+{
+    NodeObject::Ptr object;
+    return backend_.fetch (key.begin (), &object) == NodeStore::ok;
+}
+
+bool
+AccountHistoryLog::fetchPosting (Account const& account, std::int64_t index,
+    Posting& posting)
+{
+    NodeObject::Ptr object;
+
+    if (backend_.fetch (makePostingKey (account, index).begin (),
+            &object) != NodeStore::ok)
+        return false;
+
+    Blob const& data = object->getData ();
+
+    if (data.size () != postingBytes)
+        return false;
+
+    SerialIter sit (data);
+    posting.ledgerSeq = sit.get32 ();
+    posting.txnSeq = sit.get32 ();
+    posting.node = sit.get256 ();
+    return true;
+}
+
+// Find each end of an account's postings with an exponential probe
+// followed by a binary search.
+AccountHistoryLog::Range
+AccountHistoryLog::discoverRange (Account const& account)
+{
+    Range range;
+
+    if (exists (makePostingKey (account, 0)))
+    {
+        std::int64_t present = 0;
+        std::int64_t absent = 1;
+
+        while (exists (makePostingKey (account, absent)))
+        {
+            present = absent;
+            absent *= 2;
+        }
+
+        while (absent - present > 1)
+        {
+            std::int64_t const mid = present + (absent - present) / 2;
+
+            if (exists (makePostingKey (account, mid)))
+                present = mid;
+            else
+                absent = mid;
+        }
+
+        range.end = present + 1;
+    }
+
+    if (exists (makePostingKey (account, -1)))
+    {
+        std::int64_t present = -1;
+        std::int64_t absent = -2;
+
+        while (exists (makePostingKey (account, absent)))
+        {
+            present = absent;
+            absent *= 2;
+        }
+
+        while (present - absent > 1)
+        {
+            std::int64_t const mid = absent + (present - absent) / 2;
+
+            if (exists (makePostingKey (account, mid)))
+                present = mid;
+            else
+                absent = mid;
+        }
+
+        range.begin = present;
+    }
+
+    Posting posting;
+
+    if (! range.empty () &&
+        fetchPosting (account, range.begin, posting))
+    {
+        range.first = posting.position ();
+
+        if (fetchPosting (account, range.end - 1, posting))
+            range.last = posting.position ();
+    }
+
+    return range;
+}
+
+AccountHistoryLog::Range
+AccountHistoryLog::getRange (Account const& account)
+{
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        auto const iter = ranges_.find (account);
+
+        if (iter != ranges_.end ())
+            return iter->second;
+    }
+
+    // Readers never fill the cache: a range read here may already be
+    // stale when the indexer adds to this account.
+    return discoverRange (account);
+}
+
+// Index of the first posting at or after position, in [begin, end]
+std::int64_t
+AccountHistoryLog::lowerBound (Account const& account,
+    std::int64_t begin, std::int64_t end, std::uint64_t position, bool& ok)
+{
+    Posting posting;
+
+    while (ok && begin < end)
+    {
+        std::int64_t const mid = begin + (end - begin) / 2;
+
+        if (! fetchPosting (account, mid, posting))
+            ok = false;
+        else if (posting.position () < position)
+            begin = mid + 1;
+        else
+            end = mid;
+    }
+
+    return begin;
+}
+
+void
+AccountHistoryLog::load ()
+{
+    NodeObject::Ptr object;
+
+    if (backend_.fetch (makeKey (firstKey).begin (), &object) != NodeStore::ok)
+        return;
+
+    // The ledger the store started at
+    SerialIter sit (object->getData ());
+    LedgerIndex const origin = sit.get32 ();
+
+    if (! exists (makeKey (ledgerKey, origin)))
+    {
+        first_ = origin;
+        last_ = origin - 1;
+        return;
+    }
+
+    // Ledgers indexed since
+    LedgerIndex last = origin;
+    {
+        LedgerIndex step = 1;
+
+        while (exists (makeKey (ledgerKey, origin + step)))
+        {
+            last = origin + step;
+            step *= 2;
+        }
+
+        LedgerIndex absent = origin + step;
+
+        while (absent - last > 1)
+        {
+            LedgerIndex const mid = last + (absent - last) / 2;
+
+            if (exists (makeKey (ledgerKey, mid)))
+                last = mid;
+            else
+                absent = mid;
+        }
+    }
+
+    // Ledgers backfilled before it. There is never a ledger zero.
+    LedgerIndex first = origin;
+    {
+        LedgerIndex step = 1;
+
+        while (step < origin && exists (makeKey (ledgerKey, origin - step)))
+        {
+            first = origin - step;
+            step *= 2;
+        }
+
+        LedgerIndex absent = (step < origin) ? origin - step : 0;
+
+        while (first - absent > 1)
+        {
+            LedgerIndex const mid = absent + (first - absent) / 2;
+
+            if (exists (makeKey (ledgerKey, mid)))
+                first = mid;
+            else
+                absent = mid;
+        }
+    }
+
+    first_ = first;
+    last_ = last;
+}
+
+void
+AccountHistoryLog::append (LedgerIndex seq, uint256 const& hash,
+    std::vector <Entry> const& entries)
+{
+    store (seq, hash, entries, false);
+
+    if (first_ == 0)
+        first_ = seq;
+    last_ = seq;
+}
+
+void
+AccountHistoryLog::prepend (LedgerIndex seq, uint256 const& hash,
+    std::vector <Entry> const& entries)
+{
+    assert (first_ != 0 && seq + 1 == first_);
+
+    store (seq, hash, entries, true);
+
+    first_ = seq;
+}
+
+void
+AccountHistoryLog::store (LedgerIndex seq, uint256 const& hash,
+    std::vector <Entry> const& entries, bool back)
+{
+    NodeStore::Batch batch;
+    hardened_hash_map <Account, Range> updates;
+
+    auto rangeOf = [&](Account const& account) -> Range&
+    {
+        auto iter = updates.find (account);
+
+        if (iter == updates.end ())
+        {
+            bool cached = false;
+            Range range;
+            {
+                std::lock_guard <std::mutex> lock (mutex_);
+                auto const found = ranges_.find (account);
+
+                if (found != ranges_.end ())
+                {
+                    range = found->second;
+                    cached = true;
+                }
+            }
+
+            if (! cached)
+                range = discoverRange (account);
+
+            iter = updates.emplace (account, range).first;
+        }
+
+        return iter->second;
+    };
+
+    auto add = [&](Account const& account, std::int64_t index,
+        Entry const& entry)
+    {
+        Serializer s (postingBytes);
+        s.add32 (seq);
+        s.add32 (entry.txnSeq);
+        s.add256 (entry.node);
+
+        batch.push_back (NodeObject::createObject (hotUNKNOWN,
+            std::move (s.modData ()), makePostingKey (account, index)));
+    };
+
+    if (! back)
+    {
+        for (auto const& entry : entries)
+        {
+            std::uint64_t const position =
+                (std::uint64_t (seq) << 32) | entry.txnSeq;
+
+            for (auto const& account : entry.accounts)
+            {
+                Range& range = rangeOf (account);
+
+                // Already indexed before an interrupted run
+                if (! range.empty () && range.last >= position)
+                    continue;
+
+                add (account, range.end, entry);
+
+                if (range.empty ())
+                    range.first = position;
+                ++range.end;
+                range.last = position;
+            }
+        }
+    }
+    else
+    {
+        // Prepending walks the ledger backwards
+        for (auto iter = entries.rbegin (); iter != entries.rend (); ++iter)
+        {
+            std::uint64_t const position =
+                (std::uint64_t (seq) << 32) | iter->txnSeq;
+
+            for (auto const& account : iter->accounts)
+            {
+                Range& range = rangeOf (account);
+
+                if (! range.empty () && range.first <= position)
+                    continue;
+
+                if (range.empty ())
+                    range.last = position;
+                --range.begin;
+                range.first = position;
+
+                add (account, range.begin, *iter);
+            }
+        }
+    }
+
+    if (first_ == 0)
+    {
+        Serializer s (4);
+        s.add32 (seq);
+        batch.push_back (NodeObject::createObject (hotUNKNOWN,
+            std::move (s.modData ()), makeKey (firstKey)));
+    }
+
+    {
+        Serializer s (32);
+        s.add256 (hash);
+        batch.push_back (NodeObject::createObject (hotUNKNOWN,
+            std::move (s.modData ()), makeKey (ledgerKey, seq)));
+    }
+
+    backend_.storeBatch (batch);
+
+    std::lock_guard <std::mutex> lock (mutex_);
+
+    if (ranges_.size () + updates.size () > maxCachedRanges)
+        ranges_.clear ();
+
+    for (auto const& update : updates)
+        ranges_[update.first] = update.second;
+}
+
+bool
+AccountHistoryLog::getPage (Account const& account,
+    std::uint32_t minLedger, std::uint32_t maxLedger, bool forward,
+    bool hasMarker, std::uint64_t marker, std::uint32_t offset,
+    std::uint32_t numberOfResults, Page& page)
+{
+    Range const range = getRange (account);
+
+    // Postings [lo, hi) lie in the ledger range; the page starts at the
+    // marker or at the offset from the start of the range.
+    bool ok = true;
+    std::int64_t const lo = lowerBound (account, range.begin, range.end,
+        std::uint64_t (minLedger) << 32, ok);
+    std::int64_t const hi = lowerBound (account, range.begin, range.end,
+        (std::uint64_t (maxLedger) + 1) << 32, ok);
+
+    page.postings.clear ();
+    page.more = false;
+
+    if (forward)
+    {
+        std::int64_t index = hasMarker
+            ? std::max (lo, lowerBound (account, lo, hi, marker, ok))
+            : lo + offset;
+
+        for (; ok && index < hi; ++index)
+        {
+            Posting posting;
+
+            if (! fetchPosting (account, index, posting))
+                ok = false;
+            else if (page.postings.size () == numberOfResults)
+            {
+                page.next = posting;
+                page.more = true;
+                break;
+            }
+            else
+                page.postings.push_back (posting);
+        }
+    }
+    else
+    {
+        std::int64_t end = hasMarker
+            ? std::min (hi, lowerBound (account, lo, hi, marker + 1, ok))
+            : (hi - lo > offset ? hi - offset : lo);
+
+        for (; ok && end > lo; --end)
+        {
+            Posting posting;
+
+            if (! fetchPosting (account, end - 1, posting))
+                ok = false;
+            else if (page.postings.size () == numberOfResults)
+            {
+                page.next = posting;
+                page.more = true;
+                break;
+            }
+            else
+                page.postings.push_back (posting);
+        }
+    }
+
+    return ok;
+}
+
+}
@@ -0,0 +1,184 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#ifndef SKYWELL_APP_MISC_ACCOUNTHISTORYLOG_H_INCLUDED
+#define SKYWELL_APP_MISC_ACCOUNTHISTORYLOG_H_INCLUDED
+
+#include <common/base/UnorderedContainers.h>
+#include <data/nodestore/Backend.h>
+#include <protocol/UintTypes.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace skywell {
+
+/** The on-disk layout of the account history store.
+
+    Each account has a log of postings, one per transaction affecting it,
+    sorted by (ledgerSeq, txnSeq). Posting i of an account is stored under
+    hash(account, i). New ledgers are appended at indexes 0, 1, 2, ...
+    and ledgers older than the first indexed one are prepended at indexes
+    -1, -2, ..., so the indexes in use form a contiguous range and every
+    object is written exactly once.
+
+    A marker per ledger, written in the same batch after its postings,
+    records coverage. The markers are contiguous around the ledger the
+    store started at, so the indexed range is rediscovered on startup and
+    a backfill interrupted part way resumes where it stopped.
+
+    Only one thread may add ledgers; any number may read.
+*/
+class AccountHistoryLog
+{
+public:
+    struct Posting
+    {
+        std::uint32_t ledgerSeq = 0;
+        std::uint32_t txnSeq = 0;
+        uint256 node;
+
+        std::uint64_t
+        position () const
+        {
+            return (std::uint64_t (ledgerSeq) << 32) | txnSeq;
+        }
+    };
+
+    /** A transaction of a ledger being indexed. */
+    struct Entry
+    {
+        std::uint32_t txnSeq;
+        uint256 node;                   // transaction tree leaf
+        std::vector <Account> accounts; // accounts it affects
+    };
+
+    /** A page of postings, in the order requested. */
+    struct Page
+    {
+        std::vector <Posting> postings;
+        bool more = false;
+        Posting next;                   // first posting of the next page
+    };
+
+    explicit
+    AccountHistoryLog (NodeStore::Backend& backend);
+
+    /** Read the indexed range back from the ledger markers. */
+    void
+    load ();
+
+    /** The indexed ledgers, [first, last]. first is zero when empty. */
+    LedgerIndex
+    first () const
+    {
+        return first_;
+    }
+
+    LedgerIndex
+    last () const
+    {
+        return last_;
+    }
+
+    /** Index the ledger after last (), or the first ledger of an empty log.
+        The entries must be in increasing txnSeq order.
+    */
+    void
+    append (LedgerIndex seq, uint256 const& hash,
+        std::vector <Entry> const& entries);
+
+    /** Index the ledger before first () of a log that is not empty.
+        The entries must be in increasing txnSeq order.
+    */
+    void
+    prepend (LedgerIndex seq, uint256 const& hash,
+        std::vector <Entry> const& entries);
+
+    /** Select a page of an account's postings in [minLedger, maxLedger].
+
+        With a marker the page starts at the posting at that position,
+        otherwise offset postings from the start of the range. Returns
+        false if a posting could not be read.
+    */
+    bool
+    getPage (Account const& account,
+        std::uint32_t minLedger, std::uint32_t maxLedger, bool forward,
+        bool hasMarker, std::uint64_t marker, std::uint32_t offset,
+        std::uint32_t numberOfResults, Page& page);
+
+private:
+    // Postings [begin, end) of an account, and the positions of the
+    // first and last of them
+    struct Range
+    {
+        std::int64_t begin = 0;
+        std::int64_t end = 0;
+        std::uint64_t first = 0;
+        std::uint64_t last = 0;
+
+        bool
+        empty () const
+        {
+            return begin == end;
+        }
+    };
+
+    static uint256
+    makeKey (std::uint32_t type, std::uint32_t value = 0);
+
+    static uint256
+    makePostingKey (Account const& account, std::int64_t index);
+
+    bool
+    exists (uint256 const& key);
+
+    bool
+    fetchPosting (Account const& account, std::int64_t index,
+        Posting& posting);
+
+    Range
+    discoverRange (Account const& account);
+
+    Range
+    getRange (Account const& account);
+
+    std::int64_t
+    lowerBound (Account const& account, std::int64_t begin, std::int64_t end,
+        std::uint64_t position, bool& ok);
+
+    void
+    store (LedgerIndex seq, uint256 const& hash,
+        std::vector <Entry> const& entries, bool back);
+
+    NodeStore::Backend& backend_;
+
+    std::atomic <LedgerIndex> first_;
+    std::atomic <LedgerIndex> last_;
+
+    // Written only by the indexing thread, after the postings are stored
+    std::mutex mutex_;
+    hardened_hash_map <Account, Range> ranges_;
+};
+
+}
+
+#endif
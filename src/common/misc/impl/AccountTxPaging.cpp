@@ -18,13 +18,13 @@
 //==============================================================================
 
 #include <BeastConfig.h>
-#include <boost/format.hpp>
 #include <common/misc/Utility.h>
 #include <ledger/LedgerToJson.h>
 #include <main/Application.h>
 #include <common/misc/impl/AccountTxPaging.h>
 #include <transaction/tx/Transaction.h>
 #include <protocol/Serializer.h>
+#include <atomic>
 
 
 namespace skywell {
@@ -59,6 +59,196 @@ saveLedgerAsync (std::uint32_t seq)
         ledger->pendSaveValidated(false, false);
 }
 
+static std::atomic<bool> accountTxIndexExists (false);
+
+void
+buildAccountTxIndex (DatabaseCon& connection, beast::Journal journal)
+{
+    try
+    {
+        // Not the shared session: on a large history the index takes
+        // hours to build, and checkoutDb would hold every other user of
+        // the transaction database for that long.
+        soci::session session;
+        connection.openSession (session);
+
+        int count = 0;
+        if (session.get_backend_name () == "mysql")
+        {
+            session <<
+                "SELECT COUNT(*) FROM information_schema.statistics "
+                "WHERE table_schema = DATABASE() "
+                "AND table_name = 'AccountTransactions' "
+                "AND index_name = 'AcctTxIndex';", soci::into (count);
+        }
+        else
+        {
+            session <<
+                "SELECT COUNT(*) FROM sqlite_master "
+                "WHERE type = 'index' AND name = 'AcctTxIndex';",
+                soci::into (count);
+        }
+
+        if (count == 0)
+        {
+            journal.warning << "Building account transaction index";
+
+            session << "CREATE INDEX AcctTxIndex ON "
+                "AccountTransactions(Account, LedgerSeq, TxnSeq, TransID);";
+
+            journal.warning << "Account transaction index built";
+        }
+
+        accountTxIndexExists = true;
+    }
+    catch (std::exception const& e)
+    {
+        journal.error << "Unable to build account transaction index: " <<
+            e.what ();
+    }
+}
+
+bool
+accountTxIndexReady ()
+{
+    return accountTxIndexExists;
+}
+
+bool
+accountTxOffsetToken (
+    DatabaseCon& connection,
+    SkywellAddress const& account,
+    std::int32_t minLedger,
+    std::int32_t maxLedger,
+    bool forward,
+    std::uint32_t offset,
+    Json::Value& token)
+{
+    // Only the (Account, LedgerSeq, TxnSeq) index is walked to skip
+    // the offset; no transaction rows are read.
+    std::string const sql = forward
+        ? R"(SELECT LedgerSeq,TxnSeq FROM AccountTransactions
+             WHERE Account = :account AND LedgerSeq BETWEEN :first AND :last
+             ORDER BY LedgerSeq ASC, TxnSeq ASC
+             LIMIT :offset, 1;)"
+        : R"(SELECT LedgerSeq,TxnSeq FROM AccountTransactions
+             WHERE Account = :account AND LedgerSeq BETWEEN :first AND :last
+             ORDER BY LedgerSeq DESC, TxnSeq DESC
+             LIMIT :offset, 1;)";
+
+    std::string const accountID (account.humanAccountID ());
+    std::uint32_t first = minLedger;
+    std::uint32_t last = maxLedger;
+
+    boost::optional<std::uint64_t> ledgerSeq;
+    boost::optional<std::uint32_t> txnSeq;
+
+    {
+        auto db (connection.checkoutDb());
+
+        *db << sql,
+            soci::into (ledgerSeq),
+            soci::into (txnSeq),
+            soci::use (accountID, "account"),
+            soci::use (first, "first"),
+            soci::use (last, "last"),
+            soci::use (offset, "offset");
+    }
+
+    if (!ledgerSeq || !txnSeq)
+        return false;
+
+    token = Json::objectValue;
+    token[jss::ledger] = rangeCheckedCast<std::uint32_t>(*ledgerSeq);
+    token[jss::seq] = *txnSeq;
+    return true;
+}
+
+void
+accountTxOffsetPage (
+    DatabaseCon& connection,
+    std::function<void (std::uint32_t)> const& onUnsavedLedger,
+    std::function<void (std::uint32_t,
+                        std::string const&,
+                        std::string const&,
+                        std::string const&)> const& onTransaction,
+    SkywellAddress const& account,
+    std::int32_t minLedger,
+    std::int32_t maxLedger,
+    bool forward,
+    std::uint32_t offset,
+    int limit,
+    bool bAdmin,
+    std::uint32_t page_length)
+{
+    std::uint32_t numberOfResults;
+
+    if (limit <= 0 || (limit > page_length && !bAdmin))
+        numberOfResults = page_length;
+    else
+        numberOfResults = limit;
+
+    std::string const sql = forward
+        ? R"(SELECT AccountTransactions.LedgerSeq,Status,RawTxn,TxnMeta
+             FROM AccountTransactions INNER JOIN Transactions
+             ON Transactions.TransID = AccountTransactions.TransID
+             WHERE AccountTransactions.Account = :account AND
+             AccountTransactions.LedgerSeq BETWEEN :first AND :last
+             ORDER BY AccountTransactions.LedgerSeq ASC,
+             AccountTransactions.TxnSeq ASC, AccountTransactions.TransID ASC
+             LIMIT :offset, :limit;)"
+        : R"(SELECT AccountTransactions.LedgerSeq,Status,RawTxn,TxnMeta
+             FROM AccountTransactions INNER JOIN Transactions
+             ON Transactions.TransID = AccountTransactions.TransID
+             WHERE AccountTransactions.Account = :account AND
+             AccountTransactions.LedgerSeq BETWEEN :first AND :last
+             ORDER BY AccountTransactions.LedgerSeq DESC,
+             AccountTransactions.TxnSeq DESC, AccountTransactions.TransID DESC
+             LIMIT :offset, :limit;)";
+
+    std::string const accountID (account.humanAccountID ());
+    std::uint32_t first = minLedger;
+    std::uint32_t last = maxLedger;
+
+    auto db (connection.checkoutDb());
+
+    std::string const empty;
+
+    boost::optional<std::uint64_t> ledgerSeq;
+    boost::optional<std::string> status;
+    boost::optional<std::string> txnData;
+    boost::optional<std::string> txnMeta;
+    soci::indicator dataPresent, metaPresent;
+
+    soci::statement st = (db->prepare << sql,
+        soci::into (ledgerSeq),
+        soci::into (status),
+        soci::into (txnData, dataPresent),
+        soci::into (txnMeta, metaPresent),
+        soci::use (accountID, "account"),
+        soci::use (first, "first"),
+        soci::use (last, "last"),
+        soci::use (offset, "offset"),
+        soci::use (numberOfResults, "limit"));
+
+    st.execute ();
+
+    while (st.fetch ())
+    {
+        std::string const& rawData =
+            (dataPresent == soci::i_ok) ? *txnData : empty;
+        std::string const& rawMeta =
+            (metaPresent == soci::i_ok) ? *txnMeta : empty;
+
+        // Work around a bug that could leave the metadata missing
+        if (rawMeta.size() == 0)
+            onUnsavedLedger(ledgerSeq.value_or (0));
+
+        onTransaction(rangeCheckedCast<std::uint32_t>(ledgerSeq.value_or (0)),
+            *status, rawData, rawMeta);
+    }
+}
+
 void
 accountTxPage (
     DatabaseCon& connection,
@@ -112,92 +302,57 @@ accountTxPage (
     // we need to clear it in between.
     token = Json::nullValue;
 
-    static std::string const prefix (
+    // The query is a single range over the (Account, LedgerSeq, TxnSeq)
+    // index, starting at either end of the ledger range or at the marker,
+    // so the cost of a page does not depend on how deep into the history
+    // it is. Within the marker's ledger, rows on the wrong side of the
+    // marker are filtered out of the index range. Without a marker,
+    // findLedger is zero and that filter matches everything.
+    static std::string const forwardSQL (
         R"(SELECT AccountTransactions.LedgerSeq,AccountTransactions.TxnSeq,
           Status,RawTxn,TxnMeta
           FROM AccountTransactions INNER JOIN Transactions
           ON Transactions.TransID = AccountTransactions.TransID
-          AND AccountTransactions.Account = '%s' WHERE
-          )");
-
-    std::string sql;
+          WHERE AccountTransactions.Account = :account AND
+          AccountTransactions.LedgerSeq BETWEEN :first AND :last AND
+          (AccountTransactions.LedgerSeq <> :findLedger OR
+           AccountTransactions.TxnSeq >= :findSeq)
+          ORDER BY AccountTransactions.LedgerSeq ASC,
+          AccountTransactions.TxnSeq ASC
+          LIMIT :limit;)");
+
+    static std::string const backwardSQL (
+        R"(SELECT AccountTransactions.LedgerSeq,AccountTransactions.TxnSeq,
+          Status,RawTxn,TxnMeta
+          FROM AccountTransactions INNER JOIN Transactions
+          ON Transactions.TransID = AccountTransactions.TransID
+          WHERE AccountTransactions.Account = :account AND
+          AccountTransactions.LedgerSeq BETWEEN :first AND :last AND
+          (AccountTransactions.LedgerSeq <> :findLedger OR
+           AccountTransactions.TxnSeq <= :findSeq)
+          ORDER BY AccountTransactions.LedgerSeq DESC,
+          AccountTransactions.TxnSeq DESC
+          LIMIT :limit;)");
 
     // SQL's BETWEEN uses a closed interval ([a,b])
+    std::uint32_t first = minLedger;
+    std::uint32_t last = maxLedger;
 
-    if (forward && (findLedger == 0))
+    if (findLedger != 0)
     {
-        sql = boost::str (boost::format(
-            prefix +
-            (R"(AccountTransactions.LedgerSeq BETWEEN '%u' AND '%u'
-             ORDER BY AccountTransactions.LedgerSeq ASC,
-             AccountTransactions.TxnSeq ASC
-             LIMIT %u;)"))
-            % account.humanAccountID()
-            % minLedger
-            % maxLedger
-            % queryLimit);
-    }
-    else if (forward && (findLedger != 0))
-    {
-        sql = boost::str (boost::format(
-            prefix +
-            (R"(
-            AccountTransactions.LedgerSeq BETWEEN '%u' AND '%u' OR
-            ( AccountTransactions.LedgerSeq = '%u' AND
-              AccountTransactions.TxnSeq >= '%u' )
-            ORDER BY AccountTransactions.LedgerSeq ASC,
-            AccountTransactions.TxnSeq ASC
-            LIMIT %u;
-            )"))
-        % account.humanAccountID()
-        % (findLedger + 1)
-        % maxLedger
-        % findLedger
-        % findSeq
-        % queryLimit);
-    }
-    else if (!forward && (findLedger == 0))
-    {
-        sql = boost::str (boost::format(
-            prefix +
-            (R"(AccountTransactions.LedgerSeq BETWEEN '%u' AND '%u'
-             ORDER BY AccountTransactions.LedgerSeq DESC,
-             AccountTransactions.TxnSeq DESC
-             LIMIT %u;)"))
-            % account.humanAccountID()
-            % minLedger
-            % maxLedger
-            % queryLimit);
-    }
-    else if (!forward && (findLedger != 0))
-    {
-        sql = boost::str (boost::format(
-            prefix +
-            (R"(AccountTransactions.LedgerSeq BETWEEN '%u' AND '%u' OR
-             (AccountTransactions.LedgerSeq = '%u' AND
-              AccountTransactions.TxnSeq <= '%u')
-             ORDER BY AccountTransactions.LedgerSeq DESC,
-             AccountTransactions.TxnSeq DESC
-             LIMIT %u;)"))
-            % account.humanAccountID()
-            % minLedger
-            % (findLedger - 1)
-            % findLedger
-            % findSeq
-            % queryLimit);
-    }
-    else
-    {
-        assert (false);
-        // sql is empty
-        return;
+        if (forward)
+            first = findLedger;
+        else
+            last = findLedger;
     }
 
+    std::string const& sql = forward ? forwardSQL : backwardSQL;
+    std::string const accountID (account.humanAccountID ());
+
     {
         auto db (connection.checkoutDb());
 
-        std::string rawData;
-        std::string rawMeta;
+        std::string const empty;
 
         boost::optional<std::uint64_t> ledgerSeq;
         boost::optional<std::uint32_t> txnSeq;
@@ -211,7 +366,13 @@ accountTxPage (
             soci::into (txnSeq),
             soci::into (status),
             soci::into (txnData, dataPresent),
-            soci::into (txnMeta, metaPresent));
+            soci::into (txnMeta, metaPresent),
+            soci::use (accountID, "account"),
+            soci::use (first, "first"),
+            soci::use (last, "last"),
+            soci::use (findLedger, "findLedger"),
+            soci::use (findSeq, "findSeq"),
+            soci::use (queryLimit, "limit"));
 
         st.execute ();
 
@@ -235,25 +396,17 @@ accountTxPage (
 
             if (!lookingForMarker)
             {
-				if (dataPresent == soci::i_ok){
-					//convert(txnData, rawData);
-					rawData = *txnData;
-				}                  
-                else
-                    rawData.clear ();
-
-				if (metaPresent == soci::i_ok){
-					//convert(txnMeta, rawMeta);
-					rawMeta = *txnMeta;
-				} 
-                else
-                    rawMeta.clear ();
+                // The blobs are handed over straight from the row buffers
+                std::string const& rawData =
+                    (dataPresent == soci::i_ok) ? *txnData : empty;
+                std::string const& rawMeta =
+                    (metaPresent == soci::i_ok) ? *txnMeta : empty;
 
                 // Work around a bug that could leave the metadata missing
                 if (rawMeta.size() == 0)
                     onUnsavedLedger(ledgerSeq.value_or (0));
 
-               onTransaction(rangeCheckedCast<std::uint32_t>(ledgerSeq.value_or (0)),
+                onTransaction(rangeCheckedCast<std::uint32_t>(ledgerSeq.value_or (0)),
                     *status, rawData, rawMeta);
                 --numberOfResults;
             }
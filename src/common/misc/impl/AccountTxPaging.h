@@ -26,6 +26,7 @@
 
 #include <data/database/DatabaseCon.h>
 #include <common/misc/NetworkOPs.h>
+#include <beast/utility/Journal.h>
 
 //------------------------------------------------------------------------------
 
@@ -42,6 +43,56 @@ convertBlobsToTxResult (
 void
 saveLedgerAsync (std::uint32_t seq);
 
+/** Create AcctTxIndex on AccountTransactions if it does not exist yet.
+    On a large history this takes a long time, so it is run as a
+    background job once the server is up, on a session of its own:
+    callers of checkoutDb are not blocked while it runs.
+*/
+void
+buildAccountTxIndex (DatabaseCon& database, beast::Journal journal);
+
+/** Returns true once AcctTxIndex is known to exist.
+    The seek queries below rely on it. Until it exists, offset based
+    requests use accountTxOffsetPage, which scans the table only once.
+*/
+bool
+accountTxIndexReady ();
+
+/** Find the marker of the transaction at a position in an account's history.
+    This lets offset based requests be served by the same seek queries as
+    marker based ones. Returns false if there is no transaction there.
+*/
+bool
+accountTxOffsetToken (
+    DatabaseCon& database,
+    SkywellAddress const& account,
+    std::int32_t minLedger,
+    std::int32_t maxLedger,
+    bool forward,
+    std::uint32_t offset,
+    Json::Value& token);
+
+/** Read one page of an account's history starting at an offset.
+    This is the query account_tx used before AcctTxIndex existed, with
+    the offset and page applied by the database in a single statement.
+*/
+void
+accountTxOffsetPage (
+    DatabaseCon& database,
+    std::function<void (std::uint32_t)> const& onUnsavedLedger,
+    std::function<void (std::uint32_t,
+                        std::string const&,
+                        std::string const&,
+                        std::string const&)> const& onTransaction,
+    SkywellAddress const& account,
+    std::int32_t minLedger,
+    std::int32_t maxLedger,
+    bool forward,
+    std::uint32_t offset,
+    int limit,
+    bool bAdmin,
+    std::uint32_t pageLength);
+
 void
 accountTxPage (
     DatabaseCon& database,
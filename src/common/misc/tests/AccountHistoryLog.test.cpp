@@ -0,0 +1,395 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <common/misc/impl/AccountHistoryLog.h>
+#include <beast/unit_test/suite.h>
+#include <algorithm>
+#include <map>
+#include <random>
+
+namespace skywell {
+namespace tests {
+
+class AccountHistoryLog_test : public beast::unit_test::suite
+{
+public:
+    using Log = AccountHistoryLog;
+
+    // Keeps the objects in memory, so a log can be reopened
+    class MapBackend : public NodeStore::Backend
+    {
+    public:
+        std::map <uint256, NodeObject::Ptr> objects;
+
+        std::string getName () override { return "map"; }
+        void close () override { }
+
+        NodeStore::Status
+        fetch (void const* key, NodeObject::Ptr* pObject) override
+        {
+            auto const iter = objects.find (uint256::fromVoid (key));
+
+            if (iter == objects.end ())
+                return NodeStore::notFound;
+
+            *pObject = iter->second;
+            return NodeStore::ok;
+        }
+
+        bool canFetchBatch () override { return false; }
+
+        std::vector <std::shared_ptr <NodeObject>>
+        fetchBatch (std::size_t, void const* const*) override
+        {
+            return {};
+        }
+
+        void
+        store (NodeObject::Ptr const& object) override
+        {
+            objects[object->getHash ()] = object;
+        }
+
+        void
+        storeBatch (NodeStore::Batch const& batch) override
+        {
+            for (auto const& object : batch)
+                store (object);
+        }
+
+        void
+        for_each (std::function <void (NodeObject::Ptr)> f) override
+        {
+            for (auto const& object : objects)
+                f (object.second);
+        }
+
+        int getWriteLoad () override { return 0; }
+        void setDeletePath () override { }
+        void verify () override { }
+    };
+
+    //--------------------------------------------------------------------------
+
+    static std::size_t const accountCount = 6;
+
+    // The transactions of each ledger, and the postings they should make
+    std::map <LedgerIndex, std::vector <Log::Entry>> ledgers_;
+
+    static Account
+    account (std::size_t i)
+    {
+        return Account (std::uint64_t (i + 1));
+    }
+
+    void
+    generate (LedgerIndex first, LedgerIndex last, std::uint32_t seed)
+    {
+        std::mt19937 gen (seed);
+        std::uniform_int_distribution <std::size_t> txns (0, 4);
+        std::uniform_int_distribution <std::size_t> which (0, accountCount - 1);
+
+        for (LedgerIndex seq = first; seq <= last; ++seq)
+        {
+            auto& entries = ledgers_[seq];
+            std::size_t const count = txns (gen);
+
+            for (std::uint32_t txnSeq = 0; txnSeq < count; ++txnSeq)
+            {
+                Log::Entry entry;
+                entry.txnSeq = txnSeq;
+                entry.node = uint256 ((std::uint64_t (seq) << 32) | txnSeq);
+
+                std::size_t const a = which (gen);
+                std::size_t const b = which (gen);
+                entry.accounts.push_back (account (a));
+                if (b != a)
+                    entry.accounts.push_back (account (b));
+
+                entries.push_back (std::move (entry));
+            }
+        }
+    }
+
+    static uint256
+    ledgerHash (LedgerIndex seq)
+    {
+        return uint256 (std::uint64_t (seq));
+    }
+
+    // Every posting of an account in [minLedger, maxLedger], oldest first
+    std::vector <Log::Posting>
+    expected (Account const& account,
+        LedgerIndex minLedger, LedgerIndex maxLedger)
+    {
+        std::vector <Log::Posting> result;
+
+        for (auto iter = ledgers_.lower_bound (minLedger);
+            iter != ledgers_.end () && iter->first <= maxLedger; ++iter)
+        {
+            for (auto const& entry : iter->second)
+            {
+                if (std::find (entry.accounts.begin (), entry.accounts.end (),
+                        account) == entry.accounts.end ())
+                    continue;
+
+                Log::Posting posting;
+                posting.ledgerSeq = iter->first;
+                posting.txnSeq = entry.txnSeq;
+                posting.node = entry.node;
+                result.push_back (posting);
+            }
+        }
+
+        return result;
+    }
+
+    static bool
+    same (Log::Posting const& lhs, Log::Posting const& rhs)
+    {
+        return lhs.ledgerSeq == rhs.ledgerSeq &&
+            lhs.txnSeq == rhs.txnSeq && lhs.node == rhs.node;
+    }
+
+    // Read the whole range through pages of the given size and compare it
+    // with the model, then check a page selected by offset.
+    void
+    checkRange (Log& log, Account const& account,
+        LedgerIndex minLedger, LedgerIndex maxLedger, bool forward,
+        std::uint32_t pageSize)
+    {
+        std::vector <Log::Posting> want = expected (account, minLedger, maxLedger);
+        if (! forward)
+            std::reverse (want.begin (), want.end ());
+
+        std::vector <Log::Posting> got;
+        bool hasMarker = false;
+        std::uint64_t marker = 0;
+
+        for (std::size_t pages = 0; pages <= want.size (); ++pages)
+        {
+            Log::Page page;
+
+            if (! log.getPage (account, minLedger, maxLedger, forward,
+                    hasMarker, marker, 0, pageSize, page))
+            {
+                fail ("getPage failed");
+                return;
+            }
+
+            got.insert (got.end (), page.postings.begin (), page.postings.end ());
+
+            if (! page.more)
+                break;
+
+            hasMarker = true;
+            marker = page.next.position ();
+        }
+
+        bool match = got.size () == want.size ();
+
+        for (std::size_t i = 0; match && i < got.size (); ++i)
+            match = same (got[i], want[i]);
+
+        expect (match, "marker pages differ from the model");
+
+        std::uint32_t const offset = want.size () / 3;
+        Log::Page page;
+
+        if (! log.getPage (account, minLedger, maxLedger, forward,
+                false, 0, offset, pageSize, page))
+        {
+            fail ("getPage failed");
+            return;
+        }
+
+        std::size_t const count = std::min <std::size_t> (
+            pageSize, want.size () - offset);
+
+        match = page.postings.size () == count &&
+            page.more == (offset + count < want.size ());
+
+        for (std::size_t i = 0; match && i < count; ++i)
+            match = same (page.postings[i], want[offset + i]);
+
+        expect (match, "offset page differs from the model");
+    }
+
+    void
+    checkAll (Log& log)
+    {
+        std::mt19937 gen (7);
+        std::uniform_int_distribution <LedgerIndex> seq (log.first (), log.last ());
+
+        for (std::size_t i = 0; i < accountCount; ++i)
+        {
+            checkRange (log, account (i), log.first (), log.last (), true, 7);
+            checkRange (log, account (i), log.first (), log.last (), false, 7);
+
+            LedgerIndex a = seq (gen);
+            LedgerIndex b = seq (gen);
+            if (a > b)
+                std::swap (a, b);
+
+            checkRange (log, account (i), a, b, true, 3);
+            checkRange (log, account (i), a, b, false, 3);
+        }
+    }
+
+    void
+    append (Log& log, LedgerIndex first, LedgerIndex last)
+    {
+        for (LedgerIndex seq = first; seq <= last; ++seq)
+            log.append (seq, ledgerHash (seq), ledgers_[seq]);
+    }
+
+    void
+    prepend (Log& log, LedgerIndex first, LedgerIndex last)
+    {
+        for (LedgerIndex seq = last; seq >= first; --seq)
+            log.prepend (seq, ledgerHash (seq), ledgers_[seq]);
+    }
+
+    //--------------------------------------------------------------------------
+
+    void
+    testAppend ()
+    {
+        testcase ("append");
+
+        MapBackend backend;
+        {
+            Log log (backend);
+            log.load ();
+            expect (log.first () == 0, "new log is not empty");
+
+            append (log, 100, 199);
+            expect (log.first () == 100 && log.last () == 199);
+            checkAll (log);
+        }
+
+        Log log (backend);
+        log.load ();
+        expect (log.first () == 100 && log.last () == 199,
+            "reopened log lost its range");
+        checkAll (log);
+
+        append (log, 200, 230);
+        expect (log.last () == 230);
+        checkAll (log);
+    }
+
+    void
+    testBackfill ()
+    {
+        testcase ("backfill");
+
+        MapBackend backend;
+        {
+            Log log (backend);
+            append (log, 150, 199);
+        }
+
+        // Interrupted part way through the gap
+        {
+            Log log (backend);
+            log.load ();
+            expect (log.first () == 150 && log.last () == 199);
+
+            prepend (log, 131, 149);
+            expect (log.first () == 131);
+            checkAll (log);
+        }
+
+        Log log (backend);
+        log.load ();
+        expect (log.first () == 131 && log.last () == 199,
+            "reopened log lost its backfilled range");
+
+        prepend (log, 100, 130);
+        append (log, 200, 230);
+        expect (log.first () == 100 && log.last () == 230);
+        checkAll (log);
+
+        // A log that only backfilled still reopens
+        Log again (backend);
+        again.load ();
+        expect (again.first () == 100 && again.last () == 230);
+        checkAll (again);
+    }
+
+    void
+    testIdempotent ()
+    {
+        testcase ("idempotent");
+
+        MapBackend backend;
+        {
+            Log log (backend);
+            append (log, 100, 150);
+        }
+
+        // Lose the marker of the last ledger, as if the batch holding its
+        // postings was only partly written.
+        uint256 const hash = ledgerHash (150);
+
+        for (auto iter = backend.objects.begin ();
+            iter != backend.objects.end (); ++iter)
+        {
+            Blob const& data = iter->second->getData ();
+
+            if (data.size () == hash.size () &&
+                std::equal (data.begin (), data.end (), hash.begin ()))
+            {
+                backend.objects.erase (iter);
+                break;
+            }
+        }
+
+        Log log (backend);
+        log.load ();
+        expect (log.last () == 149, "marker was not removed");
+
+        std::size_t const objects = backend.objects.size ();
+
+        // Indexing the ledger again adds its marker but no postings
+        append (log, 150, 150);
+        expect (backend.objects.size () == objects + 1,
+            "postings were duplicated");
+        expect (log.last () == 150);
+        checkAll (log);
+    }
+
+    void
+    run () override
+    {
+        generate (100, 230, 42);
+
+        testAppend ();
+        testBackfill ();
+        testIdempotent ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(AccountHistoryLog,misc,skywell);
+
+}
+}
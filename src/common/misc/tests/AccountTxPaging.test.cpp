@@ -0,0 +1,166 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <common/misc/impl/AccountTxPaging.h>
+#include <beast/unit_test/suite.h>
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+
+namespace skywell {
+namespace tests {
+
+class AccountTxPaging_test : public beast::unit_test::suite
+{
+public:
+    class TempDatabase
+    {
+    public:
+        TempDatabase ()
+            : path_ (boost::filesystem::temp_directory_path () /
+                boost::filesystem::unique_path ("txn-%%%%-%%%%.db"))
+        {
+        }
+
+        ~TempDatabase ()
+        {
+            boost::system::error_code ec;
+            boost::filesystem::remove (path_, ec);
+        }
+
+        std::string
+        path () const
+        {
+            return path_.string ();
+        }
+
+    private:
+        boost::filesystem::path path_;
+    };
+
+    static void
+    fill (DatabaseCon& connection, int rows)
+    {
+        auto db (connection.checkoutDb ());
+
+        *db << "CREATE TABLE AccountTransactions ("
+            "TransID CHARACTER(64), Account CHARACTER(64), "
+            "LedgerSeq BIGINT UNSIGNED, TxnSeq INTEGER);";
+
+        soci::transaction tr (*db);
+
+        for (int i = 0; i < rows; ++i)
+        {
+            std::string const id = std::to_string (i);
+            std::string const account = "account" + std::to_string (i % 97);
+            int const ledger = i / 10;
+            int const seq = i % 10;
+
+            *db << "INSERT INTO AccountTransactions VALUES "
+                "(:id, :account, :ledger, :seq);",
+                soci::use (id), soci::use (account),
+                soci::use (ledger), soci::use (seq);
+        }
+
+        tr.commit ();
+    }
+
+    static int
+    indexCount (soci::session& session)
+    {
+        int count = 0;
+        session << "SELECT COUNT(*) FROM sqlite_master "
+            "WHERE type = 'index' AND name = 'AcctTxIndex';",
+            soci::into (count);
+        return count;
+    }
+
+    void
+    testMissingTable ()
+    {
+        testcase ("missing table");
+
+        TempDatabase file;
+        DatabaseCon connection ("sqlite", file.path (), nullptr, 0);
+
+        buildAccountTxIndex (connection, beast::Journal ());
+        expect (!accountTxIndexReady (),
+            "index reported ready after a failed build");
+    }
+
+    // The build must finish while another user holds checkoutDb
+    void
+    testBuild ()
+    {
+        testcase ("build");
+
+        TempDatabase file;
+        DatabaseCon connection ("sqlite", file.path (), nullptr, 0);
+        fill (connection, 20000);
+
+        std::packaged_task <void ()> task ([&connection]
+            {
+                buildAccountTxIndex (connection, beast::Journal ());
+            });
+        auto built = task.get_future ();
+        std::thread builder;
+
+        {
+            auto db (connection.checkoutDb ());
+            builder = std::thread (std::move (task));
+
+            auto const status = built.wait_for (std::chrono::seconds (60));
+            expect (status == std::future_status::ready,
+                "the build waited for checkoutDb");
+
+            int rows = 0;
+            *db << "SELECT COUNT(*) FROM AccountTransactions;",
+                soci::into (rows);
+            expect (rows == 20000, "the held session is unusable");
+        }
+
+        // A build stuck on the lock can only finish once it is released
+        builder.join ();
+
+        expect (accountTxIndexReady (), "index not reported ready");
+        expect (indexCount (*connection.checkoutDb ()) == 1,
+            "index not created");
+
+        // An existing index is detected and left alone
+        buildAccountTxIndex (connection, beast::Journal ());
+        expect (accountTxIndexReady (), "index no longer reported ready");
+        expect (indexCount (*connection.checkoutDb ()) == 1,
+            "index created twice");
+    }
+
+    void
+    run ()
+    {
+        testMissingTable ();
+        testBuild ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(AccountTxPaging,misc,skywell);
+
+}
+}
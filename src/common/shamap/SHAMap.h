@@ -77,6 +77,8 @@ using MissingNodeHandler = std::function <void (std::uint32_t refNum)>;
 class SHAMap
 {
 private:
+    friend class SHAMapBuilder;
+
     using Family = shamap::Family;
 
     Family&                         f_;
@@ -156,6 +158,13 @@ public:
     void visitNodes (std::function<bool (SHAMapTreeNode&)> const&) const;
     void visitLeaves(std::function<void (std::shared_ptr<SHAMapItem> const&)> const&) const;
 
+    /** Visit the nodes held in memory that no map in `others` holds.
+        Nothing is fetched. The children of a node are not visited when
+        the function returns `false` for it.
+    */
+    void visitResidentDifferences (std::vector<SHAMap const*> const& others,
+        std::function<bool (SHAMapTreeNode const&)> const&) const;
+
     // comparison/sync functions
     void getMissingNodes (std::vector<SHAMapNodeID>& nodeIDs, std::vector<uint256>& hashes, int max,
                           SHAMapSyncFilter * filter);
@@ -197,6 +206,20 @@ public:
     void getFetchPack (SHAMap * have, bool includeLeaves, int max,
         std::function<void (uint256 const&, const Blob&)>) const;
 
+    /** Like getFetchPack, but the root's branches are walked in parallel.
+
+        `schedule` is called up to `helpers` times with work to run on
+        another thread. The calling thread walks branches too, and never
+        waits for work that has not started, so work that runs late only
+        costs parallelism. Each branch gets an equal share of max; budget
+        left unused by small branches goes to those that ran out of it.
+        Nodes are reported on the calling thread, root first and then in
+        branch order.
+    */
+    void getFetchPack (SHAMap * have, bool includeLeaves, int max,
+        int helpers, std::function<void (std::function<void ()>)> const& schedule,
+        std::function<void (uint256 const&, const Blob&)>) const;
+
     void setUnbacked ();
 
     void dump (bool withHashes = false) const;
@@ -273,6 +296,13 @@ private:
     bool hasInnerNode (SHAMapNodeID const& nodeID, uint256 const& hash) const;
     bool hasLeafNode (uint256 const& tag, uint256 const& hash) const;
 
+    /** Visit the nodes below `from` that `have` lacks.
+        Returns `false` if the visitor stopped the walk.
+    */
+    bool visitSubtreeDifferences (SHAMapTreeNode* from,
+        SHAMapNodeID const& fromID, SHAMap* have,
+        std::function <bool (SHAMapTreeNode&)> const& func) const;
+
     bool walkBranch (SHAMapTreeNode* node,
                      std::shared_ptr<SHAMapItem> const& otherMapItem, bool isFirstMap,
                      Delta & differences, int & maxCount) const;
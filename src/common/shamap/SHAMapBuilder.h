@@ -0,0 +1,111 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef SKYWELL_SHAMAP_SHAMAPBUILDER_H_INCLUDED
+#define SKYWELL_SHAMAP_SHAMAPBUILDER_H_INCLUDED
+
+#include <common/shamap/SHAMap.h>
+#include <data/nodestore/Types.h>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace skywell {
+
+/** Builds a SHAMap from items supplied in ascending order of their tags.
+
+    The tree is assembled bottom-up. Each item is placed once its successor
+    is known, and an inner node is hashed as soon as the last item below it
+    has been placed, so nodes are never split, copied or rehashed.
+
+    Items are gathered by the branch of the root they belong to. Once the
+    items move on to the next branch, the subtree for the previous one is
+    built, on a thread of its own if more than one thread was requested.
+    If requested, finished nodes are written to the node store in batches
+    that go directly to the backend.
+*/
+class SHAMapBuilder
+{
+public:
+    SHAMapBuilder (SHAMapBuilder const&) = delete;
+    SHAMapBuilder& operator= (SHAMapBuilder const&) = delete;
+
+    /** Prepare to fill `map`, which must be empty.
+
+        @param leafType The type of every leaf in the map.
+        @param write `true` to store the nodes in the map's node store.
+        @param threads The number of subtrees to build at once.
+    */
+    SHAMapBuilder (SHAMap& map, SHAMapTreeNode::TNType leafType,
+        bool write, int threads = 1);
+
+    /** Add the next item.
+        Throws std::invalid_argument if its tag does not follow the tag
+        of the previous item.
+    */
+    void add (std::shared_ptr<SHAMapItem> const& item);
+
+    /** Build what remains, finish the tree and hook it to the map.
+        Returns the number of nodes built.
+    */
+    std::size_t finish ();
+
+private:
+    class Subtree;
+
+    using Items = std::vector<std::shared_ptr<SHAMapItem>>;
+    using Result = std::pair<std::shared_ptr<SHAMapTreeNode>, std::size_t>;
+
+    // Start building the subtree for the items gathered so far
+    void launch ();
+
+    // Wait for the oldest subtree being built and hook it to the root
+    void collect ();
+
+    Result build (int branch, Items const& items);
+
+    // Make a finished node shareable and queue it for writing
+    void share (std::shared_ptr<SHAMapTreeNode>& node, NodeStore::Batch& batch);
+    void store (NodeStore::Batch const& batch);
+
+    SHAMap& map_;
+    SHAMapTreeNode::TNType const leafType_;
+    NodeObjectType const objectType_;
+    bool const write_;
+    std::size_t const threads_;
+
+    std::shared_ptr<SHAMapTreeNode> root_;
+    std::size_t nodes_ = 0;
+    std::mutex storeLock_;
+
+    // The items for the root branch currently being added
+    int branch_ = -1;
+    Items items_;
+    std::shared_ptr<SHAMapItem> last_;
+
+    // Subtrees being built, oldest first. Declared last, so that the
+    // threads are joined before anything they use is destroyed.
+    std::deque<std::pair<int, std::future<Result>>> building_;
+};
+
+} // skywell
+
+#endif
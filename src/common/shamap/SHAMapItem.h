@@ -38,6 +38,7 @@ private:
 public:
     explicit SHAMapItem (uint256 const& tag);
     SHAMapItem (uint256 const& tag, Blob const & data);
+    SHAMapItem (uint256 const& tag, void const* data, std::size_t size);
     SHAMapItem (uint256 const& tag, Serializer const& s);
     SHAMapItem (uint256 const& tag, Serializer&& s);
     uint256 const& getTag() const;
@@ -46,11 +47,11 @@ public:
 
 public:  // public only to SHAMapTreeNode
     std::size_t size() const;
+    void const* data() const;
 
 private:
     explicit SHAMapItem (Blob const& data);
 
-    void const* data() const;
     void addRaw (Blob& s) const;
     void dump (beast::Journal journal);
 };
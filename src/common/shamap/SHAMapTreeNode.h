@@ -32,6 +32,8 @@
 
 namespace skywell {
 
+class SHA512HalfBatch;
+
 enum SHANodeFormat
 {
     snfPREFIX   = 1, // Form that hashes to its official hash
@@ -120,6 +122,11 @@ public:  // public only to SHAMap
     bool updateHash ();
     void updateHashDeep();
 
+    // Queue the hash computation; the node hash is valid after
+    // the batch is finished
+    void updateHash (SHA512HalfBatch& batch);
+    void updateHashDeep (SHA512HalfBatch& batch);
+
 private:
     bool isTransaction () const;
     bool hasMetaData () const;
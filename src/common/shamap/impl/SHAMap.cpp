@@ -19,6 +19,7 @@
 
 #include <BeastConfig.h>
 #include <common/shamap/SHAMap.h>
+#include <protocol/SHA512Half.h>
 
 namespace skywell {
 
@@ -937,7 +938,9 @@ void SHAMap::writeNode (
 
     canonicalize (node->getNodeHash(), node);
 
-    Serializer s;
+    // Size the buffer for the prefix form up front: 512 bytes of child
+    // hashes for inner nodes, item data and tag for leaves
+    Serializer s (4 + (node->isInner () ? 512 : node->peekItem ()->size () + 32));
     node->addRaw (s, snfPREFIX);
     f_.db().store (t,
         std::move (s.modData ()), node->getNodeHash ());
@@ -976,7 +979,6 @@ int
 SHAMap::walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq)
 {
     int flushed = 0;
-    Serializer s;
 
     if (!root_ || (root_->getSeq() == 0) || root_->isEmpty ())
         return flushed;
@@ -989,6 +991,17 @@ SHAMap::walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq)
         return 1;
     }
 
+    // Modified nodes in the order they must be written, children before
+    // their parent, with the inner node and branch that links to them.
+    struct DirtyNode
+    {
+        std::shared_ptr<SHAMapTreeNode> node;
+        SHAMapTreeNode* parent;
+        int branch;
+        int depth;
+    };
+    std::vector<DirtyNode> dirty;
+
     // Stack of {parent,index,child} pointers representing
     // inner nodes we are in the process of flushing
     using StackEntry = std::pair <std::shared_ptr<SHAMapTreeNode>, int>;
@@ -998,8 +1011,10 @@ SHAMap::walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq)
     preFlushNode (node);
 
     int pos = 0;
+    int maxDepth = 0;
 
-    // We can't flush an inner node until we flush its children
+    // Collect the modified nodes. We can't hash an inner node
+    // until we hash its children.
     while (1)
     {
         while (pos < 16)
@@ -1037,28 +1052,24 @@ SHAMap::walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq)
                         preFlushNode (child);
 
                         assert (node->getSeq() == seq_);
-                        child->updateHash();
-
-                        if (doWrite && backed_)
-                            writeNode (t, seq, child);
-
                         node->shareChild (branch, child);
+                        dirty.push_back ({std::move (child), node.get (),
+                            branch, -1});
                     }
                 }
             }
         }
 
-        // update the hash of this inner node
-        node->updateHashDeep();
-
-        // This inner node can now be shared
-        if (doWrite && backed_)
-            writeNode (t, seq, node);
-
         ++flushed;
 
+        int const depth = static_cast<int> (stack.size ());
+        maxDepth = std::max (maxDepth, depth);
+
         if (stack.empty ())
-           break;
+        {
+            dirty.push_back ({std::move (node), nullptr, 0, depth});
+            break;
+        }
 
         std::shared_ptr<SHAMapTreeNode> parent = std::move (stack.top().first);
         pos = stack.top().second;
@@ -1067,14 +1078,46 @@ SHAMap::walkSubTree (bool doWrite, NodeObjectType t, std::uint32_t seq)
         // Hook this inner node to its parent
         assert (parent->getSeq() == seq_);
         parent->shareChild (pos, node);
+        dirty.push_back ({std::move (node), parent.get (), pos, depth});
 
         // Continue with parent's next child, if any
         node = std::move (parent);
         ++pos;
     }
 
+    // Hash the leaves, then the inner nodes one level at a time from the
+    // bottom up, so that each batch only depends on earlier batches.
+    std::vector<std::vector<SHAMapTreeNode*>> levels (maxDepth + 1);
+    SHA512HalfBatch batch;
+
+    for (auto& d : dirty)
+    {
+        if (d.depth < 0)
+            d.node->updateHash (batch);
+        else
+            levels[d.depth].push_back (d.node.get ());
+    }
+    batch.finish ();
+
+    for (auto level = levels.rbegin (); level != levels.rend (); ++level)
+    {
+        for (auto inner : *level)
+            inner->updateHashDeep (batch);
+        batch.finish ();
+    }
+
+    // These nodes can now be shared
+    for (auto& d : dirty)
+    {
+        if (doWrite && backed_)
+            writeNode (t, seq, d.node);
+
+        if (d.parent)
+            d.parent->shareChild (d.branch, d.node);
+    }
+
     // Last inner node is the new root_
-    root_ = std::move (node);
+    root_ = std::move (dirty.back ().node);
 
     return flushed;
 }
@@ -0,0 +1,298 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <common/shamap/SHAMapBuilder.h>
+#include <algorithm>
+#include <stdexcept>
+
+namespace skywell {
+
+namespace {
+
+// The branch `tag` takes below an inner node at `depth`
+int selectBranch (uint256 const& tag, int depth)
+{
+    int const branch = * (tag.begin () + (depth / 2));
+
+    return (depth & 1) ? (branch & 0xf) : (branch >> 4);
+}
+
+// The number of leading nibbles two tags have in common
+int sharedNibbles (uint256 const& a, uint256 const& b)
+{
+    auto pa = a.begin ();
+    auto pb = b.begin ();
+
+    for (int i = 0; i < 32; ++i)
+    {
+        if (pa[i] != pb[i])
+            return 2 * i + (((pa[i] ^ pb[i]) & 0xf0) ? 0 : 1);
+    }
+
+    return 64;
+}
+
+}
+
+// Builds the part of the tree below one branch of the root. The inner
+// nodes along the path to the last item placed are kept, indexed by depth,
+// with a stand-in for the root at the bottom.
+class SHAMapBuilder::Subtree
+{
+public:
+    explicit Subtree (SHAMapBuilder& builder)
+        : builder_ (builder)
+    {
+        auto root = std::make_shared<SHAMapTreeNode> (builder_.map_.seq_);
+        root->makeInner ();
+        path_.push_back (std::move (root));
+
+        if (builder_.write_)
+            batch_.reserve (NodeStore::batchWritePreallocationSize);
+    }
+
+    void add (std::shared_ptr<SHAMapItem> const& item)
+    {
+        if (pending_)
+        {
+            int const shared = sharedNibbles (pending_->getTag (), item->getTag ());
+
+            // An item hangs from the deepest inner node that also
+            // leads to one of its neighbours
+            place (pending_, pendingShared_, std::max (pendingShared_, shared));
+            pendingShared_ = shared;
+        }
+
+        pending_ = item;
+    }
+
+    // Returns the node that hangs from the given branch of the root
+    std::shared_ptr<SHAMapTreeNode> finish (int branch)
+    {
+        if (pending_)
+        {
+            place (pending_, pendingShared_, pendingShared_);
+            pending_.reset ();
+        }
+
+        while (path_.size () > 1)
+            pop ();
+
+        if (! batch_.empty ())
+        {
+            builder_.store (batch_);
+            batch_.clear ();
+        }
+
+        return path_.front ()->getChild (branch);
+    }
+
+    std::size_t nodes () const
+    {
+        return nodes_;
+    }
+
+private:
+    void place (std::shared_ptr<SHAMapItem> const& item,
+        int sharedDepth, int depth)
+    {
+        // Inner nodes below the part of the path this item
+        // shares with the previous one are complete
+        while (static_cast<int> (path_.size ()) > sharedDepth + 1)
+            pop ();
+
+        pathTag_ = item->getTag ();
+
+        while (static_cast<int> (path_.size ()) <= depth)
+        {
+            auto inner = std::make_shared<SHAMapTreeNode> (builder_.map_.seq_);
+            inner->makeInner ();
+            path_.push_back (std::move (inner));
+        }
+
+        auto leaf = std::make_shared<SHAMapTreeNode> (
+            item, builder_.leafType_, builder_.map_.seq_);
+        write (leaf);
+        path_.back ()->setChild (selectBranch (pathTag_, depth), leaf);
+    }
+
+    void pop ()
+    {
+        std::shared_ptr<SHAMapTreeNode> node = std::move (path_.back ());
+        path_.pop_back ();
+
+        node->updateHashDeep ();
+        write (node);
+
+        path_.back ()->setChild (
+            selectBranch (pathTag_, static_cast<int> (path_.size ()) - 1), node);
+    }
+
+    void write (std::shared_ptr<SHAMapTreeNode>& node)
+    {
+        ++nodes_;
+        builder_.share (node, batch_);
+
+        if (batch_.size () >= NodeStore::batchWritePreallocationSize)
+        {
+            builder_.store (batch_);
+            batch_.clear ();
+        }
+    }
+
+    SHAMapBuilder& builder_;
+    std::vector<std::shared_ptr<SHAMapTreeNode>> path_;
+    uint256 pathTag_;
+
+    // The last item added, which is placed when the next one arrives
+    std::shared_ptr<SHAMapItem> pending_;
+    int pendingShared_ = 0;
+
+    NodeStore::Batch batch_;
+    std::size_t nodes_ = 0;
+};
+
+//------------------------------------------------------------------------------
+
+SHAMapBuilder::SHAMapBuilder (SHAMap& map,
+        SHAMapTreeNode::TNType leafType, bool write, int threads)
+    : map_ (map)
+    , leafType_ (leafType)
+    , objectType_ (leafType == SHAMapTreeNode::tnACCOUNT_STATE ?
+        hotACCOUNT_NODE : hotTRANSACTION_NODE)
+    , write_ (write && map.backed_)
+    , threads_ (std::max (1, threads))
+{
+    assert (map_.root_->isInner () && map_.root_->isEmpty ());
+
+    root_ = std::make_shared<SHAMapTreeNode> (map_.seq_);
+    root_->makeInner ();
+}
+
+void SHAMapBuilder::add (std::shared_ptr<SHAMapItem> const& item)
+{
+    if (last_ && item->getTag () <= last_->getTag ())
+        throw std::invalid_argument ("SHAMapBuilder: items out of order");
+
+    int const branch = selectBranch (item->getTag (), 0);
+
+    if (branch != branch_)
+    {
+        if (! items_.empty ())
+            launch ();
+
+        branch_ = branch;
+    }
+
+    items_.push_back (item);
+    last_ = item;
+}
+
+std::size_t SHAMapBuilder::finish ()
+{
+    if (! items_.empty ())
+        launch ();
+
+    while (! building_.empty ())
+        collect ();
+
+    if (! root_->isEmpty ())
+    {
+        NodeStore::Batch batch;
+
+        root_->updateHashDeep ();
+        share (root_, batch);
+        ++nodes_;
+
+        if (! batch.empty ())
+            store (batch);
+
+        map_.root_ = std::move (root_);
+    }
+
+    return nodes_;
+}
+
+void SHAMapBuilder::launch ()
+{
+    auto items = std::make_shared<Items> (std::move (items_));
+    items_.clear ();
+
+    int const branch = branch_;
+
+    // With a single thread the subtree is built right away, by collect
+    building_.emplace_back (branch, std::async (
+        threads_ > 1 ? std::launch::async : std::launch::deferred,
+        [this, branch, items]()
+        {
+            return build (branch, *items);
+        }));
+
+    while (building_.size () >= threads_)
+        collect ();
+}
+
+void SHAMapBuilder::collect ()
+{
+    auto& front = building_.front ();
+    Result result = front.second.get ();
+
+    if (result.first)
+        root_->setChild (front.first, result.first);
+
+    nodes_ += result.second;
+    building_.pop_front ();
+}
+
+SHAMapBuilder::Result
+SHAMapBuilder::build (int branch, Items const& items)
+{
+    Subtree tree (*this);
+
+    for (auto const& item : items)
+        tree.add (item);
+
+    auto node = tree.finish (branch);
+    return Result (std::move (node), tree.nodes ());
+}
+
+void SHAMapBuilder::share (std::shared_ptr<SHAMapTreeNode>& node,
+    NodeStore::Batch& batch)
+{
+    if (! write_)
+        return;
+
+    node->setSeq (0);
+    map_.canonicalize (node->getNodeHash (), node);
+
+    Serializer s (4 + (node->isInner () ? 512 : node->peekItem ()->size () + 32));
+    node->addRaw (s, snfPREFIX);
+    batch.push_back (NodeObject::createObject (
+        objectType_, std::move (s.modData ()), node->getNodeHash ()));
+}
+
+void SHAMapBuilder::store (NodeStore::Batch const& batch)
+{
+    // Subtrees are written from several threads
+    std::lock_guard<std::mutex> lock (storeLock_);
+    map_.f_.db ().storeBatch (batch);
+}
+
+} // skywell
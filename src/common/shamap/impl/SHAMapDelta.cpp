@@ -19,6 +19,8 @@
 
 #include <BeastConfig.h>
 #include <common/shamap/SHAMap.h>
+#include <data/nodestore/Database.h>
+#include <algorithm>
     
 namespace skywell {
 
@@ -221,35 +223,75 @@ SHAMap::compare (std::shared_ptr<SHAMap> const& otherMap,
 
 void SHAMap::walkMap (std::vector<SHAMapMissingNode>& missingNodes, int maxMissing) const
 {
-    std::stack <std::shared_ptr<SHAMapTreeNode>,
-        std::vector <std::shared_ptr<SHAMapTreeNode>>> nodeStack;
-
     if (!root_->isInner ())  // root_ is only node, and we have it
         return;
 
-    nodeStack.push (root_);
+    // The children of a batch of inner nodes are read from the node store
+    // together, so the backend sees many requests at once instead of one
+    // blocking read per node.
+    std::size_t const batchSize = backed_ ? std::max<std::size_t> (1,
+        f_.db().getDesiredAsyncReadCount () / 16) : 1;
+
+    std::vector <std::shared_ptr<SHAMapTreeNode>> nodeStack;
+    std::vector <std::shared_ptr<SHAMapTreeNode>> batch;
+    nodeStack.push_back (root_);
 
     while (!nodeStack.empty ())
     {
-        std::shared_ptr<SHAMapTreeNode> node = std::move (nodeStack.top());
-        nodeStack.pop ();
+        batch.clear ();
 
-        for (int i = 0; i < 16; ++i)
+        while (!nodeStack.empty () && (batch.size () < batchSize))
         {
-            if (!node->isEmptyBranch (i))
-            {
-                std::shared_ptr<SHAMapTreeNode> nextNode = descendNoStore (node, i);
+            batch.push_back (std::move (nodeStack.back ()));
+            nodeStack.pop_back ();
+        }
+
+        if (backed_)
+        {
+            bool pending = false;
 
-                if (nextNode)
+            for (auto const& node : batch)
+            {
+                for (int i = 0; i < 16; ++i)
                 {
-                    if (nextNode->isInner ())
-                        nodeStack.push (std::move (nextNode));
+                    if (!node->isEmptyBranch (i) && !node->getChildPointer (i))
+                    {
+                        uint256 const& hash = node->getChildHash (i);
+                        NodeObject::pointer obj;
+
+                        if (!getCache (hash) && !f_.db().asyncFetch (hash, obj))
+                            pending = true;
+                    }
                 }
-                else
+            }
+
+            if (pending)
+                f_.db().waitReads ();
+        }
+
+        for (auto const& node : batch)
+        {
+            for (int i = 0; i < 16; ++i)
+            {
+                if (!node->isEmptyBranch (i))
                 {
-                    missingNodes.emplace_back (type_, node->getChildHash (i));
-                    if (--maxMissing <= 0)
-                        return;
+                    // Like descendNoStore, but a missing node is reported
+                    // instead of thrown
+                    std::shared_ptr<SHAMapTreeNode> nextNode = node->getChild (i);
+                    if (!nextNode && backed_)
+                        nextNode = fetchNodeNT (node->getChildHash (i));
+
+                    if (nextNode)
+                    {
+                        if (nextNode->isInner ())
+                            nodeStack.push_back (std::move (nextNode));
+                    }
+                    else
+                    {
+                        missingNodes.emplace_back (type_, node->getChildHash (i));
+                        if (--maxMissing <= 0)
+                            return;
+                    }
                 }
             }
         }
@@ -30,6 +30,13 @@ SHAMapItem::SHAMapItem (uint256 const& tag, Blob const& data)
 {
 }
 
+SHAMapItem::SHAMapItem (uint256 const& tag, void const* data, std::size_t size)
+    : mTag (tag)
+    , mData (static_cast<int> (size))
+{
+    mData.addRaw (data, size);
+}
+
 SHAMapItem::SHAMapItem (uint256 const& tag, const Serializer& data)
     : mTag (tag)
     , mData (data.peekData ())
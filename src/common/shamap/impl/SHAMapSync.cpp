@@ -20,6 +20,12 @@
 #include <BeastConfig.h>
 #include <common/shamap/SHAMap.h>
 #include <data/nodestore/Database.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
 
 namespace skywell {
 
@@ -107,6 +113,64 @@ void SHAMap::visitNodes(std::function<bool (SHAMapTreeNode&)> const& function) c
     }
 }
 
+void SHAMap::visitResidentDifferences (std::vector<SHAMap const*> const& others,
+    std::function<bool (SHAMapTreeNode const&)> const& function) const
+{
+    // Maps share unchanged subtrees by pointer, and a shared node always
+    // sits at the same position, so each node is only compared against the
+    // nodes at its position in the other maps.
+    using Nodes = std::vector<std::shared_ptr<SHAMapTreeNode>>;
+
+    auto held = [](std::shared_ptr<SHAMapTreeNode> const& node, Nodes const& nodes)
+    {
+        return std::find (nodes.begin (), nodes.end (), node) != nodes.end ();
+    };
+
+    Nodes roots;
+    for (auto map : others)
+        roots.push_back (map->root_);
+
+    if (!root_ || root_->isEmpty () || held (root_, roots) ||
+        !function (*root_) || !root_->isInner ())
+        return;
+
+    std::stack <std::pair <std::shared_ptr<SHAMapTreeNode>, Nodes>> stack;
+    stack.emplace (root_, std::move (roots));
+
+    while (!stack.empty ())
+    {
+        auto node = std::move (stack.top ().first);
+        auto theirs = std::move (stack.top ().second);
+        stack.pop ();
+
+        for (int branch = 0; branch < 16; ++branch)
+        {
+            if (node->isEmptyBranch (branch))
+                continue;
+
+            auto child = node->getChild (branch);
+            if (!child)
+                continue;
+
+            Nodes counterparts;
+            for (auto const& their : theirs)
+            {
+                if (their->isInner () && !their->isEmptyBranch (branch))
+                {
+                    if (auto theirChild = their->getChild (branch))
+                        counterparts.push_back (std::move (theirChild));
+                }
+            }
+
+            if (held (child, counterparts))
+                continue;
+
+            if (function (*child) && child->isInner ())
+                stack.emplace (std::move (child), std::move (counterparts));
+        }
+    }
+}
+
 /** Get a list of node IDs and hashes for nodes that are part of this SHAMap
     but not available locally.  The filter can hold alternate sources of
     nodes that are not permanently stored locally
@@ -738,11 +802,19 @@ void SHAMap::visitDifferences (SHAMap* have, std::function <bool (SHAMapTreeNode
 
         return;
     }
+
+    visitSubtreeDifferences (root_.get (), SHAMapNodeID{}, have, func);
+}
+
+bool SHAMap::visitSubtreeDifferences (SHAMapTreeNode* from,
+    SHAMapNodeID const& fromID, SHAMap* have,
+    std::function <bool (SHAMapTreeNode&)> const& func) const
+{
     // contains unexplored non-matching inner node entries
     using StackEntry = std::pair <SHAMapTreeNode*, SHAMapNodeID>;
     std::stack <StackEntry, std::vector<StackEntry>> stack;
 
-    stack.push ({root_.get(), SHAMapNodeID{}});
+    stack.push ({from, fromID});
 
     while (!stack.empty())
     {
@@ -753,7 +825,7 @@ void SHAMap::visitDifferences (SHAMap* have, std::function <bool (SHAMapTreeNode
 
         // 1) Add this node to the pack
         if (!func (*node))
-            return;
+            return false;
 
         // 2) push non-matching child inner nodes
         for (int i = 0; i < 16; ++i)
@@ -772,11 +844,189 @@ void SHAMap::visitDifferences (SHAMap* have, std::function <bool (SHAMapTreeNode
                 else if (! have || ! have->hasLeafNode (next->peekItem()->getTag(), childHash))
                 {
                     if (! func (*next))
-                        return;
+                        return false;
                 }
             }
         }
     }
+
+    return true;
+}
+
+void SHAMap::getFetchPack (SHAMap* have, bool includeLeaves, int max,
+    int helpers, std::function<void (std::function<void ()>)> const& schedule,
+    std::function<void (uint256 const&, const Blob&)> func) const
+{
+    if (helpers < 1 || root_->isLeaf () || root_->getNodeHash ().isZero ())
+    {
+        getFetchPack (have, includeLeaves, max, func);
+        return;
+    }
+
+    if (have && (root_->getNodeHash () == have->root_->getNodeHash ()))
+        return;
+
+    {
+        Serializer s;
+        root_->addRaw (s, snfPREFIX);
+        func (root_->getNodeHash (), s.peekData ());
+    }
+
+    // The branches of the root that differ from the other map
+    std::vector<int> branches;
+
+    for (int branch = 0; branch < 16; ++branch)
+    {
+        if (root_->isEmptyBranch (branch))
+            continue;
+
+        SHAMapTreeNode* child = descendThrow (root_.get (), branch);
+        uint256 const& childHash = root_->getChildHash (branch);
+
+        if (child->isInner ()
+            ? (! have || ! have->hasInnerNode (
+                SHAMapNodeID{}.getChildNodeID (branch), childHash))
+            : (! have || ! have->hasLeafNode (
+                child->peekItem()->getTag(), childHash)))
+            branches.push_back (branch);
+    }
+
+    if (branches.empty ())
+        return;
+
+    // Each branch is walked independently, up to its limit. The nodes
+    // found are kept per branch so the pack comes out in the same order
+    // on every run.
+    int const budget = std::max (1, max - 1);
+    int const count = static_cast<int> (branches.size ());
+    std::vector<fetchPackEntry_t> found[16];
+    int limit[16];
+    bool truncated[16] = {};
+
+    for (int branch : branches)
+        limit[branch] = std::max (1, budget / count);
+
+    std::vector<int> pending (branches);
+    std::exception_ptr error;
+    std::mutex errorLock;
+
+    auto walkBranch = [&](int branch)
+    {
+        try
+        {
+            SHAMapTreeNode* child = descendThrow (root_.get (), branch);
+            auto& out = found[branch];
+            int left = limit[branch];
+
+            out.clear ();
+            truncated[branch] = false;
+
+            auto add = [includeLeaves, &left, &out] (SHAMapTreeNode& smn) -> bool
+            {
+                if (includeLeaves || smn.isInner ())
+                {
+                    Serializer s;
+                    smn.addRaw (s, snfPREFIX);
+                    out.emplace_back (smn.getNodeHash (), std::move (s.modData ()));
+
+                    if (--left <= 0)
+                        return false;
+                }
+                return true;
+            };
+
+            if (child->isInner ())
+                truncated[branch] = ! visitSubtreeDifferences (child,
+                    SHAMapNodeID{}.getChildNodeID (branch), have, add);
+            else
+                add (*child);
+        }
+        catch (...)
+        {
+            std::lock_guard <std::mutex> lock (errorLock);
+            if (! error)
+                error = std::current_exception ();
+        }
+    };
+
+    // Budget left unused by small branches is handed to the branches that
+    // ran out, which are walked again with the larger limit.
+    for (int round = 0; round < 4 && ! pending.empty (); ++round)
+    {
+        // Helpers that start after the caller has claimed every branch do
+        // nothing, so the caller never waits on work that has not started.
+        struct Walk
+        {
+            std::mutex mutex;
+            std::condition_variable cond;
+            std::atomic<int> next {0};
+            int active = 0;
+            bool closed = false;
+        };
+
+        auto walk = std::make_shared<Walk> ();
+
+        std::function<void ()> const work = [&]()
+        {
+            for (int i = walk->next++; i < static_cast<int> (pending.size ());
+                    i = walk->next++)
+                walkBranch (pending[i]);
+        };
+
+        int const jobs = std::min (helpers,
+            static_cast<int> (pending.size ()) - 1);
+
+        for (int i = 0; i < jobs; ++i)
+        {
+            schedule ([walk, &work]()
+            {
+                {
+                    std::lock_guard <std::mutex> lock (walk->mutex);
+                    if (walk->closed)
+                        return;
+                    ++walk->active;
+                }
+
+                work ();
+
+                std::lock_guard <std::mutex> lock (walk->mutex);
+                if (--walk->active == 0)
+                    walk->cond.notify_all ();
+            });
+        }
+
+        work ();
+
+        {
+            std::unique_lock <std::mutex> lock (walk->mutex);
+            walk->closed = true;
+            walk->cond.wait (lock, [&walk] { return walk->active == 0; });
+        }
+
+        if (error)
+            std::rethrow_exception (error);
+
+        int used = 0;
+        for (int branch : branches)
+            used += static_cast<int> (found[branch].size ());
+
+        pending.clear ();
+        for (int branch : branches)
+            if (truncated[branch])
+                pending.push_back (branch);
+
+        int const spare = budget - used;
+
+        if (pending.empty () || spare < static_cast<int> (pending.size ()))
+            break;
+
+        for (int branch : pending)
+            limit[branch] += spare / static_cast<int> (pending.size ());
+    }
+
+    for (int branch : branches)
+        for (auto const& entry : found[branch])
+            func (entry.first, entry.second);
 }
 
 } // skywell
@@ -23,6 +23,7 @@
 #include <common/base/Log.h>
 #include <common/base/StringUtilities.h>
 #include <protocol/HashPrefix.h>
+#include <protocol/SHA512Half.h>
 #include <boost/lexical_cast.hpp>
 
 namespace skywell {
@@ -89,9 +90,10 @@ SHAMapTreeNode::SHAMapTreeNode (Blob const& rawNode,
             throw std::runtime_error ("invalid node AW type");
         }
 
-        Serializer s (rawNode.begin (), rawNode.end () - 1);
+        // Parse in place; item data is copied once, into the item
+        unsigned char const* const data = rawNode.data ();
         int type = rawNode.back ();
-        int len = s.getLength ();
+        int len = rawNode.size () - 1;
 
         if ((type < 0) || (type > 4))
         {
@@ -106,7 +108,8 @@ SHAMapTreeNode::SHAMapTreeNode (Blob const& rawNode,
         if (type == 0)
         {
             // transaction
-            mItem = std::make_shared<SHAMapItem> (s.getPrefixHash (HashPrefix::transactionID), s.peekData ());
+            mItem = std::make_shared<SHAMapItem> (Serializer::getPrefixHash (
+                HashPrefix::transactionID, data, len), data, len);
             mType = tnTRANSACTION_NM;
         }
         else if (type == 1)
@@ -115,13 +118,12 @@ SHAMapTreeNode::SHAMapTreeNode (Blob const& rawNode,
             if (len < (256 / 8))
                 throw std::runtime_error ("short AS node");
 
-            uint256 u;
-            s.get256 (u, len - (256 / 8));
-            s.chop (256 / 8);
+            len -= (256 / 8);
+            uint256 const u = uint256::fromVoid (data + len);
 
             if (u.isZero ()) throw std::runtime_error ("invalid AS node");
 
-            mItem = std::make_shared<SHAMapItem> (u, s.peekData ());
+            mItem = std::make_shared<SHAMapItem> (u, data, len);
             mType = tnACCOUNT_STATE;
         }
         else if (type == 2)
@@ -132,7 +134,7 @@ SHAMapTreeNode::SHAMapTreeNode (Blob const& rawNode,
 
             for (int i = 0; i < 16; ++i)
             {
-                s.get256 (mHashes[i], i * 32);
+                mHashes[i] = uint256::fromVoid (data + i * 32);
 
                 if (mHashes[i].isNonZero ())
                     mIsBranch |= (1 << i);
@@ -145,12 +147,10 @@ SHAMapTreeNode::SHAMapTreeNode (Blob const& rawNode,
             // compressed inner
             for (int i = 0; i < (len / 33); ++i)
             {
-                int pos;
-                if (!s.get8 (pos, 32 + (i * 33)))
-                    throw std::runtime_error ("short CI node");
+                int pos = data[32 + (i * 33)];
                 if ((pos < 0) || (pos >= 16))
-                    throw std::runtime_error ("invalid CI node");                
-                s.get256 (mHashes[pos], i * 33);
+                    throw std::runtime_error ("invalid CI node");
+                mHashes[pos] = uint256::fromVoid (data + (i * 33));
 
                 if (mHashes[pos].isNonZero ())
                     mIsBranch |= (1 << pos);
@@ -164,14 +164,13 @@ SHAMapTreeNode::SHAMapTreeNode (Blob const& rawNode,
             if (len < (256 / 8))
                 throw std::runtime_error ("short TM node");
 
-            uint256 u;
-            s.get256 (u, len - (256 / 8));
-            s.chop (256 / 8);
+            len -= (256 / 8);
+            uint256 const u = uint256::fromVoid (data + len);
 
             if (u.isZero ())
                 throw std::runtime_error ("invalid TM node");
 
-            mItem = std::make_shared<SHAMapItem> (u, s.peekData ());
+            mItem = std::make_shared<SHAMapItem> (u, data, len);
             mType = tnTRANSACTION_MD;
         }
     }
@@ -191,21 +190,23 @@ SHAMapTreeNode::SHAMapTreeNode (Blob const& rawNode,
         prefix |= rawNode[2];
         prefix <<= 8;
         prefix |= rawNode[3];
-        Serializer s (rawNode.begin () + 4, rawNode.end ());
+
+        // Parse in place; item data is copied once, into the item
+        unsigned char const* const data = rawNode.data () + 4;
+        int len = rawNode.size () - 4;
 
         if (prefix == HashPrefix::transactionID)
         {
-            mItem = std::make_shared<SHAMapItem> (getSHA512Half (rawNode), s.peekData ());
+            mItem = std::make_shared<SHAMapItem> (getSHA512Half (rawNode), data, len);
             mType = tnTRANSACTION_NM;
         }
         else if (prefix == HashPrefix::leafNode)
         {
-            if (s.getLength () < 32)
+            if (len < 32)
                 throw std::runtime_error ("short PLN node");
 
-            uint256 u;
-            s.get256 (u, s.getLength () - 32);
-            s.chop (32);
+            len -= 32;
+            uint256 const u = uint256::fromVoid (data + len);
 
             if (u.isZero ())
             {
@@ -213,17 +214,17 @@ SHAMapTreeNode::SHAMapTreeNode (Blob const& rawNode,
                 throw std::runtime_error ("invalid PLN node");
             }
 
-            mItem = std::make_shared<SHAMapItem> (u, s.peekData ());
+            mItem = std::make_shared<SHAMapItem> (u, data, len);
             mType = tnACCOUNT_STATE;
         }
         else if (prefix == HashPrefix::innerNode)
         {
-            if (s.getLength () != 512)
+            if (len != 512)
                 throw std::runtime_error ("invalid PIN node");
 
             for (int i = 0; i < 16; ++i)
             {
-                s.get256 (mHashes[i], i * 32);
+                mHashes[i] = uint256::fromVoid (data + i * 32);
 
                 if (mHashes[i].isNonZero ())
                     mIsBranch |= (1 << i);
@@ -234,13 +235,12 @@ SHAMapTreeNode::SHAMapTreeNode (Blob const& rawNode,
         else if (prefix == HashPrefix::txNode)
         {
             // transaction with metadata
-            if (s.getLength () < 32)
+            if (len < 32)
                 throw std::runtime_error ("short TXN node");
 
-            uint256 txID;
-            s.get256 (txID, s.getLength () - 32);
-            s.chop (32);
-            mItem = std::make_shared<SHAMapItem> (txID, s.peekData ());
+            len -= 32;
+            uint256 const txID = uint256::fromVoid (data + len);
+            mItem = std::make_shared<SHAMapItem> (txID, data, len);
             mType = tnTRANSACTION_MD;
         }
         else
@@ -296,19 +296,19 @@ bool SHAMapTreeNode::updateHash ()
     }
     else if (mType == tnACCOUNT_STATE)
     {
-        Serializer s (mItem->size() + (256 + 32) / 8);
-        s.add32 (HashPrefix::leafNode);
-        s.addRaw (mItem->peekData ());
-        s.add256 (mItem->getTag ());
-        nh = s.getSHA512Half ();
+        sha512_half_hasher h;
+        h.add32 (HashPrefix::leafNode);
+        h.append (mItem->data (), mItem->size ());
+        h.add256 (mItem->getTag ());
+        nh = static_cast<uint256> (h);
     }
     else if (mType == tnTRANSACTION_MD)
     {
-        Serializer s (mItem->size() + (256 + 32) / 8);
-        s.add32 (HashPrefix::txNode);
-        s.addRaw (mItem->peekData ());
-        s.add256 (mItem->getTag ());
-        nh = s.getSHA512Half ();
+        sha512_half_hasher h;
+        h.add32 (HashPrefix::txNode);
+        h.append (mItem->data (), mItem->size ());
+        h.add256 (mItem->getTag ());
+        nh = static_cast<uint256> (h);
     }
     else
         assert (false);
@@ -331,6 +331,46 @@ SHAMapTreeNode::updateHashDeep()
     updateHash();
 }
 
+void
+SHAMapTreeNode::updateHash (SHA512HalfBatch& batch)
+{
+    if (mType == tnINNER)
+    {
+        if (mIsBranch != 0)
+            batch.add (mHash, HashPrefix::innerNode, mHashes, sizeof (mHashes));
+        else
+            mHash.zero ();
+    }
+    else if (mType == tnTRANSACTION_NM)
+    {
+        batch.add (mHash, HashPrefix::transactionID,
+            mItem->data (), mItem->size ());
+    }
+    else if (mType == tnACCOUNT_STATE)
+    {
+        batch.add (mHash, HashPrefix::leafNode,
+            mItem->data (), mItem->size (), mItem->getTag ());
+    }
+    else if (mType == tnTRANSACTION_MD)
+    {
+        batch.add (mHash, HashPrefix::txNode,
+            mItem->data (), mItem->size (), mItem->getTag ());
+    }
+    else
+        assert (false);
+}
+
+void
+SHAMapTreeNode::updateHashDeep (SHA512HalfBatch& batch)
+{
+    for (auto pos = 0; pos < 16; ++pos)
+    {
+        if (mChildren[pos] != nullptr)
+            mHashes[pos] = mChildren[pos]->mHash;
+    }
+    updateHash (batch);
+}
+
 void SHAMapTreeNode::addRaw (Serializer& s, SHANodeFormat format)
 {
     assert ((format == snfPREFIX) || (format == snfWIRE) || (format == snfHASH));
@@ -0,0 +1,378 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <common/shamap/SHAMapBuilder.h>
+#include <beast/chrono/manual_clock.h>
+#include <beast/unit_test/suite.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace skywell {
+namespace tests {
+
+// Keeps stored nodes in memory, or only counts them
+class TestDatabase : public NodeStore::Database
+{
+public:
+    explicit TestDatabase (bool keep)
+        : keep_ (keep)
+    {
+    }
+
+    std::map <uint256, Blob> objects;
+    std::size_t stored = 0;
+
+    std::string getName () const override { return "test"; }
+    void close () override { }
+
+    NodeObject::pointer
+    fetch (uint256 const& hash) override
+    {
+        auto const iter = objects.find (hash);
+
+        if (iter == objects.end ())
+            return nullptr;
+
+        Blob data (iter->second);
+        return NodeObject::createObject (hotUNKNOWN, std::move (data), hash);
+    }
+
+    bool
+    asyncFetch (uint256 const& hash, NodeObject::pointer& object) override
+    {
+        object = fetch (hash);
+        return true;
+    }
+
+    void waitReads () override { }
+    int getDesiredAsyncReadCount () override { return 0; }
+
+    void
+    store (NodeObjectType, Blob&& data, uint256 const& hash) override
+    {
+        ++stored;
+        if (keep_)
+            objects[hash] = std::move (data);
+    }
+
+    void
+    storeBatch (NodeStore::Batch const& batch) override
+    {
+        stored += batch.size ();
+        if (keep_)
+            for (auto const& object : batch)
+                objects[object->getHash ()] = object->getData ();
+    }
+
+    void for_each (std::function <void (NodeObject::Ptr)>) override { }
+    void import (Database&) override { }
+    std::int32_t getWriteLoad () const override { return 0; }
+    float getCacheHitRate () override { return 0; }
+    void tune (int, int) override { }
+    void sweep () override { }
+    std::uint32_t getStoreCount () const override { return 0; }
+    std::uint32_t getFetchTotalCount () const override { return 0; }
+    std::uint32_t getFetchHitCount () const override { return 0; }
+    std::uint32_t getStoreSize () const override { return 0; }
+    std::uint32_t getFetchSize () const override { return 0; }
+
+private:
+    bool const keep_;
+};
+
+class TestFamily : public shamap::Family
+{
+public:
+    explicit TestFamily (bool keep = true)
+        : fullbelow_ ("full_below", clock_)
+        , treecache_ ("tree_node_cache", 65536, 60, clock_, beast::Journal ())
+        , db_ (keep)
+    {
+    }
+
+    FullBelowCache& fullbelow () override { return fullbelow_; }
+    FullBelowCache const& fullbelow () const override { return fullbelow_; }
+    TreeNodeCache& treecache () override { return treecache_; }
+    TreeNodeCache const& treecache () const override { return treecache_; }
+    NodeStore::Database& db () override { return db_; }
+    NodeStore::Database const& db () const override { return db_; }
+    void missing_node (std::uint32_t) override { }
+
+    TestDatabase&
+    database ()
+    {
+        return db_;
+    }
+
+private:
+    beast::manual_clock <std::chrono::steady_clock> clock_;
+    FullBelowCache fullbelow_;
+    TreeNodeCache treecache_;
+    TestDatabase db_;
+};
+
+using Items = std::vector <std::shared_ptr <SHAMapItem>>;
+
+// Random leaves, in tag order. Every third tag differs from its
+// predecessor in the last bit only, if requested, so the tree is deep.
+static Items
+makeItems (std::size_t count, std::size_t size, bool nearCollisions,
+    std::uint64_t seed)
+{
+    std::mt19937_64 gen (seed);
+    Items items;
+    items.reserve (count);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        uint256 tag;
+
+        if (nearCollisions && i % 3 == 1)
+        {
+            tag = items.back ()->getTag ();
+            tag.begin ()[31] ^= 1;
+        }
+        else
+        {
+            for (auto p = tag.begin (); p != tag.end (); ++p)
+                *p = static_cast <unsigned char> (gen ());
+        }
+
+        Blob data (size == 0 ? 20 + gen () % 50 : size);
+        for (auto& c : data)
+            c = static_cast <unsigned char> (gen ());
+
+        items.push_back (std::make_shared <SHAMapItem> (tag, data));
+    }
+
+    auto const byTag = [](std::shared_ptr <SHAMapItem> const& lhs,
+        std::shared_ptr <SHAMapItem> const& rhs)
+    {
+        return lhs->getTag () < rhs->getTag ();
+    };
+
+    std::sort (items.begin (), items.end (), byTag);
+    items.erase (std::unique (items.begin (), items.end (),
+        [](std::shared_ptr <SHAMapItem> const& lhs,
+            std::shared_ptr <SHAMapItem> const& rhs)
+        {
+            return lhs->getTag () == rhs->getTag ();
+        }), items.end ());
+
+    return items;
+}
+
+//------------------------------------------------------------------------------
+
+class SHAMapBuilder_test : public beast::unit_test::suite
+{
+public:
+    // Build the same leaves with addGiveItem and with the builder, and
+    // check that the trees and the stored nodes agree.
+    void
+    testMatch (std::size_t count, bool nearCollisions, int threads)
+    {
+        Items const items = makeItems (count, 0, nearCollisions, count + 1);
+
+        TestFamily expectedFamily;
+        SHAMap expected (SHAMapType::STATE, expectedFamily, beast::Journal ());
+
+        for (auto const& item : items)
+            expected.addGiveItem (item, false, false);
+
+        expected.flushDirty (hotACCOUNT_NODE, 1);
+
+        TestFamily family;
+        SHAMap map (SHAMapType::STATE, family, beast::Journal ());
+        std::size_t nodes;
+        {
+            SHAMapBuilder builder (map, SHAMapTreeNode::tnACCOUNT_STATE,
+                true, threads);
+
+            for (auto const& item : items)
+                builder.add (item);
+
+            nodes = builder.finish ();
+        }
+
+        std::stringstream ss;
+        ss << count << " leaves, " << threads << " threads";
+
+        expect (map.getHash () == expected.getHash (), ss.str ());
+
+        if (count == 0)
+            return;
+
+        expect (nodes == family.database ().objects.size (),
+            "node count differs from the nodes stored");
+        expect (family.database ().objects ==
+            expectedFamily.database ().objects, "stored nodes differ");
+
+        bool found = true;
+        for (auto const& item : items)
+            found = found && map.hasItem (item->getTag ());
+
+        expect (found, "an item is missing from the built map");
+    }
+
+    void
+    testOrder ()
+    {
+        testcase ("order");
+
+        Items const items = makeItems (3, 0, false, 5);
+
+        {
+            TestFamily family;
+            SHAMap map (SHAMapType::STATE, family, beast::Journal ());
+            SHAMapBuilder builder (map, SHAMapTreeNode::tnACCOUNT_STATE, false);
+
+            builder.add (items[1]);
+
+            try
+            {
+                builder.add (items[0]);
+                fail ("out of order item accepted");
+            }
+            catch (std::invalid_argument const&)
+            {
+                pass ();
+            }
+        }
+
+        {
+            TestFamily family;
+            SHAMap map (SHAMapType::STATE, family, beast::Journal ());
+            SHAMapBuilder builder (map, SHAMapTreeNode::tnACCOUNT_STATE, false);
+
+            builder.add (items[2]);
+
+            try
+            {
+                builder.add (items[2]);
+                fail ("duplicate item accepted");
+            }
+            catch (std::invalid_argument const&)
+            {
+                pass ();
+            }
+        }
+    }
+
+    void
+    run ()
+    {
+        testcase ("match");
+
+        for (int threads : {1, 4})
+        {
+            for (std::size_t count : {0, 1, 2, 17, 1000, 10000})
+                testMatch (count, false, threads);
+
+            testMatch (5000, true, threads);
+        }
+
+        testOrder ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(SHAMapBuilder,shamap,skywell);
+
+//------------------------------------------------------------------------------
+
+// Builds a state tree from random 100 byte leaves with addGiveItem and with
+// SHAMapBuilder, storing to a backend that only counts. Run with
+// --unittest=SHAMapBuilder_bench --unittest-arg=<leaves>
+class SHAMapBuilder_bench_test : public beast::unit_test::suite
+{
+public:
+    void
+    run ()
+    {
+        using clock_type = std::chrono::steady_clock;
+
+        std::size_t count = 1000000;
+        if (! arg ().empty ())
+            count = std::stoul (arg ());
+
+        int const threads = std::max (1u, std::thread::hardware_concurrency ());
+        Items const items = makeItems (count, 100, false, 7);
+
+        uint256 expected;
+        {
+            TestFamily family (false);
+            SHAMap map (SHAMapType::STATE, family, beast::Journal ());
+
+            auto const start = clock_type::now ();
+            for (auto const& item : items)
+                map.addGiveItem (item, false, false);
+            map.flushDirty (hotACCOUNT_NODE, 1);
+            auto const elapsed = std::chrono::duration_cast <
+                std::chrono::milliseconds> (clock_type::now () - start);
+
+            expected = map.getHash ();
+
+            std::stringstream ss;
+            ss << "addGiveItem " << count << " leaves: " <<
+                elapsed.count () << " ms, " <<
+                family.database ().stored << " nodes";
+            log << ss.str ();
+        }
+
+        for (int t : {1, threads})
+        {
+            TestFamily family (false);
+            SHAMap map (SHAMapType::STATE, family, beast::Journal ());
+
+            auto const start = clock_type::now ();
+            {
+                SHAMapBuilder builder (map, SHAMapTreeNode::tnACCOUNT_STATE,
+                    true, t);
+                for (auto const& item : items)
+                    builder.add (item);
+                builder.finish ();
+            }
+            auto const elapsed = std::chrono::duration_cast <
+                std::chrono::milliseconds> (clock_type::now () - start);
+
+            expect (map.getHash () == expected);
+
+            std::stringstream ss;
+            ss << "SHAMapBuilder " << count << " leaves, " << t <<
+                " threads: " << elapsed.count () << " ms, " <<
+                family.database ().stored << " nodes";
+            log << ss.str ();
+
+            if (threads == 1)
+                break;
+        }
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(SHAMapBuilder_bench,shamap,skywell);
+
+}
+}
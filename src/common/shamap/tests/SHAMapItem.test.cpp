@@ -0,0 +1,116 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <common/shamap/SHAMapItem.h>
+#include <common/shamap/SHAMapTreeNode.h>
+#include <protocol/HashPrefix.h>
+#include <beast/unit_test/suite.h>
+
+namespace skywell {
+namespace tests {
+
+class SHAMapItem_test : public beast::unit_test::suite
+{
+public:
+    static Serializer
+    makeData (std::size_t size)
+    {
+        Serializer s (static_cast<int> (size));
+        for (std::size_t i = 0; i < size; ++i)
+            s.add8 (static_cast<unsigned char> (i * 7));
+        return s;
+    }
+
+    void
+    testMove ()
+    {
+        testcase ("move");
+
+        uint256 tag;
+        tag.SetHex ("4F81A9D1C1E0D9E8B3F6C7A2E5D4C3B2A1908F7E6D5C4B3A2918070605040302");
+
+        Serializer s = makeData (300);
+        Blob const expected = s.peekData ();
+        void const* const buffer = s.getDataPtr ();
+
+        SHAMapItem const item (tag, std::move (s));
+        expect (item.peekData () == expected, "moved data differs");
+        expect (item.data () == buffer, "moved buffer was copied");
+
+        SHAMapItem const sized (tag, expected.data (), expected.size ());
+        expect (sized.peekData () == expected, "sized data differs");
+        expect (sized.peekData ().capacity () == expected.size (),
+            "sized item is not exactly sized");
+    }
+
+    // A leaf written in each form parses back to the same item
+    void
+    testRoundTrip (SHAMapTreeNode::TNType type, std::size_t size)
+    {
+        Serializer data = makeData (size);
+
+        // A transaction without metadata is keyed by its ID
+        uint256 tag;
+        if (type == SHAMapTreeNode::tnTRANSACTION_NM)
+            tag = Serializer::getPrefixHash (
+                HashPrefix::transactionID, data.peekData ());
+        else
+            tag.SetHex ("0B1C2D3E4F5061728394A5B6C7D8E9FA0B1C2D3E4F5061728394A5B6C7D8E9FA");
+
+        auto const item = std::make_shared <SHAMapItem> (tag, std::move (data));
+        SHAMapTreeNode node (item, type, 1);
+
+        for (auto format : {snfPREFIX, snfWIRE})
+        {
+            Serializer s;
+            node.addRaw (s, format);
+
+            SHAMapTreeNode const parsed (s.peekData (), 1, format,
+                node.getNodeHash (), false);
+
+            expect (parsed.getType () == type, "type differs");
+            expect (parsed.getNodeHash () == node.getNodeHash (),
+                "hash differs");
+            expect (parsed.peekItem ()->getTag () == tag, "tag differs");
+            expect (parsed.peekItem ()->peekData () == item->peekData (),
+                "data differs");
+        }
+    }
+
+    void
+    run ()
+    {
+        testMove ();
+
+        testcase ("round trip");
+
+        for (std::size_t size : {12, 120, 300})
+        {
+            testRoundTrip (SHAMapTreeNode::tnACCOUNT_STATE, size);
+            testRoundTrip (SHAMapTreeNode::tnTRANSACTION_NM, size);
+            testRoundTrip (SHAMapTreeNode::tnTRANSACTION_MD, size);
+        }
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(SHAMapItem,shamap,skywell);
+
+}
+}
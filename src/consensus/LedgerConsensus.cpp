@@ -905,6 +905,9 @@ private:
     */
     void accept (std::shared_ptr<SHAMap> set)
     {
+        CloseTracer& tracer = getApp().getLedgerMaster ().getCloseTracer ();
+        LedgerIndex const seq = mPreviousLedger->getLedgerSeq () + 1;
+        CloseTracer::Span span (tracer, CloseTracer::accept, seq);
 
         {
             std::lock_guard<Application::MutexType> lock(getApp().getMasterMutex());
@@ -954,12 +957,19 @@ private:
         WriteLog (lsDEBUG, LedgerConsensus)
             << "Applying consensus set transactions to the"
             << " last closed ledger";
-        applyTransactions (set, newLCL, newLCL, retriableTransactions, false);
+        {
+            CloseTracer::Span applySpan (tracer, CloseTracer::apply, seq);
+            applyTransactions (set, newLCL, newLCL, retriableTransactions, false);
+        }
         newLCL->updateSkipList ();
         newLCL->setClosed ();
 
-        int asf = newLCL->peekAccountStateMap ()->flushDirty (hotACCOUNT_NODE, newLCL->getLedgerSeq());
-        int tmf = newLCL->peekTransactionMap ()->flushDirty (hotTRANSACTION_NODE, newLCL->getLedgerSeq());
+        int asf, tmf;
+        {
+            CloseTracer::Span flushSpan (tracer, CloseTracer::flush, seq);
+            asf = newLCL->peekAccountStateMap ()->flushDirty (hotACCOUNT_NODE, newLCL->getLedgerSeq());
+            tmf = newLCL->peekTransactionMap ()->flushDirty (hotTRANSACTION_NODE, newLCL->getLedgerSeq());
+        }
 
         WriteLog (lsDEBUG, LedgerConsensus) << "Flushed " << asf << " account and " << tmf << "transaction nodes";
 
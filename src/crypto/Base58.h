@@ -33,6 +33,7 @@
 #define SKYWELL_CRYPTO_BASE58_H_INCLUDED
 
 #include <common/base/Blob.h>
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <iterator>
@@ -77,7 +78,7 @@ public:
             { return to_char (digit); }
 
         int from_char (char c) const
-            { return m_inverse [c]; }
+            { return m_inverse [static_cast <unsigned char> (c)]; }
 
     private:
         std::string const m_chars;
@@ -96,32 +97,24 @@ public:
     static std::string encode (InputIt first, InputIt last,
         Alphabet const& alphabet, bool withCheck)
     {
-        typedef typename std::iterator_traits<InputIt>::value_type value_type;
-        std::vector <typename std::remove_const <value_type>::type> v;
         std::size_t const size (std::distance (first, last));
-        if (withCheck)
-        {
-            v.reserve (size + 1 + 4);
-            v.insert (v.begin(), first, last);
-            unsigned char hash [4];
-            fourbyte_hash256 (hash, &v.front(), v.size());
-            v.resize (0);
-            // Place the hash reversed in the front
-            std::copy (std::reverse_iterator <unsigned char const*> (hash+4),
-                       std::reverse_iterator <unsigned char const*> (hash),
-                       std::back_inserter (v));
-        }
-        else
+        std::size_t const total (size + (withCheck ? 4 : 0));
+
+        // Account IDs and public keys fit on the stack
+        unsigned char small [64];
+        std::vector <unsigned char> large;
+        unsigned char* v = small;
+        if (total > sizeof (small))
         {
-            v.reserve (size + 1);
+            large.resize (total);
+            v = large.data ();
         }
-        // Append input little endian
-        std::copy (std::reverse_iterator <InputIt> (last),
-                   std::reverse_iterator <InputIt> (first),
-                   std::back_inserter (v));
-        // Pad zero to make the BIGNUM positive
-        v.push_back (0);
-        return raw_encode (&v.front(), &v.back()+1, alphabet);
+
+        std::copy (first, last, v);
+        if (withCheck)
+            fourbyte_hash256 (v + size, v, size);
+
+        return encodeBigEndian (v, total, alphabet);
     }
 
     template <class Container>
@@ -154,6 +147,11 @@ public:
     static bool decode (std::string const& str, Blob& vchRet);
     static bool decodeWithCheck (const char* psz, Blob& vchRet, Alphabet const& alphabet = getSkywellAlphabet());
     static bool decodeWithCheck (std::string const& str, Blob& vchRet, Alphabet const& alphabet = getSkywellAlphabet());
+
+private:
+    // Encode big endian data, each leading zero byte becomes alphabet[0]
+    static std::string encodeBigEndian (unsigned char const* data,
+        std::size_t size, Alphabet const& alphabet);
 };
 
 }
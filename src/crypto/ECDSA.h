@@ -22,6 +22,7 @@
 
 #include <common/base/base_uint.h>
 #include <common/base/Blob.h>
+#include <common/base/Slice.h>
 
 namespace skywell {
 
@@ -32,6 +33,11 @@ bool ECDSAVerify (uint256 const& hash,
                   std::uint8_t const* key_data,
                   std::size_t key_size);
 
+/** Verify a DER encoded signature without copying it or the key. */
+bool ECDSAVerify (uint256 const& hash,
+                  Slice const& sig,
+                  Slice const& publicKey);
+
 } // skywell
 
 #endif
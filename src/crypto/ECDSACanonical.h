@@ -21,6 +21,9 @@
 #define SKYWELL_CRYPTO_ECDSACANONICAL_H_INCLUDED
 
 #include <common/base/Blob.h>
+#include <common/base/Slice.h>
+#include <cstddef>
+#include <cstdint>
 
 namespace skywell {
 
@@ -30,6 +33,25 @@ enum class ECDSA
     strict
 };
 
+/** The R and S values of a DER encoded ECDSA signature.
+    Each points into the signature at the big endian value, with any
+    sign padding byte removed, and is between 1 and 32 bytes long.
+*/
+struct ECDSASigParts
+{
+    std::uint8_t const* r;
+    std::size_t rSize;
+    std::uint8_t const* s;
+    std::size_t sSize;
+};
+
+/** Locates R and S in a DER encoded secp256k1 ECDSA signature.
+    The encoding must be strict DER with positive, minimally encoded
+    integers, and no trailing data. Nothing is copied or allocated.
+*/
+bool parseECDSASig (std::uint8_t const* sig, std::size_t sigLen,
+    ECDSASigParts& parts);
+
 /** Checks whether a secp256k1 ECDSA signature is canonical.
     Return value is true if the signature is canonical.
     If mustBeStrict is specified, the signature must be
@@ -47,6 +69,13 @@ inline bool isCanonicalECDSASig (Blob const& signature,
         isCanonicalECDSASig (&signature[0], signature.size(), mustBeStrict);
 }
 
+inline bool isCanonicalECDSASig (Slice const& signature,
+    ECDSA mustBeStrict)
+{
+    return isCanonicalECDSASig (signature.data(), signature.size(),
+        mustBeStrict);
+}
+
 /** Converts a canonical secp256k1 ECDSA signature to a
     fully-canonical one. Returns true if the original signature
     was already fully-canonical. The behavior if something
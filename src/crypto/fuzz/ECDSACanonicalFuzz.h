@@ -0,0 +1,352 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#ifndef SKYWELL_CRYPTO_ECDSACANONICALFUZZ_H_INCLUDED
+#define SKYWELL_CRYPTO_ECDSACANONICALFUZZ_H_INCLUDED
+
+#include <openssl/bn.h>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace skywell {
+namespace fuzz {
+
+// The BIGNUM based canonicality checks that ECDSACanonical.cpp used to
+// carry. They are the reference the allocation free parser is fuzzed
+// against, and are kept here unchanged apart from the packaging.
+namespace reference {
+
+struct BigNum
+{
+    BIGNUM* num;
+
+    BigNum& operator= (BigNum const&) = delete;
+
+    BigNum ()
+        : num (BN_new ())
+    {
+    }
+
+    explicit BigNum (char const* hex)
+        : num (BN_new ())
+    {
+        BN_hex2bn (&num, hex);
+    }
+
+    BigNum (BigNum const& other)
+        : num (BN_new ())
+    {
+        if (BN_copy (num, other.num) == nullptr)
+            BN_clear (num);
+    }
+
+    ~BigNum ()
+    {
+        BN_free (num);
+    }
+
+    operator BIGNUM* ()
+    {
+        return num;
+    }
+
+    operator BIGNUM const* () const
+    {
+        return num;
+    }
+
+    bool set (unsigned char const* ptr, std::size_t len)
+    {
+        return BN_bin2bn (ptr, len, num) != nullptr;
+    }
+};
+
+inline BigNum const& modulus ()
+{
+    static BigNum const n (
+        "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BBFD25E8CD0364141");
+    return n;
+}
+
+// Reads <02> <length> <value>; returns the bytes consumed, or 0
+inline std::size_t
+signaturePart (unsigned char const* sig, std::size_t size, BigNum& bn)
+{
+    if ((size < 3) || (sig[0] != 0x02))
+        return 0;
+
+    std::size_t const len (sig[1]);
+
+    if (len > (size - 2))
+        return 0;
+
+    if ((len < 1) || (len > 33))
+        return 0;
+
+    if ((sig[2] & 0x80) != 0)
+        return 0;
+
+    if ((sig[2] == 0) && (len == 1))
+        return 0;
+
+    if ((sig[2] == 0) && ((sig[3] & 0x80) == 0))
+        return 0;
+
+    if (! bn.set (sig + 2, len))
+        return 0;
+
+    return len + 2;
+}
+
+inline bool
+isCanonicalECDSASig (void const* vSig, std::size_t sigLen, bool strict)
+{
+    unsigned char const* sig = reinterpret_cast<unsigned char const*> (vSig);
+
+    if ((sigLen < 8) || (sigLen > 72))
+        return false;
+
+    if ((sig[0] != 0x30) || (sig[1] != (sigLen - 2)))
+        return false;
+
+    sig += 2;
+    sigLen -= 2;
+
+    BigNum bnR;
+    std::size_t skip = signaturePart (sig, sigLen, bnR);
+    if (skip == 0)
+        return false;
+    sig += skip;
+    sigLen -= skip;
+
+    BigNum bnS;
+    skip = signaturePart (sig, sigLen, bnS);
+    if (skip == 0)
+        return false;
+    sigLen -= skip;
+
+    if (sigLen != 0)
+        return false;
+
+    if (BN_cmp (bnR, modulus ()) != -1)
+        return false;
+
+    if (BN_cmp (bnS, modulus ()) != -1)
+        return false;
+
+    if (strict)
+    {
+        BigNum mS;
+
+        if (BN_sub (mS, modulus (), bnS) == 0)
+            return false;
+
+        if (BN_cmp (bnS, mS) == 1)
+            return false;
+    }
+
+    return true;
+}
+
+// The signature must already be canonical
+inline bool
+makeCanonicalECDSASig (void* vSig, std::size_t& sigLen)
+{
+    unsigned char* sig = reinterpret_cast<unsigned char*> (vSig);
+
+    int const rLen = sig[3];
+    int const sPos = rLen + 6;
+    int const sLen = sig[rLen + 5];
+
+    BigNum origS, newS;
+    BN_bin2bn (&sig[sPos], sLen, origS);
+    BN_sub (newS, modulus (), origS);
+
+    if (BN_cmp (origS, newS) != 1)
+        return true;
+
+    unsigned char newSbuf [64];
+    int const newSlen = BN_bn2bin (newS, newSbuf);
+
+    if ((newSbuf[0] & 0x80) == 0)
+    {
+        sig[1] = sig[1] - sLen + newSlen;
+        sig[sPos - 1] = newSlen;
+        std::memcpy (&sig[sPos], newSbuf, newSlen);
+    }
+    else
+    {
+        sig[1] = sig[1] - sLen + newSlen + 1;
+        sig[sPos - 1] = newSlen + 1;
+        sig[sPos] = 0;
+        std::memcpy (&sig[sPos + 1], newSbuf, newSlen);
+    }
+    sigLen = sig[1] + 2;
+    return false;
+}
+
+} // reference
+
+/** Produces DER-like signatures that sit near the parser's boundaries.
+
+    Most inputs are well formed signatures whose R and S have random
+    lengths and values close to zero, to the group order and to half
+    of it; the rest are those signatures with bytes flipped, inserted,
+    dropped or truncated, or plain random bytes.
+*/
+class SignatureGenerator
+{
+public:
+    using Bytes = std::vector <std::uint8_t>;
+
+    explicit SignatureGenerator (std::uint64_t seed)
+        : gen_ (seed)
+    {
+    }
+
+    Bytes operator() ()
+    {
+        int const kind = pick (10);
+
+        if (kind == 0)
+        {
+            Bytes b (pick (80));
+            for (auto& x : b)
+                x = byte ();
+            return b;
+        }
+
+        Bytes sig (wellFormed ());
+
+        if (kind >= 6)
+            mutate (sig);
+
+        return sig;
+    }
+
+private:
+    int pick (int n)
+    {
+        return std::uniform_int_distribution <int> (0, n - 1) (gen_);
+    }
+
+    std::uint8_t byte ()
+    {
+        return static_cast <std::uint8_t> (pick (256));
+    }
+
+    // A value of 1 to 33 bytes; when 32 bytes long it is often near
+    // one of the interesting bounds.
+    Bytes value ()
+    {
+        static std::uint8_t const bounds[3][32] = {
+            { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+              0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFE,
+              0xBA, 0xAE, 0xDC, 0xE6, 0xAF, 0x48, 0xA0, 0x3B,
+              0xBF, 0xD2, 0x5E, 0x8C, 0xD0, 0x36, 0x41, 0x41 },
+            { 0x7F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+              0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+              0x5D, 0x57, 0x6E, 0x73, 0x57, 0xA4, 0x50, 0x1D,
+              0xDF, 0xE9, 0x2F, 0x46, 0x68, 0x1B, 0x20, 0xA0 },
+            { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+              0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+              0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+              0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF } };
+
+        Bytes v;
+        int const shape = pick (4);
+
+        if (shape < 3)
+        {
+            v.assign (bounds[shape], bounds[shape] + 32);
+
+            // Nudge the low bytes up or down a little
+            int const at = 31 - pick (2);
+            v[at] = static_cast <std::uint8_t> (v[at] + pick (5) - 2);
+        }
+        else
+        {
+            v.resize (1 + pick (32));
+            for (auto& x : v)
+                x = byte ();
+            if (pick (4) == 0)
+                v[0] = 0;
+        }
+
+        // Add the sign byte a DER encoder would, or sometimes not
+        if ((v[0] & 0x80) != 0 && pick (8) != 0)
+            v.insert (v.begin (), 0);
+
+        return v;
+    }
+
+    Bytes wellFormed ()
+    {
+        Bytes const r (value ());
+        Bytes const s (value ());
+
+        Bytes sig;
+        sig.push_back (0x30);
+        sig.push_back (static_cast <std::uint8_t> (4 + r.size () + s.size ()));
+        sig.push_back (0x02);
+        sig.push_back (static_cast <std::uint8_t> (r.size ()));
+        sig.insert (sig.end (), r.begin (), r.end ());
+        sig.push_back (0x02);
+        sig.push_back (static_cast <std::uint8_t> (s.size ()));
+        sig.insert (sig.end (), s.begin (), s.end ());
+        return sig;
+    }
+
+    void mutate (Bytes& sig)
+    {
+        for (int n = 1 + pick (3); n > 0 && ! sig.empty (); --n)
+        {
+            std::size_t const at = pick (static_cast <int> (sig.size ()));
+
+            switch (pick (5))
+            {
+            case 0:
+                sig[at] ^= static_cast <std::uint8_t> (1 << pick (8));
+                break;
+            case 1:
+                sig[at] = byte ();
+                break;
+            case 2:
+                sig.insert (sig.begin () + at, byte ());
+                break;
+            case 3:
+                sig.erase (sig.begin () + at);
+                break;
+            default:
+                sig.resize (at);
+                break;
+            }
+        }
+    }
+
+    std::mt19937_64 gen_;
+};
+
+} // fuzz
+} // skywell
+
+#endif
@@ -0,0 +1,136 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+// Fuzzes the DER parser in ECDSACanonical.cpp against the BIGNUM based
+// implementation it replaced. See README.md for building and running.
+
+#include <BeastConfig.h>
+#include <crypto/ECDSACanonical.h>
+#include <crypto/fuzz/ECDSACanonicalFuzz.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+namespace {
+
+using namespace skywell;
+
+void
+printBytes (char const* desc, std::uint8_t const* bytes, std::size_t len)
+{
+    std::printf ("%s (%u bytes):\n", desc, static_cast <unsigned> (len));
+    for (std::size_t i = 0; i < len; ++i)
+    {
+        std::printf ("0x%02x,", bytes[i]);
+        if (((i + 1) & 15) == 0)
+            std::printf ("\n");
+    }
+    std::printf ("\n");
+}
+
+// Returns false after printing the input if the implementations disagree
+bool
+check (std::uint8_t const* data, std::size_t size)
+{
+    for (auto const strict : { ECDSA::not_strict, ECDSA::strict })
+    {
+        bool const expected = fuzz::reference::isCanonicalECDSASig (
+            data, size, strict == ECDSA::strict);
+        bool const actual = isCanonicalECDSASig (data, size, strict);
+
+        if (expected != actual)
+        {
+            std::printf ("\n\n");
+            printBytes ("sig", data, size);
+            std::printf ("%s: reference %s, parser %s\n",
+                strict == ECDSA::strict ? "strict" : "not strict",
+                expected ? "canonical" : "not canonical",
+                actual ? "canonical" : "not canonical");
+            return false;
+        }
+    }
+
+    // Both makeCanonicalECDSASig must produce the same bytes
+    if (size <= 72 && isCanonicalECDSASig (data, size, ECDSA::not_strict))
+    {
+        std::uint8_t expected[80], actual[80];
+        std::memcpy (expected, data, size);
+        std::memcpy (actual, data, size);
+
+        std::size_t expectedSize = size, actualSize = size;
+        bool const e = fuzz::reference::makeCanonicalECDSASig (
+            expected, expectedSize);
+        bool const a = makeCanonicalECDSASig (actual, actualSize);
+
+        if (e != a || expectedSize != actualSize ||
+            std::memcmp (expected, actual, actualSize) != 0)
+        {
+            std::printf ("\n\n");
+            printBytes ("sig", data, size);
+            printBytes ("reference", expected, expectedSize);
+            printBytes ("parser", actual, actualSize);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}
+
+#if defined (SKYWELL_LIBFUZZER)
+
+extern "C" int
+LLVMFuzzerTestOneInput (std::uint8_t const* data, std::size_t size)
+{
+    if (! check (data, size))
+        std::abort ();
+    return 0;
+}
+
+#else
+
+int main ()
+{
+    std::printf ("fuzzing: isCanonicalECDSASig, makeCanonicalECDSASig\n\n");
+
+    fuzz::SignatureGenerator generate (std::random_device {} ());
+
+    for (std::uint64_t ctr = 0;; ++ctr)
+    {
+        auto const sig = generate ();
+
+        if (! check (sig.data (), sig.size ()))
+            std::exit (1);
+
+        // print out status
+        if (ctr && (ctr % 0x10000 == 0))
+        {
+            std::printf (".");
+            if ((ctr % 0x200000) == 0)
+                std::printf (" [%016llx]\n",
+                    static_cast <unsigned long long> (ctr));
+            std::fflush (stdout);
+        }
+    }
+}
+
+#endif
@@ -19,10 +19,11 @@
 
 #include <BeastConfig.h>
 #include <crypto/Base58.h>
-#include <crypto/CAutoBN_CTX.h>
-#include <crypto/CBigNum.h>
+#include <common/base/base_uint.h>
 #include <openssl/sha.h>
-#include <stdexcept>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <string>
 
 // Copyright (c) 2009-2010 Satoshi Nakamoto
@@ -66,41 +67,92 @@ Base58::Alphabet const& Base58::getSkywellAlphabet ()
     return alphabet;
 }
 
-std::string Base58::raw_encode (unsigned char const* begin,
-    unsigned char const* end, Alphabet const& alphabet)
+std::string Base58::encodeBigEndian (unsigned char const* data,
+    std::size_t size, Alphabet const& alphabet)
 {
-    CAutoBN_CTX pctx;
-    CBigNum bn58 = 58;
-    CBigNum bn0 = 0;
+    std::size_t zeros = 0;
+    while (zeros < size && data[zeros] == 0)
+        ++zeros;
+
+    // Work in limbs of five base58 digits (58^5 < 2^32) so each input
+    // byte touches a fifth as many words. 25 bytes per 7 limbs, rounded up.
+    std::uint64_t const limbBase = 58ull * 58 * 58 * 58 * 58;
+    std::size_t const capacity ((size - zeros) * 7 / 25 + 1);
+
+    std::uint32_t small [32];
+    std::vector <std::uint32_t> large;
+    std::uint32_t* limbs = small;
+    if (capacity > sizeof (small) / sizeof (small[0]))
+    {
+        large.resize (capacity);
+        limbs = large.data ();
+    }
 
-    // Convert little endian data to bignum
-    CBigNum bn (begin, end);
-    std::size_t const size (std::distance (begin, end));
+    // Repeatedly multiply the limbs (little endian) by 256 and add the
+    // next byte, only touching the limbs that are in use
+    std::size_t length = 0;
+    for (std::size_t i = zeros; i < size; ++i)
+    {
+        std::uint64_t carry = data[i];
+        for (std::size_t k = 0; k < length; ++k)
+        {
+            carry += static_cast <std::uint64_t> (limbs[k]) << 8;
+            limbs[k] = static_cast <std::uint32_t> (carry % limbBase);
+            carry /= limbBase;
+        }
+        while (carry != 0)
+        {
+            assert (length < capacity);
+            limbs[length++] = static_cast <std::uint32_t> (carry % limbBase);
+            carry /= limbBase;
+        }
+    }
 
-    // Convert bignum to std::string
+    char digits [5];
     std::string str;
-    // Expected size increase from base58 conversion is approximately 137%
-    // use 138% to be safe
-    str.reserve (size * 138 / 100 + 1);
-    CBigNum dv;
-    CBigNum rem;
-
-    while (bn > bn0)
+    str.reserve (zeros + length * 5);
+    str.assign (zeros, alphabet [0]);
+    for (std::size_t k = length; k-- != 0;)
     {
-        if (!BN_div (&dv, &rem, &bn, &bn58, pctx))
-            throw std::runtime_error ("EncodeBase58 : BN_div failed");
+        std::uint32_t limb = limbs[k];
+        for (int d = 5; d-- != 0;)
+        {
+            digits[d] = alphabet [limb % 58];
+            limb /= 58;
+        }
 
-        bn = dv;
-        unsigned int c = rem.getuint ();
-        str += alphabet [c];
+        // The most significant limb carries no leading zero digits
+        int skip = 0;
+        if (k + 1 == length)
+            while (skip < 4 && digits[skip] == alphabet [0])
+                ++skip;
+
+        str.append (digits + skip, 5 - skip);
     }
+    return str;
+}
+
+std::string Base58::raw_encode (unsigned char const* begin,
+    unsigned char const* end, Alphabet const& alphabet)
+{
+    // The input is little endian with a trailing zero pad byte
+    // (a holdover from the BIGNUM conversion); drop it
+    if (begin != end && end[-1] == 0)
+        --end;
 
-    for (const unsigned char* p = end-2; p >= begin && *p == 0; p--)
-        str += alphabet [0];
+    std::size_t const size (std::distance (begin, end));
 
-    // Convert little endian std::string to big endian
-    reverse (str.begin (), str.end ());
-    return str;
+    unsigned char small [64];
+    std::vector <unsigned char> large;
+    unsigned char* v = small;
+    if (size > sizeof (small))
+    {
+        large.resize (size);
+        v = large.data ();
+    }
+
+    std::reverse_copy (begin, end, v);
+    return encodeBigEndian (v, size, alphabet);
 }
 
 //------------------------------------------------------------------------------
@@ -108,52 +160,47 @@ std::string Base58::raw_encode (unsigned char const* begin,
 bool Base58::raw_decode (char const* first, char const* last, void* dest,
     std::size_t size, bool checked, Alphabet const& alphabet)
 {
-    CAutoBN_CTX pctx;
-    CBigNum bn58 = 58;
-    CBigNum bn = 0;
-    CBigNum bnChar;
+    unsigned char* const out (static_cast <unsigned char*> (dest));
+
+    // Count leading zeros
+    std::size_t nLeadingZeros = 0;
+    for (char const* p = first; p!=last && *p==alphabet[0]; p++)
+        nLeadingZeros++;
+
+    if (nLeadingZeros > size)
+        return false;
 
-    // Convert big endian string to bignum
-    for (char const* p = first; p != last; ++p)
+    // Accumulate the value big endian in the output, failing
+    // as soon as it no longer fits
+    std::memset (out, 0, size);
+
+    for (char const* p = first + nLeadingZeros; p != last; ++p)
     {
         int i (alphabet.from_char (*p));
         if (i == -1)
             return false;
-        bnChar.setuint ((unsigned int) i);
-
-        int const success (BN_mul (&bn, &bn, &bn58, pctx));
 
-        assert (success);
-        (void) success;
+        unsigned int carry = i;
+        for (std::size_t k = size; k-- != 0;)
+        {
+            carry += 58 * static_cast <unsigned int> (out[k]);
+            out[k] = static_cast <unsigned char> (carry & 0xff);
+            carry >>= 8;
+        }
 
-        bn += bnChar;
+        if (carry != 0)
+            return false;
     }
 
-    // Get bignum as little endian data
-    Blob vchTmp = bn.getvch ();
-
-    // Trim off sign byte if present
-    if (vchTmp.size () >= 2 && vchTmp.end ()[-1] == 0 && vchTmp.end ()[-2] >= 0x80)
-        vchTmp.erase (vchTmp.end () - 1);
-
-    char* const out (static_cast <char*> (dest));
-
-    // Count leading zeros
-    int nLeadingZeros = 0;
-    for (char const* p = first; p!=last && *p==alphabet[0]; p++)
-        nLeadingZeros++;
+    // Verify that the size is correct: the value must occupy
+    // exactly the bytes not taken by the leading zeros
+    std::size_t valueBytes = size;
+    for (std::size_t k = 0; k < size && out[k] == 0; ++k)
+        --valueBytes;
 
-    // Verify that the size is correct
-    if (vchTmp.size() + nLeadingZeros != size)
+    if (valueBytes + nLeadingZeros != size)
         return false;
 
-    // Fill the leading zeros
-    memset (out, 0, nLeadingZeros);
-
-    // Copy little endian data to big endian
-    std::reverse_copy (vchTmp.begin (), vchTmp.end (),
-        out + nLeadingZeros);
-
     if (checked)
     {
         char hash4 [4];
@@ -167,59 +214,55 @@ bool Base58::raw_decode (char const* first, char const* last, void* dest,
 
 bool Base58::decode (const char* psz, Blob& vchRet, Alphabet const& alphabet)
 {
-    CAutoBN_CTX pctx;
     vchRet.clear ();
-    CBigNum bn58 = 58;
-    CBigNum bn = 0;
-    CBigNum bnChar;
 
     while (isspace (*psz))
         psz++;
 
-    // Convert big endian string to bignum
-    for (const char* p = psz; *p; p++)
-    {
-        //  TODO Make this use the inverse table!
-        //             Or better yet ditch this and call raw_decode
-        //
-        const char* p1 = strchr (alphabet.chars(), *p);
-
-        if (p1 == nullptr)
-        {
-            while (isspace (*p))
-                p++;
+    // Find the end of the digits, allowing only trailing whitespace
+    char const* last = psz;
+    while (*last && alphabet.from_char (*last) != -1)
+        last++;
 
-            if (*p != '\0')
-                return false;
-
-            break;
-        }
-
-        bnChar.setuint (p1 - alphabet.chars());
-
-        if (!BN_mul (&bn, &bn, &bn58, pctx))
-            throw std::runtime_error ("DecodeBase58 : BN_mul failed");
-
-        bn += bnChar;
+    for (char const* p = last; *p; p++)
+    {
+        if (!isspace (*p))
+            return false;
     }
 
-    // Get bignum as little endian data
-    Blob vchTmp = bn.getvch ();
-
-    // Trim off sign byte if present
-    if (vchTmp.size () >= 2 && vchTmp.end ()[-1] == 0 && vchTmp.end ()[-2] >= 0x80)
-        vchTmp.erase (vchTmp.end () - 1);
-
     // Restore leading zeros
-    int nLeadingZeros = 0;
+    std::size_t nLeadingZeros = 0;
 
-    for (const char* p = psz; *p == alphabet.chars()[0]; p++)
+    for (const char* p = psz; p != last && *p == alphabet.chars()[0]; p++)
         nLeadingZeros++;
 
-    vchRet.assign (nLeadingZeros + vchTmp.size (), 0);
+    // log(58) / log(256), rounded up
+    std::size_t const capacity ((last - psz - nLeadingZeros) * 733 / 1000 + 1);
+    vchRet.assign (capacity, 0);
+
+    // Convert big endian string to big endian bytes
+    std::size_t length = 0;
+    for (char const* p = psz + nLeadingZeros; p != last; ++p)
+    {
+        unsigned int carry = alphabet.from_char (*p);
+        std::size_t j = 0;
+        for (std::size_t k = capacity; (carry != 0 || j < length) && k-- != 0; ++j)
+        {
+            carry += 58 * static_cast <unsigned int> (vchRet[k]);
+            vchRet[k] = static_cast <unsigned char> (carry & 0xff);
+            carry >>= 8;
+        }
+        assert (carry == 0);
+        length = j;
+    }
+
+    // Strip the unused high bytes, keeping one per leading zero digit
+    std::size_t skip = capacity - length;
+    while (skip < capacity && vchRet[skip] == 0)
+        ++skip;
 
-    // Convert little endian data to big endian
-    std::reverse_copy (vchTmp.begin (), vchTmp.end (), vchRet.end () - vchTmp.size ());
+    vchRet.erase (vchRet.begin (), vchRet.begin () + skip);
+    vchRet.insert (vchRet.begin (), nLeadingZeros, 0);
     return true;
 }
 
@@ -27,10 +27,16 @@
 #include <crypto/ECDSACanonical.h>
 #include <crypto/impl/ec_key.h>
 #include <crypto/impl/ECDSAKey.h>
+#include <crypto/impl/secp256k1.h>
+#include <common/base/UnorderedContainers.h>
 #include <openssl/ec.h>
 #include <openssl/ecdsa.h>
 #include <openssl/hmac.h>
+#include <array>
 #include <cstdint>
+#include <cstring>
+#include <list>
+#include <mutex>
 
 namespace skywell  {
 
@@ -69,9 +75,109 @@ static bool ECDSAVerify (uint256 const& hash, std::uint8_t const* sig, size_t si
     return ECDSA_verify (0, hash.begin(), hash.size(), sig, sigLen, key) > 0;
 }
 
-static bool ECDSAVerify (uint256 const& hash, Blob const& sig, const openssl::ec_key& key)
+namespace {
+
+// Compressed public keys seen recently, already decoded and with their
+// multiplication tables built. Validators and busy accounts sign over and
+// over, so most verifications find their key here.
+class PublicKeyCache
+{
+public:
+    typedef std::array <std::uint8_t, 33> key_type;
+    typedef std::shared_ptr <secp256k1::PublicKey const> value_type;
+
+    explicit PublicKeyCache (std::size_t capacity)
+        : capacity_ (capacity)
+    {
+    }
+
+    value_type find (key_type const& key)
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+
+        auto const iter = map_.find (key);
+
+        if (iter == map_.end ())
+            return value_type ();
+
+        // Move the entry to the front of the recency list
+        list_.splice (list_.begin (), list_, iter->second);
+        return iter->second->second;
+    }
+
+    void insert (key_type const& key, value_type const& value)
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+
+        if (map_.find (key) != map_.end ())
+            return;
+
+        list_.emplace_front (key, value);
+        map_.emplace (key, list_.begin ());
+
+        if (list_.size () > capacity_)
+        {
+            map_.erase (list_.back ().first);
+            list_.pop_back ();
+        }
+    }
+
+private:
+    typedef std::list <std::pair <key_type, value_type>> list_type;
+
+    std::mutex mutex_;
+    std::size_t const capacity_;
+    list_type list_;    // most recently used first
+    hardened_hash_map <key_type, list_type::iterator> map_;
+};
+
+// Each entry holds about 2KB of tables
+static PublicKeyCache publicKeyCache (2048);
+
+static std::shared_ptr <secp256k1::PublicKey const>
+getPublicKey (std::uint8_t const* key_data, std::size_t key_size)
+{
+    PublicKeyCache::key_type key;
+
+    if (key_size != key.size ())
+        return secp256k1::parsePublicKey (key_data, key_size);
+
+    std::memcpy (key.data (), key_data, key.size ());
+
+    auto result = publicKeyCache.find (key);
+
+    if (! result)
+    {
+        result = secp256k1::parsePublicKey (key_data, key_size);
+
+        if (result)
+            publicKeyCache.insert (key, result);
+    }
+
+    return result;
+}
+
+}
+
+static bool ECDSAVerify (uint256 const& hash,
+                         std::uint8_t const* sig,
+                         std::size_t sig_size,
+                         std::uint8_t const* key_data,
+                         std::size_t key_size)
 {
-    return ECDSAVerify (hash, sig.data(), sig.size(), (EC_KEY*) key.get());
+    // Less common key encodings go through OpenSSL
+    if (! secp256k1::isSupportedKey (key_data, key_size))
+    {
+        openssl::ec_key const key = ECDSAPublicKey (key_data, key_size);
+        return ECDSAVerify (hash, sig, sig_size, (EC_KEY*) key.get());
+    }
+
+    auto const key = getPublicKey (key_data, key_size);
+
+    if (! key)
+        return false;
+
+    return secp256k1::verify (*key, hash, sig, sig_size);
 }
 
 bool ECDSAVerify (uint256 const& hash,
@@ -79,7 +185,15 @@ bool ECDSAVerify (uint256 const& hash,
                   std::uint8_t const* key_data,
                   std::size_t key_size)
 {
-    return ECDSAVerify (hash, sig, ECDSAPublicKey (key_data, key_size));
+    return ECDSAVerify (hash, sig.data (), sig.size (), key_data, key_size);
+}
+
+bool ECDSAVerify (uint256 const& hash,
+                  Slice const& sig,
+                  Slice const& publicKey)
+{
+    return ECDSAVerify (hash, sig.data (), sig.size (),
+        publicKey.data (), publicKey.size ());
 }
 
 } // skywell
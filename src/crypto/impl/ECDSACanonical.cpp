@@ -19,8 +19,6 @@
 
 #include <BeastConfig.h>
 #include <crypto/ECDSACanonical.h>
-#include <openssl/bn.h>
-#include <openssl/ecdsa.h>
 #include <algorithm>
 #include <cstring>
 #include <iterator>
@@ -29,148 +27,100 @@ namespace skywell {
 
 namespace detail {
 
-// A simple wrapper for a BIGNUM to make it
-// easier to allocate, construct, and free them
-struct BigNum
+// The secp256k1 group order, big endian
+static std::uint8_t const order[32] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFE,
+    0xBA, 0xAE, 0xDC, 0xE6, 0xAF, 0x48, 0xA0, 0x3B,
+    0xBF, 0xD2, 0x5E, 0x8C, 0xD0, 0x36, 0x41, 0x41 };
+
+// (order - 1) / 2, the largest fully-canonical S
+static std::uint8_t const halfOrder[32] = {
+    0x7F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x5D, 0x57, 0x6E, 0x73, 0x57, 0xA4, 0x50, 0x1D,
+    0xDF, 0xE9, 0x2F, 0x46, 0x68, 0x1B, 0x20, 0xA0 };
+
+// Reads one INTEGER: <02> <length> <value>, advancing sig and size.
+// The value must be positive and minimally encoded.
+static bool
+parseSigPart (std::uint8_t const*& sig, std::size_t& size,
+    std::uint8_t const*& value, std::size_t& valueSize)
 {
-    BIGNUM* num;
+    if ((size < 3) || (sig[0] != 0x02))
+        return false;
 
-    BigNum& operator=(BigNum const&) = delete;
+    std::size_t const len (sig[1]);
 
-    BigNum ()
-        : num (BN_new ())
-    {
+    // Claimed length can't be longer than amount of data available
+    if (len > (size - 2))
+        return false;
 
-    }
+    // Signature must be between 1 and 33 bytes.
+    if ((len < 1) || (len > 33))
+        return false;
 
-    BigNum (const char *hex)
-        : num (BN_new ())
-    {
-        BN_hex2bn (&num, hex);
-    }
+    std::uint8_t const* p = sig + 2;
 
-    BigNum (unsigned char const* ptr, std::size_t len)
-        : num (BN_new ())
-    {
-        set (ptr, len);
-    }
+    // The signature can't be negative
+    if ((p[0] & 0x80) != 0)
+        return false;
 
-    BigNum (BigNum const& other)
-        : num (BN_new ())
-    {
-        if (BN_copy (num, other.num) == nullptr)
-            BN_clear (num);
-    }
+    // It can't be zero
+    if ((p[0] == 0) && (len == 1))
+        return false;
 
-    ~BigNum ()
-    {
-        BN_free (num);
-    }
+    // And it can't be padded
+    if ((p[0] == 0) && ((p[1] & 0x80) == 0))
+        return false;
 
-    operator BIGNUM* ()
-    {
-        return num;
-    }
+    value = p;
+    valueSize = len;
 
-    operator BIGNUM const* () const
+    // Drop the sign padding; anything still longer than 32 bytes is
+    // larger than the modulus.
+    if (p[0] == 0)
     {
-        return num;
+        ++value;
+        --valueSize;
     }
 
-    bool set (unsigned char const* ptr, std::size_t len)
-    {
-        if (BN_bin2bn (ptr, len, num) == nullptr)
-            return false;
+    if (valueSize > 32)
+        return false;
 
-        return true;
-    }
-};
+    sig += len + 2;
+    size -= len + 2;
+    return true;
+}
 
-class SignaturePart
+// Compares a big endian value of at most 32 bytes with a 32 byte constant.
+static int
+compare (std::uint8_t const* value, std::size_t size,
+    std::uint8_t const* constant)
 {
-private:
-    std::size_t m_skip;
-    BigNum m_bn;
-
-public:
-    SignaturePart (unsigned char const* sig, std::size_t size)
-        : m_skip (0)
+    if (size < 32)
     {
-        // The format is: <02> <length of signature> <signature>
-        if ((sig[0] != 0x02) || (size < 3))
-            return;
-
-        std::size_t const len (sig[1]);
-
-        // Claimed length can't be longer than amount of data available
-        if (len > (size - 2))
-            return;
-
-        // Signature must be between 1 and 33 bytes.
-        if ((len < 1) || (len > 33))
-            return;
-
-        // The signature can't be negative
-        if ((sig[2] & 0x80) != 0)
-            return;
-
-        // It can't be zero
-        if ((sig[2] == 0) && (len == 1))
-            return;
-
-        // And it can't be padded
-        if ((sig[2] == 0) && ((sig[3] & 0x80) == 0))
-            return;
-
-        // Load the signature (ignore the marker prefix and length) and if
-        // successful, count the number of bytes we consumed.
-        if (m_bn.set (sig + 2, len))
-            m_skip = len + 2;
-    }
-
-    bool valid () const
-    {
-        return m_skip != 0;
-    }
-
-    // The signature as a BIGNUM
-    BigNum getBigNum () const
-    {
-        return m_bn;
-    }
-
-    // Returns the number of bytes to skip for this signature part
-    std::size_t skip () const
-    {
-        return m_skip;
+        // A shorter value is smaller unless the constant's
+        // leading bytes are zero too.
+        for (std::size_t i = 0; i < 32 - size; ++i)
+        {
+            if (constant[i] != 0)
+                return -1;
+        }
+        constant += 32 - size;
     }
-};
 
-// The SECp256k1 modulus
-static BigNum const modulus (
-    "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BBFD25E8CD0364141");
+    return std::memcmp (value, constant, size);
+}
 
 } // detail
 
-/** Determine whether a signature is canonical.
-    Canonical signatures are important to protect against signature morphing
-    attacks.
-    @param vSig the signature data
-    @param sigLen the length of the signature
-    @param strict_param whether to enforce strictly canonical semantics
-
-    @note For more details please see:
-    https://skywell.com/wiki/Transaction_Malleability
-    https://bitcointalk.org/index.php?topic=8392.msg127623#msg127623
-    https://github.com/sipa/bitcoin/commit/58bc86e37fda1aec270bccb3df6c20fbd2a6591c
-*/
-bool isCanonicalECDSASig (void const* vSig, std::size_t sigLen, ECDSA strict_param)
+bool parseECDSASig (std::uint8_t const* sig, std::size_t sigLen,
+    ECDSASigParts& parts)
 {
     // The format of a signature should be:
     // <30> <len> [ <02> <lenR> <R> ] [ <02> <lenS> <S> ]
 
-    unsigned char const* sig = reinterpret_cast<unsigned char const*> (vSig);
-
     if ((sigLen < 8) || (sigLen > 72))
         return false;
 
@@ -181,38 +131,41 @@ bool isCanonicalECDSASig (void const* vSig, std::size_t sigLen, ECDSA strict_par
     sig += 2;
     sigLen -= 2;
 
-    // Verify the R signature
-    detail::SignaturePart sigR (sig, sigLen);
-
-    if (!sigR.valid ())
+    if (! detail::parseSigPart (sig, sigLen, parts.r, parts.rSize))
         return false;
 
-    // Eat the number of bytes we consumed
-    sig += sigR.skip ();
-    sigLen -= sigR.skip ();
+    if (! detail::parseSigPart (sig, sigLen, parts.s, parts.sSize))
+        return false;
 
-    // Verify the S signature
-    detail::SignaturePart sigS (sig, sigLen);
+    // Nothing should remain at this point.
+    return sigLen == 0;
+}
 
-    if (!sigS.valid ())
-        return false;
+/** Determine whether a signature is canonical.
+    Canonical signatures are important to protect against signature morphing
+    attacks.
+    @param vSig the signature data
+    @param sigLen the length of the signature
+    @param strict_param whether to enforce strictly canonical semantics
 
-    // Eat the number of bytes we consumed
-    sig += sigS.skip ();
-    sigLen -= sigS.skip ();
+    @note For more details please see:
+    https://skywell.com/wiki/Transaction_Malleability
+    https://bitcointalk.org/index.php?topic=8392.msg127623#msg127623
+    https://github.com/sipa/bitcoin/commit/58bc86e37fda1aec270bccb3df6c20fbd2a6591c
+*/
+bool isCanonicalECDSASig (void const* vSig, std::size_t sigLen, ECDSA strict_param)
+{
+    ECDSASigParts parts;
 
-    // Nothing should remain at this point.
-    if (sigLen != 0)
+    if (! parseECDSASig (
+            reinterpret_cast<std::uint8_t const*> (vSig), sigLen, parts))
         return false;
 
     // Check whether R or S are greater than the modulus.
-    auto bnR (sigR.getBigNum ());
-    auto bnS (sigS.getBigNum ());
-
-    if (BN_cmp (bnR, detail::modulus) != -1)
+    if (detail::compare (parts.r, parts.rSize, detail::order) >= 0)
         return false;
 
-    if (BN_cmp (bnS, detail::modulus) != -1)
+    if (detail::compare (parts.s, parts.sSize, detail::order) >= 0)
         return false;
 
     // For a given signature, (R,S), the signature (R, N-S) is also valid. For
@@ -220,12 +173,7 @@ bool isCanonicalECDSASig (void const* vSig, std::size_t sigLen, ECDSA strict_par
     // be specified. If operating in strict mode, check that as well.
     if (strict_param == ECDSA::strict)
     {
-        detail::BigNum mS;
-
-        if (BN_sub (mS, detail::modulus, bnS) == 0)
-            return false;
-
-        if (BN_cmp (bnS, mS) == 1)
+        if (detail::compare (parts.s, parts.sSize, detail::halfOrder) > 0)
             return false;
     }
 
@@ -242,40 +190,52 @@ bool isCanonicalECDSASig (void const* vSig, std::size_t sigLen, ECDSA strict_par
 bool makeCanonicalECDSASig (void* vSig, std::size_t& sigLen)
 {
     unsigned char * sig = reinterpret_cast<unsigned char *> (vSig);
-    bool ret = false;
 
     // Find internals
     int rLen = sig[3];
     int sPos = rLen + 6, sLen = sig[rLen + 5];
 
-    detail::BigNum origS, newS;
-    BN_bin2bn (&sig[sPos], sLen, origS);
-    BN_sub (newS, detail::modulus, origS);
+    // Right-align S in 32 bytes, dropping any sign padding
+    std::uint8_t origS[32] = {};
+    int const copied = std::min (sLen, 32);
+    std::memcpy (&origS[32 - copied], &sig[sPos + sLen - copied], copied);
 
-    if (BN_cmp (origS, newS) == 1)
-    { // original signature is not fully canonical
-        unsigned char newSbuf [64];
-        int newSlen = BN_bn2bin (newS, newSbuf);
+    if (detail::compare (origS, 32, detail::halfOrder) <= 0)
+        return true;
 
-        if ((newSbuf[0] & 0x80) == 0)
-        { // no extra padding byte is needed
-            sig[1] = sig[1] - sLen + newSlen;
-            sig[sPos - 1] = newSlen;
-            std::memcpy (&sig[sPos], newSbuf, newSlen);
-        }
-        else
-        { // an extra padding byte is needed
-            sig[1] = sig[1] - sLen + newSlen + 1;
-            sig[sPos - 1] = newSlen + 1;
-            sig[sPos] = 0;
-            std::memcpy (&sig[sPos + 1], newSbuf, newSlen);
-        }
-        sigLen = sig[1] + 2;
+    // original signature is not fully canonical
+    std::uint8_t newS[32];
+    int borrow = 0;
+    for (int i = 31; i >= 0; --i)
+    {
+        int const d = detail::order[i] - origS[i] - borrow;
+        newS[i] = static_cast<std::uint8_t> (d);
+        borrow = (d < 0) ? 1 : 0;
+    }
+
+    int skip = 0;
+    while (skip < 31 && newS[skip] == 0)
+        ++skip;
+
+    unsigned char const* newSbuf = &newS[skip];
+    int const newSlen = 32 - skip;
+
+    if ((newSbuf[0] & 0x80) == 0)
+    { // no extra padding byte is needed
+        sig[1] = sig[1] - sLen + newSlen;
+        sig[sPos - 1] = newSlen;
+        std::memcpy (&sig[sPos], newSbuf, newSlen);
     }
     else
-        ret = true;
+    { // an extra padding byte is needed
+        sig[1] = sig[1] - sLen + newSlen + 1;
+        sig[sPos - 1] = newSlen + 1;
+        sig[sPos] = 0;
+        std::memcpy (&sig[sPos + 1], newSbuf, newSlen);
+    }
+    sigLen = sig[1] + 2;
 
-    return ret;
+    return false;
 }
 
 template <class FwdIter, class Container>
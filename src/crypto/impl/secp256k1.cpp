@@ -0,0 +1,1220 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2014 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <crypto/impl/secp256k1.h>
+#include <crypto/ECDSACanonical.h>
+#include <cassert>
+#include <cstring>
+
+namespace skywell {
+namespace secp256k1 {
+
+// Verification only ever handles public data, so none of the arithmetic
+// below attempts to run in constant time.
+
+namespace {
+
+#if defined (__SIZEOF_INT128__)
+
+typedef unsigned __int128 wide;
+
+#else
+
+// Compilers without a 128-bit integer (MSVC) get this stand-in. It has
+// just the operations the limb arithmetic below uses: mixing with 64-bit
+// values, shifting the carry down by 64, and truncating to the low limb.
+class wide
+{
+public:
+    wide (std::uint64_t lo = 0)
+        : lo_ (lo), hi_ (0)
+    {
+    }
+
+    operator std::uint64_t () const
+    {
+        return lo_;
+    }
+
+    explicit operator bool () const
+    {
+        return (lo_ | hi_) != 0;
+    }
+
+    wide& operator+= (wide const& b)
+    {
+        lo_ += b.lo_;
+        hi_ += b.hi_ + (lo_ < b.lo_ ? 1 : 0);
+        return *this;
+    }
+
+    wide& operator-= (wide const& b)
+    {
+        hi_ -= b.hi_ + (lo_ < b.lo_ ? 1 : 0);
+        lo_ -= b.lo_;
+        return *this;
+    }
+
+    wide& operator>>= (int n)
+    {
+        assert (n == 64);
+        lo_ = hi_;
+        hi_ = 0;
+        return *this;
+    }
+
+    friend wide operator>> (wide a, int n)
+    {
+        return a >>= n;
+    }
+
+    friend wide operator+ (wide a, wide const& b)
+    {
+        return a += b;
+    }
+
+    friend wide operator+ (wide a, std::uint64_t b)
+    {
+        return a += wide (b);
+    }
+
+    friend wide operator- (wide a, wide const& b)
+    {
+        return a -= b;
+    }
+
+    friend wide operator- (wide a, std::uint64_t b)
+    {
+        return a -= wide (b);
+    }
+
+    // The product is truncated to 128 bits
+    friend wide operator* (wide const& a, std::uint64_t b)
+    {
+        wide r (mul (a.lo_, b));
+        r.hi_ += a.hi_ * b;
+        return r;
+    }
+
+private:
+    static wide mul (std::uint64_t a, std::uint64_t b)
+    {
+        std::uint64_t const a0 = a & 0xffffffff, a1 = a >> 32;
+        std::uint64_t const b0 = b & 0xffffffff, b1 = b >> 32;
+
+        std::uint64_t const p00 = a0 * b0;
+        std::uint64_t const p01 = a0 * b1;
+        std::uint64_t const p10 = a1 * b0;
+        std::uint64_t const p11 = a1 * b1;
+
+        std::uint64_t const mid = (p00 >> 32) + (p01 & 0xffffffff) +
+            (p10 & 0xffffffff);
+
+        wide r;
+        r.lo_ = (mid << 32) | (p00 & 0xffffffff);
+        r.hi_ = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+        return r;
+    }
+
+    std::uint64_t lo_;
+    std::uint64_t hi_;
+};
+
+#endif
+
+//------------------------------------------------------------------------------
+//
+// Field elements modulo p = 2^256 - 2^32 - 977
+//
+// Four 64-bit limbs, least significant first, always fully reduced.
+//
+
+struct Field
+{
+    std::uint64_t d[4];
+};
+
+// 2^256 - p
+std::uint64_t const fieldC = 0x1000003D1ULL;
+
+// Adds fieldC to r; if that carries out, r was at least p.
+inline void
+reduceOnce (Field& r)
+{
+    wide t = (wide) r.d[0] + fieldC;
+    std::uint64_t const t0 = t; t >>= 64;
+    t += r.d[1]; std::uint64_t const t1 = t; t >>= 64;
+    t += r.d[2]; std::uint64_t const t2 = t; t >>= 64;
+    t += r.d[3]; std::uint64_t const t3 = t; t >>= 64;
+
+    if (t)
+    {
+        r.d[0] = t0; r.d[1] = t1; r.d[2] = t2; r.d[3] = t3;
+    }
+}
+
+inline Field
+fieldFromInt (std::uint64_t v)
+{
+    Field r = {{ v, 0, 0, 0 }};
+    return r;
+}
+
+inline bool
+isZero (Field const& a)
+{
+    return (a.d[0] | a.d[1] | a.d[2] | a.d[3]) == 0;
+}
+
+inline bool
+operator== (Field const& a, Field const& b)
+{
+    return a.d[0] == b.d[0] && a.d[1] == b.d[1] &&
+        a.d[2] == b.d[2] && a.d[3] == b.d[3];
+}
+
+inline Field
+operator+ (Field const& a, Field const& b)
+{
+    Field r;
+    wide t = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        t += (wide) a.d[i] + b.d[i];
+        r.d[i] = t;
+        t >>= 64;
+    }
+
+    if (t)
+    {
+        // a + b - 2^256 is small enough that adding fieldC cannot carry
+        t = fieldC;
+        for (int i = 0; i < 4; ++i)
+        {
+            t += r.d[i];
+            r.d[i] = t;
+            t >>= 64;
+        }
+    }
+    else
+    {
+        reduceOnce (r);
+    }
+    return r;
+}
+
+inline Field
+operator- (Field const& a, Field const& b)
+{
+    Field r;
+    std::uint64_t borrow = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        wide t = (wide) a.d[i] - b.d[i] - borrow;
+        r.d[i] = t;
+        borrow = (t >> 64) ? 1 : 0;
+    }
+
+    if (borrow)
+    {
+        // r holds a - b + 2^256; a - b + p is r - fieldC
+        borrow = fieldC;
+        for (int i = 0; i < 4; ++i)
+        {
+            wide t = (wide) r.d[i] - borrow;
+            r.d[i] = t;
+            borrow = (t >> 64) ? 1 : 0;
+        }
+    }
+    return r;
+}
+
+inline Field
+negate (Field const& a)
+{
+    return fieldFromInt (0) - a;
+}
+
+// Reduces a 512-bit product modulo p.
+Field
+reduce (std::uint64_t const* t)
+{
+    // 2^256 is congruent to fieldC: fold the high half in twice
+    Field r;
+    wide c = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        c += (wide) t[i + 4] * fieldC + t[i];
+        r.d[i] = c;
+        c >>= 64;
+    }
+
+    c = c * fieldC + r.d[0];
+    r.d[0] = c; c >>= 64;
+    c += r.d[1]; r.d[1] = c; c >>= 64;
+    c += r.d[2]; r.d[2] = c; c >>= 64;
+    c += r.d[3]; r.d[3] = c; c >>= 64;
+
+    if (c)
+    {
+        // The low limbs are tiny here, so this cannot carry again
+        c = (wide) r.d[0] + fieldC;
+        r.d[0] = c; c >>= 64;
+        c += r.d[1]; r.d[1] = c; c >>= 64;
+        c += r.d[2]; r.d[2] = c; c >>= 64;
+        r.d[3] += c;
+    }
+
+    reduceOnce (r);
+    return r;
+}
+
+Field
+operator* (Field const& a, Field const& b)
+{
+    std::uint64_t t[8];
+    {
+        wide c = 0;
+        for (int j = 0; j < 4; ++j)
+        {
+            c += (wide) a.d[0] * b.d[j];
+            t[j] = c;
+            c >>= 64;
+        }
+        t[4] = c;
+    }
+    for (int i = 1; i < 4; ++i)
+    {
+        wide c = 0;
+        for (int j = 0; j < 4; ++j)
+        {
+            c += (wide) a.d[i] * b.d[j] + t[i + j];
+            t[i + j] = c;
+            c >>= 64;
+        }
+        t[i + 4] = c;
+    }
+    return reduce (t);
+}
+
+Field
+square (Field const& a)
+{
+    // The cross products once, then doubled, then the squares
+    std::uint64_t t[8] = {};
+    for (int i = 0; i < 3; ++i)
+    {
+        wide c = 0;
+        for (int j = i + 1; j < 4; ++j)
+        {
+            c += (wide) a.d[i] * a.d[j] + t[i + j];
+            t[i + j] = c;
+            c >>= 64;
+        }
+        t[i + 4] = c;
+    }
+
+    for (int i = 7; i > 0; --i)
+        t[i] = (t[i] << 1) | (t[i - 1] >> 63);
+
+    wide c = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        wide const sq = (wide) a.d[i] * a.d[i];
+        c += (std::uint64_t) sq;
+        c += t[2 * i];
+        t[2 * i] = c;
+        c >>= 64;
+        c += (std::uint64_t) (sq >> 64);
+        c += t[2 * i + 1];
+        t[2 * i + 1] = c;
+        c >>= 64;
+    }
+    return reduce (t);
+}
+
+inline Field
+squareN (Field a, int n)
+{
+    while (n--)
+        a = square (a);
+    return a;
+}
+
+// a^(2^223 - 1) and a^(2^22 - 1), the shared prefix of the addition chains
+// for inversion and square roots.
+void
+powPrefix (Field const& a, Field& x2, Field& x22, Field& x223)
+{
+    x2 = square (a) * a;
+    Field const x3 = square (x2) * a;
+    Field const x6 = squareN (x3, 3) * x3;
+    Field const x9 = squareN (x6, 3) * x3;
+    Field const x11 = squareN (x9, 2) * x2;
+    x22 = squareN (x11, 11) * x11;
+    Field const x44 = squareN (x22, 22) * x22;
+    Field const x88 = squareN (x44, 44) * x44;
+    Field const x176 = squareN (x88, 88) * x88;
+    Field const x220 = squareN (x176, 44) * x44;
+    x223 = squareN (x220, 3) * x3;
+}
+
+// a^(p - 2)
+Field
+inverse (Field const& a)
+{
+    Field x2, x22, x223;
+    powPrefix (a, x2, x22, x223);
+    Field t = squareN (x223, 23) * x22;
+    t = squareN (t, 5) * a;
+    t = squareN (t, 3) * x2;
+    return squareN (t, 2) * a;
+}
+
+// a^((p + 1) / 4), a square root of a if one exists
+Field
+squareRoot (Field const& a)
+{
+    Field x2, x22, x223;
+    powPrefix (a, x2, x22, x223);
+    Field t = squareN (x223, 23) * x22;
+    t = squareN (t, 6) * x2;
+    return squareN (t, 2);
+}
+
+// Loads 32 big endian bytes; fails if the value is not below p.
+bool
+fieldFromBytes (Field& r, std::uint8_t const* p)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        std::uint64_t v = 0;
+        for (int j = 0; j < 8; ++j)
+            v = (v << 8) | p[(3 - i) * 8 + j];
+        r.d[i] = v;
+    }
+
+    Field t = r;
+    reduceOnce (t);
+    return t == r;
+}
+
+//------------------------------------------------------------------------------
+//
+// Scalars modulo the group order n
+//
+
+struct Scalar
+{
+    std::uint64_t d[4];
+};
+
+Scalar const order = {{
+    0xBFD25E8CD0364141ULL, 0xBAAEDCE6AF48A03BULL,
+    0xFFFFFFFFFFFFFFFEULL, 0xFFFFFFFFFFFFFFFFULL }};
+
+// 2^256 - n
+std::uint64_t const orderC[3] = {
+    0x402DA1732FC9BEBFULL, 0x4551231950B75FC4ULL, 0x1ULL };
+
+inline bool
+isZero (Scalar const& a)
+{
+    return (a.d[0] | a.d[1] | a.d[2] | a.d[3]) == 0;
+}
+
+// Returns true and subtracts n if a is at least n.
+inline bool
+reduceOnce (Scalar& a)
+{
+    wide t = 0;
+    std::uint64_t r[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        t += (wide) a.d[i] + (i < 3 ? orderC[i] : 0);
+        r[i] = t;
+        t >>= 64;
+    }
+
+    if (! t)
+        return false;
+
+    std::memcpy (a.d, r, sizeof (r));
+    return true;
+}
+
+// Reduces a little endian value of up to eight limbs modulo n.
+Scalar
+reduceWide (std::uint64_t const* in, int len)
+{
+    std::uint64_t t[8];
+    std::memcpy (t, in, len * sizeof (std::uint64_t));
+
+    while (len > 4)
+    {
+        // t = lo + hi * 2^256, and 2^256 is congruent to orderC
+        std::uint64_t r[8] = {};
+        std::memcpy (r, t, 4 * sizeof (std::uint64_t));
+
+        for (int i = 0; i < len - 4; ++i)
+        {
+            wide c = 0;
+            int k = i;
+            for (int j = 0; j < 3; ++j, ++k)
+            {
+                c += (wide) t[4 + i] * orderC[j] + r[k];
+                r[k] = c;
+                c >>= 64;
+            }
+            for (; c != 0 && k < 8; ++k)
+            {
+                c += r[k];
+                r[k] = c;
+                c >>= 64;
+            }
+        }
+
+        std::memcpy (t, r, sizeof (r));
+        len = 8;
+        while (len > 4 && t[len - 1] == 0)
+            --len;
+    }
+
+    Scalar s;
+    std::memcpy (s.d, t, sizeof (s.d));
+    reduceOnce (s);
+    return s;
+}
+
+// The full 512-bit product, little endian
+void
+mulWide (std::uint64_t* t, std::uint64_t const* a, std::uint64_t const* b)
+{
+    for (int i = 0; i < 8; ++i)
+        t[i] = 0;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        wide c = 0;
+        for (int j = 0; j < 4; ++j)
+        {
+            c += (wide) a[i] * b[j] + t[i + j];
+            t[i + j] = c;
+            c >>= 64;
+        }
+        t[i + 4] = c;
+    }
+}
+
+Scalar
+operator* (Scalar const& a, Scalar const& b)
+{
+    std::uint64_t t[8];
+    mulWide (t, a.d, b.d);
+    return reduceWide (t, 8);
+}
+
+Scalar
+operator+ (Scalar const& a, Scalar const& b)
+{
+    std::uint64_t t[5];
+    wide c = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        c += (wide) a.d[i] + b.d[i];
+        t[i] = c;
+        c >>= 64;
+    }
+    t[4] = c;
+    return reduceWide (t, 5);
+}
+
+Scalar
+negate (Scalar const& a)
+{
+    if (isZero (a))
+        return a;
+
+    Scalar r;
+    std::uint64_t borrow = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        wide t = (wide) order.d[i] - a.d[i] - borrow;
+        r.d[i] = t;
+        borrow = (t >> 64) ? 1 : 0;
+    }
+    return r;
+}
+
+// Halves v, where v is an integer of 256 bits plus a carry bit.
+inline void
+halve (std::uint64_t* v, std::uint64_t carry)
+{
+    for (int i = 0; i < 3; ++i)
+        v[i] = (v[i] >> 1) | (v[i + 1] << 63);
+    v[3] = (v[3] >> 1) | (carry << 63);
+}
+
+inline bool
+lessThan (std::uint64_t const* a, std::uint64_t const* b)
+{
+    for (int i = 3; i >= 0; --i)
+    {
+        if (a[i] != b[i])
+            return a[i] < b[i];
+    }
+    return false;
+}
+
+inline void
+subtract (std::uint64_t* a, std::uint64_t const* b)
+{
+    std::uint64_t borrow = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        wide t = (wide) a[i] - b[i] - borrow;
+        a[i] = t;
+        borrow = (t >> 64) ? 1 : 0;
+    }
+}
+
+// a - b modulo n, for reduced a and b
+inline void
+subtractModOrder (Scalar& a, Scalar const& b)
+{
+    std::uint64_t borrow = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        wide t = (wide) a.d[i] - b.d[i] - borrow;
+        a.d[i] = t;
+        borrow = (t >> 64) ? 1 : 0;
+    }
+
+    if (borrow)
+    {
+        wide c = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            c += (wide) a.d[i] + order.d[i];
+            a.d[i] = c;
+            c >>= 64;
+        }
+    }
+}
+
+// x / 2 modulo n
+inline void
+halveModOrder (Scalar& x)
+{
+    if ((x.d[0] & 1) == 0)
+    {
+        halve (x.d, 0);
+        return;
+    }
+
+    wide c = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        c += (wide) x.d[i] + order.d[i];
+        x.d[i] = c;
+        c >>= 64;
+    }
+    halve (x.d, static_cast<std::uint64_t> (c));
+}
+
+// a^-1 modulo n by the binary extended Euclidean algorithm, for a != 0.
+// Much cheaper than exponentiation, and timing does not matter here.
+Scalar
+inverse (Scalar const& a)
+{
+    Scalar u = a;
+    Scalar v = order;
+    Scalar x1 = {{ 1, 0, 0, 0 }};
+    Scalar x2 = {{ 0, 0, 0, 0 }};
+
+    static std::uint64_t const one[4] = { 1, 0, 0, 0 };
+
+    for (;;)
+    {
+        while ((u.d[0] & 1) == 0)
+        {
+            halve (u.d, 0);
+            halveModOrder (x1);
+        }
+
+        while ((v.d[0] & 1) == 0)
+        {
+            halve (v.d, 0);
+            halveModOrder (x2);
+        }
+
+        if (! lessThan (u.d, v.d))
+        {
+            subtract (u.d, v.d);
+            subtractModOrder (x1, x2);
+
+            if (isZero (u))
+                break;
+        }
+        else
+        {
+            subtract (v.d, u.d);
+            subtractModOrder (x2, x1);
+        }
+
+        if (! lessThan (one, u.d))
+            return x1;
+        if (! lessThan (one, v.d))
+            return x2;
+    }
+
+    // u and v met without reaching one: a shares a factor with n,
+    // which cannot happen for a prime n and a nonzero a.
+    assert (false);
+    return x2;
+}
+
+// Loads 32 big endian bytes, without reducing.
+Scalar
+scalarFromBytes (std::uint8_t const* p)
+{
+    Scalar r;
+    for (int i = 0; i < 4; ++i)
+    {
+        std::uint64_t v = 0;
+        for (int j = 0; j < 8; ++j)
+            v = (v << 8) | p[(3 - i) * 8 + j];
+        r.d[i] = v;
+    }
+    return r;
+}
+
+//------------------------------------------------------------------------------
+//
+// Points
+//
+
+struct Affine
+{
+    Field x;
+    Field y;
+};
+
+struct Jacobian
+{
+    Field x;
+    Field y;
+    Field z;
+    bool infinity;
+};
+
+Field const curveB = fieldFromInt (7);
+
+inline Jacobian
+toJacobian (Affine const& a)
+{
+    Jacobian r;
+    r.x = a.x;
+    r.y = a.y;
+    r.z = fieldFromInt (1);
+    r.infinity = false;
+    return r;
+}
+
+// dbl-2009-l, for curves with a = 0
+Jacobian
+twice (Jacobian const& p)
+{
+    if (p.infinity || isZero (p.y))
+    {
+        Jacobian r = p;
+        r.infinity = true;
+        return r;
+    }
+
+    Field const a = square (p.x);
+    Field const b = square (p.y);
+    Field const c = square (b);
+    Field d = square (p.x + b) - a - c;
+    d = d + d;
+    Field const e = a + a + a;
+    Field const f = square (e);
+
+    Jacobian r;
+    r.x = f - d - d;
+    Field c8 = c + c;
+    c8 = c8 + c8;
+    c8 = c8 + c8;
+    r.y = e * (d - r.x) - c8;
+    r.z = p.y * p.z;
+    r.z = r.z + r.z;
+    r.infinity = false;
+    return r;
+}
+
+// madd-2007-bl, adding an affine point
+Jacobian
+add (Jacobian const& p, Affine const& q)
+{
+    if (p.infinity)
+        return toJacobian (q);
+
+    Field const z1z1 = square (p.z);
+    Field const u2 = q.x * z1z1;
+    Field const s2 = q.y * p.z * z1z1;
+    Field const h = u2 - p.x;
+    Field r = s2 - p.y;
+
+    if (isZero (h))
+    {
+        if (isZero (r))
+            return twice (toJacobian (q));
+
+        Jacobian inf = p;
+        inf.infinity = true;
+        return inf;
+    }
+
+    r = r + r;
+    Field const hh = square (h);
+    Field i = hh + hh;
+    i = i + i;
+    Field const j = h * i;
+    Field const v = p.x * i;
+
+    Jacobian out;
+    out.x = square (r) - j - v - v;
+    Field const yj = p.y * j;
+    out.y = r * (v - out.x) - yj - yj;
+    out.z = square (p.z + h) - z1z1 - hh;
+    out.infinity = false;
+    return out;
+}
+
+inline Affine
+negate (Affine const& a)
+{
+    Affine r;
+    r.x = a.x;
+    r.y = negate (a.y);
+    return r;
+}
+
+// Fills table with p, 3p, 5p, ... (2 * size - 1)p in affine form.
+void
+oddMultiples (Affine* table, int size, Affine const& p)
+{
+    Affine two;
+    {
+        Jacobian const d = twice (toJacobian (p));
+        Field const zi = inverse (d.z);
+        Field const zi2 = square (zi);
+        two.x = d.x * zi2;
+        two.y = d.y * zi2 * zi;
+    }
+
+    // Every entry is a small odd multiple of a point of prime order,
+    // so none of the additions meet the doubling or infinity cases.
+    Jacobian* const points = new Jacobian[size];
+    points[0] = toJacobian (p);
+    for (int i = 1; i < size; ++i)
+        points[i] = add (points[i - 1], two);
+
+    // Montgomery's trick: a single inversion for every z coordinate
+    Field* const prefix = new Field[size];
+    prefix[0] = points[0].z;
+    for (int i = 1; i < size; ++i)
+        prefix[i] = prefix[i - 1] * points[i].z;
+
+    Field acc = inverse (prefix[size - 1]);
+    for (int i = size - 1; i >= 0; --i)
+    {
+        Field const zi = (i == 0) ? acc : acc * prefix[i - 1];
+        if (i != 0)
+            acc = acc * points[i].z;
+
+        Field const zi2 = square (zi);
+        table[i].x = points[i].x * zi2;
+        table[i].y = points[i].y * zi2 * zi;
+    }
+
+    delete[] prefix;
+    delete[] points;
+}
+
+//------------------------------------------------------------------------------
+//
+// Scalar multiplication
+//
+
+// Window sizes of the wNAF representations. The generator tables are
+// built once; a key's tables are built when the key is parsed.
+int const windowG = 8;
+int const windowKey = 6;
+
+int const tableSizeG = 1 << (windowG - 2);
+int const tableSizeKey = 1 << (windowKey - 2);
+
+// Every scalar fed to wnaf is below 2^129
+int const wnafBits = 130;
+
+// The curve endomorphism: lambda * (x, y) = (beta * x, y)
+Scalar const lambda = {{
+    0xDF02967C1B23BD72ULL, 0x122E22EA20816678ULL,
+    0xA5261C028812645AULL, 0x5363AD4CC05C30E0ULL }};
+
+Field const beta = {{
+    0xC1396C28719501EEULL, 0x9CF0497512F58995ULL,
+    0x6E64479EAC3434E9ULL, 0x7AE96A2B657C0710ULL }};
+
+// Constants for splitting a scalar into two halves of about 128 bits,
+// from the lattice basis (a1, b1), (a2, b2) of the endomorphism:
+// g1 = round (2^384 * b2 / n), g2 = round (2^384 * -b1 / n).
+std::uint64_t const splitG1[4] = {
+    0xE893209A45DBB031ULL, 0x3DAA8A1471E8CA7FULL,
+    0xE86C90E49284EB15ULL, 0x3086D221A7D46BCDULL };
+
+std::uint64_t const splitG2[4] = {
+    0x1571B4AE8AC47F71ULL, 0x221208AC9DF506C6ULL,
+    0x6F547FA90ABFE4C4ULL, 0xE4437ED6010E8828ULL };
+
+Scalar const minusB1 = {{
+    0x6F547FA90ABFE4C3ULL, 0xE4437ED6010E8828ULL, 0, 0 }};
+
+Scalar const minusB2 = {{
+    0xD765CDA83DB1562CULL, 0x8A280AC50774346DULL,
+    0xFFFFFFFFFFFFFFFEULL, 0xFFFFFFFFFFFFFFFFULL }};
+
+// round (k * g / 2^384)
+Scalar
+mulShift384 (Scalar const& k, std::uint64_t const* g)
+{
+    std::uint64_t t[8];
+    mulWide (t, k.d, g);
+
+    // Add 2^383 to round to nearest
+    wide c = (wide) t[5] + (std::uint64_t (1) << 63);
+    c >>= 64;
+    c += t[6];
+    std::uint64_t const lo = c;
+    c >>= 64;
+    c += t[7];
+
+    Scalar r = {{ lo, static_cast<std::uint64_t> (c), 0, 0 }};
+    return r;
+}
+
+// Finds k1, k2 with k = k1 + k2 * lambda (mod n), each at most 128 bits
+// once negated where that makes it smaller.
+void
+split (Scalar const& k, Scalar& k1, bool& neg1, Scalar& k2, bool& neg2)
+{
+    Scalar const c1 = mulShift384 (k, splitG1);
+    Scalar const c2 = mulShift384 (k, splitG2);
+
+    k2 = c1 * minusB1 + c2 * minusB2;
+    k1 = k + negate (k2 * lambda);
+
+    neg1 = k1.d[3] != 0 || k1.d[2] != 0;
+    if (neg1)
+        k1 = negate (k1);
+
+    neg2 = k2.d[3] != 0 || k2.d[2] != 0;
+    if (neg2)
+        k2 = negate (k2);
+}
+
+// The width-w non-adjacent form of a scalar below 2^129; returns the
+// number of digits used.
+int
+wnaf (int* digits, Scalar const& s, int w)
+{
+    auto bits = [&s](int pos, int count) -> int
+    {
+        std::uint64_t v = s.d[pos / 64] >> (pos % 64);
+        if ((pos % 64) + count > 64 && pos / 64 < 3)
+            v |= s.d[pos / 64 + 1] << (64 - pos % 64);
+        return static_cast<int> (v & ((std::uint64_t (1) << count) - 1));
+    };
+
+    std::memset (digits, 0, wnafBits * sizeof (int));
+
+    int carry = 0;
+    int last = -1;
+    int bit = 0;
+    while (bit < wnafBits)
+    {
+        if (bits (bit, 1) == carry)
+        {
+            ++bit;
+            continue;
+        }
+
+        int now = w;
+        if (now > wnafBits - bit)
+            now = wnafBits - bit;
+
+        int word = bits (bit, now) + carry;
+        carry = (word >> (w - 1)) & 1;
+        word -= carry << w;
+
+        digits[bit] = word;
+        last = bit;
+        bit += now;
+    }
+
+    assert (carry == 0);
+    return last + 1;
+}
+
+struct GeneratorTables
+{
+    Affine g[tableSizeG];        // odd multiples of G
+    Affine g128[tableSizeG];     // odd multiples of 2^128 G
+
+    GeneratorTables ()
+    {
+        static std::uint8_t const gx[32] = {
+            0x79, 0xBE, 0x66, 0x7E, 0xF9, 0xDC, 0xBB, 0xAC,
+            0x55, 0xA0, 0x62, 0x95, 0xCE, 0x87, 0x0B, 0x07,
+            0x02, 0x9B, 0xFC, 0xDB, 0x2D, 0xCE, 0x28, 0xD9,
+            0x59, 0xF2, 0x81, 0x5B, 0x16, 0xF8, 0x17, 0x98 };
+        static std::uint8_t const gy[32] = {
+            0x48, 0x3A, 0xDA, 0x77, 0x26, 0xA3, 0xC4, 0x65,
+            0x5D, 0xA4, 0xFB, 0xFC, 0x0E, 0x11, 0x08, 0xA8,
+            0xFD, 0x17, 0xB4, 0x48, 0xA6, 0x85, 0x54, 0x19,
+            0x9C, 0x47, 0xD0, 0x8F, 0xFB, 0x10, 0xD4, 0xB8 };
+
+        Affine base;
+        fieldFromBytes (base.x, gx);
+        fieldFromBytes (base.y, gy);
+        oddMultiples (g, tableSizeG, base);
+
+        Jacobian p = toJacobian (base);
+        for (int i = 0; i < 128; ++i)
+            p = twice (p);
+
+        Field const zi = inverse (p.z);
+        Field const zi2 = square (zi);
+        base.x = p.x * zi2;
+        base.y = p.y * zi2 * zi;
+        oddMultiples (g128, tableSizeG, base);
+    }
+};
+
+GeneratorTables const&
+generatorTables ()
+{
+    static GeneratorTables const tables;
+    return tables;
+}
+
+inline void
+addDigit (Jacobian& r, Affine const* table, int digit, bool negated)
+{
+    if (digit > 0)
+        r = add (r, negated ? negate (table[digit / 2]) : table[digit / 2]);
+    else
+        r = add (r, negated ? table[-digit / 2] : negate (table[-digit / 2]));
+}
+
+//------------------------------------------------------------------------------
+
+// Loads a big endian value of at most 32 bytes.
+Scalar
+scalarFromBytes (std::uint8_t const* p, std::size_t size)
+{
+    std::uint8_t buf[32] = {};
+    std::memcpy (buf + 32 - size, p, size);
+    return scalarFromBytes (buf);
+}
+
+} // (anon)
+
+//------------------------------------------------------------------------------
+
+class PublicKey
+{
+public:
+    Affine point;
+    Affine table[tableSizeKey];         // odd multiples of the point
+    Affine tableLambda[tableSizeKey];   // the same, times lambda
+
+    explicit
+    PublicKey (Affine const& p)
+        : point (p)
+    {
+        oddMultiples (table, tableSizeKey, point);
+
+        for (int i = 0; i < tableSizeKey; ++i)
+        {
+            tableLambda[i].x = table[i].x * beta;
+            tableLambda[i].y = table[i].y;
+        }
+    }
+};
+
+bool
+isSupportedKey (std::uint8_t const* data, std::size_t size)
+{
+    if (size == 33)
+        return data[0] == 0x02 || data[0] == 0x03;
+
+    if (size == 65)
+        return data[0] == 0x04;
+
+    return false;
+}
+
+std::shared_ptr <PublicKey const>
+parsePublicKey (std::uint8_t const* data, std::size_t size)
+{
+    if (! isSupportedKey (data, size))
+        return nullptr;
+
+    Affine p;
+    if (! fieldFromBytes (p.x, data + 1))
+        return nullptr;
+
+    Field const rhs = square (p.x) * p.x + curveB;
+
+    if (size == 33)
+    {
+        p.y = squareRoot (rhs);
+
+        if (! (square (p.y) == rhs))
+            return nullptr;
+
+        if ((p.y.d[0] & 1) != (data[0] & 1))
+            p.y = negate (p.y);
+    }
+    else
+    {
+        if (! fieldFromBytes (p.y, data + 33))
+            return nullptr;
+
+        if (! (square (p.y) == rhs))
+            return nullptr;
+    }
+
+    return std::make_shared <PublicKey const> (p);
+}
+
+bool
+verify (PublicKey const& key, uint256 const& hash,
+    std::uint8_t const* sig, std::size_t sigLen)
+{
+    ECDSASigParts parts;
+    if (! parseECDSASig (sig, sigLen, parts))
+        return false;
+
+    Scalar const r = scalarFromBytes (parts.r, parts.rSize);
+    Scalar const s = scalarFromBytes (parts.s, parts.sSize);
+
+    // Both must lie in [1, n - 1]
+    Scalar t = r;
+    if (isZero (r) || reduceOnce (t))
+        return false;
+    t = s;
+    if (isZero (s) || reduceOnce (t))
+        return false;
+
+    Scalar z = scalarFromBytes (hash.begin ());
+    reduceOnce (z);
+
+    Scalar const w = inverse (s);
+    Scalar const u1 = z * w;
+    Scalar const u2 = r * w;
+
+    // u1 G is split at bit 128 against the two generator tables,
+    // u2 Q through the endomorphism against the key's two tables.
+    Scalar lo = {{ u1.d[0], u1.d[1], 0, 0 }};
+    Scalar hi = {{ u1.d[2], u1.d[3], 0, 0 }};
+
+    Scalar k1, k2;
+    bool neg1, neg2;
+    split (u2, k1, neg1, k2, neg2);
+
+    int dLo[wnafBits], dHi[wnafBits], d1[wnafBits], d2[wnafBits];
+    int const nLo = wnaf (dLo, lo, windowG);
+    int const nHi = wnaf (dHi, hi, windowG);
+    int const n1 = wnaf (d1, k1, windowKey);
+    int const n2 = wnaf (d2, k2, windowKey);
+
+    int bits = nLo;
+    if (nHi > bits) bits = nHi;
+    if (n1 > bits) bits = n1;
+    if (n2 > bits) bits = n2;
+
+    GeneratorTables const& gt = generatorTables ();
+
+    Jacobian acc;
+    acc.infinity = true;
+
+    for (int i = bits - 1; i >= 0; --i)
+    {
+        acc = twice (acc);
+
+        if (d1[i] != 0)
+            addDigit (acc, key.table, d1[i], neg1);
+        if (d2[i] != 0)
+            addDigit (acc, key.tableLambda, d2[i], neg2);
+        if (dLo[i] != 0)
+            addDigit (acc, gt.g, dLo[i], false);
+        if (dHi[i] != 0)
+            addDigit (acc, gt.g128, dHi[i], false);
+    }
+
+    if (acc.infinity)
+        return false;
+
+    // Compare x / z^2 against r, and against r + n when that is still
+    // below p, without leaving Jacobian coordinates.
+    Field const zz = square (acc.z);
+    Field rx;
+    std::memcpy (rx.d, r.d, sizeof (rx.d));
+
+    if (rx * zz == acc.x)
+        return true;
+
+    Scalar rn = r;
+    {
+        wide c = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            c += (wide) rn.d[i] + order.d[i];
+            rn.d[i] = c;
+            c >>= 64;
+        }
+        if (c)
+            return false;
+    }
+
+    std::memcpy (rx.d, rn.d, sizeof (rx.d));
+    Field check = rx;
+    reduceOnce (check);
+    if (! (check == rx))
+        return false;
+
+    return rx * zz == acc.x;
+}
+
+} // secp256k1
+} // skywell
@@ -0,0 +1,65 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2014 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef SKYWELL_CRYPTO_SECP256K1_H_INCLUDED
+#define SKYWELL_CRYPTO_SECP256K1_H_INCLUDED
+
+#include <common/base/base_uint.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace skywell {
+namespace secp256k1 {
+
+/** A parsed secp256k1 public key.
+
+    Besides the point itself the key carries tables of its small odd
+    multiples, and of those of its image under the curve endomorphism,
+    so that repeated verifications against the same key only pay for
+    the doublings and additions of the multiplication itself.
+*/
+class PublicKey;
+
+/** Returns true if the key is in an encoding parsePublicKey handles.
+    These are the 33 byte compressed and 65 byte uncompressed forms.
+*/
+bool
+isSupportedKey (std::uint8_t const* data, std::size_t size);
+
+/** Decode a public key and build its tables.
+    Returns nullptr if the key is malformed or not on the curve.
+*/
+std::shared_ptr <PublicKey const>
+parsePublicKey (std::uint8_t const* data, std::size_t size);
+
+/** Verify a DER encoded ECDSA signature of a 256-bit digest.
+
+    The signature must be strictly DER encoded, as OpenSSL requires,
+    with R and S no longer than 32 bytes.
+    Canonical form (low S) is not enforced here.
+*/
+bool
+verify (PublicKey const& key, uint256 const& hash,
+    std::uint8_t const* sig, std::size_t sigLen);
+
+} // secp256k1
+} // skywell
+
+#endif
@@ -0,0 +1,250 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <crypto/Base58.h>
+#include <beast/unit_test/suite.h>
+#include <chrono>
+#include <random>
+#include <sstream>
+
+namespace skywell {
+
+class Base58_test : public beast::unit_test::suite
+{
+public:
+    static Blob fromHex (std::string const& hex)
+    {
+        Blob b;
+        for (std::size_t i = 0; i + 1 < hex.size (); i += 2)
+            b.push_back (static_cast<unsigned char> (
+                std::stoi (hex.substr (i, 2), nullptr, 16)));
+        return b;
+    }
+
+    // Schoolbook base conversion: divide the whole number by 58 until
+    // nothing is left, then restore the leading zero bytes
+    static std::string reference (Blob v, Base58::Alphabet const& alphabet)
+    {
+        std::size_t zeros = 0;
+        while (zeros < v.size () && v[zeros] == 0)
+            ++zeros;
+
+        std::string digits;
+        std::size_t first = zeros;
+        while (first < v.size ())
+        {
+            unsigned int rem = 0;
+            for (std::size_t i = first; i < v.size (); ++i)
+            {
+                unsigned int const cur = rem * 256 + v[i];
+                v[i] = static_cast<unsigned char> (cur / 58);
+                rem = cur % 58;
+            }
+            digits.push_back (alphabet.to_char (rem));
+            while (first < v.size () && v[first] == 0)
+                ++first;
+        }
+
+        digits.append (zeros, alphabet.to_char (0));
+        return std::string (digits.rbegin (), digits.rend ());
+    }
+
+    static std::string encode (Blob const& v, Base58::Alphabet const& alphabet)
+    {
+        return Base58::encode (v.data (), v.data () + v.size (),
+            alphabet, false);
+    }
+
+    void testVectors ()
+    {
+        testcase ("vectors");
+
+        auto const& alphabet = Base58::getBitcoinAlphabet ();
+
+        struct
+        {
+            char const* hex;
+            char const* text;
+        }
+        const vectors[] =
+        {
+            { "", "" },
+            { "61", "2g" },
+            { "626262", "a3gV" },
+            { "636363", "aPEr" },
+            { "73696d706c792061206c6f6e6720737472696e67",
+                "2cFupjhnEsSn59qHXstmK2ffpLv2" },
+            { "00eb15231dfceb60925886b67d065299925915aeb172c06647",
+                "1NS17iag9jJgTHD1VXjvLCEnZuQ3rJDE9L" },
+            { "516b6fcd0f", "ABnLTmg" },
+            { "bf4f89001e670274dd", "3SEo3LWLoPntC" },
+            { "572e4794", "3EFU7m" },
+            { "ecac89cad93923c02321", "EJDM8drfXA6uyA" },
+            { "10c8511e", "Rt5zm" },
+            { "00000000000000000000", "1111111111" },
+        };
+
+        for (auto const& v : vectors)
+        {
+            Blob const data (fromHex (v.hex));
+            expect (encode (data, alphabet) == v.text, v.text);
+
+            Blob decoded;
+            expect (Base58::decode (v.text, decoded, alphabet) &&
+                decoded == data, v.text);
+        }
+
+        // The zero account, 21 zero bytes with a check
+        Blob const zero (21, 0);
+        expect (Base58::encodeWithCheck (zero) ==
+            "jjjjjjjjjjjjjjjjjjjjjhoLvTp");
+    }
+
+    void testRandom ()
+    {
+        testcase ("random");
+
+        std::mt19937 gen (58);
+        std::uniform_int_distribution<int> byte (0, 255);
+        std::uniform_int_distribution<int> length (0, 70);
+        std::uniform_int_distribution<int> zeros (0, 3);
+
+        std::size_t mismatches = 0;
+        for (int i = 0; i < 20000; ++i)
+        {
+            Blob v (length (gen));
+            for (auto& b : v)
+                b = static_cast<unsigned char> (byte (gen));
+            for (int z = zeros (gen); z > 0 && z <= int (v.size ()); --z)
+                v[z - 1] = 0;
+
+            for (auto alphabet : { &Base58::getSkywellAlphabet (),
+                &Base58::getBitcoinAlphabet () })
+            {
+                std::string const s (encode (v, *alphabet));
+                if (s != reference (v, *alphabet))
+                    ++mismatches;
+
+                Blob decoded;
+                if (! Base58::decode (s.c_str (), decoded, *alphabet) ||
+                        decoded != v)
+                    ++mismatches;
+            }
+
+            Blob decoded;
+            std::string const checked (Base58::encodeWithCheck (
+                v.empty () ? Blob (1, 0) : v));
+            if (! Base58::decodeWithCheck (checked, decoded) ||
+                    decoded != (v.empty () ? Blob (1, 0) : v))
+                ++mismatches;
+        }
+
+        expect (mismatches == 0, std::to_string (mismatches) + " mismatches");
+    }
+
+    void testInvalid ()
+    {
+        testcase ("invalid");
+
+        Blob decoded;
+        expect (! Base58::decode ("j0", decoded));
+        expect (! Base58::decode ("jO", decoded));
+        expect (! Base58::decode ("j\xc3\xa9", decoded));
+        expect (! Base58::decode ("jp s", decoded));
+        expect (Base58::decode (" jps \t", decoded));
+
+        // A changed digit must fail the check
+        Blob const id (21, 7);
+        std::string s (Base58::encodeWithCheck (id));
+        expect (Base58::decodeWithCheck (s, decoded) && decoded == id);
+        s[5] = (s[5] == 'p') ? 's' : 'p';
+        expect (! Base58::decodeWithCheck (s, decoded));
+        expect (! Base58::decodeWithCheck ("jjj", decoded));
+
+        // raw_decode wants exactly the given size
+        std::string const text (encode (id, Base58::getSkywellAlphabet ()));
+        unsigned char out [22];
+        expect (Base58::raw_decode (text.data (), text.data () + text.size (),
+            out, 21, false, Base58::getSkywellAlphabet ()));
+        expect (! Base58::raw_decode (text.data (), text.data () + text.size (),
+            out, 20, false, Base58::getSkywellAlphabet ()));
+        expect (! Base58::raw_decode (text.data (), text.data () + text.size (),
+            out, 22, false, Base58::getSkywellAlphabet ()));
+    }
+
+    void run ()
+    {
+        testVectors ();
+        testRandom ();
+        testInvalid ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(Base58,crypto,skywell);
+
+//------------------------------------------------------------------------------
+
+// Encodes and decodes checked account IDs. Run with --unittest=Base58_bench
+class Base58_bench_test : public beast::unit_test::suite
+{
+public:
+    void run ()
+    {
+        using clock_type = std::chrono::steady_clock;
+        int const count = 1000000;
+
+        Blob id (21);
+        std::vector<std::string> encoded;
+        encoded.reserve (count);
+
+        auto start = clock_type::now ();
+        for (int i = 0; i < count; ++i)
+        {
+            id[1] = static_cast<unsigned char> (i);
+            id[2] = static_cast<unsigned char> (i >> 8);
+            id[3] = static_cast<unsigned char> (i >> 16);
+            encoded.push_back (Base58::encodeWithCheck (id));
+        }
+        auto const encodeTime = std::chrono::duration<double> (
+            clock_type::now () - start).count ();
+
+        Blob decoded;
+        std::size_t failures = 0;
+        start = clock_type::now ();
+        for (auto const& s : encoded)
+            if (! Base58::decodeWithCheck (s, decoded))
+                ++failures;
+        auto const decodeTime = std::chrono::duration<double> (
+            clock_type::now () - start).count ();
+
+        expect (failures == 0);
+
+        std::stringstream ss;
+        ss << "encode " << static_cast<int> (count / encodeTime) <<
+            " ids/s, decode " << static_cast<int> (count / decodeTime) <<
+            " ids/s";
+        log << ss.str ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(Base58_bench,crypto,skywell);
+
+}
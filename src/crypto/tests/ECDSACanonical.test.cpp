@@ -0,0 +1,174 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <crypto/ECDSACanonical.h>
+#include <crypto/fuzz/ECDSACanonicalFuzz.h>
+#include <beast/unit_test/suite.h>
+#include <string>
+
+namespace skywell {
+
+class ECDSACanonical_test : public beast::unit_test::suite
+{
+public:
+    using Bytes = fuzz::SignatureGenerator::Bytes;
+
+    static Bytes fromHex (std::string const& hex)
+    {
+        Bytes b;
+        for (std::size_t i = 0; i + 1 < hex.size (); i += 2)
+            b.push_back (static_cast<std::uint8_t> (
+                std::stoi (hex.substr (i, 2), nullptr, 16)));
+        return b;
+    }
+
+    bool canonical (std::string const& hex, ECDSA strict)
+    {
+        Bytes const sig (fromHex (hex));
+        return isCanonicalECDSASig (sig.data (), sig.size (), strict);
+    }
+
+    void testVectors ()
+    {
+        testcase ("vectors");
+
+        // Low S
+        std::string const low =
+            "304402202c0a4e4c318c35c97b083e14b8119f9837fb5f4edf0236a721d5341695de386f"
+            "022024a1109e8c543cb93ef81577b77e6026dde592734f82375e7b28812717862a91";
+        expect (canonical (low, ECDSA::strict));
+        expect (canonical (low, ECDSA::not_strict));
+
+        // High S, which makeCanonicalECDSASig replaces with n - S
+        std::string const high =
+            "3046022100af54b0a90effe8261fafac2dec37c83df91b45cb4faa0ad73756c33b9c6ce2d4"
+            "022100f5e90f717a588ec88e2867a46ccaad44a8d8ddf4ccc8cbbda60009831ca88de2";
+        expect (! canonical (high, ECDSA::strict));
+        expect (canonical (high, ECDSA::not_strict));
+
+        Bytes sig (fromHex (high));
+        std::size_t size = sig.size ();
+        expect (! makeCanonicalECDSASig (sig.data (), size));
+        sig.resize (size);
+        expect (isCanonicalECDSASig (sig.data (), size, ECDSA::strict));
+        expect (makeCanonicalECDSASig (sig.data (), size));
+
+        // R padded without need, R negative, S zero, S equal to the order
+        expect (! canonical (
+            "30450221002c0a4e4c318c35c97b083e14b8119f9837fb5f4edf0236a721d5341695de386f"
+            "022024a1109e8c543cb93ef81577b77e6026dde592734f82375e7b28812717862a91",
+            ECDSA::not_strict));
+        expect (! canonical (
+            "30440220ac0a4e4c318c35c97b083e14b8119f9837fb5f4edf0236a721d5341695de386f"
+            "022024a1109e8c543cb93ef81577b77e6026dde592734f82375e7b28812717862a91",
+            ECDSA::not_strict));
+        expect (! canonical (
+            "302502202c0a4e4c318c35c97b083e14b8119f9837fb5f4edf0236a721d5341695de386f"
+            "020100", ECDSA::not_strict));
+        expect (! canonical (
+            "304502202c0a4e4c318c35c97b083e14b8119f9837fb5f4edf0236a721d5341695de386f"
+            "022100fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364141",
+            ECDSA::not_strict));
+
+        // S equal to half the order is the largest strictly canonical S
+        std::string const half =
+            "304402202c0a4e4c318c35c97b083e14b8119f9837fb5f4edf0236a721d5341695de386f"
+            "02207fffffffffffffffffffffffffffffff5d576e7357a4501ddfe92f46681b20a";
+        expect (canonical (half + "0", ECDSA::strict));
+        expect (! canonical (half + "1", ECDSA::strict));
+        expect (canonical (half + "1", ECDSA::not_strict));
+    }
+
+    // The allocation free parser against the BIGNUM code it replaced, on
+    // the inputs crypto/fuzz/fuzz-ecdsa-canonical.cpp uses.
+    void testDifferential ()
+    {
+        testcase ("differential");
+
+        fuzz::SignatureGenerator generate (72);
+
+        std::size_t mismatches = 0;
+        std::size_t strict = 0;
+        std::size_t loose = 0;
+        std::size_t invalid = 0;
+
+        for (int i = 0; i < 200000; ++i)
+        {
+            Bytes const sig (generate ());
+
+            bool const s = isCanonicalECDSASig (
+                sig.data (), sig.size (), ECDSA::strict);
+            bool const l = isCanonicalECDSASig (
+                sig.data (), sig.size (), ECDSA::not_strict);
+
+            if (s != fuzz::reference::isCanonicalECDSASig (
+                    sig.data (), sig.size (), true))
+                ++mismatches;
+            if (l != fuzz::reference::isCanonicalECDSASig (
+                    sig.data (), sig.size (), false))
+                ++mismatches;
+
+            if (s)
+                ++strict;
+            else if (l)
+                ++loose;
+            else
+                ++invalid;
+
+            if (l)
+            {
+                Bytes expected (sig);
+                Bytes actual (sig);
+                std::size_t expectedSize = sig.size ();
+                std::size_t actualSize = sig.size ();
+                expected.resize (80);
+                actual.resize (80);
+
+                bool const e = fuzz::reference::makeCanonicalECDSASig (
+                    expected.data (), expectedSize);
+                bool const a = makeCanonicalECDSASig (
+                    actual.data (), actualSize);
+                expected.resize (expectedSize);
+                actual.resize (actualSize);
+
+                if (e != a || expected != actual)
+                    ++mismatches;
+            }
+        }
+
+        expect (mismatches == 0, std::to_string (mismatches) + " mismatches");
+
+        // Every outcome must be well represented
+        expect (strict > 10000, std::to_string (strict) + " strict");
+        expect (loose > 10000, std::to_string (loose) + " canonical");
+        expect (invalid > 10000, std::to_string (invalid) + " invalid");
+    }
+
+    void run ()
+    {
+        testVectors ();
+        testDifferential ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(ECDSACanonical,crypto,skywell);
+
+}
@@ -0,0 +1,451 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <crypto/impl/secp256k1.h>
+#include <beast/unit_test/suite.h>
+#include <openssl/ec.h>
+#include <openssl/ecdsa.h>
+#include <openssl/obj_mac.h>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <sstream>
+
+namespace skywell {
+
+class secp256k1_test : public beast::unit_test::suite
+{
+public:
+    using Bytes = std::vector <std::uint8_t>;
+
+    static Bytes fromHex (std::string const& hex)
+    {
+        Bytes b;
+        for (std::size_t i = 0; i + 1 < hex.size (); i += 2)
+            b.push_back (static_cast<std::uint8_t> (
+                std::stoi (hex.substr (i, 2), nullptr, 16)));
+        return b;
+    }
+
+    static uint256 hashFromBytes (Bytes const& b)
+    {
+        uint256 h;
+        std::copy (b.begin (), b.end (), h.begin ());
+        return h;
+    }
+
+    static bool nativeVerify (Bytes const& key, uint256 const& hash,
+        Bytes const& sig)
+    {
+        auto const k = secp256k1::parsePublicKey (key.data (), key.size ());
+        return k && secp256k1::verify (*k, hash, sig.data (), sig.size ());
+    }
+
+    static bool opensslVerify (Bytes const& key, uint256 const& hash,
+        Bytes const& sig)
+    {
+        EC_KEY* k = EC_KEY_new_by_curve_name (NID_secp256k1);
+        std::uint8_t const* p = key.data ();
+        bool result = false;
+        if (o2i_ECPublicKey (&k, &p, key.size ()) != nullptr)
+            result = ECDSA_verify (0, hash.begin (), hash.size (),
+                sig.data (), sig.size (), k) > 0;
+        EC_KEY_free (k);
+        return result;
+    }
+
+    // Strict DER from unsigned big endian R and S
+    static Bytes makeDER (Bytes r, Bytes s)
+    {
+        auto integer = [](Bytes v)
+        {
+            while (v.size () > 1 && v[0] == 0 && v[1] < 0x80)
+                v.erase (v.begin ());
+            if (v.empty () || v[0] >= 0x80)
+                v.insert (v.begin (), 0);
+            v.insert (v.begin (), static_cast<std::uint8_t> (v.size ()));
+            v.insert (v.begin (), 0x02);
+            return v;
+        };
+
+        Bytes body (integer (r));
+        Bytes const ss (integer (s));
+        body.insert (body.end (), ss.begin (), ss.end ());
+        body.insert (body.begin (), static_cast<std::uint8_t> (body.size ()));
+        body.insert (body.begin (), 0x30);
+        return body;
+    }
+
+    // R and S of a strict DER signature, as 32 byte big endian values
+    static void splitDER (Bytes const& sig, Bytes& r, Bytes& s)
+    {
+        auto value = [](std::uint8_t const* p, std::size_t n)
+        {
+            Bytes v (32, 0);
+            while (n > 32)
+            {
+                ++p;
+                --n;
+            }
+            std::copy (p, p + n, v.end () - n);
+            return v;
+        };
+
+        std::size_t const rLen = sig[3];
+        r = value (&sig[4], rLen);
+        s = value (&sig[6 + rLen], sig[5 + rLen]);
+    }
+
+    static Bytes order ()
+    {
+        return fromHex ("FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFE"
+            "BAAEDCE6AF48A03BBFD25E8CD0364141");
+    }
+
+    // n - s, the other S that makes the same signature valid
+    static Bytes negateS (Bytes const& s)
+    {
+        Bytes const n (order ());
+        Bytes r (32);
+        int borrow = 0;
+        for (int i = 31; i >= 0; --i)
+        {
+            int const d = n[i] - s[i] - borrow;
+            r[i] = static_cast<std::uint8_t> (d & 0xff);
+            borrow = d < 0 ? 1 : 0;
+        }
+        return r;
+    }
+
+    // Signatures made by OpenSSL for keys with small and extreme private
+    // scalars: 1, 2, 3, an arbitrary one, n - 1 and (n - 1) / 2.
+    void testVectors ()
+    {
+        testcase ("vectors");
+
+        struct
+        {
+            char const* key;
+            char const* hash;
+            char const* sig;
+        }
+        const vectors[] =
+        {
+            { "0279be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798",
+              "40988a6186ab008b60f0261e3a81e572be64f3c4489aa86e340c2a0849214829",
+              "304402202c0a4e4c318c35c97b083e14b8119f9837fb5f4edf0236a721d5341695de386f"
+              "022024a1109e8c543cb93ef81577b77e6026dde592734f82375e7b28812717862a91" },
+            { "04c6047f9441ed7d6d3045406e95c07cd85c778e4b8cef3ca7abac09b95c709ee5"
+              "1ae168fea63dc339a3c58419466ceaeef7f632653266d0e1236431a950cfe52a",
+              "85f85b3e1630e6e7ad5d8b0f9b883c211e1e8b64979c4e6194f3cd367415cf5f",
+              "3046022100af54b0a90effe8261fafac2dec37c83df91b45cb4faa0ad73756c33b9c6ce2d4"
+              "022100f5e90f717a588ec88e2867a46ccaad44a8d8ddf4ccc8cbbda60009831ca88de2" },
+            { "02f9308a019258c31049344f85f89d5229b531c845836f99b08601f113bce036f9",
+              "589d51c7ae4b2bfd6343462efc15cf01a9b2ecfff25fde450af9c6a165bdbc63",
+              "304502210081ee87f3530ce699c554d9e0e07726d2e188e6aa04f1254ceb0f6d9c24fd5028"
+              "0220151f8ecc183e7e6b93c6076159238caa306aad254830d86d4221e06d454fcd1b" },
+            { "043236df14a7e600a4634e62af87704dcd1f20e6ebde6d98a2a4d72bf1107a54bf"
+              "a60f117e62a650e40a226ec16a55161cf91f4f5e76a894be8383653ba61dcbde",
+              "cb6807da6db88ba5e93ef2bbe3da0fc2cf68fc3b984536a0f4d11509a70abb20",
+              "304502201190066dbb341c8a7aed3c0b516ead407a1bfe7f34151cdf9222ed70cfe07de4"
+              "022100fa1cafe9643ee4b54e2ec54f45523600f414cfaa5018fe61cdb73fae502643ac" },
+            { "0379be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798",
+              "a4a3cc87ace0a994c32923e73f3256d8c55855e0d953b212d70b17ea762941e0",
+              "304502207070f2c8060c96eef8ef97db7add4b983390cfa7272dc2b1558b92d091eda1a3"
+              "022100bd387ec279292a33a4a899b402eb5bc188dd89066c420263b54ba71e0879cce6" },
+            { "0400000000000000000000003b78ce563f89a0ed9414f5aa28ad0d96d6795f9c63"
+              "3f3979bf72ae8202983dc989aec7f2ff2ed91bdd69ce02fc0700ca100e59ddf3",
+              "55fe556304d9cb80ad3b527e98f4e674b02d8a94281d181502196c8c8d6172e0",
+              "3044022005d7c0e90de5dc029cc3d8fbf31d1292d8f761ca6b98c9a19e91ac8657c4d17b"
+              "022066e16f8bc8fd90b164d18eb91d34565050f1c7ab283f569b4d5b237c951425e3" },
+        };
+
+        for (auto const& v : vectors)
+        {
+            Bytes const key (fromHex (v.key));
+            uint256 hash (hashFromBytes (fromHex (v.hash)));
+            Bytes const sig (fromHex (v.sig));
+
+            expect (secp256k1::isSupportedKey (key.data (), key.size ()),
+                v.key);
+            expect (nativeVerify (key, hash, sig), v.sig);
+
+            // Low and high S are both accepted here
+            Bytes r, s;
+            splitDER (sig, r, s);
+            expect (nativeVerify (key, hash, makeDER (r, negateS (s))),
+                v.sig);
+
+            hash.begin ()[31] ^= 1;
+            expect (! nativeVerify (key, hash, sig), v.sig);
+        }
+    }
+
+    void testInvalid ()
+    {
+        testcase ("invalid");
+
+        Bytes const key (fromHex (
+            "0279be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798"));
+        uint256 const hash (hashFromBytes (fromHex (
+            "40988a6186ab008b60f0261e3a81e572be64f3c4489aa86e340c2a0849214829")));
+        Bytes const sig (fromHex (
+            "304402202c0a4e4c318c35c97b083e14b8119f9837fb5f4edf0236a721d5341695de386f"
+            "022024a1109e8c543cb93ef81577b77e6026dde592734f82375e7b28812717862a91"));
+
+        Bytes r, s;
+        splitDER (sig, r, s);
+        Bytes const zero (32, 0);
+        Bytes const n (order ());
+
+        expect (nativeVerify (key, hash, makeDER (r, s)));
+        expect (! nativeVerify (key, hash, makeDER (zero, s)), "r = 0");
+        expect (! nativeVerify (key, hash, makeDER (r, zero)), "s = 0");
+        expect (! nativeVerify (key, hash, makeDER (n, s)), "r = n");
+        expect (! nativeVerify (key, hash, makeDER (r, n)), "s = n");
+
+        // r + n still fits in 32 bytes here, and must not be reduced
+        Bytes rn (r);
+        {
+            int carry = 0;
+            for (int i = 31; i >= 0; --i)
+            {
+                int const d = rn[i] + n[i] + carry;
+                rn[i] = static_cast<std::uint8_t> (d & 0xff);
+                carry = d >> 8;
+            }
+            if (! carry)
+                expect (! nativeVerify (key, hash, makeDER (rn, s)), "r + n");
+        }
+
+        auto mutated = [&](std::function <void (Bytes&)> f)
+        {
+            Bytes m (sig);
+            f (m);
+            return m;
+        };
+
+        expect (! nativeVerify (key, hash, Bytes ()), "empty");
+        expect (! nativeVerify (key, hash, mutated ([](Bytes& m)
+            { m[0] = 0x31; })), "sequence tag");
+        expect (! nativeVerify (key, hash, mutated ([](Bytes& m)
+            { m[2] = 0x03; })), "integer tag");
+        expect (! nativeVerify (key, hash, mutated ([](Bytes& m)
+            { ++m[1]; })), "sequence length");
+        expect (! nativeVerify (key, hash, mutated ([](Bytes& m)
+            { m.push_back (0); })), "trailing byte");
+        expect (! nativeVerify (key, hash, mutated ([](Bytes& m)
+            { m.pop_back (); })), "truncated");
+        expect (! nativeVerify (key, hash, mutated ([](Bytes& m)
+            {
+                // A redundant leading zero on R
+                m.insert (m.begin () + 4, 0);
+                ++m[1];
+                ++m[3];
+            })), "padded r");
+        expect (! nativeVerify (key, hash, mutated ([](Bytes& m)
+            {
+                // R with its top bit set reads as negative
+                m[4] |= 0x80;
+            })), "negative r");
+
+        // Keys: not on the curve, x >= p, unknown prefixes and sizes
+        Bytes bad (key);
+        bad[32] ^= 1;
+        expect (! secp256k1::parsePublicKey (bad.data (), bad.size ()) ||
+            ! nativeVerify (bad, hash, sig), "other x");
+        Bytes big (33, 0xff);
+        big[0] = 0x02;
+        expect (! secp256k1::parsePublicKey (big.data (), big.size ()),
+            "x >= p");
+        bad = key;
+        bad[0] = 0x05;
+        expect (! secp256k1::isSupportedKey (bad.data (), bad.size ()));
+        expect (! secp256k1::parsePublicKey (bad.data (), bad.size ()));
+        expect (! secp256k1::parsePublicKey (key.data (), 32));
+        Bytes uncompressed (fromHex (
+            "04c6047f9441ed7d6d3045406e95c07cd85c778e4b8cef3ca7abac09b95c709ee5"
+            "1ae168fea63dc339a3c58419466ceaeef7f632653266d0e1236431a950cfe52a"));
+        uncompressed[64] ^= 1;
+        expect (! secp256k1::parsePublicKey (
+            uncompressed.data (), uncompressed.size ()), "y off the curve");
+    }
+
+    // Compares against OpenSSL on random keys, each with a good signature
+    // and a set of damaged ones.
+    void testDifferential ()
+    {
+        testcase ("differential");
+
+        std::mt19937 gen (256);
+        std::uniform_int_distribution<int> byte (0, 255);
+
+        std::size_t mismatches = 0;
+        std::size_t valid = 0;
+        std::size_t total = 0;
+
+        auto compare = [&](Bytes const& key, uint256 const& hash,
+            Bytes const& sig)
+        {
+            bool const expected = opensslVerify (key, hash, sig);
+            if (nativeVerify (key, hash, sig) != expected)
+                ++mismatches;
+            if (expected)
+                ++valid;
+            ++total;
+        };
+
+        for (int i = 0; i < 250; ++i)
+        {
+            EC_KEY* k = EC_KEY_new_by_curve_name (NID_secp256k1);
+            EC_KEY_generate_key (k);
+            EC_KEY_set_conv_form (k, (i % 5 == 0) ?
+                POINT_CONVERSION_UNCOMPRESSED : POINT_CONVERSION_COMPRESSED);
+
+            Bytes key (65);
+            std::uint8_t* p = key.data ();
+            key.resize (i2o_ECPublicKey (k, &p));
+
+            uint256 hash;
+            for (auto& b : hash)
+                b = static_cast<std::uint8_t> (byte (gen));
+
+            Bytes sig (ECDSA_size (k));
+            unsigned int sigLen = 0;
+            ECDSA_sign (0, hash.begin (), hash.size (), sig.data (),
+                &sigLen, k);
+            sig.resize (sigLen);
+            EC_KEY_free (k);
+
+            compare (key, hash, sig);
+
+            Bytes r, s;
+            splitDER (sig, r, s);
+            compare (key, hash, makeDER (r, negateS (s)));
+            compare (key, hash, makeDER (s, r));
+
+            uint256 other (hash);
+            other.begin ()[byte (gen) % 32] ^= 1 << (byte (gen) % 8);
+            compare (key, other, sig);
+
+            for (int j = 0; j < 8; ++j)
+            {
+                Bytes m (sig);
+                m[byte (gen) % m.size ()] ^= 1 << (byte (gen) % 8);
+                compare (key, hash, m);
+            }
+
+            Bytes m (sig);
+            m.resize (byte (gen) % sig.size ());
+            compare (key, hash, m);
+
+            Bytes badKey (key);
+            badKey[1 + byte (gen) % (key.size () - 1)] ^= 1 << (byte (gen) % 8);
+            compare (badKey, hash, sig);
+        }
+
+        expect (mismatches == 0, std::to_string (mismatches) +
+            " of " + std::to_string (total) + " disagree");
+        expect (valid >= 500, std::to_string (valid) + " valid");
+    }
+
+    void run ()
+    {
+        testVectors ();
+        testInvalid ();
+        testDifferential ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(secp256k1,crypto,skywell);
+
+//------------------------------------------------------------------------------
+
+// Verifications per second, OpenSSL against the native path.
+// Run with --unittest=secp256k1_bench
+class secp256k1_bench_test : public beast::unit_test::suite
+{
+public:
+    void run ()
+    {
+        using clock_type = std::chrono::steady_clock;
+        using Bytes = secp256k1_test::Bytes;
+        int const count = 2000;
+
+        EC_KEY* k = EC_KEY_new_by_curve_name (NID_secp256k1);
+        EC_KEY_generate_key (k);
+        EC_KEY_set_conv_form (k, POINT_CONVERSION_COMPRESSED);
+        Bytes key (33);
+        std::uint8_t* p = key.data ();
+        i2o_ECPublicKey (k, &p);
+
+        std::vector <uint256> hashes (count);
+        std::vector <Bytes> sigs (count);
+        std::mt19937 gen;
+        for (int i = 0; i < count; ++i)
+        {
+            for (auto& b : hashes[i])
+                b = static_cast<std::uint8_t> (gen ());
+            sigs[i].resize (ECDSA_size (k));
+            unsigned int sigLen = 0;
+            ECDSA_sign (0, hashes[i].begin (), hashes[i].size (),
+                sigs[i].data (), &sigLen, k);
+            sigs[i].resize (sigLen);
+        }
+        EC_KEY_free (k);
+
+        auto rate = [&](std::function <bool (int)> verify)
+        {
+            int good = 0;
+            auto const start = clock_type::now ();
+            for (int i = 0; i < count; ++i)
+                good += verify (i);
+            std::chrono::duration<double> const elapsed =
+                clock_type::now () - start;
+            expect (good == count);
+            return static_cast<int> (count / elapsed.count ());
+        };
+
+        int const openssl = rate ([&](int i)
+        {
+            return secp256k1_test::opensslVerify (key, hashes[i], sigs[i]);
+        });
+        int const uncached = rate ([&](int i)
+        {
+            return secp256k1_test::nativeVerify (key, hashes[i], sigs[i]);
+        });
+        auto const parsed = secp256k1::parsePublicKey (key.data (), key.size ());
+        int const cached = rate ([&](int i)
+        {
+            return secp256k1::verify (*parsed, hashes[i],
+                sigs[i].data (), sigs[i].size ());
+        });
+
+        std::stringstream ss;
+        ss << "openssl " << openssl << "/s, native " << uncached <<
+            "/s, native with parsed key " << cached << "/s";
+        log << ss.str ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(secp256k1_bench,crypto,skywell);
+
+}
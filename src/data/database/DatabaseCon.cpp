@@ -25,30 +25,38 @@
 
 namespace skywell {
 
+static std::string
+mysqlConnectionString (DatabaseCon::Setup const& setup, std::string const& strName)
+{
+	//std::string dbpath = "host=localhost user=jingtum pass=good db=jingtum";
+	if (strName.compare("transaction") == 0)
+		return setup.mysqlStrings[0];
+	else if (strName.compare("ledger") == 0)
+		return setup.mysqlStrings[1];
+	else if (strName.compare("wallet") == 0)
+		return setup.mysqlStrings[2];
+	return {};
+}
+
 DatabaseCon::DatabaseCon (
     Setup const& setup,
     std::string const& strName,
     const char* initStrings[],
     int initCount)
+    : DatabaseCon ("mysql", mysqlConnectionString (setup, strName),
+        initStrings, initCount)
 {
-    auto const useTempFiles  // Use temporary files or regular DB files?
-        = setup.standAlone &&
-          setup.startUp != Config::LOAD &&
-          setup.startUp != Config::LOAD_FILE &&
-          setup.startUp != Config::REPLAY;
-
-    boost::filesystem::path pPath = useTempFiles ? "" : (setup.dataDir / strName);
-
-	//std::string dbpath = "host=localhost user=jingtum pass=good db=jingtum";
-	std::string dbPath;
-	if (strName.compare("transaction") == 0)
-		dbPath = setup.mysqlStrings[0];
-	else if (strName.compare("ledger") == 0)
-		dbPath = setup.mysqlStrings[1];
-	else if (strName.compare("wallet") == 0)
-		dbPath = setup.mysqlStrings[2];
+}
 
-	open(session_, "mysql", dbPath);
+DatabaseCon::DatabaseCon (
+    std::string const& backend,
+    std::string const& connectionString,
+    const char* initStrings[],
+    int initCount)
+    : backend_ (backend)
+    , connectionString_ (connectionString)
+{
+	open(session_, backend_, connectionString_);
 
     for (int i = 0; i < initCount; ++i)
     {
@@ -95,6 +103,11 @@ DatabaseCon::Setup setup_DatabaseCon (Config const& c)
 	return setup;
 }
 
+void DatabaseCon::openSession (soci::session& s) const
+{
+    open (s, backend_, connectionString_);
+}
+
 void DatabaseCon::setupCheckpointing (JobQueue* q)
 {
     if (! q)
@@ -89,6 +89,12 @@ public:
                  const char* initString[],
                  int countInit);
 
+    /** Open a database on a soci backend, such as "mysql" or "sqlite". */
+    DatabaseCon (std::string const& backend,
+                 std::string const& connectionString,
+                 const char* initString[],
+                 int countInit);
+
     soci::session& getSession()
     {
         return session_;
@@ -99,11 +105,21 @@ public:
         return LockedSociSession (&session_, lock_);
     }
 
+    /** Open another session on the same database.
+
+        The new session does not share the lock taken by checkoutDb, so a
+        long statement on it does not stall the users of this connection.
+    */
+    void openSession (soci::session& s) const;
+
     void setupCheckpointing (JobQueue*);
 
 private:
     LockedSociSession::mutex lock_;
 
+    std::string const backend_;
+    std::string const connectionString_;
+
     soci::session session_;
     std::unique_ptr<Checkpointer> checkpointer_;
 };
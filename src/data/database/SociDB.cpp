@@ -106,10 +106,9 @@ void open (soci::session& s,
            std::string const& beName,
            std::string const& connectionString)
 {
-    //if (beName == "sqlite")
-    //    s.open(soci::sqlite3, connectionString);
-    //else 
-    if (beName == "mysql")
+    if (beName == "sqlite")
+        s.open(soci::sqlite3, connectionString);
+    else if (beName == "mysql")
     	s.open(soci::mysql, connectionString);
     else
         throw std::runtime_error ("Unsupported soci backend: " + beName);
@@ -109,6 +109,14 @@ public:
                         Blob&& data,
                         uint256 const& hash) = 0;
 
+    /** Store a group of objects directly in the backend.
+
+        The objects bypass the cache and the write queue. This is meant
+        for bulk loads, such as importing a ledger snapshot, where the
+        objects would only push useful entries out of the cache.
+    */
+    virtual void storeBatch (Batch const& batch) = 0;
+
     /** Visit every object in the database
         This is usually called during import.
 
@@ -342,6 +342,25 @@ public:
         }
     }
 
+    void storeBatch (Batch const& batch) override
+    {
+        storeBatchInternal (batch, *m_backend.get());
+    }
+
+    void storeBatchInternal (Batch const& batch, Backend& backend)
+    {
+        backend.storeBatch (batch);
+        if (m_fastBackend)
+            m_fastBackend->storeBatch (batch);
+
+        for (auto const& object : batch)
+        {
+            ++m_storeCount;
+            m_storeSize += object->getData().size();
+            m_negCache.erase (object->getHash());
+        }
+    }
+
     //------------------------------------------------------------------------------
 
     float getCacheHitRate ()
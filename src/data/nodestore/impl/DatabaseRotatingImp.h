@@ -117,6 +117,11 @@ public:
                 *getWritableBackend());
     }
 
+    void storeBatch (Batch const& batch) override
+    {
+        storeBatchInternal (batch, *getWritableBackend());
+    }
+
     NodeObject::Ptr fetchNode (uint256 const& hash) override
     {
         return fetchFrom (hash);
@@ -0,0 +1,154 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ledger/CloseTracer.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace skywell {
+
+CloseTracer::CloseTracer (beast::insight::Collector::ptr const& collector)
+{
+    for (int i = 0; i < phaseCount; ++i)
+        events_[i] = collector->make_event ("ledger.close",
+            getName (static_cast <Phase> (i)));
+}
+
+char const* CloseTracer::getName (Phase phase)
+{
+    switch (phase)
+    {
+    case accept:        return "accept";
+    case apply:         return "apply";
+    case flush:         return "flush";
+    case save:          return "save";
+    case publish:       return "publish";
+    case orderBooks:    return "order_books";
+    default:
+        break;
+    }
+
+    return "unknown";
+}
+
+void CloseTracer::record (Phase phase, LedgerIndex seq,
+    clock_type::duration elapsed)
+{
+    auto const micros = std::chrono::duration_cast <
+        std::chrono::microseconds> (elapsed);
+
+    histograms_[phase].record (micros);
+    events_[phase].notify (elapsed);
+
+    std::lock_guard <std::mutex> sl (mutex_);
+
+    Close& close = recent_[seq % recentCount];
+    if (close.seq != seq)
+    {
+        close.seq = seq;
+        close.micros.fill (-1);
+    }
+
+    // A phase run more than once for a ledger counts its total time
+    if (close.micros[phase] < 0)
+        close.micros[phase] = 0;
+    close.micros[phase] += micros.count ();
+}
+
+Json::Value CloseTracer::getJson () const
+{
+    auto ms = [](double micros)
+    {
+        return std::round (micros / 10) / 100;
+    };
+
+    Json::Value ret (Json::objectValue);
+
+    std::array <std::vector <std::int64_t>, phaseCount> samples;
+    LedgerIndex first = 0;
+    LedgerIndex last = 0;
+    {
+        std::lock_guard <std::mutex> sl (mutex_);
+
+        for (auto const& close : recent_)
+        {
+            if (close.seq == 0)
+                continue;
+
+            if (first == 0 || close.seq < first)
+                first = close.seq;
+            last = std::max (last, close.seq);
+
+            for (int i = 0; i < phaseCount; ++i)
+            {
+                if (close.micros[i] >= 0)
+                    samples[i].push_back (close.micros[i]);
+            }
+        }
+    }
+
+    Json::Value& recent = (ret["recent"] = Json::objectValue);
+    if (last != 0)
+    {
+        recent["first"] = first;
+        recent["last"] = last;
+    }
+
+    for (int i = 0; i < phaseCount; ++i)
+    {
+        auto& v = samples[i];
+        if (v.empty ())
+            continue;
+
+        std::sort (v.begin (), v.end ());
+
+        auto at = [&v](double fraction)
+        {
+            auto const n = static_cast <std::size_t> (
+                std::ceil (fraction * v.size ()));
+            return v[std::max <std::size_t> (n, 1) - 1];
+        };
+
+        Json::Value& p = recent[getName (static_cast <Phase> (i))];
+        p["count"] = static_cast <Json::UInt> (v.size ());
+        p["p50_ms"] = ms (at (0.50));
+        p["p99_ms"] = ms (at (0.99));
+        p["max_ms"] = ms (v.back ());
+    }
+
+    Json::Value& lifetime = (ret["lifetime"] = Json::objectValue);
+    for (int i = 0; i < phaseCount; ++i)
+    {
+        auto const& h = histograms_[i];
+        auto const count = h.count ();
+        if (count == 0)
+            continue;
+
+        Json::Value& p = lifetime[getName (static_cast <Phase> (i))];
+        p["count"] = static_cast <Json::UInt> (count);
+        p["p50_ms"] = ms (h.percentile (0.50).count ());
+        p["p99_ms"] = ms (h.percentile (0.99).count ());
+    }
+
+    return ret;
+}
+
+} // skywell
@@ -0,0 +1,113 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef SKYWELL_APP_LEDGER_CLOSETRACER_H_INCLUDED
+#define SKYWELL_APP_LEDGER_CLOSETRACER_H_INCLUDED
+
+#include <protocol/Protocol.h>
+#include <common/base/LatencyHistogram.h>
+#include <common/json/json_value.h>
+#include <beast/insight/Collector.h>
+#include <beast/insight/Event.h>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace skywell {
+
+/** Where the time goes while ledgers close.
+
+    A Span times one phase of closing a ledger. Every phase has a
+    histogram covering the life of the server and a beast::insight event,
+    and the timings of the most recent closes are kept by ledger so their
+    percentiles can be reported separately.
+*/
+class CloseTracer
+{
+public:
+    using clock_type = std::chrono::steady_clock;
+
+    enum Phase
+    {
+        accept,         // LedgerConsensus::accept, start to finish
+        apply,          // Applying the consensus set to the closed ledger
+        flush,          // Writing the changed nodes to the node store
+        save,           // Saving the validated ledger to SQL
+        publish,        // NetworkOPs::pubLedger
+        orderBooks,     // OrderBookDB::update
+        phaseCount
+    };
+
+    /** Times a phase of closing a ledger, from construction to destruction. */
+    class Span
+    {
+    public:
+        Span (CloseTracer& tracer, Phase phase, LedgerIndex seq)
+            : tracer_ (tracer)
+            , phase_ (phase)
+            , seq_ (seq)
+            , start_ (clock_type::now ())
+        {
+        }
+
+        Span (Span const&) = delete;
+        Span& operator= (Span const&) = delete;
+
+        ~Span ()
+        {
+            tracer_.record (phase_, seq_, clock_type::now () - start_);
+        }
+
+    private:
+        CloseTracer& tracer_;
+        Phase phase_;
+        LedgerIndex seq_;
+        clock_type::time_point start_;
+    };
+
+    explicit CloseTracer (beast::insight::Collector::ptr const& collector);
+
+    void record (Phase phase, LedgerIndex seq, clock_type::duration elapsed);
+
+    /** Percentiles of every phase for the recent closes and since startup. */
+    Json::Value getJson () const;
+
+    static char const* getName (Phase phase);
+
+private:
+    // Number of closes kept for the recent percentiles
+    static std::size_t const recentCount = 256;
+
+    struct Close
+    {
+        LedgerIndex seq = 0;
+        std::array <std::int64_t, phaseCount> micros;
+    };
+
+    std::array <LatencyHistogram, phaseCount> histograms_;
+    std::array <beast::insight::Event, phaseCount> events_;
+
+    std::mutex mutable mutex_;
+    std::array <Close, recentCount> recent_;
+};
+
+} // skywell
+
+#endif
@@ -292,11 +292,11 @@ void Ledger::updateHash ()
             mAccountHash.zero ();
     }
 
-    //  TODO Fix this hard coded magic number 122
-    Serializer s (122);
-    s.add32 (HashPrefix::ledgerMaster);
+    sha512_half_hasher h;
+    h.add32 (HashPrefix::ledgerMaster);
+    Serializer s (h);
     addRaw (s);
-    mHash = s.getSHA512Half ();
+    mHash = static_cast<uint256> (h);
     mValidHash = true;
 }
 
@@ -447,7 +447,7 @@ bool Ledger::addTransaction (
     Serializer s (txn.getDataLength () + md.getDataLength () + 16);
     s.addVL (txn.peekData ());
     s.addVL (md.peekData ());
-    auto item = std::make_shared<SHAMapItem> (txID, s.peekData ());
+    auto item = std::make_shared<SHAMapItem> (txID, std::move (s));
 
     if (!mTransactionMap->addGiveItem (item, true, true))
     {
@@ -641,6 +641,13 @@ Ledger::getHash ()
 
 bool Ledger::saveValidatedLedger (bool current)
 {
+    // Only the ledgers we close are traced, not the history we acquire
+    std::unique_ptr <CloseTracer::Span> span;
+    if (current)
+        span.reset (new CloseTracer::Span (
+            getApp().getLedgerMaster ().getCloseTracer (),
+            CloseTracer::save, mLedgerSeq));
+
     // TODO(tom): Fix this hard-coded SQL!
     WriteLog (lsTRACE, Ledger) << "saveValidatedLedger "
                                << (current ? "" : "fromAcquire ") 
@@ -28,8 +28,17 @@
 #include <protocol/JsonFields.h>
 #include <protocol/Protocol.h>
 #include <protocol/SkywellLedgerHash.h>
+#include <common/core/Config.h>
+#include <common/core/JobQueue.h>
 #include <common/core/LoadFeeTrack.h>
+#include <common/json/json_reader.h>
+#include <common/json/to_string.h>
 #include <main/Application.h>
+#include <boost/filesystem.hpp>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
 
 namespace skywell {
 
@@ -45,6 +54,12 @@ Cleans up the ledger. Specifically, resolves these issues:
 
 2. Upon request, checks for missing nodes in a ledger and triggers a fetch.
 
+The range to clean can be split between several workers, each of which
+walks its own part backwards. The cleaner thread runs one of them and jobs
+run the rest. Progress is saved to a checkpoint file
+in the database directory, so a run interrupted by a restart resumes where
+it left off.
+
 */
 
 class LedgerCleanerImp
@@ -52,6 +67,15 @@ class LedgerCleanerImp
     , public beast::Thread
 {
 public:
+    typedef std::chrono::steady_clock clock_type;
+
+    // The part of the range left to one worker
+    struct Range
+    {
+        LedgerIndex  minRange;
+        LedgerIndex  maxRange;
+    };
+
     struct State
     {
         State()
@@ -59,7 +83,10 @@ public:
             , maxRange (0)
             , checkNodes (false)
             , fixTxns (false)
+            , threads (1)
             , failures (0)
+            , generation (0)
+            , checked (0)
         {
         }
 
@@ -67,7 +94,13 @@ public:
         LedgerIndex  maxRange;    // The highest ledger in the range we're checking
         bool         checkNodes;  // Check all state/transaction nodes
         bool         fixTxns;     // Rewrite SQL databases
+        int          threads;     // Number of workers
         int          failures;    // Number of errors encountered since last success
+        std::vector<Range> ranges;          // The work left to each worker
+        std::uint64_t generation;           // Changes with every request
+        std::uint64_t checked;              // Ledgers processed in this run
+        clock_type::time_point started;     // When this run started
+        clock_type::time_point saved;       // When progress was last saved
     };
 
     typedef beast::SharedData <State> SharedState;
@@ -75,6 +108,9 @@ public:
     SharedState m_state;
     beast::Journal m_journal;
 
+    // Serializes writes to the checkpoint file
+    std::mutex m_checkpointLock;
+
     //--------------------------------------------------------------------------
 
     LedgerCleanerImp (Stoppable& stoppable, beast::Journal journal)
@@ -123,7 +159,7 @@ public:
     {
         SharedState::Access state (m_state);
 
-        if (state->maxRange == 0)
+        if (state->ranges.empty ())
         {
             map["status"] = "idle";
         }
@@ -134,6 +170,22 @@ public:
             map["max_ledger"] = state->maxRange;
             map["check_nodes"] = state->checkNodes ? "true" : "false";
             map["fix_txns"] = state->fixTxns ? "true" : "false";
+            map["threads"] = state->threads;
+
+            std::uint64_t remaining = 0;
+            for (auto const& range : state->ranges)
+            {
+                if ((range.minRange != 0) && (range.minRange <= range.maxRange))
+                    remaining += range.maxRange - range.minRange + 1;
+            }
+            map["remaining"] = remaining;
+            map["checked"] = state->checked;
+
+            auto const elapsed = std::chrono::duration_cast <
+                std::chrono::seconds> (clock_type::now () - state->started);
+            if (elapsed.count () > 0)
+                map["ledgers_per_second"] = state->checked / elapsed.count ();
+
             if (state->failures > 0)
                 map["fail_counts"] = state->failures;
         }
@@ -158,6 +210,7 @@ public:
             state->minRange = minRange;
             state->checkNodes = false;
             state->fixTxns = false;
+            state->threads = 1;
             state->failures = 0;
 
             /*
@@ -185,6 +238,12 @@ public:
                 "check_nodes"
                     A boolean, when set to true means check the nodes.
 
+                "threads"
+                    An unsigned integer, the number of workers to split the
+                    range between. Workers only back off while the server
+                    is loaded. Defaults to one, which also pauses between
+                    ledgers.
+
                 "stop"
                     A boolean, when set to true informs the cleaner to gracefully
                     stop its current activities if any cleaning is taking place.
@@ -214,10 +273,17 @@ public:
             if (params.isMember(jss::check_nodes))
                 state->checkNodes = params[jss::check_nodes].asBool();
 
+            if (params.isMember(jss::threads))
+                state->threads = std::max (1u, std::min (64u, params[jss::threads].asUInt()));
+
             if (params.isMember(jss::stop) && params[jss::stop].asBool())
                 state->minRange = state->maxRange = 0;
+
+            startRun (*state);
         }
 
+        saveCheckpoint ();
+
         notify();
     }
 
@@ -227,9 +293,176 @@ public:
     //
     //--------------------------------------------------------------------------
 
+    // Split the range between the workers and restart the counters
+    static void startRun (State& state)
+    {
+        state.ranges.clear ();
+        ++state.generation;
+        state.checked = 0;
+        state.started = state.saved = clock_type::now ();
+
+        if ((state.minRange == 0) || (state.maxRange == 0) ||
+            (state.minRange > state.maxRange))
+        {
+            state.minRange = state.maxRange = 0;
+            return;
+        }
+
+        std::uint64_t const count = state.maxRange - state.minRange + 1;
+        std::uint64_t const workers = std::min<std::uint64_t> (state.threads, count);
+
+        LedgerIndex first = state.minRange;
+        for (std::uint64_t i = 0; i < workers; ++i)
+        {
+            LedgerIndex const last = state.minRange - 1 +
+                static_cast<LedgerIndex> (count * (i + 1) / workers);
+            state.ranges.push_back ({first, last});
+            first = last + 1;
+        }
+    }
+
+    boost::filesystem::path checkpointPath () const
+    {
+        auto const dbPath = getConfig ().legacy ("database_path");
+        if (dbPath.empty ())
+            return {};
+        return boost::filesystem::path (dbPath) / "ledger_cleaner.json";
+    }
+
+    /** Save the work left, or remove the checkpoint if there is none. */
+    void saveCheckpoint ()
+    {
+        auto const path = checkpointPath ();
+        if (path.empty ())
+            return;
+
+        Json::Value checkpoint (Json::objectValue);
+        {
+            SharedState::Access state (m_state);
+
+            if (!state->ranges.empty ())
+            {
+                checkpoint[jss::check_nodes] = state->checkNodes;
+                checkpoint[jss::fix_txns] = state->fixTxns;
+                checkpoint[jss::threads] = state->threads;
+                checkpoint[jss::min_ledger] = state->minRange;
+                checkpoint[jss::max_ledger] = state->maxRange;
+
+                Json::Value& ranges = (checkpoint["ranges"] = Json::arrayValue);
+                for (auto const& range : state->ranges)
+                {
+                    Json::Value& r = ranges.append (Json::arrayValue);
+                    r.append (range.minRange);
+                    r.append (range.maxRange);
+                }
+            }
+
+            state->saved = clock_type::now ();
+        }
+
+        std::lock_guard <std::mutex> lock (m_checkpointLock);
+        boost::system::error_code ec;
+
+        if (checkpoint.size () == 0)
+        {
+            boost::filesystem::remove (path, ec);
+            return;
+        }
+
+        // Write then rename, so a crash never leaves a partial checkpoint
+        auto const temp = path.string () + ".tmp";
+        {
+            std::ofstream out (temp.c_str (), std::ios::out | std::ios::trunc);
+            out << to_string (checkpoint);
+            if (!out)
+            {
+                m_journal.warning << "Unable to write " << temp;
+                return;
+            }
+        }
+
+        boost::filesystem::rename (temp, path, ec);
+        if (ec)
+            m_journal.warning << "Unable to save progress: " << ec.message ();
+    }
+
+    /** Restore the work left by a previous run.
+        @return `true` if there is work to resume.
+    */
+    bool loadCheckpoint ()
+    {
+        auto const path = checkpointPath ();
+        boost::system::error_code ec;
+        if (path.empty () || !boost::filesystem::exists (path, ec))
+            return false;
+
+        std::ifstream in (path.string ().c_str ());
+        Json::Value checkpoint;
+        Json::Reader reader;
+
+        // asUInt throws on values it can't convert, so check every field
+        // before using it
+        auto const isIndex = [](Json::Value const& v)
+        {
+            return !v.isNull () && v.isConvertibleTo (Json::uintValue);
+        };
+
+        std::vector<Range> ranges;
+        bool valid = reader.parse (in, checkpoint) && checkpoint.isObject () &&
+            checkpoint["ranges"].isArray () &&
+            isIndex (checkpoint[jss::threads]) &&
+            isIndex (checkpoint[jss::min_ledger]) &&
+            isIndex (checkpoint[jss::max_ledger]) &&
+            (checkpoint[jss::min_ledger].asUInt () <=
+                checkpoint[jss::max_ledger].asUInt ());
+
+        if (valid)
+        {
+            for (auto const& r : checkpoint["ranges"])
+            {
+                if (!r.isArray () || (r.size () != 2) ||
+                    !isIndex (r[0u]) || !isIndex (r[1u]) ||
+                    (r[0u].asUInt () > r[1u].asUInt ()))
+                {
+                    valid = false;
+                    break;
+                }
+                ranges.push_back ({r[0u].asUInt (), r[1u].asUInt ()});
+            }
+        }
+
+        if (!valid)
+        {
+            m_journal.warning << "Ignoring damaged checkpoint " << path.string ();
+            return false;
+        }
+
+        SharedState::Access state (m_state);
+
+        state->checkNodes = checkpoint[jss::check_nodes].asBool ();
+        state->fixTxns = checkpoint[jss::fix_txns].asBool ();
+        state->threads = std::max (1u,
+            std::min (64u, checkpoint[jss::threads].asUInt ()));
+        state->minRange = checkpoint[jss::min_ledger].asUInt ();
+        state->maxRange = checkpoint[jss::max_ledger].asUInt ();
+        state->failures = 0;
+
+        startRun (*state);
+
+        state->ranges = std::move (ranges);
+
+        m_journal.info << "Resuming " << state->minRange << "-" <<
+            state->maxRange << " with " << state->ranges.size () << " workers";
+
+        return !state->ranges.empty ();
+    }
+
     void init ()
     {
         m_journal.debug << "Initializing";
+
+        if (loadCheckpoint ())
+            notify ();
     }
 
     void run ()
@@ -381,6 +614,98 @@ public:
 
     /** Run the ledger cleaner. */
     void doLedgerCleaner()
+    {
+        std::uint64_t generation;
+        std::size_t workers;
+
+        {
+            SharedState::Access state (m_state);
+            generation = state->generation;
+            workers = state->ranges.size ();
+        }
+
+        if (workers == 1)
+        {
+            cleanRange (0, generation, true);
+        }
+        else if (workers > 1)
+        {
+            // The ranges are claimed in turn by this thread and by jobs.
+            // A job that starts once every range is claimed does nothing,
+            // so this thread never waits on a job that has not run.
+            struct Claims
+            {
+                std::mutex mutex;
+                std::condition_variable cond;
+                std::size_t next = 0;
+                std::size_t active = 0;
+            };
+
+            auto claims = std::make_shared<Claims> ();
+
+            auto work = [this, claims, workers, generation] ()
+            {
+                std::unique_lock<std::mutex> lock (claims->mutex);
+
+                while (claims->next < workers)
+                {
+                    std::size_t const index = claims->next++;
+                    ++claims->active;
+                    lock.unlock ();
+
+                    cleanRange (index, generation, false);
+
+                    lock.lock ();
+                    --claims->active;
+                }
+
+                claims->cond.notify_all ();
+            };
+
+            for (std::size_t i = 1; i < workers; ++i)
+            {
+                getApp().getJobQueue ().addJob (jtADMIN, "LedgerCleaner",
+                    [work] (Job&) { work (); });
+            }
+
+            work ();
+
+            std::unique_lock<std::mutex> lock (claims->mutex);
+            claims->cond.wait (lock, [&claims] { return claims->active == 0; });
+        }
+
+        {
+            SharedState::Access state (m_state);
+            if (state->generation != generation)
+                return;
+
+            bool done = true;
+            for (auto const& range : state->ranges)
+            {
+                if ((range.minRange != 0) && (range.minRange <= range.maxRange))
+                    done = false;
+            }
+
+            if (done)
+            {
+                auto const elapsed = std::chrono::duration_cast <
+                    std::chrono::seconds> (clock_type::now () - state->started);
+
+                m_journal.info << "Cleaned " << state->checked <<
+                    " ledgers in " << elapsed.count () << "s";
+
+                state->minRange = state->maxRange = 0;
+                state->ranges.clear ();
+            }
+        }
+
+        saveCheckpoint ();
+    }
+
+    /** Clean one worker's part of the range, from the top down.
+        @param pause Wait briefly after each ledger, to reduce I/O pressure.
+    */
+    void cleanRange (std::size_t index, std::uint64_t generation, bool pause)
     {
         Ledger::pointer goodLedger;
 
@@ -402,13 +727,17 @@ public:
 
             {
                 SharedState::Access state (m_state);
-                if ((state->minRange > state->maxRange) ||
-                    (state->maxRange == 0) || (state->minRange == 0))
+                if (state->generation != generation)
+                    return;
+
+                Range& range = state->ranges[index];
+                if ((range.minRange > range.maxRange) ||
+                    (range.maxRange == 0) || (range.minRange == 0))
                 {
-                    state->minRange = state->maxRange = 0;
+                    range.minRange = range.maxRange = 0;
                     return;
                 }
-                ledgerIndex = state->maxRange;
+                ledgerIndex = range.maxRange;
                 doNodes = state->checkNodes;
                 doTxns = state->fixTxns;
             }
@@ -440,18 +769,31 @@ public:
             }
             else
             {
+                bool save = false;
                 {
                     SharedState::Access state (m_state);
-                    if (ledgerIndex == state->minRange)
-                        ++state->minRange;
-                    if (ledgerIndex == state->maxRange)
-                        --state->maxRange;
+                    if (state->generation != generation)
+                        return;
+
+                    Range& range = state->ranges[index];
+                    if (ledgerIndex == range.minRange)
+                        ++range.minRange;
+                    if (ledgerIndex == range.maxRange)
+                        --range.maxRange;
                     state->failures = 0;
+                    ++state->checked;
+
+                    save = (clock_type::now () - state->saved) >
+                        std::chrono::seconds (30);
                 }
+
+                if (save)
+                    saveCheckpoint ();
+
                 // Reduce I/O pressure and wait for acquiring to catch up to us
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                if (pause)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
             }
-
         }
     }
 };
@@ -0,0 +1,219 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ledger/LedgerHashIndex.h>
+#include <data/database/DatabaseCon.h>
+#include <data/database/SociDB.h>
+#include <boost/optional.hpp>
+#include <algorithm>
+#include <utility>
+
+namespace skywell {
+
+// Rows read from the Ledgers table per statement, so the database is
+// not held for the whole load
+static LedgerIndex const loadChunk = 65536;
+
+uint256 LedgerHashIndex::get (LedgerIndex seq) const
+{
+    ScopedLockType sl (mutex_);
+
+    if (seq < first_ || (seq - first_) >= hashes_.size ())
+        return uint256 ();
+
+    return hashes_[seq - first_];
+}
+
+void LedgerHashIndex::set (LedgerIndex seq, uint256 const& hash)
+{
+    if (hash.isZero ())
+        return;
+
+    ScopedLockType sl (mutex_);
+
+    extend (seq, seq);
+
+    uint256& slot = hashes_[seq - first_];
+    if (slot.isZero ())
+        ++known_;
+    slot = hash;
+}
+
+bool LedgerHashIndex::fill (LedgerIndex seq, uint256 const& hash)
+{
+    if (hash.isZero () || seq < first_ || (seq - first_) >= hashes_.size ())
+        return false;
+
+    uint256& slot = hashes_[seq - first_];
+    if (slot.isNonZero ())
+        return false;
+
+    slot = hash;
+    ++known_;
+    return true;
+}
+
+void LedgerHashIndex::trim (LedgerIndex seq)
+{
+    ScopedLockType sl (mutex_);
+
+    if (hashes_.empty () || seq <= first_)
+        return;
+
+    std::size_t const n = std::min <std::size_t> (
+        seq - first_, hashes_.size ());
+
+    known_ -= std::count_if (hashes_.begin (), hashes_.begin () + n,
+        [](uint256 const& h) { return h.isNonZero (); });
+
+    if (n == hashes_.size ())
+    {
+        std::vector <uint256> ().swap (hashes_);
+        first_ = 0;
+        return;
+    }
+
+    hashes_.erase (hashes_.begin (), hashes_.begin () + n);
+    first_ = seq;
+
+    if (hashes_.capacity () > 2 * hashes_.size ())
+        hashes_.shrink_to_fit ();
+}
+
+void LedgerHashIndex::extend (LedgerIndex first, LedgerIndex last)
+{
+    if (hashes_.empty ())
+    {
+        first_ = first;
+        hashes_.resize (last - first + 1);
+        return;
+    }
+
+    if (first < first_)
+    {
+        // Ledgers are usually added going backwards from the newest, so
+        // grow the front at least by the current size to amortize the copy
+        LedgerIndex grow = std::max <LedgerIndex> (first_ - first,
+            std::min <std::size_t> (hashes_.size (), first_));
+
+        hashes_.insert (hashes_.begin (), grow, uint256 ());
+        first_ -= grow;
+    }
+
+    if ((last - first_) >= hashes_.size ())
+        hashes_.resize (last - first_ + 1);
+}
+
+std::size_t LedgerHashIndex::load (DatabaseCon& db,
+    std::function <bool ()> const& shouldStop, beast::Journal journal)
+{
+    boost::optional <std::uint64_t> minSeq, maxSeq;
+    {
+        auto session = db.checkoutDb ();
+        *session << "SELECT MIN(LedgerSeq),MAX(LedgerSeq) FROM Ledgers;",
+            soci::into (minSeq), soci::into (maxSeq);
+    }
+
+    if (!minSeq || !maxSeq || *minSeq > *maxSeq)
+        return 0;
+
+    {
+        ScopedLockType sl (mutex_);
+        extend (static_cast <LedgerIndex> (*minSeq),
+            static_cast <LedgerIndex> (*maxSeq));
+    }
+
+    std::size_t added = 0;
+    std::vector <std::pair <LedgerIndex, uint256>> rows;
+
+    // Newest first, those are the ledgers most often asked for
+    LedgerIndex last = static_cast <LedgerIndex> (*maxSeq);
+    for (;;)
+    {
+        if (shouldStop ())
+        {
+            journal.info << "Hash index load stopped at ledger " << last;
+            break;
+        }
+
+        LedgerIndex const first = std::max <LedgerIndex> (
+            static_cast <LedgerIndex> (*minSeq),
+            (last >= loadChunk) ? (last - loadChunk + 1) : 0);
+
+        rows.clear ();
+        {
+            auto session = db.checkoutDb ();
+
+            std::uint64_t ls;
+            std::string lh;
+            soci::statement st = (session->prepare <<
+                "SELECT LedgerSeq,LedgerHash FROM Ledgers "
+                "WHERE LedgerSeq >= :first AND LedgerSeq <= :last;",
+                soci::into (ls), soci::into (lh),
+                soci::use (first), soci::use (last));
+
+            st.execute ();
+            while (st.fetch ())
+            {
+                uint256 hash;
+                if (hash.SetHexExact (lh.c_str ()))
+                    rows.emplace_back (static_cast <LedgerIndex> (ls), hash);
+            }
+        }
+
+        {
+            ScopedLockType sl (mutex_);
+            for (auto const& row : rows)
+            {
+                if (fill (row.first, row.second))
+                    ++added;
+            }
+        }
+
+        if (first <= *minSeq)
+            break;
+        last = first - 1;
+    }
+
+    journal.info << "Hash index loaded " << added << " ledgers, " <<
+        *minSeq << "-" << *maxSeq;
+
+    return added;
+}
+
+Json::Value LedgerHashIndex::getJson () const
+{
+    ScopedLockType sl (mutex_);
+
+    Json::Value ret (Json::objectValue);
+
+    if (!hashes_.empty ())
+    {
+        ret["first"] = first_;
+        ret["last"] = static_cast <Json::UInt> (first_ + hashes_.size () - 1);
+    }
+    ret["known"] = static_cast <Json::UInt> (known_);
+    ret["size_kb"] = static_cast <Json::UInt> (
+        hashes_.capacity () * sizeof (uint256) / 1024);
+
+    return ret;
+}
+
+} // skywell
@@ -0,0 +1,96 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef SKYWELL_APP_LEDGER_LEDGERHASHINDEX_H_INCLUDED
+#define SKYWELL_APP_LEDGER_LEDGERHASHINDEX_H_INCLUDED
+
+#include <protocol/Protocol.h>
+#include <common/base/base_uint.h>
+#include <common/json/json_value.h>
+#include <beast/utility/Journal.h>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace skywell {
+
+class DatabaseCon;
+
+namespace tests {
+class LedgerHashIndex_test;
+}
+
+/** The hashes of the validated ledgers, indexed by sequence.
+
+    The hashes are held in one contiguous array, slot i holding the hash
+    of ledger first + i, so a lookup is a single memory read. A zero hash
+    marks a ledger whose hash is not known. The array costs 32 bytes per
+    ledger of the range it covers; trimming it when old ledgers are
+    deleted keeps it to the retained history.
+*/
+class LedgerHashIndex
+{
+public:
+    LedgerHashIndex () = default;
+    LedgerHashIndex (LedgerHashIndex const&) = delete;
+    LedgerHashIndex& operator= (LedgerHashIndex const&) = delete;
+
+    /** Returns the hash of a ledger, or a zero hash if it is unknown. */
+    uint256 get (LedgerIndex seq) const;
+
+    /** Record the hash of a ledger, replacing any hash already known. */
+    void set (LedgerIndex seq, uint256 const& hash);
+
+    /** Forget every ledger preceding `seq` and release the memory. */
+    void trim (LedgerIndex seq);
+
+    /** Fill the index from the Ledgers table.
+
+        Rows are read newest first, 65536 ledgers per statement, and the
+        database is released between chunks. Hashes that are already known
+        are left alone, as they came from ledgers accepted since startup.
+        The load stops between chunks if `shouldStop` returns `true`.
+
+        @return The number of hashes added.
+    */
+    std::size_t load (DatabaseCon& db,
+        std::function <bool ()> const& shouldStop, beast::Journal journal);
+
+    Json::Value getJson () const;
+
+private:
+    friend class tests::LedgerHashIndex_test;
+
+    // Make room for [first, last], growing geometrically at either end
+    void extend (LedgerIndex first, LedgerIndex last);
+
+    bool fill (LedgerIndex seq, uint256 const& hash);
+
+    using LockType = std::mutex;
+    using ScopedLockType = std::lock_guard <LockType>;
+
+    mutable LockType mutex_;
+    LedgerIndex first_ = 0;
+    std::vector <uint256> hashes_;
+    std::size_t known_ = 0;
+};
+
+} // skywell
+
+#endif
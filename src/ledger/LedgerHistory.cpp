@@ -22,6 +22,9 @@
 #include <common/base/Log.h>
 #include <common/base/seconds_clock.h>
 #include <common/json/to_string.h>
+#include <protocol/JsonFields.h>
+#include <algorithm>
+#include <unordered_map>
 
 namespace skywell {
 
@@ -43,6 +46,7 @@ LedgerHistory::LedgerHistory (
     , mismatch_counter_ (collector->make_counter ("ledger.history", "mismatch"))
     , m_ledgers_by_hash ("LedgerCache", CACHED_LEDGER_NUM, CACHED_LEDGER_AGE, get_seconds_clock (), deprecatedLogs().journal("TaggedCache"))
     , m_consensus_validated ("ConsensusValidated", 64, 300, get_seconds_clock (), deprecatedLogs().journal("TaggedCache"))
+    , memory_limit_ (0)
 {
 }
 
@@ -457,10 +461,168 @@ bool LedgerHistory::fixIndex (LedgerIndex ledgerIndex, LedgerHash const& ledgerH
     return true;
 }
 
-void LedgerHistory::tune (int size, int age)
+void LedgerHistory::tune (int size, int age, std::size_t memory)
 {
     m_ledgers_by_hash.setTargetSize (size);
     m_ledgers_by_hash.setTargetAge (age);
+    memory_limit_ = memory;
+}
+
+// Approximate footprint of a tree node and the item it holds
+static
+std::size_t
+nodeBytes (SHAMapTreeNode const& node)
+{
+    std::size_t bytes = sizeof (SHAMapTreeNode);
+
+    if (node.isLeaf ())
+        bytes += sizeof (SHAMapItem) + node.peekItem ()->size ();
+
+    return bytes;
+}
+
+std::vector<LedgerHistory::LedgerMemory>
+LedgerHistory::measure (
+    std::vector<Ledger::pointer> const& pinned, std::size_t& retained)
+{
+    std::vector<LedgerHash> pinnedHashes;
+    std::vector<SHAMap const*> pinnedState, pinnedTx;
+
+    for (auto const& ledger : pinned)
+    {
+        if (!ledger)
+            continue;
+
+        pinnedHashes.push_back (ledger->getHash ());
+        pinnedState.push_back (ledger->peekAccountStateMap ().get ());
+        pinnedTx.push_back (ledger->peekTransactionMap ().get ());
+    }
+
+    std::vector<LedgerMemory> ret;
+
+    for (auto& ledger : m_ledgers_by_hash.getCachedObjects ())
+    {
+        if (std::find (pinnedHashes.begin (), pinnedHashes.end (),
+                ledger->getHash ()) == pinnedHashes.end ())
+            ret.push_back ({std::move (ledger), 0, 0});
+    }
+
+    std::sort (ret.begin (), ret.end (),
+        [](LedgerMemory const& x, LedgerMemory const& y)
+        {
+            return x.ledger->getLedgerSeq () < y.ledger->getLedgerSeq ();
+        });
+
+    // Ledgers are visited newest first, so the ledger that owns a node is
+    // the newest one holding it: releasing the ledgers oldest first frees
+    // the node along with its owner. A node reached by a second ledger is
+    // shared, as is everything below it. Nodes held by a pinned ledger are
+    // never reached.
+    struct NodeUse
+    {
+        std::size_t owner;
+        bool shared;
+        std::size_t bytes;
+    };
+
+    std::unordered_map<SHAMapTreeNode const*, NodeUse> nodes;
+
+    for (std::size_t i = ret.size (); i-- != 0;)
+    {
+        auto visit = [&nodes, i] (SHAMapTreeNode const& node)
+        {
+            auto const result = nodes.emplace (&node, NodeUse {i, false, 0});
+            NodeUse& use = result.first->second;
+
+            if (result.second)
+            {
+                use.bytes = nodeBytes (node);
+                return true;
+            }
+
+            if ((use.owner == i) || use.shared)
+                return false;
+
+            use.shared = true;
+            return true;
+        };
+
+        ret[i].ledger->peekAccountStateMap ()->visitResidentDifferences (
+            pinnedState, visit);
+        ret[i].ledger->peekTransactionMap ()->visitResidentDifferences (
+            pinnedTx, visit);
+    }
+
+    retained = 0;
+
+    for (auto const& node : nodes)
+    {
+        retained += node.second.bytes;
+        ret[node.second.owner].freed += node.second.bytes;
+
+        if (!node.second.shared)
+            ret[node.second.owner].unique += node.second.bytes;
+    }
+
+    return ret;
+}
+
+void LedgerHistory::sweep (std::vector<Ledger::pointer> const& pinned)
+{
+    m_ledgers_by_hash.sweep ();
+    m_consensus_validated.sweep ();
+
+    if (memory_limit_ == 0)
+        return;
+
+    std::size_t retained;
+    auto const ledgers = measure (pinned, retained);
+
+    int released = 0;
+
+    for (auto const& entry : ledgers)
+    {
+        if (retained <= memory_limit_)
+            break;
+
+        m_ledgers_by_hash.del (entry.ledger->getHash (), true);
+        retained -= entry.freed;
+        ++released;
+    }
+
+    if (released != 0)
+        WriteLog (lsDEBUG, LedgerMaster) << "Released " << released <<
+            " ledgers from history, " << retained << " bytes retained";
+}
+
+Json::Value LedgerHistory::getMemoryJson (
+    std::vector<Ledger::pointer> const& pinned)
+{
+    std::size_t retained;
+    auto const ledgers = measure (pinned, retained);
+
+    Json::Value ret (Json::objectValue);
+    ret["limit_kb"] = static_cast<Json::UInt> (memory_limit_ / 1024);
+    ret["retained_kb"] = static_cast<Json::UInt> (retained / 1024);
+
+    Json::Value& pinnedJson = (ret["pinned"] = Json::arrayValue);
+    for (auto const& ledger : pinned)
+    {
+        if (ledger)
+            pinnedJson.append (ledger->getLedgerSeq ());
+    }
+
+    Json::Value& ledgersJson = (ret["ledgers"] = Json::arrayValue);
+    for (auto const& entry : ledgers)
+    {
+        Json::Value& l = ledgersJson.append (Json::objectValue);
+        l[jss::ledger_index] = entry.ledger->getLedgerSeq ();
+        l[jss::ledger_hash] = to_string (entry.ledger->getHash ());
+        l["unique_kb"] = static_cast<Json::UInt> (entry.unique / 1024);
+        l["freed_kb"] = static_cast<Json::UInt> (entry.freed / 1024);
+    }
+
+    return ret;
 }
 
 void LedgerHistory::clearLedgerCachePrior (LedgerIndex seq)
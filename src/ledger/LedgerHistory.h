@@ -22,13 +22,24 @@
 
 #include <beast/Insight.h>
 #include <ledger/Ledger.h>
+#include <common/json/json_value.h>
 #include <protocol/SkywellLedgerHash.h>
+#include <vector>
 
 namespace skywell {
 
 //  TODO Rename to OldLedgers ?
 
-/** Retains historical ledgers. */
+/** Retains historical ledgers.
+
+    Besides the count and age limits of the cache, the ledgers retained
+    are bounded by the memory they hold. Neighbouring ledgers share all
+    but the tree nodes that changed between them, so a ledger is charged
+    only for the nodes in memory that no other retained ledger holds, and
+    nothing held by a pinned ledger (the validated and published ledgers)
+    is charged at all. When the total exceeds the budget the oldest
+    unpinned ledgers are released first.
+*/
 class LedgerHistory
 {
 public:
@@ -68,16 +79,21 @@ public:
     /** Set the history cache's paramters
         @param size The target size of the cache
         @param age The target age of the cache, in seconds
+        @param memory The memory budget of the retained ledgers, in bytes,
+                      or zero for no limit
     */
-    void tune (int size, int age);
+    void tune (int size, int age, std::size_t memory);
 
-    /** Remove stale cache entries
+    /** Remove stale cache entries, then release the oldest ledgers until
+        the retained ledgers fit the memory budget.
+        @param pinned Ledgers which are never released
     */
-    void sweep ()
-    {
-        m_ledgers_by_hash.sweep ();
-        m_consensus_validated.sweep ();
-    }
+    void sweep (std::vector<Ledger::pointer> const& pinned);
+
+    /** Report the memory held by each retained ledger
+        @param pinned Ledgers which are never released
+    */
+    Json::Value getMemoryJson (std::vector<Ledger::pointer> const& pinned);
 
     /** Report that we have locally built a particular ledger
     */
@@ -97,6 +113,18 @@ public:
     void clearLedgerCachePrior (LedgerIndex seq);
 
 private:
+    struct LedgerMemory
+    {
+        Ledger::pointer ledger;
+        std::size_t unique;     // Bytes no other retained ledger holds
+        std::size_t freed;      // Bytes no newer retained ledger holds
+    };
+
+    /** Measure the retained ledgers that are not pinned, oldest first
+        @param retained Set to the bytes held by them but not the pinned ones
+    */
+    std::vector<LedgerMemory> measure (
+        std::vector<Ledger::pointer> const& pinned, std::size_t& retained);
 
     /** Log details in the case where we build one ledger but
         validate a different one.
@@ -121,6 +149,8 @@ private:
 
     // Maps ledger indexes to the corresponding hash.
     std::map <LedgerIndex, LedgerHash> mLedgersByIndex; // validated ledgers
+
+    std::size_t memory_limit_;
 };
 
 } // skywell
@@ -25,10 +25,12 @@
 #include <ledger/LedgerMaster.h>
 #include <ledger/InboundLedgers.h>
 #include <ledger/LedgerCleaner.h>
+#include <ledger/LedgerHashIndex.h>
 #include <ledger/LedgerHistory.h>
 #include <ledger/LedgerHolder.h>
 #include <ledger/OrderBookDB.h>
 #include <main/Application.h>
+#include <common/misc/AccountHistory.h>
 #include <common/misc/IHashRouter.h>
 #include <common/misc/NetworkOPs.h>
 #include <common/misc/CanonicalTXSet.h>
@@ -71,6 +73,8 @@ public:
     Ledger::pointer mHistLedger;        // The last ledger we handled fetching history
 
     LedgerHistory mLedgerHistory;
+    LedgerHashIndex mHashIndex;         // Hashes of the validated ledgers by sequence
+    CloseTracer mCloseTracer;
 
     CanonicalTXSet mHeldTransactions;
 
@@ -115,6 +119,7 @@ public:
         : LedgerMaster (parent)
         , m_journal (journal)
         , mLedgerHistory (collector)
+        , mCloseTracer (collector)
         , mHeldTransactions (uint256 ())
         , mLedgerCleaner (make_LedgerCleaner (*this, deprecatedLogs().journal("LedgerCleaner")))
         , mMinValidations (0)
@@ -140,6 +145,21 @@ public:
     {
     }
 
+    void onStart () override
+    {
+        // Filling the hash index reads every row of the Ledgers table,
+        // so it is done in the background rather than holding up startup
+        getApp().getJobQueue ().addJob (jtADVANCE, "loadHashIndex",
+            std::bind (&LedgerMasterImp::loadHashIndex, this,
+                std::placeholders::_1));
+    }
+
+    void loadHashIndex (Job& job)
+    {
+        mHashIndex.load (getApp().getLedgerDB (),
+            [&job] { return job.shouldCancel (); }, m_journal);
+    }
+
     LedgerIndex getCurrentLedgerIndex ()
     {
         return mCurrentLedger.get ()->getLedgerSeq ();
@@ -241,6 +261,7 @@ public:
         mValidLedgerSeq = l->getLedgerSeq();
         getApp().getOPs().updateLocalTx (l);
         getApp().getSHAMapStore().onLedgerClosed (getValidatedLedger());
+        getApp().getAccountHistory().onLedgerValidated (l);
         mLedgerHistory.validatedLedger (l);
 
     #if SKYWELL_HOOK_VALIDATORS
@@ -336,6 +357,7 @@ public:
 
     bool fixIndex (LedgerIndex ledgerIndex, LedgerHash const& ledgerHash)
     {
+        mHashIndex.set (ledgerIndex, ledgerHash);
         return mLedgerHistory.fixIndex (ledgerIndex, ledgerHash);
     }
 
@@ -592,6 +614,8 @@ public:
             if (it->second.first != prevHash)
                 break;
 
+            // This hash is confirmed by its child
+            mHashIndex.set (seq, prevHash);
             prevHash = it->second.second;
         }
 
@@ -711,6 +735,8 @@ public:
         if (isCurrent)
             mLedgerHistory.addLedger(ledger, true);
 
+        mHashIndex.set (ledger->getLedgerSeq (), ledger->getHash ());
+
         ledger->pendSaveValidated (isSynchronous, isCurrent);
 
         {
@@ -1084,7 +1110,7 @@ public:
 
                                     setFullLedger(ledger, false, false);
                                     mHistLedger = ledger;
-                                    if ((mFillInProgress == 0) && (Ledger::getHashByIndex(ledger->getLedgerSeq() - 1) == ledger->getParentHash()))
+                                    if ((mFillInProgress == 0) && (getStoredHash (ledger->getLedgerSeq() - 1) == ledger->getParentHash()))
                                     { // Previous ledger is in DB
                                         ScopedLockType sl(m_mutex);
 
@@ -1465,12 +1491,30 @@ public:
         if (hash.isNonZero ())
             return hash;
 
-        return Ledger::getHashByIndex (index);
+        return getStoredHash (index);
+    }
+
+    // The hash of a ledger saved to the database, from the hash index if it
+    // is there; a hash read from the database is added to the index
+    uint256 getStoredHash (std::uint32_t index)
+    {
+        uint256 hash = mHashIndex.get (index);
+
+        if (hash.isZero ())
+        {
+            hash = Ledger::getHashByIndex (index);
+            mHashIndex.set (index, hash);
+        }
+
+        return hash;
     }
 
     uint256 walkHashBySeq (std::uint32_t index)
     {
-        uint256 ledgerHash;
+        uint256 ledgerHash = mHashIndex.get (index);
+        if (ledgerHash.isNonZero ())
+            return ledgerHash;
+
         Ledger::pointer referenceLedger;
 
         referenceLedger = mValidLedger.get ();
@@ -1591,14 +1635,33 @@ public:
         ScopedLockType sl (mCompleteLock);
         mCompleteLedgers.setRange (minV, maxV);
     }
-    void tune (int size, int age)
+    void tune (int size, int age, std::size_t memory)
+    {
+        mLedgerHistory.tune (size, age, memory);
+    }
+
+    // The ledgers the history cache must not release
+    std::vector<Ledger::pointer> getPinnedLedgers ()
     {
-        mLedgerHistory.tune (size, age);
+        ScopedLockType ml (m_mutex);
+        return { mValidLedger.get (), mPubLedger };
     }
 
     void sweep ()
     {
-        mLedgerHistory.sweep ();
+        mLedgerHistory.sweep (getPinnedLedgers ());
+    }
+
+    Json::Value getHistoryMemoryJson ()
+    {
+        Json::Value ret = mLedgerHistory.getMemoryJson (getPinnedLedgers ());
+        ret["hash_index"] = mHashIndex.getJson ();
+        return ret;
+    }
+
+    CloseTracer& getCloseTracer ()
+    {
+        return mCloseTracer;
     }
 
     float getCacheHitRate ()
@@ -1618,6 +1681,8 @@ public:
 
     void clearPriorLedgers (LedgerIndex seq) override
     {
+        mHashIndex.trim (seq);
+
         ScopedLockType sl (mCompleteLock);
         for (LedgerIndex i = mCompleteLedgers.getFirst(); i < seq; ++i)
         {
@@ -21,6 +21,7 @@
 #define SKYWELL_APP_LEDGER_LEDGERMASTER_H_INCLUDED
 
 #include <ledger/LedgerEntrySet.h>
+#include <ledger/CloseTracer.h>
 #include <common/base/StringUtilities.h>
 #include <common/core/Config.h>
 #include <protocol/SkywellLedgerHash.h>
@@ -124,9 +125,15 @@ public:
     virtual bool getValidatedRange (std::uint32_t& minVal, std::uint32_t& maxVal) = 0;
     virtual bool getFullValidatedRange (std::uint32_t& minVal, std::uint32_t& maxVal) = 0;
 
-    virtual void tune (int size, int age) = 0;
+    virtual void tune (int size, int age, std::size_t memory) = 0;
     virtual void sweep () = 0;
     virtual float getCacheHitRate () = 0;
+
+    /** Report the memory held by each ledger in the history cache. */
+    virtual Json::Value getHistoryMemoryJson () = 0;
+
+    /** Timing of the phases of closing a ledger. */
+    virtual CloseTracer& getCloseTracer () = 0;
     virtual void addValidateCallback (callback& c) = 0;
 
     virtual void checkAccept (Ledger::ref ledger) = 0;
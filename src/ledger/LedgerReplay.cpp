@@ -0,0 +1,215 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ledger/LedgerReplay.h>
+#include <ledger/LedgerMaster.h>
+#include <consensus/LedgerConsensus.h>
+#include <main/Application.h>
+#include <common/misc/CanonicalTXSet.h>
+#include <common/misc/IHashRouter.h>
+
+namespace skywell {
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+double
+milliseconds (LedgerReplayStats::duration d)
+{
+    return std::chrono::duration<double, std::milli> (d).count ();
+}
+
+// Rebuild the consensus transaction set, which holds no metadata, from
+// the transaction tree of a closed ledger.
+std::shared_ptr<SHAMap>
+makeTxSet (Ledger const& ledger, std::uint32_t& count)
+{
+    auto set = std::make_shared<SHAMap> (SHAMapType::TRANSACTION,
+        getApp ().family (), deprecatedLogs ().journal ("SHAMap"));
+
+    auto const& txMap = ledger.peekTransactionMap ();
+    SHAMapTreeNode::TNType type;
+
+    for (auto item = txMap->peekFirstItem (type); item;
+        item = txMap->peekNextItem (item->getTag (), type))
+    {
+        auto const txn = Ledger::getSTransaction (item, type);
+
+        if (!txn)
+            continue;
+
+        Serializer s;
+        txn->add (s);
+        set->addItem (SHAMapItem (item->getTag (), std::move (s)), true, false);
+
+        // The stored ledger vouches for the signatures, as a peer's relay
+        // does during consensus
+        getApp ().getHashRouter ().setFlag (item->getTag (), SF_SIGGOOD);
+        ++count;
+    }
+
+    return set;
+}
+
+}
+
+Json::Value
+LedgerReplayStats::getJson () const
+{
+    Json::Value ret (Json::objectValue);
+
+    auto const total = load + apply + rehash + flush + save;
+    double const seconds = milliseconds (total) / 1000;
+
+    ret["ledgers"] = ledgers;
+    ret["transactions"] = transactions;
+    ret["mismatches"] = mismatches;
+    ret["seconds"] = seconds;
+
+    if (seconds > 0)
+    {
+        ret["ledgers_per_second"] = ledgers / seconds;
+        ret["transactions_per_second"] = transactions / seconds;
+    }
+
+    Json::Value& phases = (ret["phases_ms"] = Json::objectValue);
+    phases["load"] = milliseconds (load);
+    phases["apply"] = milliseconds (apply);
+    phases["rehash"] = milliseconds (rehash);
+    phases["flush"] = milliseconds (flush);
+    phases["save"] = milliseconds (save);
+
+    return ret;
+}
+
+bool
+replayLedgers (LedgerIndex first, LedgerIndex last, bool save,
+    LedgerReplayStats& stats, beast::Journal journal)
+{
+    Ledger::pointer parent = getApp ().getLedgerMaster ().getClosedLedger ();
+
+    if (!parent || (first == 0) || (parent->getLedgerSeq () + 1 != first))
+    {
+        journal.fatal << "Replay needs ledger " << (first - 1) << " loaded";
+        return false;
+    }
+
+    for (LedgerIndex seq = first; seq <= last; ++seq)
+    {
+        auto start = clock_type::now ();
+
+        Ledger::pointer stored;
+        std::shared_ptr<SHAMap> set;
+        std::uint32_t count = 0;
+
+        try
+        {
+            stored = Ledger::loadByIndex (seq);
+
+            if (stored)
+                set = makeTxSet (*stored, count);
+        }
+        catch (SHAMapMissingNode const& mn)
+        {
+            journal.fatal << "Ledger " << seq << ": " << mn;
+            return false;
+        }
+
+        if (!stored)
+        {
+            journal.fatal << "No ledger " << seq << " in the database";
+            return false;
+        }
+
+        if (stored->getParentHash () != parent->getHash ())
+        {
+            journal.fatal << "Ledger " << seq << " does not follow "
+                << parent->getHash ();
+            return false;
+        }
+
+        auto now = clock_type::now ();
+        stats.load += now - start;
+        start = now;
+
+        // Build the ledger exactly as LedgerConsensus::accept does
+        CanonicalTXSet retriableTransactions (set->getHash ());
+        auto built = std::make_shared<Ledger> (false, *parent);
+        applyTransactions (set, built, built, retriableTransactions, false);
+
+        now = clock_type::now ();
+        stats.apply += now - start;
+        start = now;
+
+        built->updateSkipList ();
+        built->setClosed ();
+        built->peekAccountStateMap ()->getHash ();
+        built->peekTransactionMap ()->getHash ();
+
+        now = clock_type::now ();
+        stats.rehash += now - start;
+        start = now;
+
+        built->peekAccountStateMap ()->flushDirty (
+            hotACCOUNT_NODE, built->getLedgerSeq ());
+        built->peekTransactionMap ()->flushDirty (
+            hotTRANSACTION_NODE, built->getLedgerSeq ());
+        built->setAccepted (stored->getCloseTimeNC (),
+            stored->getCloseResolution (), stored->getCloseAgree ());
+
+        now = clock_type::now ();
+        stats.flush += now - start;
+        start = now;
+
+        ++stats.ledgers;
+        stats.transactions += count;
+
+        if ((built->getAccountHash () != stored->getAccountHash ()) ||
+            (built->getTransHash () != stored->getTransHash ()) ||
+            (built->getHash () != stored->getHash ()))
+        {
+            ++stats.mismatches;
+            journal.error << "Ledger " << seq << " mismatch: account "
+                << built->getAccountHash () << " expected "
+                << stored->getAccountHash () << ", transactions "
+                << built->getTransHash () << " expected "
+                << stored->getTransHash ();
+
+            stored->setClosed ();
+            stored->setImmutable ();
+            parent = stored;
+            continue;
+        }
+
+        if (save)
+        {
+            built->pendSaveValidated (true, false);
+            stats.save += clock_type::now () - start;
+        }
+
+        journal.info << "Replayed ledger " << seq << ": " << count << " txns";
+        parent = built;
+    }
+
+    return true;
+}
+
+} // skywell
@@ -0,0 +1,68 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef SKYWELL_APP_LEDGER_LEDGERREPLAY_H_INCLUDED
+#define SKYWELL_APP_LEDGER_LEDGERREPLAY_H_INCLUDED
+
+#include <ledger/Ledger.h>
+#include <common/json/json_value.h>
+#include <beast/utility/Journal.h>
+#include <chrono>
+
+namespace skywell {
+
+/** What a ledger replay did and where the time went. */
+struct LedgerReplayStats
+{
+    using duration = std::chrono::steady_clock::duration;
+
+    std::uint32_t ledgers = 0;
+    std::uint32_t transactions = 0;
+    std::uint32_t mismatches = 0;
+
+    duration load {};       // Fetching the stored ledger and its tx set
+    duration apply {};      // applyTransactions
+    duration rehash {};     // Skip list update and tree root hashes
+    duration flush {};      // flushDirty to the node store
+    duration save {};       // Writing the ledger to the SQL databases
+
+    Json::Value getJson () const;
+};
+
+/** Replay stored ledgers offline.
+
+    Each ledger in [first, last] is rebuilt the way consensus builds it:
+    its transactions are applied to its parent with applyTransactions, the
+    trees are hashed and flushed, and the ledger is accepted with its
+    recorded close time. The account, transaction and ledger hashes must
+    match the stored ledger. A rebuilt ledger that matches becomes the
+    parent of the next one; otherwise the stored ledger is used.
+
+    The parent of `first` must be the closed ledger, which is what
+    starting up with --ledger <first-1> arranges. With `save`, matching
+    ledgers are also written to the SQL databases, so that phase is timed.
+
+    @return `false` if a ledger could not be loaded.
+*/
+bool replayLedgers (LedgerIndex first, LedgerIndex last, bool save,
+    LedgerReplayStats& stats, beast::Journal journal);
+
+} // skywell
+
+#endif
@@ -0,0 +1,397 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ledger/LedgerSnapshot.h>
+#include <main/Application.h>
+#include <common/base/Log.h>
+#include <common/shamap/SHAMapBuilder.h>
+#include <lz4.h>
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <thread>
+
+namespace skywell {
+
+namespace {
+
+char const snapshotMagic[8] = { 'S', 'K', 'Y', 'S', 'N', 'A', 'P', 0 };
+std::uint32_t const snapshotVersion = 1;
+std::uint32_t const snapshotCompressed = 1;
+
+// Chunks are cut once they hold this much leaf data
+std::size_t const chunkTarget = 1024 * 1024;
+
+// Larger chunks are rejected, so a bad size can't exhaust memory
+std::uint32_t const chunkLimit = 64 * 1024 * 1024;
+
+void put32 (std::string& out, std::uint32_t v)
+{
+    char const be[4] = {
+        static_cast<char> (v >> 24), static_cast<char> (v >> 16),
+        static_cast<char> (v >> 8), static_cast<char> (v) };
+    out.append (be, sizeof (be));
+}
+
+std::uint32_t get32 (unsigned char const* p)
+{
+    return (std::uint32_t (p[0]) << 24) | (std::uint32_t (p[1]) << 16) |
+        (std::uint32_t (p[2]) << 8) | std::uint32_t (p[3]);
+}
+
+void read (std::istream& in, void* data, std::size_t size)
+{
+    if (! in.read (static_cast<char*> (data), size))
+        throw std::runtime_error ("ledger snapshot is truncated");
+}
+
+std::uint32_t read32 (std::istream& in)
+{
+    unsigned char be[4];
+    read (in, be, sizeof (be));
+    return get32 (be);
+}
+
+//------------------------------------------------------------------------------
+
+// Collects leaves and writes them out a chunk at a time
+class ChunkWriter
+{
+public:
+    ChunkWriter (std::ostream& out, bool compress)
+        : out_ (out)
+        , compress_ (compress)
+    {
+        raw_.reserve (chunkTarget + 4096);
+    }
+
+    void add (SHAMapItem const& item)
+    {
+        raw_.append (reinterpret_cast<char const*> (item.getTag ().begin ()),
+            item.getTag ().size ());
+        put32 (raw_, static_cast<std::uint32_t> (item.size ()));
+        raw_.append (static_cast<char const*> (item.data ()), item.size ());
+        ++count_;
+
+        if (raw_.size () >= chunkTarget)
+            flush ();
+    }
+
+    // Write any pending leaves and the empty chunk that ends the section
+    void finish ()
+    {
+        flush ();
+
+        std::string end;
+        put32 (end, 0);
+        put32 (end, 0);
+        put32 (end, 0);
+        out_.write (end.data (), end.size ());
+    }
+
+private:
+    void flush ()
+    {
+        if (count_ == 0)
+            return;
+
+        std::string const* stored = &raw_;
+
+        if (compress_)
+        {
+            packed_.resize (LZ4_compressBound (static_cast<int> (raw_.size ())));
+            int const size = LZ4_compress (raw_.data (), &packed_[0],
+                static_cast<int> (raw_.size ()));
+
+            if (size <= 0)
+                throw std::runtime_error ("ledger snapshot compression failed");
+
+            packed_.resize (size);
+            stored = &packed_;
+        }
+
+        std::string prefix;
+        put32 (prefix, count_);
+        put32 (prefix, static_cast<std::uint32_t> (raw_.size ()));
+        put32 (prefix, static_cast<std::uint32_t> (stored->size ()));
+        out_.write (prefix.data (), prefix.size ());
+        out_.write (stored->data (), stored->size ());
+
+        if (! out_)
+            throw std::runtime_error ("unable to write ledger snapshot");
+
+        raw_.clear ();
+        count_ = 0;
+    }
+
+    std::ostream& out_;
+    bool const compress_;
+    std::string raw_;
+    std::string packed_;
+    std::uint32_t count_ = 0;
+};
+
+void exportMap (SHAMap const& map, std::ostream& out, bool compress)
+{
+    ChunkWriter writer (out, compress);
+
+    map.visitLeaves (
+        [&writer](std::shared_ptr<SHAMapItem> const& item)
+        {
+            writer.add (*item);
+        });
+
+    writer.finish ();
+}
+
+//------------------------------------------------------------------------------
+
+struct Chunk
+{
+    std::uint32_t count;
+    std::uint32_t rawSize;
+    std::string stored;
+};
+
+using Leaves = std::vector<std::shared_ptr<SHAMapItem>>;
+
+Leaves decodeChunk (Chunk const& chunk, bool compressed)
+{
+    std::string inflated;
+    std::string const* raw = &chunk.stored;
+
+    if (compressed)
+    {
+        inflated.resize (chunk.rawSize);
+        int const size = LZ4_decompress_safe (chunk.stored.data (),
+            &inflated[0], static_cast<int> (chunk.stored.size ()),
+            static_cast<int> (chunk.rawSize));
+
+        if (size < 0 || static_cast<std::uint32_t> (size) != chunk.rawSize)
+            throw std::runtime_error ("ledger snapshot chunk is corrupt");
+
+        raw = &inflated;
+    }
+    else if (chunk.stored.size () != chunk.rawSize)
+    {
+        throw std::runtime_error ("ledger snapshot chunk is corrupt");
+    }
+
+    Leaves leaves;
+    leaves.reserve (chunk.count);
+
+    auto p = reinterpret_cast<unsigned char const*> (raw->data ());
+    auto const end = p + raw->size ();
+
+    while (p != end)
+    {
+        if (end - p < 36)
+            throw std::runtime_error ("ledger snapshot leaf is truncated");
+
+        uint256 tag = uint256::fromVoid (p);
+        std::uint32_t const size = get32 (p + 32);
+        p += 36;
+
+        // Leaves carry at least a type and a field
+        if (size < 12 || static_cast<std::size_t> (end - p) < size)
+            throw std::runtime_error ("ledger snapshot leaf is malformed");
+
+        leaves.push_back (std::make_shared<SHAMapItem> (tag, p, size));
+        p += size;
+    }
+
+    if (leaves.size () != chunk.count)
+        throw std::runtime_error ("ledger snapshot chunk count is wrong");
+
+    return leaves;
+}
+
+// Rebuild one tree from its section of the snapshot. While the tree is
+// built from one chunk, the chunks after it are decoded in parallel.
+std::shared_ptr<SHAMap> importMap (std::istream& in, bool compressed,
+    SHAMapType type, SHAMapTreeNode::TNType leafType, beast::Journal journal)
+{
+    auto map = std::make_shared<SHAMap> (type, getApp ().family (),
+        deprecatedLogs ().journal ("SHAMap"));
+    std::size_t const threads =
+        std::max (2u, std::thread::hardware_concurrency ());
+    SHAMapBuilder builder (*map, leafType, true, static_cast<int> (threads));
+    std::deque<std::future<Leaves>> decoding;
+    std::size_t leafCount = 0;
+    bool more = true;
+
+    while (more || ! decoding.empty ())
+    {
+        while (more && decoding.size () < threads)
+        {
+            auto chunk = std::make_shared<Chunk> ();
+            chunk->count = read32 (in);
+            chunk->rawSize = read32 (in);
+            std::uint32_t const storedSize = read32 (in);
+
+            if (chunk->count == 0)
+            {
+                more = false;
+                break;
+            }
+
+            if (chunk->rawSize > chunkLimit || storedSize > chunkLimit)
+                throw std::runtime_error ("ledger snapshot chunk is too large");
+
+            chunk->stored.resize (storedSize);
+            read (in, &chunk->stored[0], storedSize);
+
+            decoding.push_back (std::async (std::launch::async,
+                [chunk, compressed]()
+                {
+                    return decodeChunk (*chunk, compressed);
+                }));
+        }
+
+        if (decoding.empty ())
+            break;
+
+        for (auto const& item : decoding.front ().get ())
+            builder.add (item);
+
+        decoding.pop_front ();
+    }
+
+    std::size_t const nodes = builder.finish ();
+
+    if (journal.info) journal.info <<
+        "Imported " << to_string (map->getHash ()) << ": " <<
+        nodes << " nodes";
+
+    map->setImmutable ();
+    return map;
+}
+
+}
+
+//------------------------------------------------------------------------------
+
+void exportLedgerSnapshot (Ledger& ledger, std::ostream& out, bool compress)
+{
+    Serializer header (128);
+    ledger.addRaw (header);
+
+    std::string prefix (snapshotMagic, sizeof (snapshotMagic));
+    put32 (prefix, snapshotVersion);
+    put32 (prefix, compress ? snapshotCompressed : 0);
+    put32 (prefix, static_cast<std::uint32_t> (header.getLength ()));
+    prefix.append (reinterpret_cast<char const*> (header.getDataPtr ()),
+        header.getLength ());
+    prefix.append (reinterpret_cast<char const*> (ledger.getHash ().begin ()),
+        ledger.getHash ().size ());
+    out.write (prefix.data (), prefix.size ());
+
+    exportMap (*ledger.peekAccountStateMap (), out, compress);
+    exportMap (*ledger.peekTransactionMap (), out, compress);
+
+    out.flush ();
+
+    if (! out)
+        throw std::runtime_error ("unable to write ledger snapshot");
+}
+
+bool isLedgerSnapshot (std::istream& in)
+{
+    char magic[sizeof (snapshotMagic)];
+    auto const pos = in.tellg ();
+    bool const ok = in.read (magic, sizeof (magic)) &&
+        std::memcmp (magic, snapshotMagic, sizeof (magic)) == 0;
+
+    in.clear ();
+    in.seekg (pos);
+    return ok;
+}
+
+Ledger::pointer importLedgerSnapshot (std::istream& in, beast::Journal journal)
+{
+    char magic[sizeof (snapshotMagic)];
+    read (in, magic, sizeof (magic));
+
+    if (std::memcmp (magic, snapshotMagic, sizeof (magic)) != 0)
+        throw std::runtime_error ("not a ledger snapshot");
+
+    if (read32 (in) != snapshotVersion)
+        throw std::runtime_error ("unsupported ledger snapshot version");
+
+    bool const compressed = (read32 (in) & snapshotCompressed) != 0;
+
+    std::uint32_t const headerSize = read32 (in);
+
+    if (headerSize > 1024)
+        throw std::runtime_error ("ledger snapshot header is malformed");
+
+    Blob raw (headerSize);
+    read (in, raw.data (), raw.size ());
+
+    uint256 ledgerHash;
+    read (in, ledgerHash.begin (), ledgerHash.size ());
+
+    SerialIter sit (raw);
+    std::uint32_t const seq = sit.get32 ();
+    std::uint64_t const totCoins = sit.get64 ();
+    uint256 const parentHash = sit.get256 ();
+    uint256 const transHash = sit.get256 ();
+    uint256 const accountHash = sit.get256 ();
+    std::uint32_t const parentCloseTime = sit.get32 ();
+    std::uint32_t const closeTime = sit.get32 ();
+    int const closeResolution = sit.get8 ();
+    int const closeFlags = sit.get8 ();
+
+    if (journal.info) journal.info <<
+        "Importing snapshot of ledger " << seq << " " << to_string (ledgerHash);
+
+    auto const stateMap = importMap (in, compressed, SHAMapType::STATE,
+        SHAMapTreeNode::tnACCOUNT_STATE, journal);
+
+    if (stateMap->getHash () != accountHash)
+        throw std::runtime_error ("ledger snapshot state does not match its header");
+
+    auto const txMap = importMap (in, compressed, SHAMapType::TRANSACTION,
+        SHAMapTreeNode::tnTRANSACTION_MD, journal);
+
+    if (txMap->getHash () != transHash)
+        throw std::runtime_error ("ledger snapshot transactions do not match its header");
+
+    bool loaded = false;
+    auto ledger = std::make_shared<Ledger> (parentHash, transHash, accountHash,
+        totCoins, closeTime, parentCloseTime, closeFlags, closeResolution,
+        seq, loaded);
+
+    if (! loaded || ledger->getHash () != ledgerHash)
+        throw std::runtime_error ("ledger snapshot header is inconsistent");
+
+    ledger->setClosed ();
+    ledger->setImmutable ();
+    ledger->setAccepted ();
+    ledger->setFull ();
+
+    return ledger;
+}
+
+} // skywell
@@ -0,0 +1,70 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef SKYWELL_APP_LEDGER_LEDGERSNAPSHOT_H_INCLUDED
+#define SKYWELL_APP_LEDGER_LEDGERSNAPSHOT_H_INCLUDED
+
+#include <ledger/Ledger.h>
+#include <beast/utility/Journal.h>
+#include <iosfwd>
+
+namespace skywell {
+
+/** Binary ledger snapshots.
+
+    A snapshot holds a closed ledger's header followed by the leaves of its
+    state and transaction trees in key order, packed into chunks of about
+    a megabyte that may be LZ4 compressed. Because the leaves are sorted,
+    importing rebuilds each tree bottom-up with SHAMapBuilder and writes
+    the nodes straight to the node store backend, which is far faster than
+    loading a JSON ledger or acquiring the state from the network.
+
+    Every integer is stored big endian:
+
+        magic           8 bytes, "SKYSNAP" and a zero byte
+        version         uint32 (1)
+        flags           uint32, bit 0 set if the chunks are compressed
+        header          Ledger::addRaw form, preceded by its uint32 length
+        ledger hash     32 bytes
+        state chunks    ending with an empty chunk
+        tx chunks       ending with an empty chunk
+
+    A chunk is (leaf count, raw size, stored size) as uint32s and the stored
+    bytes. Raw chunk data is a run of leaves, each the 32 byte key, a uint32
+    length and the item data.
+*/
+
+/** Write a snapshot of a closed ledger. Throws on I/O errors. */
+void exportLedgerSnapshot (Ledger& ledger, std::ostream& out, bool compress);
+
+/** Returns `true` if the stream is positioned at a snapshot.
+    The stream position is left unchanged.
+*/
+bool isLedgerSnapshot (std::istream& in);
+
+/** Read a snapshot, storing every node of the ledger's trees.
+    Chunks are decompressed and decoded on several threads while the trees
+    are built. The ledger is verified against the hashes in its header.
+    Throws if the snapshot is malformed or inconsistent.
+*/
+Ledger::pointer importLedgerSnapshot (std::istream& in, beast::Journal journal);
+
+} // skywell
+
+#endif
@@ -101,6 +101,9 @@ static void updateHelper (SLE::ref entry,
 
 void OrderBookDB::update (Ledger::pointer ledger)
 {
+    CloseTracer::Span span (getApp().getLedgerMaster ().getCloseTracer (),
+        CloseTracer::orderBooks, ledger->getLedgerSeq ());
+
     hash_set<uint256> seen;
     OrderBookDB::IssueToOrderBook destMap;
     OrderBookDB::IssueToOrderBook sourceMap;
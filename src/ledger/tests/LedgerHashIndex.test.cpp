@@ -0,0 +1,210 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ledger/LedgerHashIndex.h>
+#include <beast/unit_test/suite.h>
+#include <limits>
+
+namespace skywell {
+namespace tests {
+
+class LedgerHashIndex_test : public beast::unit_test::suite
+{
+public:
+    static
+    uint256
+    hashOf (LedgerIndex seq)
+    {
+        return uint256 (0x1000000ull + seq);
+    }
+
+    static
+    std::size_t
+    known (LedgerHashIndex const& index)
+    {
+        return index.getJson ()["known"].asUInt ();
+    }
+
+    void
+    testSetGet ()
+    {
+        testcase ("set and get");
+
+        LedgerHashIndex index;
+        expect (index.get (0).isZero ());
+        expect (index.get (100).isZero ());
+
+        index.set (100, hashOf (100));
+        expect (index.get (100) == hashOf (100));
+        expect (index.get (99).isZero ());
+        expect (index.get (101).isZero ());
+        expect (index.get (0).isZero ());
+        expect (index.get (
+            std::numeric_limits <LedgerIndex>::max ()).isZero ());
+        expect (known (index) == 1);
+
+        // Replacing a hash doesn't count it twice
+        index.set (100, hashOf (1));
+        expect (index.get (100) == hashOf (1));
+        expect (known (index) == 1);
+
+        // A zero hash is never recorded
+        index.set (200, uint256 ());
+        expect (index.get (200).isZero ());
+        expect (index.hashes_.size () == 1);
+        expect (known (index) == 1);
+    }
+
+    void
+    testExtend ()
+    {
+        testcase ("extend");
+
+        LedgerHashIndex index;
+
+        // Growing the back leaves the ledgers between unknown
+        index.set (100, hashOf (100));
+        index.set (110, hashOf (110));
+        expect (index.first_ == 100);
+        expect (index.hashes_.size () == 11);
+        for (LedgerIndex seq = 101; seq < 110; ++seq)
+            expect (index.get (seq).isZero ());
+        expect (known (index) == 2);
+
+        // Growing the front goes at least as far as the current size
+        index.set (95, hashOf (95));
+        expect (index.first_ == 89);
+        expect (index.hashes_.size () == 22);
+        for (LedgerIndex seq = 89; seq < 95; ++seq)
+            expect (index.get (seq).isZero ());
+        for (LedgerIndex seq = 96; seq < 100; ++seq)
+            expect (index.get (seq).isZero ());
+
+        index.set (80, hashOf (80));
+        expect (index.first_ == 67);
+        index.set (60, hashOf (60));
+        expect (index.first_ == 23);
+
+        // but never below ledger zero
+        index.set (20, hashOf (20));
+        expect (index.first_ == 0);
+        expect (index.hashes_.size () == 111);
+
+        for (LedgerIndex seq : {20u, 60u, 80u, 95u, 100u, 110u})
+            expect (index.get (seq) == hashOf (seq), std::to_string (seq));
+        expect (known (index) == 6);
+
+        // extend alone only makes room
+        index.extend (150, 160);
+        expect (index.hashes_.size () == 161);
+        expect (index.get (155).isZero ());
+        expect (known (index) == 6);
+    }
+
+    void
+    testTrim ()
+    {
+        testcase ("trim");
+
+        LedgerHashIndex index;
+        index.trim (10);
+        expect (index.hashes_.empty ());
+
+        for (LedgerIndex seq = 100; seq <= 120; seq += 2)
+            index.set (seq, hashOf (seq));
+        expect (known (index) == 11);
+
+        // At or below the base nothing goes
+        index.trim (100);
+        index.trim (50);
+        expect (index.first_ == 100);
+        expect (index.hashes_.size () == 21);
+        expect (known (index) == 11);
+
+        // Above the base the older ledgers go
+        index.trim (105);
+        expect (index.first_ == 105);
+        expect (index.hashes_.size () == 16);
+        expect (known (index) == 8);
+        expect (index.get (104).isZero ());
+        expect (index.get (106) == hashOf (106));
+        expect (index.get (120) == hashOf (120));
+
+        // Past the end everything goes
+        index.trim (500);
+        expect (index.hashes_.empty ());
+        expect (index.first_ == 0);
+        expect (known (index) == 0);
+        expect (index.get (120).isZero ());
+
+        // and the index starts over
+        index.set (600, hashOf (600));
+        expect (index.first_ == 600);
+        expect (index.get (600) == hashOf (600));
+        expect (known (index) == 1);
+    }
+
+    void
+    testFill ()
+    {
+        testcase ("fill");
+
+        LedgerHashIndex index;
+
+        // Nothing to fill until the range covers the ledger
+        expect (!index.fill (100, hashOf (100)));
+
+        index.extend (100, 110);
+        index.set (105, hashOf (1));
+
+        expect (index.fill (100, hashOf (100)));
+        expect (index.get (100) == hashOf (100));
+
+        // Known hashes are left alone
+        expect (!index.fill (105, hashOf (105)));
+        expect (index.get (105) == hashOf (1));
+        expect (!index.fill (100, hashOf (2)));
+        expect (index.get (100) == hashOf (100));
+
+        // Outside the range or zero, nothing is added
+        expect (!index.fill (99, hashOf (99)));
+        expect (!index.fill (111, hashOf (111)));
+        expect (!index.fill (101, uint256 ()));
+        expect (index.get (99).isZero ());
+        expect (index.get (111).isZero ());
+        expect (index.hashes_.size () == 11);
+
+        expect (known (index) == 2);
+    }
+
+    void
+    run ()
+    {
+        testSetGet ();
+        testExtend ();
+        testTrim ();
+        testFill ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(LedgerHashIndex,ledger,skywell);
+
+}
+}
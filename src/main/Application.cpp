@@ -22,8 +22,10 @@
 #include <boost/lexical_cast.hpp>
 #include <beast/module/core/thread/DeadlineTimer.h>
 #include <boost/asio/signal_set.hpp>
+#include <algorithm>
 #include <fstream>
 #include <cassert>
+#include <thread>
 #include <main/Application.h>
 #include <main/BasicApp.h>
 #include <main/Tuning.h>
@@ -39,7 +41,10 @@
 #include <ledger/AcceptedLedger.h>
 #include <ledger/InboundLedgers.h>
 #include <ledger/LedgerMaster.h>
+#include <ledger/LedgerSnapshot.h>
 #include <ledger/OrderBookDB.h>
+#include <common/misc/AccountHistory.h>
+#include <common/misc/impl/AccountTxPaging.h>
 #include <common/misc/AmendmentTable.h>
 #include <common/misc/IHashRouter.h>
 #include <common/misc/NetworkOPs.h>
@@ -56,6 +61,7 @@
 #include <common/core/LoadFeeTrack.h>
 #include <common/core/ConfigSections.h>
 #include <common/shamap/Family.h>
+#include <common/shamap/SHAMapBuilder.h>
 #include <transaction/paths/FindPaths.h>
 #include <transaction/paths/PathRequests.h>
 #include <network/peers/UniqueNodeList.h>
@@ -260,6 +266,7 @@ public:
     NodeStoreScheduler m_nodeStoreScheduler;
     std::unique_ptr <SHAMapStore> m_shaMapStore;
     std::unique_ptr <NodeStore::Database> m_nodeStore;
+    std::unique_ptr <AccountHistory> m_accountHistory;
 
     // These are not Stoppable-derived
     NodeCache m_tempNodeCache;
@@ -334,6 +341,10 @@ public:
                 m_txMaster, getConfig()))
 
         , m_nodeStore (m_shaMapStore->makeDatabase ("NodeStore.main", 4))
+
+        , m_accountHistory (make_AccountHistory (setup_AccountHistory (
+                getConfig()), *this, m_nodeStoreScheduler,
+                m_logs.journal ("AccountHistory")))
         , m_tempNodeCache ("NodeCache", 16384, 90, get_seconds_clock (),
             m_logs.journal("TaggedCache"))
 
@@ -387,6 +398,7 @@ public:
         , m_networkOPs (make_NetworkOPs (get_seconds_clock (),
             getConfig ().RUN_STANDALONE, getConfig ().NETWORK_QUORUM,
             *m_jobQueue, *m_ledgerMaster, *m_jobQueue,
+            m_collectorManager->group ("fetch_pack"),
             m_logs.journal("NetworkOPs")))
 
         //  NOTE LocalCredentials starts the deprecated UNL service
@@ -593,6 +605,11 @@ public:
         return *m_shaMapStore;
     }
 
+    AccountHistory& getAccountHistory () override
+    {
+        return *m_accountHistory;
+    }
+
     Overlay& overlay ()
     {
         return *m_overlay;
@@ -724,6 +741,9 @@ public:
                 m_logs.severity (beast::Journal::kDebug);
         }
 
+        if (getConfig ().DEBUG_LOG_ASYNC != 0)
+            m_logs.async (getConfig ().DEBUG_LOG_ASYNC);
+
         if (!getConfig ().RUN_STANDALONE)
             m_sntpClient->init (getConfig ().SNTP_SERVERS);
 
@@ -804,7 +824,8 @@ public:
 
         mValidations->tune (getConfig ().getSize (siValidationsSize), getConfig ().getSize (siValidationsAge));
         m_nodeStore->tune (getConfig ().getSize (siNodeCacheSize), getConfig ().getSize (siNodeCacheAge));
-        m_ledgerMaster->tune (getConfig ().getSize (siLedgerSize), getConfig ().getSize (siLedgerAge));
+        m_ledgerMaster->tune (getConfig ().getSize (siLedgerSize), getConfig ().getSize (siLedgerAge),
+            std::size_t (getConfig ().getSize (siLedgerMemory)) << 20);
         m_sleCache.setTargetSize (getConfig ().getSize (siSLECacheSize));
         m_sleCache.setTargetAge (getConfig ().getSize (siSLECacheAge));
         family().treecache().setTargetSize (getConfig ().getSize (siTreeCacheSize));
@@ -828,6 +849,8 @@ public:
 
         {
             auto setup = setup_ServerHandler(getConfig(), std::cerr);
+            if (getConfig ().NO_LISTEN)
+                setup.ports.clear ();
             setup.makeContexts();
             serverHandler_->setup (setup, m_journal);
         }
@@ -1101,11 +1124,22 @@ bool ApplicationImp::loadOldLedger (std::string const& ledgerID, bool replay, bo
 
         if (isFileName)
         {
-            std::ifstream ledgerFile (ledgerID.c_str (), std::ios::in);
+            std::ifstream ledgerFile (ledgerID.c_str (), std::ios::in | std::ios::binary);
             if (!ledgerFile)
             {
                 m_journal.fatal << "Unable to open file";
             }
+            else if (isLedgerSnapshot (ledgerFile))
+            {
+                try
+                {
+                    loadLedger = importLedgerSnapshot (ledgerFile, m_journal);
+                }
+                catch (std::exception const& e)
+                {
+                    m_journal.fatal << "Unable to import ledger snapshot: " << e.what ();
+                }
+            }
             else
             {
                  Json::Reader reader;
@@ -1174,6 +1208,11 @@ bool ApplicationImp::loadOldLedger (std::string const& ledgerID, bool replay, bo
                          loadLedger = std::make_shared<Ledger> (seq, closeTime);
                          loadLedger->setTotalCoins(totalCoins);
 
+                         // Parse every entry, then build the state tree
+                         // bottom-up from the sorted entries
+                         std::vector<std::shared_ptr<SHAMapItem>> items;
+                         items.reserve (ledger.get ().size ());
+
                          for (Json::UInt index = 0; index < ledger.get ().size (); ++index)
                          {
                              Json::Value& entry = ledger.get ()[index];
@@ -1187,11 +1226,8 @@ bool ApplicationImp::loadOldLedger (std::string const& ledgerID, bool replay, bo
                              if (stp.object && (uIndex.isNonZero ()))
                              {
                                  STLedgerEntry sle (*stp.object, uIndex);
-                                 bool ok = loadLedger->addSLE (sle);
-                                 if (!ok) 
-                                 {
-                                     m_journal.warning << "Couldn't add serialized ledger: " << uIndex;
-                                 }
+                                 items.push_back (std::make_shared<SHAMapItem> (
+                                     uIndex, sle.getSerializer ()));
                              }
                              else
                              {
@@ -1199,6 +1235,30 @@ bool ApplicationImp::loadOldLedger (std::string const& ledgerID, bool replay, bo
                              }
                          }
 
+                         std::stable_sort (items.begin (), items.end (),
+                             [](std::shared_ptr<SHAMapItem> const& a,
+                                std::shared_ptr<SHAMapItem> const& b)
+                             {
+                                 return a->getTag () < b->getTag ();
+                             });
+
+                         SHAMapBuilder builder (*loadLedger->peekAccountStateMap (),
+                             SHAMapTreeNode::tnACCOUNT_STATE, false,
+                             std::thread::hardware_concurrency ());
+
+                         for (std::size_t i = 0; i < items.size (); ++i)
+                         {
+                             if (i != 0 && items[i]->getTag () == items[i - 1]->getTag ())
+                             {
+                                 m_journal.warning << "Couldn't add serialized ledger: " << items[i]->getTag ();
+                                 continue;
+                             }
+
+                             builder.add (items[i]);
+                         }
+
+                         builder.finish ();
+
                          loadLedger->setClosed ();
                          loadLedger->setAccepted (closeTime, closeTimeResolution, !closeTimeEstimated);
                      }
@@ -1578,6 +1638,15 @@ void ApplicationImp::updateTables ()
     assert (!schemaHas (getApp().getTxnDB (), "AccountTransactions", 0, "foobar"));
     addTxnSeqField ();
 
+    // account_tx pages are read by seeking along AcctTxIndex. Creating it
+    // on a large history takes a long time, so it is built in the
+    // background; until it exists account_tx uses the offset query.
+    m_jobQueue->addJob (jtADMIN, "buildAccountTxIndex",
+        [this] (Job&)
+        {
+            buildAccountTxIndex (getTxnDB (), m_journal);
+        });
+
     if (schemaHas (getApp().getTxnDB (), "AccountTransactions", 0, "PRIMARY"))
     {
         WriteLog (lsFATAL, Application) << "AccountTransactions database should not have a primary key";
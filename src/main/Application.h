@@ -62,6 +62,7 @@ class Validations;
 
 class DatabaseCon;
 class SHAMapStore;
+class AccountHistory;
 
 using NodeCache     = TaggedCache <uint256, Blob>;
 using SLECache      = TaggedCache <uint256, STLedgerEntry>;
@@ -114,6 +115,7 @@ public:
     virtual Resource::Manager&      getResourceManager () = 0;
     virtual PathRequests&           getPathRequests () = 0;
     virtual SHAMapStore&            getSHAMapStore () = 0;
+    virtual AccountHistory&         getAccountHistory () = 0;
 
     virtual DatabaseCon& getTxnDB () = 0;
     virtual DatabaseCon& getLedgerDB () = 0;
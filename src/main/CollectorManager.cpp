@@ -28,7 +28,9 @@ class CollectorManagerImp
 public:
     beast::Journal m_journal;
     beast::insight::Collector::ptr m_collector;
+    std::shared_ptr <beast::insight::PrometheusCollector> m_prometheus;
     std::unique_ptr <beast::insight::Groups> m_groups;
+    std::string m_path;
 
     CollectorManagerImp (Section const& params, beast::Journal journal)
         : m_journal (journal)
@@ -42,6 +44,14 @@ public:
 
             m_collector = beast::insight::StatsDCollector::New (address, prefix, journal);
         }
+        else if (server == "prometheus")
+        {
+            std::string const& prefix (get<std::string> (params, "prefix"));
+
+            m_prometheus = beast::insight::PrometheusCollector::New (prefix, journal);
+            m_collector = m_prometheus;
+            m_path = get<std::string> (params, "path", "/metrics");
+        }
         else
         {
             m_collector = beast::insight::NullCollector::New ();
@@ -63,6 +73,17 @@ public:
     {
         return m_groups->get (name);
     }
+
+    std::string const& path ()
+    {
+        return m_path;
+    }
+
+    void write (std::string& text)
+    {
+        if (m_prometheus)
+            m_prometheus->write (text);
+    }
 };
 
 //------------------------------------------------------------------------------
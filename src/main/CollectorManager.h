@@ -33,6 +33,14 @@ public:
     virtual ~CollectorManager () = 0;
     virtual beast::insight::Collector::ptr const& collector () = 0;
     virtual beast::insight::Group::ptr const& group (std::string const& name) = 0;
+
+    /** The HTTP path the metrics are served on.
+        Empty unless the collector is scraped rather than pushing.
+    */
+    virtual std::string const& path () = 0;
+
+    /** Append the metrics in the Prometheus text format. */
+    virtual void write (std::string& text) = 0;
 };
 
 }
@@ -21,11 +21,13 @@
 #include <beast/chrono/basic_seconds_clock.h>
 #include <beast/unit_test.h>
 #include <google/protobuf/stubs/common.h>
+#include <boost/lexical_cast.hpp>
 #include <boost/program_options.hpp>
 #include <cstdlib>
 #include <thread>
 #include <utility>
 #include <main/Application.h>
+#include <ledger/LedgerReplay.h>
 #include <common/base/Log.h>
 #include <common/base/CheckLibraryVersions.h>
 #include <common/base/StringUtilities.h>
@@ -205,6 +207,47 @@ static int runShutdownTests ()
     return EXIT_SUCCESS;
 }
 
+// Parses "<first>[-<last>]"
+static bool parseLedgerRange (std::string const& range,
+    LedgerIndex& first, LedgerIndex& last)
+{
+    try
+    {
+        auto const dash = range.find ('-');
+        first = boost::lexical_cast<LedgerIndex> (range.substr (0, dash));
+        last = (dash == std::string::npos) ? first :
+            boost::lexical_cast<LedgerIndex> (range.substr (dash + 1));
+    }
+    catch (boost::bad_lexical_cast&)
+    {
+        return false;
+    }
+
+    return (first > 1) && (first <= last);
+}
+
+static int runReplayBench (LedgerIndex first, LedgerIndex last, bool save)
+{
+    // The parent of the first ledger is loaded by setup, as for --ledger
+    getConfig ().NO_LISTEN = true;
+    std::unique_ptr<Application> app (make_Application (deprecatedLogs ()));
+
+    setupServer ();
+
+    LedgerReplayStats stats;
+    bool const ok = replayLedgers (first, last, save, stats,
+        deprecatedLogs ().journal ("LedgerReplay"));
+
+    std::cout << to_string (stats.getJson ()) << std::endl;
+
+    // Stoppables can only be stopped once started: run () starts them,
+    // sees the stop already signaled and stops them all again.
+    app->signalStop ();
+    app->run ();
+
+    return (ok && (stats.mismatches == 0)) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 static int runUnitTests (std::string const& pattern,
                          std::string const& argument)
 {
@@ -271,8 +314,10 @@ int run (int argc, char** argv)
     ("verbose,v"    , "Verbose logging.")
     ("load"         , "Load the current ledger from the local DB.")
     ("replay"       ,"Replay a ledger close.")
+    ("replay_bench" , po::value<std::string> (), "Replay the stored ledgers <first>[-<last>] offline and report timings.")
+    ("replay_save"  , "With --replay_bench, also save each replayed ledger to SQL.")
     ("ledger"       , po::value<std::string> (), "Load the specified ledger and start from .")
-    ("ledgerfile"   , po::value<std::string> (), "Load the specified ledger file.")
+    ("ledgerfile"   , po::value<std::string> (), "Load the specified JSON ledger or ledger snapshot file.")
     ("start"        , "Start from a fresh Ledger.")
     ("net"          , "Get the initial ledger from the network.")
     ("fg"           , "Run in the foreground.")
@@ -349,7 +394,8 @@ int run (int argc, char** argv)
         && !vm.count ("fg")
         && !vm.count ("standalone")
         && !vm.count ("shutdowntest")
-        && !vm.count ("unittest"))
+        && !vm.count ("unittest")
+        && !vm.count ("replay_bench"))
     {
         std::string logMe = DoSustain (getConfig ().getDebugLogFile ().string ());
 
@@ -394,7 +440,7 @@ int run (int argc, char** argv)
         // config file, quiet flag.
         getConfig ().setup (configFile, bool (vm.count ("quiet")));
 
-        if (vm.count ("standalone"))
+        if (vm.count ("standalone") || vm.count ("replay_bench"))
         {
             getConfig ().RUN_STANDALONE = true;
             getConfig ().LEDGER_HISTORY = 0;
@@ -412,7 +458,22 @@ int run (int argc, char** argv)
         getConfig ().doImport = true;
     }
 
-    if (vm.count ("ledger"))
+    LedgerIndex replayFirst = 0, replayLast = 0;
+
+    if (vm.count ("replay_bench"))
+    {
+        if (!parseLedgerRange (vm["replay_bench"].as<std::string> (),
+                replayFirst, replayLast))
+        {
+            std::cerr << "Invalid replay_bench range" << std::endl;
+
+            return -1;
+        }
+
+        getConfig ().START_LEDGER = std::to_string (replayFirst - 1);
+        getConfig ().START_UP = Config::LOAD;
+    }
+    else if (vm.count ("ledger"))
     {
         getConfig ().START_LEDGER = vm["ledger"].as<std::string> ();
 
@@ -497,6 +558,12 @@ int run (int argc, char** argv)
         return runShutdownTests ();
     }
 
+    if (iResult == 0 && vm.count ("replay_bench"))
+    {
+        return runReplayBench (replayFirst, replayLast,
+            vm.count ("replay_save") != 0);
+    }
+
     if (iResult == 0)
     {
         if (!vm.count ("parameters"))
@@ -24,6 +24,7 @@
 #include <common/base/DecayingSample.h>
 #include <network/resource/impl/Key.h>
 #include <network/resource/impl/Tuning.h>
+#include <atomic>
 #include <cassert>
 #include <boost/intrusive/list.hpp>
 
@@ -43,7 +44,8 @@ struct Entry
        @param now Construction time of Entry.
     */
     explicit Entry(clock_type::time_point const now)
-        : refcount (0)
+        : shard (0)
+        , refcount (0)
         , local_balance (now)
         , remote_balance (0)
         , lastWarningTime (0)
@@ -72,32 +74,37 @@ struct Entry
     }
 
     // Balance including remote contributions
-    int balance (clock_type::time_point const now)
+    int balance (clock_type::time_point const now) const
     {
-        return local_balance.value (now) + remote_balance;
+        return local_balance.value (now) + remote_balance.load ();
     }
 
     // Add a charge and return normalized balance
     // including contributions from imports.
     int add (int charge, clock_type::time_point const now)
     {
-        return local_balance.add (charge, now) + remote_balance;
+        return local_balance.add (charge, now) + remote_balance.load ();
     }
 
     // Back pointer to the map key (bit of a hack here)
     Key const* key;
 
-    // Number of Consumer references
+    // Index of the Logic shard holding this entry
+    std::size_t shard;
+
+    // Number of Consumer references, guarded by the shard's mutex
     int refcount;
 
+    // Balances and the warning time are read and updated without a lock
+
     // Exponentially decaying balance of resource consumption
-    DecayingSample <decayWindowSeconds, clock_type> local_balance;
+    AtomicDecayingSample <decayWindowSeconds, clock_type> local_balance;
 
     // Normalized balance contribution from imports
-    int remote_balance;
+    std::atomic <int> remote_balance;
 
     // Time of the last warning
-    clock_type::rep lastWarningTime;
+    std::atomic <clock_type::rep> lastWarningTime;
 
     // For inactive entries, time after which this entry will be erased
     clock_type::rep whenExpires;
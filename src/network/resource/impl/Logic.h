@@ -22,7 +22,6 @@
 
 #include <beast/chrono/abstract_clock.h>
 #include <beast/Insight.h>
-#include <beast/threads/SharedData.h>
 #include <beast/utility/PropertyStream.h>
 #include <network/resource/Fees.h>
 #include <network/resource/Gossip.h>
@@ -32,22 +31,47 @@
 #include <protocol/JsonFields.h>
 #include <boost/asio.hpp>
 #include <common/misc/Utility.h>
+#include <array>
 #include <cassert>
+#include <chrono>
+#include <mutex>
 
 namespace skywell {
 namespace Resource {
 
+namespace tests {
+class Logic_test;
+}
+
+/** The table of consumers.
+
+    Entries are spread over shards by the hash of their key, each with its
+    own mutex, which is taken to find, create, reference count or expire an
+    entry. Charging an entry and reading its balance use only the entry's
+    atomics, so the per message and per request path takes no lock at all.
+*/
 class Logic
 {
 private:
+    friend class tests::Logic_test;
+
     typedef beast::abstract_clock <std::chrono::steady_clock> clock_type;
     typedef hash_map <std::string, Import> Imports;
     typedef hash_map <Key, Entry, Key::hasher, Key::key_equal> Table;
     using EntryIntrusiveList = boost::intrusive::make_list<Entry, 
                                                     boost::intrusive::constant_time_size<false>>::type;
-    struct State
+
+    enum
     {
-        // Table of all entries
+        // Number of shards in the consumer table (a power of two)
+        shardCount = 16
+    };
+
+    struct Shard
+    {
+        std::mutex mutex;
+
+        // Table of the shard's entries
         Table table;
 
         // Because the following are intrusive lists, a given Entry may be in
@@ -65,12 +89,9 @@ private:
 
         // List of all inactve entries
         EntryIntrusiveList inactive;
-
-        // All imported gossip data
-        Imports import_table;
     };
 
-    typedef beast::SharedData <State> SharedState;
+    typedef std::lock_guard <std::mutex> lock_guard;
 
     struct Stats
     {
@@ -84,7 +105,12 @@ private:
         beast::insight::Meter drop;
     };
 
-    SharedState m_state;
+    std::array <Shard, shardCount> m_shards;
+
+    // All imported gossip data. Lock before any shard.
+    std::mutex m_importMutex;
+    Imports m_imports;
+
     Stats m_stats;
     beast::abstract_clock <std::chrono::steady_clock>& m_clock;
     beast::Journal m_journal;
@@ -107,9 +133,9 @@ public:
         // Order matters here as well, the import table has to be
         // destroyed before the consumer table.
         //
-        SharedState::UnlockedAccess state (m_state);
-        state->import_table.clear();
-        state->table.clear();
+        m_imports.clear();
+        for (auto& shard : m_shards)
+            shard.table.clear();
     }
 
     Consumer newInboundEndpoint (boost::asio::ip::tcp::endpoint const& address)
@@ -117,36 +143,15 @@ public:
         if (isWhitelisted (address))
             return newAdminEndpoint (convert_endpoint_to_string(address));
 
-        Entry* entry (nullptr);
+        boost::asio::ip::tcp::endpoint endpoint;
+        endpoint.address(address.address());
+        endpoint.port(0);
 
-        {
-            boost::asio::ip::tcp::endpoint endpoint;
-            endpoint.address(address.address());
-            endpoint.port(0);
-
-            SharedState::Access state (m_state);
-            std::pair <Table::iterator, bool> result (
-                    state->table.emplace (std::piecewise_construct,
-                        std::make_tuple (kindInbound, endpoint), // Key
-                        std::make_tuple (m_clock.now())));                  // Entry
-
-            entry = &result.first->second;
-            entry->key = &result.first->first;
-            ++entry->refcount;
-            if (entry->refcount == 1)
-            {
-                if (! result.second)
-                {
-                    state->inactive.erase (
-                        state->inactive.iterator_to (*entry));
-                }
-                state->inbound.push_back (*entry);
-            }
-        }
+        Entry& entry (insert (Key (kindInbound, endpoint)));
 
-        m_journal.debug << "New inbound endpoint " << *entry;
+        m_journal.debug << "New inbound endpoint " << entry;
 
-        return Consumer (*this, *entry);
+        return Consumer (*this, entry);
     }
 
     Consumer newOutboundEndpoint (boost::asio::ip::tcp::endpoint const& address)
@@ -154,58 +159,20 @@ public:
         if (isWhitelisted (address))
             return newAdminEndpoint (convert_endpoint_to_string(address));
 
-        Entry* entry (nullptr);
+        Entry& entry (insert (Key (kindOutbound, address)));
 
-        {
-            SharedState::Access state (m_state);
-            std::pair <Table::iterator, bool> result (
-                state->table.emplace (std::piecewise_construct,
-                    std::make_tuple (kindOutbound, address),            // Key
-                    std::make_tuple (m_clock.now())));                  // Entry
-
-            entry = &result.first->second;
-            entry->key = &result.first->first;
-            ++entry->refcount;
-            if (entry->refcount == 1)
-            {
-                if (! result.second)
-                    state->inactive.erase (
-                        state->inactive.iterator_to (*entry));
-                state->outbound.push_back (*entry);
-            }
-        }
-
-        m_journal.debug << "New outbound endpoint " << *entry;
+        m_journal.debug << "New outbound endpoint " << entry;
 
-        return Consumer (*this, *entry);
+        return Consumer (*this, entry);
     }
 
     Consumer newAdminEndpoint (std::string const& name)
     {
-        Entry* entry (nullptr);
+        Entry& entry (insert (Key (kindAdmin, name)));
 
-        {
-            SharedState::Access state (m_state);
-            std::pair <Table::iterator, bool> result (
-                state->table.emplace (std::piecewise_construct,
-                    std::make_tuple (kindAdmin, name),                  // Key
-                    std::make_tuple (m_clock.now())));                  // Entry
-
-            entry = &result.first->second;
-            entry->key = &result.first->first;
-            ++entry->refcount;
-            if (entry->refcount == 1)
-            {
-                if (! result.second)
-                    state->inactive.erase (
-                        state->inactive.iterator_to (*entry));
-                state->admin.push_back (*entry);
-            }
-        }
+        m_journal.debug << "New admin endpoint " << entry;
 
-        m_journal.debug << "New admin endpoint " << *entry;
-
-        return Consumer (*this, *entry);
+        return Consumer (*this, entry);
     }
 
     Entry& elevateToAdminEndpoint (Entry& prior, std::string const& name)
@@ -213,30 +180,11 @@ public:
         m_journal.info <<
             "Elevate " << prior << " to " << name;
 
-        Entry* entry (nullptr);
+        Entry& entry (insert (Key (kindAdmin, name)));
 
-        {
-            SharedState::Access state (m_state);
-            std::pair <Table::iterator, bool> result (
-                state->table.emplace (std::piecewise_construct,
-                    std::make_tuple (kindAdmin, name),                  // Key
-                    std::make_tuple (m_clock.now())));                  // Entry
-
-            entry = &result.first->second;
-            entry->key = &result.first->first;
-            ++entry->refcount;
-            if (entry->refcount == 1)
-            {
-                if (! result.second)
-                    state->inactive.erase (
-                        state->inactive.iterator_to (*entry));
-                state->admin.push_back (*entry);
-            }
+        release (prior);
 
-            release (prior, state);
-        }
-
-        return *entry;
+        return entry;
     }
 
     Json::Value getJson ()
@@ -250,43 +198,50 @@ public:
         clock_type::time_point const now (m_clock.now());
 
         Json::Value ret (Json::objectValue);
-        SharedState::Access state (m_state);
 
-        for (auto& inboundEntry : state->inbound)
+        for (auto& shard : m_shards)
         {
-            int localBalance = inboundEntry.local_balance.value (now);
-            if ((localBalance + inboundEntry.remote_balance) >= threshold)
-            {
-                Json::Value& entry = (ret[inboundEntry.to_string()] = Json::objectValue);
-                entry[jss::local] = localBalance;
-                entry[jss::remote] = inboundEntry.remote_balance;
-                entry[jss::type] = "outbound";
-            }
+            lock_guard lock (shard.mutex);
 
-        }
-        for (auto& outboundEntry : state->outbound)
-        {
-            int localBalance = outboundEntry.local_balance.value (now);
-            if ((localBalance + outboundEntry.remote_balance) >= threshold)
+            for (auto& inboundEntry : shard.inbound)
             {
-                Json::Value& entry = (ret[outboundEntry.to_string()] = Json::objectValue);
-                entry[jss::local] = localBalance;
-                entry[jss::remote] = outboundEntry.remote_balance;
-                entry[jss::type] = "outbound";
-            }
+                int localBalance = inboundEntry.local_balance.value (now);
+                int remoteBalance = inboundEntry.remote_balance.load ();
+                if ((localBalance + remoteBalance) >= threshold)
+                {
+                    Json::Value& entry = (ret[inboundEntry.to_string()] = Json::objectValue);
+                    entry[jss::local] = localBalance;
+                    entry[jss::remote] = remoteBalance;
+                    entry[jss::type] = "outbound";
+                }
 
-        }
-        for (auto& adminEntry : state->admin)
-        {
-            int localBalance = adminEntry.local_balance.value (now);
-            if ((localBalance + adminEntry.remote_balance) >= threshold)
+            }
+            for (auto& outboundEntry : shard.outbound)
             {
-                Json::Value& entry = (ret[adminEntry.to_string()] = Json::objectValue);
-                entry[jss::local] = localBalance;
-                entry[jss::remote] = adminEntry.remote_balance;
-                entry[jss::type] = "admin";
+                int localBalance = outboundEntry.local_balance.value (now);
+                int remoteBalance = outboundEntry.remote_balance.load ();
+                if ((localBalance + remoteBalance) >= threshold)
+                {
+                    Json::Value& entry = (ret[outboundEntry.to_string()] = Json::objectValue);
+                    entry[jss::local] = localBalance;
+                    entry[jss::remote] = remoteBalance;
+                    entry[jss::type] = "outbound";
+                }
+
             }
+            for (auto& adminEntry : shard.admin)
+            {
+                int localBalance = adminEntry.local_balance.value (now);
+                int remoteBalance = adminEntry.remote_balance.load ();
+                if ((localBalance + remoteBalance) >= threshold)
+                {
+                    Json::Value& entry = (ret[adminEntry.to_string()] = Json::objectValue);
+                    entry[jss::local] = localBalance;
+                    entry[jss::remote] = remoteBalance;
+                    entry[jss::type] = "admin";
+                }
 
+            }
         }
 
         return ret;
@@ -297,18 +252,20 @@ public:
         clock_type::time_point const now (m_clock.now());
 
         Gossip gossip;
-        SharedState::Access state (m_state);
-
-        gossip.items.reserve (state->inbound.size());
 
-        for (auto& inboundEntry : state->inbound)
+        for (auto& shard : m_shards)
         {
-            Gossip::Item item;
-            item.balance = inboundEntry.local_balance.value (now);
-            if (item.balance >= minimumGossipBalance)
+            lock_guard lock (shard.mutex);
+
+            for (auto& inboundEntry : shard.inbound)
             {
-                item.address = inboundEntry.key->address.ep;
-                gossip.items.push_back (item);
+                Gossip::Item item;
+                item.balance = inboundEntry.local_balance.value (now);
+                if (item.balance >= minimumGossipBalance)
+                {
+                    item.address = inboundEntry.key->address.ep;
+                    gossip.items.push_back (item);
+                }
             }
         }
 
@@ -319,13 +276,13 @@ public:
 
     void importConsumers (std::string const& origin, Gossip const& gossip)
     {
-        clock_type::rep const elapsed (m_clock.elapsed());
+        clock_type::rep const elapsed (seconds ());
         {
-            SharedState::Access state (m_state);
+            lock_guard lock (m_importMutex);
             std::pair <Imports::iterator, bool> result (
-                state->import_table.emplace (std::piecewise_construct,
+                m_imports.emplace (std::piecewise_construct,
                     std::make_tuple(origin),                  // Key
-                    std::make_tuple(m_clock.elapsed())));     // Import
+                    std::make_tuple(elapsed)));               // Import
 
             if (result.second)
             {
@@ -382,53 +339,70 @@ public:
     }
 
     // Called periodically to expire entries and groom the table.
+    // Each shard is swept under its own lock, so lookups in the
+    // other shards carry on meanwhile.
     //
     void periodicActivity ()
     {
-        SharedState::Access state (m_state);
-
-        clock_type::rep const elapsed (m_clock.elapsed());
+        clock_type::rep const elapsed (seconds ());
 
-        for (auto iter (state->inactive.begin()); iter != state->inactive.end();)
         {
-            if (iter->whenExpires <= elapsed)
-            {
-                m_journal.debug << "Expired " << *iter;
+            lock_guard lock (m_importMutex);
 
-                Table::iterator table_iter (state->table.find (*iter->key));
-                ++iter;
-
-                erase (table_iter, state);
-            }
-            else
+            Imports::iterator iter (m_imports.begin());
+            while (iter != m_imports.end())
             {
-                break;
+                Import& import (iter->second);
+                if (iter->second.whenExpires <= elapsed)
+                {
+                    for (auto item_iter (import.items.begin());
+                        item_iter != import.items.end(); ++item_iter)
+                    {
+                        item_iter->consumer.entry().remote_balance -= item_iter->balance;
+                    }
+
+                    iter = m_imports.erase (iter);
+                }
+                else
+                {
+                    ++iter;
+                }
             }
         }
 
-        Imports::iterator iter (state->import_table.begin());
-        while (iter != state->import_table.end())
+        for (auto& shard : m_shards)
         {
-            Import& import (iter->second);
-            if (iter->second.whenExpires <= elapsed)
+            lock_guard lock (shard.mutex);
+
+            for (auto iter (shard.inactive.begin()); iter != shard.inactive.end();)
             {
-                for (auto item_iter (import.items.begin());
-                    item_iter != import.items.end(); ++item_iter)
+                if (iter->whenExpires <= elapsed)
                 {
-                    item_iter->consumer.entry().remote_balance -= item_iter->balance;
-                }
+                    m_journal.debug << "Expired " << *iter;
 
-                iter = state->import_table.erase (iter);
-            }
-            else
-            {
-                ++iter;
+                    Table::iterator table_iter (shard.table.find (*iter->key));
+                    ++iter;
+
+                    erase (table_iter, shard);
+                }
+                else
+                {
+                    break;
+                }
             }
         }
     }
 
     //--------------------------------------------------------------------------
 
+    // Whole seconds since the clock's epoch. The tuning constants are in
+    // seconds, while the clock's own ticks may be much finer.
+    clock_type::rep seconds ()
+    {
+        return std::chrono::duration_cast <std::chrono::seconds> (
+            m_clock.now ().time_since_epoch ()).count ();
+    }
+
     // Returns the disposition based on the balance and thresholds
     static Disposition disposition (int balance)
     {
@@ -441,12 +415,50 @@ public:
         return Disposition::ok;
     }
 
-    void acquire (Entry& entry, SharedState::Access& state)
+    // Find or create the entry for a key and add a reference to it
+    Entry& insert (Key const& key)
     {
+        std::size_t const index (
+            Key::hasher() (key) & (shardCount - 1));
+        Shard& shard (m_shards[index]);
+
+        lock_guard lock (shard.mutex);
+        std::pair <Table::iterator, bool> result (
+            shard.table.emplace (std::piecewise_construct,
+                std::make_tuple (key),                              // Key
+                std::make_tuple (m_clock.now())));                  // Entry
+
+        Entry& entry (result.first->second);
+        entry.key = &result.first->first;
+        entry.shard = index;
         ++entry.refcount;
+        if (entry.refcount == 1)
+        {
+            if (! result.second)
+                shard.inactive.erase (
+                    shard.inactive.iterator_to (entry));
+
+            switch (key.kind)
+            {
+            case kindInbound:
+                shard.inbound.push_back (entry);
+                break;
+            case kindOutbound:
+                shard.outbound.push_back (entry);
+                break;
+            case kindAdmin:
+                shard.admin.push_back (entry);
+                break;
+            default:
+                assert (false);
+                break;
+            }
+        }
+
+        return entry;
     }
 
-    void release (Entry& entry, SharedState::Access& state)
+    void release (Entry& entry, Shard& shard)
     {
         if (--entry.refcount == 0)
         {
@@ -455,35 +467,52 @@ public:
             switch (entry.key->kind)
             {
             case kindInbound:
-                state->inbound.erase (state->inbound.iterator_to (entry));
+                shard.inbound.erase (shard.inbound.iterator_to (entry));
                 break;
             case kindOutbound:
-                state->outbound.erase (state->outbound.iterator_to (entry));
+                shard.outbound.erase (shard.outbound.iterator_to (entry));
                 break;
             case kindAdmin:
-                state->admin.erase (state->admin.iterator_to (entry));
+                shard.admin.erase (shard.admin.iterator_to (entry));
                 break;
             default:
                 assert (false);
                 break;
             }
-            state->inactive.push_back (entry);
-            entry.whenExpires = m_clock.elapsed() + secondsUntilExpiration;
+            shard.inactive.push_back (entry);
+            entry.whenExpires = seconds () + secondsUntilExpiration;
         }
     }
 
-    void erase (Table::iterator iter, SharedState::Access& state)
+    void erase (Table::iterator iter, Shard& shard)
     {
         Entry& entry (iter->second);
 
         assert (entry.refcount == 0);
 
-        state->inactive.erase (state->inactive.iterator_to (entry));
+        shard.inactive.erase (shard.inactive.iterator_to (entry));
+
+        shard.table.erase (iter);
+    }
+
+    //--------------------------------------------------------------------------
+
+    void acquire (Entry& entry)
+    {
+        lock_guard lock (m_shards[entry.shard].mutex);
 
-        state->table.erase (iter);
+        ++entry.refcount;
     }
 
-    Disposition charge (Entry& entry, Charge const& fee, SharedState::Access& state)
+    void release (Entry& entry)
+    {
+        Shard& shard (m_shards[entry.shard]);
+        lock_guard lock (shard.mutex);
+
+        release (entry, shard);
+    }
+
+    Disposition charge (Entry& entry, Charge const& fee)
     {
         clock_type::time_point const now (m_clock.now());
         int const balance (entry.add (fee.cost(), now));
@@ -493,29 +522,40 @@ public:
         return disposition (balance);
     }
 
-    bool warn (Entry& entry, SharedState::Access& state)
+    bool warn (Entry& entry)
     {
+        if (entry.admin())
+            return false;
+
+        // Only the caller that moves lastWarningTime on to this
+        // second issues the warning.
         bool notify (false);
-        clock_type::rep const elapsed (m_clock.elapsed());
-        if (entry.balance (m_clock.now()) >= warningThreshold &&
-            elapsed != entry.lastWarningTime)
+        clock_type::rep const elapsed (seconds ());
+        if (entry.balance (m_clock.now()) >= warningThreshold)
         {
-            charge (entry, feeWarning, state);
-            notify = true;
-            entry.lastWarningTime = elapsed;
+            clock_type::rep last (entry.lastWarningTime.load ());
+            while (last != elapsed && ! notify)
+                notify = entry.lastWarningTime.compare_exchange_weak (
+                    last, elapsed);
         }
 
         if (notify)
+        {
+            charge (entry, feeWarning);
+
             m_journal.info << "Load warning: " << entry;
 
-        if (notify)
             ++m_stats.warn;
+        }
 
         return notify;
     }
 
-    bool disconnect (Entry& entry, SharedState::Access& state)
+    bool disconnect (Entry& entry)
     {
+        if (entry.admin())
+            return false;
+
         bool drop (false);
         clock_type::time_point const now (m_clock.now());
         int const balance (entry.balance (now));
@@ -529,7 +569,7 @@ public:
             // Adding feeDrop at this point keeps the dropped connection
             // from re-connecting for at least a little while after it is
             // dropped.
-            charge (entry, feeDrop, state);
+            charge (entry, feeDrop);
 
             ++m_stats.drop;
 
@@ -539,58 +579,9 @@ public:
         return drop;
     }
 
-    int balance (Entry& entry, SharedState::Access& state)
-    {
-        return entry.balance (m_clock.now());
-    }
-
-    //--------------------------------------------------------------------------
-
-    void acquire (Entry& entry)
-    {
-        SharedState::Access state (m_state);
-        acquire (entry, state);
-    }
-
-    void release (Entry& entry)
-    {
-        SharedState::Access state (m_state);
-
-        release (entry, state);
-    }
-
-    Disposition charge (Entry& entry, Charge const& fee)
-    {
-        SharedState::Access state (m_state);
-
-        return charge (entry, fee, state);
-    }
-
-    bool warn (Entry& entry)
-    {
-        if (entry.admin())
-            return false;
-
-        SharedState::Access state (m_state);
-
-        return warn (entry, state);
-    }
-
-    bool disconnect (Entry& entry)
-    {
-        if (entry.admin())
-            return false;
-
-        SharedState::Access state (m_state);
-
-        return disconnect (entry, state);
-    }
-
     int balance (Entry& entry)
     {
-        SharedState::Access state (m_state);
-
-        return balance (entry, state);
+        return entry.balance (m_clock.now());
     }
 
     //--------------------------------------------------------------------------
@@ -608,36 +599,34 @@ public:
             item ["name"] = entry.to_string();
             item ["balance"] = entry.balance(now);
 
-            if (entry.remote_balance != 0)
-                item ["remote_balance"] = entry.remote_balance;
+            int const remoteBalance (entry.remote_balance.load ());
+            if (remoteBalance != 0)
+                item ["remote_balance"] = remoteBalance;
         }
     }
 
-    void onWrite (beast::PropertyStream::Map& map)
+    void writeLists (clock_type::time_point const now,
+                     beast::PropertyStream::Map& map,
+                     std::string const& name,
+                     EntryIntrusiveList Shard::*list)
     {
-        clock_type::time_point const now (m_clock.now());
-
-        SharedState::Access state (m_state);
+        beast::PropertyStream::Set s (name, map);
 
+        for (auto& shard : m_shards)
         {
-            beast::PropertyStream::Set s ("inbound", map);
-            writeList (now, s, state->inbound);
-        }
-
-        {
-            beast::PropertyStream::Set s ("outbound", map);
-            writeList (now, s, state->outbound);
+            lock_guard lock (shard.mutex);
+            writeList (now, s, shard.*list);
         }
+    }
 
-        {
-            beast::PropertyStream::Set s ("admin", map);
-            writeList (now, s, state->admin);
-        }
+    void onWrite (beast::PropertyStream::Map& map)
+    {
+        clock_type::time_point const now (m_clock.now());
 
-        {
-            beast::PropertyStream::Set s ("inactive", map);
-            writeList (now, s, state->inactive);
-        }
+        writeLists (now, map, "inbound", &Shard::inbound);
+        writeLists (now, map, "outbound", &Shard::outbound);
+        writeLists (now, map, "admin", &Shard::admin);
+        writeLists (now, map, "inactive", &Shard::inactive);
     }
 };
 
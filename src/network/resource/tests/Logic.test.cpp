@@ -0,0 +1,444 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <network/resource/impl/Logic.h>
+#include <network/resource/Consumer.h>
+#include <common/base/seconds_clock.h>
+#include <beast/chrono/manual_clock.h>
+#include <beast/insight/NullCollector.h>
+#include <beast/unit_test/suite.h>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace skywell {
+namespace Resource {
+namespace tests {
+
+class Logic_test : public beast::unit_test::suite
+{
+public:
+    using clock_type = beast::manual_clock <std::chrono::steady_clock>;
+
+    // 11.0.0.0/8 is public, so these are not whitelisted
+    static
+    boost::asio::ip::tcp::endpoint
+    address (std::uint32_t n, std::uint16_t port = 0)
+    {
+        return boost::asio::ip::tcp::endpoint (
+            boost::asio::ip::address_v4 (0x0b000001 + n), port);
+    }
+
+    // skywell::is_public currently treats every unicast address as
+    // private, so newInboundEndpoint whitelists all of them. Entries
+    // that are charged like a real peer are made through insert.
+    static
+    Entry&
+    inbound (Logic& logic, std::uint32_t n)
+    {
+        return logic.insert (Key (kindInbound, address (n)));
+    }
+
+    static
+    std::size_t
+    entries (Logic& logic)
+    {
+        std::size_t n = 0;
+        for (auto& shard : logic.m_shards)
+            n += shard.table.size ();
+        return n;
+    }
+
+    static
+    std::size_t
+    inactive (Logic& logic)
+    {
+        std::size_t n = 0;
+        for (auto& shard : logic.m_shards)
+            n += shard.inactive.size ();
+        return n;
+    }
+
+    // Charges until the balance reaches at least `balance`
+    static
+    void
+    chargeTo (Logic& logic, Entry& entry, int balance)
+    {
+        while (logic.balance (entry) < balance)
+            logic.charge (entry, feeInvalidRequest);
+    }
+
+    void
+    testReferences ()
+    {
+        testcase ("references");
+
+        clock_type clock;
+        Logic logic (beast::insight::NullCollector::New (), clock,
+            beast::Journal ());
+
+        std::vector <Entry*> held;
+        for (std::uint32_t i = 0; i < 64; ++i)
+            held.push_back (&inbound (logic, i));
+
+        expect (entries (logic) == 64, "one entry per address");
+
+        std::set <std::size_t> shards;
+        bool placed = true;
+        for (std::size_t i = 0; i < logic.m_shards.size (); ++i)
+        {
+            for (auto const& item : logic.m_shards[i].table)
+            {
+                placed = placed && (item.second.shard == i);
+                shards.insert (i);
+            }
+        }
+        expect (placed, "entry in the wrong shard");
+        expect (shards.size () > 1, "entries not spread over shards");
+
+        Entry& same (inbound (logic, 0));
+        expect (entries (logic) == 64, "same address added twice");
+        expect (&same == held[0], "entry differs");
+        expect (same.refcount == 2, "refcount");
+        logic.release (same);
+        expect (held[0]->refcount == 1, "release");
+
+        logic.acquire (*held[1]);
+        expect (held[1]->refcount == 2, "acquire");
+        logic.release (*held[1]);
+        expect (inactive (logic) == 0, "active entry marked inactive");
+
+        // Consumers hold a reference for as long as they exist
+        Consumer admin (logic.newAdminEndpoint ("admin"));
+        {
+            Consumer copy (admin);
+            Consumer assigned;
+            assigned = admin;
+            expect (admin.entry ().refcount == 3, "copy refcount");
+        }
+        expect (admin.entry ().refcount == 1, "copies released");
+        admin = Consumer ();
+        expect (inactive (logic) == 1, "released consumer not inactive");
+
+        for (auto entry : held)
+            logic.release (*entry);
+        expect (entries (logic) == 65, "entries erased before expiring");
+        expect (inactive (logic) == 65, "released entries not inactive");
+    }
+
+    void
+    testExpiry ()
+    {
+        testcase ("expiry");
+
+        clock_type clock;
+        clock.set (1000);
+        Logic logic (beast::insight::NullCollector::New (), clock,
+            beast::Journal ());
+
+        {
+            Entry& entry (inbound (logic, 0));
+            chargeTo (logic, entry, warningThreshold);
+            logic.release (entry);
+        }
+        expect (inactive (logic) == 1, "released entry not inactive");
+
+        clock.advance (std::chrono::seconds (secondsUntilExpiration - 1));
+        logic.periodicActivity ();
+        expect (entries (logic) == 1, "expired too soon");
+
+        // Using it again makes it active and restarts its expiry
+        {
+            Entry& entry (inbound (logic, 0));
+            expect (inactive (logic) == 0, "reused entry still inactive");
+            logic.release (entry);
+        }
+
+        clock.advance (std::chrono::seconds (secondsUntilExpiration - 1));
+        logic.periodicActivity ();
+        expect (entries (logic) == 1, "expiry not restarted");
+
+        clock.advance (std::chrono::seconds (1));
+        logic.periodicActivity ();
+        expect (entries (logic) == 0, "inactive entry not expired");
+        expect (inactive (logic) == 0, "expired entry still listed");
+
+        // An entry that is in use never expires
+        Entry& held (inbound (logic, 1));
+        clock.advance (std::chrono::seconds (10 * secondsUntilExpiration));
+        logic.periodicActivity ();
+        expect (entries (logic) == 1, "active entry expired");
+        logic.release (held);
+    }
+
+    void
+    testWarn ()
+    {
+        testcase ("warn");
+
+        clock_type clock;
+        clock.set (1000);
+        Logic logic (beast::insight::NullCollector::New (), clock,
+            beast::Journal ());
+
+        Entry& entry (inbound (logic, 0));
+        expect (! logic.warn (entry), "warned below the threshold");
+
+        // Far enough above the threshold that decay does not matter
+        chargeTo (logic, entry, 3 * warningThreshold);
+        expect (logic.charge (entry, Charge (0)) == Disposition::warn,
+            "disposition");
+
+        int const threads = 8;
+        for (int second = 0; second < 3; ++second)
+        {
+            std::atomic <int> ready (0);
+            std::atomic <int> warnings (0);
+            std::vector <std::thread> workers;
+
+            for (int t = 0; t < threads; ++t)
+            {
+                workers.emplace_back ([&]
+                {
+                    logic.acquire (entry);
+
+                    ++ready;
+                    while (ready.load () < threads)
+                        ;
+
+                    for (int i = 0; i < 1000; ++i)
+                        if (logic.warn (entry))
+                            ++warnings;
+
+                    logic.release (entry);
+                });
+            }
+
+            for (auto& w : workers)
+                w.join ();
+
+            std::stringstream ss;
+            ss << warnings.load () << " warnings in second " << second;
+            expect (warnings == 1, ss.str ());
+
+            ++clock;
+        }
+        logic.release (entry);
+
+        Consumer admin (logic.newAdminEndpoint ("admin"));
+        chargeTo (logic, admin.entry (), 3 * warningThreshold);
+        expect (! admin.warn (), "admin warned");
+    }
+
+    void
+    testImport ()
+    {
+        testcase ("import");
+
+        clock_type clock;
+        clock.set (1000);
+        Logic logic (beast::insight::NullCollector::New (), clock,
+            beast::Journal ());
+
+        auto gossip = [] (std::vector <std::pair <std::uint32_t, int>> items)
+        {
+            Gossip g;
+            for (auto const& item : items)
+            {
+                Gossip::Item i;
+                i.address = address (item.first);
+                i.balance = item.second;
+                g.items.push_back (i);
+            }
+            return g;
+        };
+
+        Consumer x (logic.newInboundEndpoint (address (0)));
+        Consumer y (logic.newInboundEndpoint (address (1)));
+
+        logic.importConsumers ("a", gossip ({{0, 500}, {1, 200}}));
+        expect (x.balance () == 500, "first import");
+        expect (y.balance () == 200, "first import, second item");
+
+        // Imports from different origins add up
+        logic.importConsumers ("b", gossip ({{0, 300}}));
+        expect (x.balance () == 800, "second origin");
+
+        // A new import from an origin replaces its previous one
+        clock.advance (std::chrono::seconds (gossipExpirationSeconds / 2));
+        logic.importConsumers ("a", gossip ({{0, 100}}));
+        expect (x.balance () == 400, "replaced import");
+        expect (y.balance () == 0, "item dropped from import");
+
+        // Expired imports are taken back out, oldest first
+        clock.advance (std::chrono::seconds (gossipExpirationSeconds / 2));
+        logic.periodicActivity ();
+        expect (x.balance () == 100, "expired origin");
+
+        clock.advance (std::chrono::seconds (gossipExpirationSeconds / 2));
+        logic.periodicActivity ();
+        expect (x.balance () == 0, "expired imports");
+    }
+
+    void
+    testDrop ()
+    {
+        testcase ("drop");
+
+        clock_type clock;
+        clock.set (1000);
+        Logic logic (beast::insight::NullCollector::New (), clock,
+            beast::Journal ());
+
+        Entry& entry (inbound (logic, 0));
+        chargeTo (logic, entry, warningThreshold);
+        expect (! logic.disconnect (entry), "dropped below the threshold");
+
+        chargeTo (logic, entry, dropThreshold);
+        expect (logic.charge (entry, Charge (0)) == Disposition::drop,
+            "disposition");
+
+        int const before = logic.balance (entry);
+        expect (logic.disconnect (entry), "not dropped");
+        expect (logic.balance (entry) > before, "drop not charged");
+        logic.release (entry);
+
+        // A remote balance counts towards the drop threshold
+        Entry& remote (inbound (logic, 1));
+        expect (! logic.disconnect (remote), "dropped with no balance");
+        remote.remote_balance += dropThreshold;
+        expect (logic.disconnect (remote), "remote balance did not drop");
+        remote.remote_balance -= dropThreshold;
+        logic.release (remote);
+
+        Consumer admin (logic.newAdminEndpoint ("admin"));
+        chargeTo (logic, admin.entry (), dropThreshold);
+        expect (! admin.disconnect (), "admin dropped");
+    }
+
+    void
+    run ()
+    {
+        testReferences ();
+        testExpiry ();
+        testWarn ();
+        testImport ();
+        testDrop ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(Logic,resource,skywell);
+
+//------------------------------------------------------------------------------
+
+// Charges 64 inbound consumers from a growing number of threads, while
+// another thread runs periodicActivity every 100ms, and reports charges
+// per second. One call in 64 is a disconnect check instead. Run with
+// --unittest=Logic_bench --unittest-arg=<most threads>[,<seconds per run>]
+class Logic_bench_test : public beast::unit_test::suite
+{
+public:
+    void
+    run ()
+    {
+        using clock_type = std::chrono::steady_clock;
+
+        int maxThreads = 8;
+        int seconds = 2;
+        if (! arg ().empty ())
+        {
+            std::stringstream ss (arg ());
+            char comma;
+            ss >> maxThreads >> comma >> seconds;
+        }
+
+        Logic logic (beast::insight::NullCollector::New (),
+            get_seconds_clock (), beast::Journal ());
+
+        std::vector <Consumer> consumers;
+        for (std::uint32_t i = 0; i < 64; ++i)
+        {
+            // 11.0.0.0/8 is public, so these are not whitelisted
+            consumers.push_back (logic.newInboundEndpoint (
+                boost::asio::ip::tcp::endpoint (
+                    boost::asio::ip::address_v4 (0x0b000001 + i), 0)));
+        }
+
+        for (int threads = 1; threads <= maxThreads; threads *= 2)
+        {
+            std::atomic <bool> stop (false);
+            std::atomic <std::uint64_t> charges (0);
+
+            std::vector <std::thread> workers;
+            for (int t = 0; t < threads; ++t)
+            {
+                workers.emplace_back ([&, t]
+                {
+                    std::minstd_rand rng (t + 1);
+                    std::uint64_t n = 0;
+                    while (! stop.load (std::memory_order_relaxed))
+                    {
+                        for (int i = 0; i < 64; ++i)
+                        {
+                            Consumer& c (consumers[rng () % 64]);
+                            if (i == 0)
+                                c.disconnect ();
+                            else
+                                c.charge (feeLightPeer);
+                        }
+                        n += 64;
+                    }
+                    charges += n;
+                });
+            }
+
+            auto const start = clock_type::now ();
+            auto const until = start + std::chrono::seconds (seconds);
+            while (clock_type::now () < until)
+            {
+                std::this_thread::sleep_for (std::chrono::milliseconds (100));
+                logic.periodicActivity ();
+            }
+            stop = true;
+            for (auto& w : workers)
+                w.join ();
+
+            auto const ms = std::chrono::duration_cast <
+                std::chrono::milliseconds> (clock_type::now () - start).count ();
+
+            std::stringstream ss;
+            ss << threads << " threads: " <<
+                (charges.load () * 1000 / ms) << " charges/s";
+            log << ss.str ();
+        }
+
+        pass ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(Logic_bench,resource,skywell);
+
+}
+}
+}
@@ -60,6 +60,7 @@ JSS ( accountState );               // out: LedgerToJson
 JSS ( accountTreeHash );            // out: ledger/Ledger.cpp
 JSS ( account_data );               // out: AccountInfo
 JSS ( account_hash );               // out: LedgerToJson
+JSS ( account_history );            // out: NetworkOPs
 JSS ( account_id );                 // out: WalletPropose
 JSS ( account_index );              // in: AccountCurrencies, AccountOffers,
                                     //     AccountInfo, AccountLines,
@@ -109,6 +110,7 @@ JSS ( command );                    // in: RPCHandler
 JSS ( comment );                    // in: UnlAdd
 JSS ( complete );                   // out: NetworkOPs, InboundLedger
 JSS ( complete_ledgers );           // out: NetworkOPs, PeerImp
+JSS ( compress );                   // in: LedgerSnapshot
 JSS ( consensus );                  // out: NetworkOPs, LedgerConsensus
 JSS ( converge_time );              // out: NetworkOPs
 JSS ( converge_time_s );            // out: NetworkOPs
@@ -266,6 +268,7 @@ JSS ( parent_hash );                // out: LedgerToJson
 JSS ( partition );                  // in: LogLevel
 JSS ( passphrase );                 // in: WalletPropose
 JSS ( password );                   // in: Subscribe
+JSS ( path );                       // in: LedgerSnapshot
 JSS ( paths );                      // in: SkywellPathFind
 JSS ( paths_canonical );            // out: SkywellPathFind
 JSS ( paths_computed );             // out: PathRequest, SkywellPathFind
@@ -345,6 +348,7 @@ JSS ( taker_gets );                 // in: Subscribe, Unsubscribe, BookOffers
 JSS ( taker_gets_funded );          // out: NetworkOPs
 JSS ( taker_pays );                 // in: Subscribe, Unsubscribe, BookOffers
 JSS ( taker_pays_funded );          // out: NetworkOPs
+JSS ( threads );                    // in: LedgerCleaner
 JSS ( threshold );                  // in: Blacklist
 JSS ( timeouts );                   // out: InboundLedger
 JSS ( totalCoins );                 // out: LedgerToJson
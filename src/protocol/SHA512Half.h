@@ -0,0 +1,149 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef SKYWELL_PROTOCOL_SHA512HALF_H_INCLUDED
+#define SKYWELL_PROTOCOL_SHA512HALF_H_INCLUDED
+
+#include <common/base/base_uint.h>
+#include <openssl/sha.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace skywell {
+
+/** Incremental SHA-512Half hasher.
+
+    Meets the requirements of the beast Hasher concept, so it can be used
+    with hash_append. Integers fed through add32 and add256 are appended
+    in their canonical (big endian) serialized form, allowing prefixed
+    objects to be hashed without first copying them into a Serializer.
+*/
+class sha512_half_hasher
+{
+private:
+    SHA512_CTX ctx_;
+
+public:
+    using result_type = uint256;
+
+    sha512_half_hasher () noexcept
+    {
+        SHA512_Init (&ctx_);
+    }
+
+    void
+    append (void const* data, std::size_t size) noexcept
+    {
+        SHA512_Update (&ctx_, data, size);
+    }
+
+    void
+    add32 (std::uint32_t i) noexcept
+    {
+        unsigned char const be[4] = {
+            static_cast<unsigned char> (i >> 24),
+            static_cast<unsigned char> ((i >> 16) & 0xff),
+            static_cast<unsigned char> ((i >> 8) & 0xff),
+            static_cast<unsigned char> (i & 0xff) };
+        append (be, sizeof (be));
+    }
+
+    void
+    add256 (uint256 const& u) noexcept
+    {
+        append (u.begin (), u.size ());
+    }
+
+    explicit
+    operator result_type () noexcept
+    {
+        uint256 j[2];
+        SHA512_Final (reinterpret_cast<unsigned char*> (&j[0]), &ctx_);
+        return j[0];
+    }
+};
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+// A message of the form prefix | data [| tag] queued for hashing
+struct SHA512HalfJob
+{
+    std::uint8_t prefix[4];
+    std::uint8_t const* data;
+    std::size_t size;
+    std::uint8_t const* tag;
+    uint256* result;
+
+    std::size_t
+    length () const
+    {
+        return 4 + size + (tag ? 32 : 0);
+    }
+};
+
+}
+
+/** Multi-buffer SHA-512Half engine.
+
+    Collects independent messages of the form prefix | data [| tag] and
+    hashes them together. On processors with AVX2 (four lanes) or AVX-512
+    (eight lanes) the compression function runs on several messages at
+    once; elsewhere each message is hashed in turn.
+
+    The caller must keep the data, tag and result storage alive and
+    unmodified until finish() returns.
+*/
+class SHA512HalfBatch
+{
+public:
+    SHA512HalfBatch () = default;
+    SHA512HalfBatch (SHA512HalfBatch const&) = delete;
+    SHA512HalfBatch& operator= (SHA512HalfBatch const&) = delete;
+
+    /** Queue the hash of prefix | data. */
+    void add (uint256& result, std::uint32_t prefix,
+        void const* data, std::size_t size);
+
+    /** Queue the hash of prefix | data | tag. */
+    void add (uint256& result, std::uint32_t prefix,
+        void const* data, std::size_t size, uint256 const& tag);
+
+    /** Number of messages waiting to be hashed. */
+    std::size_t
+    size () const
+    {
+        return jobs_.size ();
+    }
+
+    /** Hash every queued message and store the results. */
+    void finish ();
+
+    /** Number of messages the compression function processes at once. */
+    static int lanes ();
+
+private:
+    std::vector<detail::SHA512HalfJob> jobs_;
+};
+
+} // skywell
+
+#endif
@@ -21,7 +21,10 @@
 #define SKYWELL_PROTOCOL_SOTEMPLATE_H_INCLUDED
 
 #include <protocol/SField.h>
+#include <cassert>
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 namespace skywell {
 
@@ -81,13 +84,23 @@ public:
     /** Add an element to the template. */
     void push_back (SOElement const& r);
 
-    /** Retrieve the position of a named field. */
-    int getIndex (SField const&) const;
+    /** Retrieve the position of a named field, or -1 if absent. */
+    int getIndex (SField const& f) const
+    {
+        // The mapping table should be large enough for any possible field
+        //
+        assert (f.getNum () < static_cast<int> (mIndex.size ()));
+
+        return mIndex[f.getNum ()];
+    }
 
 private:
     list_type mTypes;
 
-    std::vector <int> mIndex;       // field num -> index
+    // field num -> index. SField numbers are handed out while the static
+    // field definitions are constructed, so the table is filled in at
+    // startup rather than at compile time; a lookup is a single load.
+    std::vector <std::int16_t> mIndex;
 };
 
 } // skywell
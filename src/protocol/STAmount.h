@@ -371,6 +371,15 @@ getRate (STAmount const& offerOut, STAmount const& offerIn);
 std::uint64_t
 getNValue(STAmount const& amount);
 
+namespace detail {
+
+// Compute (a * b + c) / d. The operands are mantissas, so the
+// intermediate fits in 128 bits and the quotient fits in 64 bits.
+std::uint64_t
+mulDiv (std::uint64_t a, std::uint64_t b, std::uint64_t c, std::uint64_t d);
+
+}
+
 //------------------------------------------------------------------------------
 
 inline bool isSWT(STAmount const& amount)
@@ -213,7 +213,18 @@ public:
         return &v_[offset].get();
     }
 
-    int getFieldIndex (SField const& field) const;
+    /** Retrieve the position of a field, or -1 if it is not present.
+        Templated objects resolve the field through the template's
+        direct index table; free objects search their elements.
+    */
+    int getFieldIndex (SField const& field) const
+    {
+        if (mType != nullptr)
+            return mType->getIndex (field);
+
+        return findFieldIndex (field);
+    }
+
     SField const& getFieldSType (int index) const;
 
     const STBase& peekAtField (SField const& field) const;
@@ -299,6 +310,8 @@ public:
     }
 
 private:
+    int findFieldIndex (SField const& field) const;
+
     // Implementation for getting (most) fields that return by value.
     //
     // The remove_cv and remove_reference are necessitated by the STBitString
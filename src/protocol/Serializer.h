@@ -21,6 +21,7 @@
 #define SKYWELL_PROTOCOL_SERIALIZER_H_INCLUDED
 
 #include <protocol/SField.h>
+#include <protocol/SHA512Half.h>
 #include <common/base/base_uint.h>
 #include <common/base/Buffer.h>
 #include <cassert>
@@ -28,6 +29,7 @@
 #include <iomanip>
 #include <sstream>
 #include <type_traits>
+#include <utility>
 
 namespace skywell {
 
@@ -39,16 +41,36 @@ private:
     // DEPRECATED
     Blob mData;
 
+    // When set, added bytes are fed to the hasher instead of stored
+    sha512_half_hasher* mHasher = nullptr;
+    std::size_t mHashed = 0;
+
 public:
     explicit
     Serializer (int n = 256)
     {
         mData.reserve (n);
     }
+
+    /** Construct a Serializer that streams into a hasher.
+
+        Every byte added is fed to the hasher and nothing is stored, so
+        only the add functions may be used. This lets an object be hashed
+        in its canonical form without an intermediate buffer.
+    */
+    explicit
+    Serializer (sha512_half_hasher& hasher)
+        : mHasher (&hasher)
+    {
+    }
     Serializer (Blob const& data) : mData (data)
     {
         ;
     }
+    Serializer (Blob&& data) : mData (std::move (data))
+    {
+        ;
+    }
     Serializer (std::string const& data) : mData (data.data (), (data.data ()) + data.size ())
     {
         ;
@@ -89,9 +111,7 @@ public:
 
     template <int Bits, class Tag>
     int addBitString(base_uint<Bits, Tag> const& v) {
-        int ret = mData.size ();
-        mData.insert (mData.end (), v.begin (), v.end ());
-        return ret;
+        return append (v.begin (), v.size ());
     }
 
     // TODO(tom): merge with add128 and add256.
@@ -298,6 +318,23 @@ public:
     static int decodeVLLength (int b1, int b2);
     static int decodeVLLength (int b1, int b2, int b3);
 private:
+    // All add functions write through here
+    int append (void const* ptr, std::size_t len)
+    {
+        if (mHasher != nullptr)
+        {
+            int ret = mHashed;
+            mHasher->append (ptr, len);
+            mHashed += len;
+            return ret;
+        }
+
+        int ret = mData.size ();
+        auto const p = static_cast<unsigned char const*> (ptr);
+        mData.insert (mData.end (), p, p + len);
+        return ret;
+    }
+
     static int lengthVL (int length)
     {
         return length + encodeLengthLength (length);
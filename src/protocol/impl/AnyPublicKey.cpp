@@ -20,18 +20,29 @@
 #include <protocol/AnyPublicKey.h>
 #include <protocol/Serializer.h>
 #include <protocol/STExchange.h>
+#include <crypto/ECDSA.h>
+#include <crypto/ECDSACanonical.h>
 #include <crypto/ed25519-donna/ed25519.h>
 #include <cassert>
 
 namespace skywell {
 
-/** Verify a secp256k1 signature. */
+/** Verify a secp256k1 signature.
+    The message is hashed with SHA-512Half, and the signature must be
+    fully canonical.
+*/
 bool
 verify_secp256k1 (void const* pk,
     void const* msg, std::size_t msg_size,
     void const* sig, std::size_t sig_size)
 {
-    return false;
+    if (sig_size == 0)
+        return false;
+    Slice const s (sig, sig_size);
+    if (! isCanonicalECDSASig (s, ECDSA::strict))
+        return false;
+    return ECDSAVerify (getSHA512Half (msg, msg_size),
+        s, Slice (pk, 33));
 }
 
 bool
@@ -64,7 +75,7 @@ AnyPublicKeySlice::type() const noexcept
     if (len == 32 &&
             pk[0] == 0xED)
         return KeyType::ed25519;
-    if (len == 33 &&
+    if (pk_size == 33 &&
             (pk[0] == 0x02 || pk[0] == 0x03))
         return KeyType::secp256k1;
     return KeyType::unknown;
@@ -81,7 +92,7 @@ AnyPublicKeySlice::verify (
         return verify_ed25519(data() + 1,
             msg, msg_size, sig, sig_size);
     case KeyType::secp256k1:
-        return verify_secp256k1(data() + 1,
+        return verify_secp256k1(data(),
             msg, msg_size, sig, sig_size);
     default:
         break;
@@ -0,0 +1,350 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <protocol/SHA512Half.h>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SKYWELL_SHA512_MULTIBUFFER 1
+#else
+#define SKYWELL_SHA512_MULTIBUFFER 0
+#endif
+
+namespace skywell {
+
+using detail::SHA512HalfJob;
+
+static
+void
+hashOne (SHA512HalfJob const& job)
+{
+    sha512_half_hasher h;
+    h.append (job.prefix, 4);
+    if (job.size != 0)
+        h.append (job.data, job.size);
+    if (job.tag)
+        h.append (job.tag, 32);
+    *job.result = static_cast<uint256> (h);
+}
+
+#if SKYWELL_SHA512_MULTIBUFFER
+
+static std::uint64_t const sha512K[80] =
+{
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL,
+    0xe9b5dba58189dbbcULL, 0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
+    0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL, 0xd807aa98a3030242ULL,
+    0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL,
+    0xc19bf174cf692694ULL, 0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL,
+    0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL, 0x2de92c6f592b0275ULL,
+    0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL,
+    0xbf597fc7beef0ee4ULL, 0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
+    0x06ca6351e003826fULL, 0x142929670a0e6e70ULL, 0x27b70a8546d22ffcULL,
+    0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL,
+    0x92722c851482353bULL, 0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL,
+    0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL, 0xd192e819d6ef5218ULL,
+    0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL,
+    0x34b0bcb5e19b48a8ULL, 0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL,
+    0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL, 0x748f82ee5defb2fcULL,
+    0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL,
+    0xc67178f2e372532bULL, 0xca273eceea26619cULL, 0xd186b8c721c0c207ULL,
+    0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL, 0x06f067aa72176fbaULL,
+    0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL,
+    0x431d67c49c100d4cULL, 0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL,
+    0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+static std::uint64_t const sha512H0[8] =
+{
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL,
+    0xa54ff53a5f1d36f1ULL, 0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+    0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+static inline
+std::uint64_t
+loadBE64 (std::uint8_t const* p)
+{
+    return
+        (static_cast<std::uint64_t> (p[0]) << 56) |
+        (static_cast<std::uint64_t> (p[1]) << 48) |
+        (static_cast<std::uint64_t> (p[2]) << 40) |
+        (static_cast<std::uint64_t> (p[3]) << 32) |
+        (static_cast<std::uint64_t> (p[4]) << 24) |
+        (static_cast<std::uint64_t> (p[5]) << 16) |
+        (static_cast<std::uint64_t> (p[6]) << 8) |
+        (static_cast<std::uint64_t> (p[7]));
+}
+
+static inline
+void
+storeBE64 (std::uint8_t* p, std::uint64_t v)
+{
+    for (int i = 7; i >= 0; --i)
+    {
+        p[i] = static_cast<std::uint8_t> (v & 0xff);
+        v >>= 8;
+    }
+}
+
+static inline
+std::size_t
+paddedBlocks (std::size_t length)
+{
+    // message, 0x80 terminator and 128-bit length
+    return (length + 17 + 127) / 128;
+}
+
+// Copy the part of [src, src+size) at message offset 'at' that overlaps
+// the 128 byte block starting at message offset 'begin'
+static inline
+void
+copyOverlap (std::uint8_t* block, std::size_t begin,
+    std::size_t at, std::uint8_t const* src, std::size_t size)
+{
+    std::size_t const lo = std::max (begin, at);
+    std::size_t const hi = std::min (begin + 128, at + size);
+
+    if (lo < hi)
+        std::memcpy (block + (lo - begin), src + (lo - at), hi - lo);
+}
+
+// Produce block 'index' of the padded message without assembling
+// the whole message in memory
+static
+void
+fillBlock (SHA512HalfJob const& job, std::size_t index, std::uint8_t* block)
+{
+    std::size_t const length = job.length ();
+    std::size_t const begin = index * 128;
+
+    std::memset (block, 0, 128);
+    copyOverlap (block, begin, 0, job.prefix, 4);
+    if (job.size != 0)
+        copyOverlap (block, begin, 4, job.data, job.size);
+    if (job.tag)
+        copyOverlap (block, begin, 4 + job.size, job.tag, 32);
+
+    if (length >= begin && length < begin + 128)
+        block[length - begin] = 0x80;
+
+    if (index + 1 == paddedBlocks (length))
+        storeBE64 (block + 120, static_cast<std::uint64_t> (length) * 8);
+}
+
+// The SHA-512 compression function, applied to one block of every lane
+template <class V>
+static inline __attribute__ ((always_inline))
+void
+compressLanes (V* state, V* w)
+{
+    V a = state[0], b = state[1], c = state[2], d = state[3];
+    V e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (int t = 0; t < 80; ++t)
+    {
+        if (t >= 16)
+        {
+            V const w15 = w[(t - 15) & 15];
+            V const w2 = w[(t - 2) & 15];
+            V const s0 = ((w15 >> 1) | (w15 << 63)) ^
+                ((w15 >> 8) | (w15 << 56)) ^ (w15 >> 7);
+            V const s1 = ((w2 >> 19) | (w2 << 45)) ^
+                ((w2 >> 61) | (w2 << 3)) ^ (w2 >> 6);
+            w[t & 15] += s0 + s1 + w[(t - 7) & 15];
+        }
+
+        V const S1 = ((e >> 14) | (e << 50)) ^
+            ((e >> 18) | (e << 46)) ^ ((e >> 41) | (e << 23));
+        V const ch = (e & f) ^ (~e & g);
+        V const t1 = h + S1 + ch + sha512K[t] + w[t & 15];
+        V const S0 = ((a >> 28) | (a << 36)) ^
+            ((a >> 34) | (a << 30)) ^ ((a >> 39) | (a << 25));
+        V const maj = (a & b) ^ (a & c) ^ (b & c);
+        V const t2 = S0 + maj;
+
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+// Hash up to L messages at once, one per vector lane. Messages of
+// different lengths are handled by masking finished lanes.
+template <class V, int L>
+static inline __attribute__ ((always_inline))
+void
+hashLanes (SHA512HalfJob const* jobs, int count)
+{
+    std::size_t blocks[L];
+    std::size_t maxBlocks = 0;
+
+    for (int lane = 0; lane < L; ++lane)
+    {
+        blocks[lane] = (lane < count) ? paddedBlocks (jobs[lane].length ()) : 0;
+        maxBlocks = std::max (maxBlocks, blocks[lane]);
+    }
+
+    V state[8];
+    for (int i = 0; i < 8; ++i)
+        for (int lane = 0; lane < L; ++lane)
+            state[i][lane] = sha512H0[i];
+
+    std::uint8_t block[L][128];
+
+    for (std::size_t index = 0; index < maxBlocks; ++index)
+    {
+        V mask;
+        for (int lane = 0; lane < L; ++lane)
+        {
+            if (index < blocks[lane])
+            {
+                fillBlock (jobs[lane], index, block[lane]);
+                mask[lane] = ~std::uint64_t (0);
+            }
+            else
+            {
+                std::memset (block[lane], 0, 128);
+                mask[lane] = 0;
+            }
+        }
+
+        V w[16];
+        for (int t = 0; t < 16; ++t)
+            for (int lane = 0; lane < L; ++lane)
+                w[t][lane] = loadBE64 (block[lane] + t * 8);
+
+        V next[8];
+        for (int i = 0; i < 8; ++i)
+            next[i] = state[i];
+
+        compressLanes (next, w);
+
+        for (int i = 0; i < 8; ++i)
+            state[i] = (next[i] & mask) | (state[i] & ~mask);
+    }
+
+    for (int lane = 0; lane < count; ++lane)
+    {
+        std::uint8_t* out = jobs[lane].result->begin ();
+        for (int i = 0; i < 4; ++i)
+            storeBE64 (out + i * 8, state[i][lane]);
+    }
+}
+
+typedef std::uint64_t sha512x4 __attribute__ ((vector_size (32)));
+typedef std::uint64_t sha512x8 __attribute__ ((vector_size (64)));
+
+__attribute__ ((target ("avx2")))
+static
+void
+hashLanes4 (SHA512HalfJob const* jobs, int count)
+{
+    hashLanes<sha512x4, 4> (jobs, count);
+}
+
+__attribute__ ((target ("avx512f")))
+static
+void
+hashLanes8 (SHA512HalfJob const* jobs, int count)
+{
+    hashLanes<sha512x8, 8> (jobs, count);
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+
+void
+SHA512HalfBatch::add (uint256& result, std::uint32_t prefix,
+    void const* data, std::size_t size)
+{
+    SHA512HalfJob job;
+    job.prefix[0] = static_cast<std::uint8_t> (prefix >> 24);
+    job.prefix[1] = static_cast<std::uint8_t> ((prefix >> 16) & 0xff);
+    job.prefix[2] = static_cast<std::uint8_t> ((prefix >> 8) & 0xff);
+    job.prefix[3] = static_cast<std::uint8_t> (prefix & 0xff);
+    job.data = static_cast<std::uint8_t const*> (data);
+    job.size = size;
+    job.tag = nullptr;
+    job.result = &result;
+    jobs_.push_back (job);
+}
+
+void
+SHA512HalfBatch::add (uint256& result, std::uint32_t prefix,
+    void const* data, std::size_t size, uint256 const& tag)
+{
+    add (result, prefix, data, size);
+    jobs_.back ().tag = tag.begin ();
+}
+
+int
+SHA512HalfBatch::lanes ()
+{
+#if SKYWELL_SHA512_MULTIBUFFER
+    static int const n =
+        __builtin_cpu_supports ("avx512f") ? 8 :
+        __builtin_cpu_supports ("avx2") ? 4 : 1;
+    return n;
+#else
+    return 1;
+#endif
+}
+
+void
+SHA512HalfBatch::finish ()
+{
+    std::size_t i = 0;
+
+#if SKYWELL_SHA512_MULTIBUFFER
+    int const n = lanes ();
+
+    // A lone message is cheaper through the scalar path
+    while (n > 1 && (jobs_.size () - i) > 1)
+    {
+        int const count = static_cast<int> (
+            std::min<std::size_t> (n, jobs_.size () - i));
+
+        if (n == 8)
+            hashLanes8 (&jobs_[i], count);
+        else
+            hashLanes4 (&jobs_[i], count);
+
+        i += count;
+    }
+#endif
+
+    for (; i < jobs_.size (); ++i)
+        hashOne (jobs_[i]);
+
+    jobs_.clear ();
+}
+
+} // skywell
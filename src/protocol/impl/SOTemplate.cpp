@@ -48,20 +48,11 @@ void SOTemplate::push_back (SOElement const& r)
 
     // Add the field to the index mapping table
     //
-    mIndex [r.e_field.getNum ()] = mTypes.size ();
+    mIndex [r.e_field.getNum ()] = static_cast<std::int16_t> (mTypes.size ());
 
     // Append the new element.
     //
     mTypes.push_back (value_type (new SOElement (r)));
 }
 
-int SOTemplate::getIndex (SField const& f) const
-{
-    // The mapping table should be large enough for any possible field
-    //
-    assert (f.getNum () < mIndex.size ());
-
-    return mIndex[f.getNum ()];
-}
-
 } // skywell
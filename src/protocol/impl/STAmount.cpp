@@ -1130,6 +1130,41 @@ operator- (STAmount const& value)
 //
 //------------------------------------------------------------------------------
 
+namespace detail {
+
+std::uint64_t
+mulDiv (std::uint64_t a, std::uint64_t b, std::uint64_t c, std::uint64_t d)
+{
+    assert (d != 0);
+
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 v = a;
+    v *= b;
+    v += c;
+    v /= d;
+
+    assert ((v >> 64) == 0);
+    return static_cast<std::uint64_t> (v);
+#else
+    CBigNum v;
+
+    if ((BN_add_word64 (&v, a) != 1) ||
+            (BN_mul_word64 (&v, b) != 1) ||
+            (BN_add_word64 (&v, c) != 1) ||
+            (BN_div_word64 (&v, d) == ((std::uint64_t) - 1)))
+    {
+        throw std::runtime_error ("internal bn error");
+    }
+
+    assert (BN_num_bytes (&v) <= 64);
+    return v.getuint64 ();
+#endif
+}
+
+}
+
+using detail::mulDiv;
+
 STAmount
 divide (STAmount const& num, STAmount const& den, Issue const& issue)
 {
@@ -1164,20 +1199,11 @@ divide (STAmount const& num, STAmount const& den, Issue const& issue)
     }
 
     // Compute (numerator * 10^17) / denominator
-    CBigNum v;
-
-    if ((BN_add_word64 (&v, numVal) != 1) ||
-            (BN_mul_word64 (&v, tenTo17) != 1) ||
-            (BN_div_word64 (&v, denVal) == ((std::uint64_t) - 1)))
-    {
-        throw std::runtime_error ("internal bn error");
-    }
-
     // 10^16 <= quotient <= 10^18
-    assert (BN_num_bytes (&v) <= 64);
+    std::uint64_t const quotient = mulDiv (numVal, tenTo17, 0, denVal);
 
     // TODO(tom): where do 5 and 17 come from?
-    return STAmount (issue, v.getuint64 () + 5,
+    return STAmount (issue, quotient + 5,
                      numOffset - denOffset - 17,
                      num.negative() != den.negative());
 }
@@ -1229,20 +1255,10 @@ multiply (STAmount const& v1, STAmount const& v2, Issue const& issue)
 
     // Compute (numerator * denominator) / 10^14 with rounding
     // 10^16 <= result <= 10^18
-    CBigNum v;
-
-    if ((BN_add_word64 (&v, value1) != 1) ||
-            (BN_mul_word64 (&v, value2) != 1) ||
-            (BN_div_word64 (&v, tenTo14) == ((std::uint64_t) - 1)))
-    {
-        throw std::runtime_error ("internal bn error");
-    }
-
-    // 10^16 <= product <= 10^18
-    assert (BN_num_bytes (&v) <= 64);
+    std::uint64_t const product = mulDiv (value1, value2, 0, tenTo14);
 
     // TODO(tom): where do 7 and 14 come from?
-    return STAmount (issue, v.getuint64 () + 7,
+    return STAmount (issue, product + 7,
         offset1 + offset2 + 14, v1.negative() != v2.negative());
 }
 
@@ -1338,21 +1354,9 @@ mulRound (STAmount const& v1, STAmount const& v2,
     bool resultNegative = v1.negative() != v2.negative();
     // Compute (numerator * denominator) / 10^14 with rounding
     // 10^16 <= result <= 10^18
-    CBigNum v;
-
-    if ((BN_add_word64 (&v, value1) != 1) || (BN_mul_word64 (&v, value2) != 1))
-        throw std::runtime_error ("internal bn error");
-
-    if (resultNegative != roundUp) // rounding down is automatic when we divide
-        BN_add_word64 (&v, tenTo14m1);
-
-    if  (BN_div_word64 (&v, tenTo14) == ((std::uint64_t) - 1))
-        throw std::runtime_error ("internal bn error");
-
-    // 10^16 <= product <= 10^18
-    assert (BN_num_bytes (&v) <= 64);
-
-    std::uint64_t amount = v.getuint64 ();
+    // Rounding down is automatic when we divide
+    std::uint64_t amount = mulDiv (value1, value2,
+        (resultNegative != roundUp) ? tenTo14m1 : 0, tenTo14);
     int offset = offset1 + offset2 + 14;
     canonicalizeRound (
         isSWT (issue), amount, offset, resultNegative != roundUp);
@@ -1389,21 +1393,10 @@ divRound (STAmount const& num, STAmount const& den,
 
     bool resultNegative = num.negative() != den.negative();
     // Compute (numerator * 10^17) / denominator
-    CBigNum v;
-
-    if ((BN_add_word64 (&v, numVal) != 1) || (BN_mul_word64 (&v, tenTo17) != 1))
-        throw std::runtime_error ("internal bn error");
-
-    if (resultNegative != roundUp) // Rounding down is automatic when we divide
-        BN_add_word64 (&v, denVal - 1);
-
-    if (BN_div_word64 (&v, denVal) == ((std::uint64_t) - 1))
-        throw std::runtime_error ("internal bn error");
-
     // 10^16 <= quotient <= 10^18
-    assert (BN_num_bytes (&v) <= 64);
-
-    std::uint64_t amount = v.getuint64 ();
+    // Rounding down is automatic when we divide
+    std::uint64_t amount = mulDiv (numVal, tenTo17,
+        (resultNegative != roundUp) ? (denVal - 1) : 0, denVal);
     int offset = numOffset - denOffset - 17;
     canonicalizeRound (
         isSWT (issue), amount, offset, resultNegative != roundUp);
@@ -28,6 +28,7 @@
 #include <protocol/STParsedJSON.h>
 #include <common/misc/Utility.h>
 #include <common/misc/static_initializer.h>
+#include <algorithm>
 
 namespace skywell {
 
@@ -266,23 +267,40 @@ std::string STObject::getFullText () const
 
 void STObject::add (Serializer& s, bool withSigningFields) const
 {
-    std::map<int, STBase const*> fields;
+    std::vector<STBase const*> fields;
+    fields.reserve (v_.size ());
     for (auto const& e : v_)
     {
         // pick out the fields and sort them
         if ((e->getSType() != STI_NOTPRESENT) &&
             e->getFName().shouldInclude (withSigningFields))
         {
-            fields.insert (std::make_pair (
-                e->getFName().fieldCode, &e.get()));
+            fields.push_back (&e.get());
         }
     }
 
-    // insert sorted
-    for (auto const& e : fields)
+    // Insertion sort: an object has few fields, and unlike stable_sort
+    // it needs no temporary buffer. It keeps the first of two equal fields.
+    for (std::size_t i = 1; i < fields.size (); ++i)
     {
-        auto const field = e.second;
+        STBase const* const field = fields[i];
+        int const code = field->getFName().fieldCode;
+        std::size_t j = i;
+        for (; j > 0 && fields[j - 1]->getFName().fieldCode > code; --j)
+            fields[j] = fields[j - 1];
+        fields[j] = field;
+    }
+
+    // A field appearing twice is only serialized once
+    fields.erase (std::unique (fields.begin (), fields.end (),
+        [](STBase const* lhs, STBase const* rhs)
+        {
+            return lhs->getFName().fieldCode == rhs->getFName().fieldCode;
+        }), fields.end ());
 
+    // insert sorted
+    for (auto const field : fields)
+    {
         // When we serialize an object inside another object,
         // the type associated by rule with this field name
         // must be OBJECT, or the object cannot be deserialized
@@ -356,25 +374,24 @@ bool STObject::isEquivalent (const STBase& t) const
 
 uint256 STObject::getHash (std::uint32_t prefix) const
 {
-    Serializer s;
-    s.add32 (prefix);
+    sha512_half_hasher h;
+    h.add32 (prefix);
+    Serializer s (h);
     add (s, true);
-    return s.getSHA512Half ();
+    return static_cast<uint256> (h);
 }
 
 uint256 STObject::getSigningHash (std::uint32_t prefix) const
 {
-    Serializer s;
-    s.add32 (prefix);
+    sha512_half_hasher h;
+    h.add32 (prefix);
+    Serializer s (h);
     add (s, false);
-    return s.getSHA512Half ();
+    return static_cast<uint256> (h);
 }
 
-int STObject::getFieldIndex (SField const& field) const
+int STObject::findFieldIndex (SField const& field) const
 {
-    if (mType != nullptr)
-        return mType->getIndex (field);
-
     int i = 0;
     for (auto const& elem : v_)
     {
@@ -22,49 +22,55 @@
 #include <protocol/Serializer.h>
 #include <openssl/ripemd.h>
 #include <openssl/pem.h>
+#include <algorithm>
 
 namespace skywell {
 
 int Serializer::addZeros (size_t uBytes)
 {
-    int ret = mData.size ();
+    int ret = (mHasher != nullptr) ? mHashed : mData.size ();
+    unsigned char const zeros[32] = {};
 
-    while (uBytes--)
-        mData.push_back (0);
+    while (uBytes != 0)
+    {
+        std::size_t const n = std::min (uBytes, sizeof (zeros));
+        append (zeros, n);
+        uBytes -= n;
+    }
 
     return ret;
 }
 
 int Serializer::add16 (std::uint16_t i)
 {
-    int ret = mData.size ();
-    mData.push_back (static_cast<unsigned char> (i >> 8));
-    mData.push_back (static_cast<unsigned char> (i & 0xff));
-    return ret;
+    unsigned char const be[2] = {
+        static_cast<unsigned char> (i >> 8),
+        static_cast<unsigned char> (i & 0xff) };
+    return append (be, sizeof (be));
 }
 
 int Serializer::add32 (std::uint32_t i)
 {
-    int ret = mData.size ();
-    mData.push_back (static_cast<unsigned char> (i >> 24));
-    mData.push_back (static_cast<unsigned char> ((i >> 16) & 0xff));
-    mData.push_back (static_cast<unsigned char> ((i >> 8) & 0xff));
-    mData.push_back (static_cast<unsigned char> (i & 0xff));
-    return ret;
+    unsigned char const be[4] = {
+        static_cast<unsigned char> (i >> 24),
+        static_cast<unsigned char> ((i >> 16) & 0xff),
+        static_cast<unsigned char> ((i >> 8) & 0xff),
+        static_cast<unsigned char> (i & 0xff) };
+    return append (be, sizeof (be));
 }
 
 int Serializer::add64 (std::uint64_t i)
 {
-    int ret = mData.size ();
-    mData.push_back (static_cast<unsigned char> (i >> 56));
-    mData.push_back (static_cast<unsigned char> ((i >> 48) & 0xff));
-    mData.push_back (static_cast<unsigned char> ((i >> 40) & 0xff));
-    mData.push_back (static_cast<unsigned char> ((i >> 32) & 0xff));
-    mData.push_back (static_cast<unsigned char> ((i >> 24) & 0xff));
-    mData.push_back (static_cast<unsigned char> ((i >> 16) & 0xff));
-    mData.push_back (static_cast<unsigned char> ((i >> 8) & 0xff));
-    mData.push_back (static_cast<unsigned char> (i & 0xff));
-    return ret;
+    unsigned char const be[8] = {
+        static_cast<unsigned char> (i >> 56),
+        static_cast<unsigned char> ((i >> 48) & 0xff),
+        static_cast<unsigned char> ((i >> 40) & 0xff),
+        static_cast<unsigned char> ((i >> 32) & 0xff),
+        static_cast<unsigned char> ((i >> 24) & 0xff),
+        static_cast<unsigned char> ((i >> 16) & 0xff),
+        static_cast<unsigned char> ((i >> 8) & 0xff),
+        static_cast<unsigned char> (i & 0xff) };
+    return append (be, sizeof (be));
 }
 
 template <> int Serializer::addInteger(unsigned char i) { return add8(i); }
@@ -74,37 +80,27 @@ template <> int Serializer::addInteger(std::uint64_t i) { return add64(i); }
 
 int Serializer::add128 (const uint128& i)
 {
-    int ret = mData.size ();
-    mData.insert (mData.end (), i.begin (), i.end ());
-    return ret;
+    return append (i.begin (), i.size ());
 }
 
 int Serializer::add256 (uint256 const& i)
 {
-    int ret = mData.size ();
-    mData.insert (mData.end (), i.begin (), i.end ());
-    return ret;
+    return append (i.begin (), i.size ());
 }
 
 int Serializer::addRaw (Blob const& vector)
 {
-    int ret = mData.size ();
-    mData.insert (mData.end (), vector.begin (), vector.end ());
-    return ret;
+    return append (vector.data (), vector.size ());
 }
 
 int Serializer::addRaw (const Serializer& s)
 {
-    int ret = mData.size ();
-    mData.insert (mData.end (), s.begin (), s.end ());
-    return ret;
+    return append (s.mData.data (), s.mData.size ());
 }
 
 int Serializer::addRaw (const void* ptr, int len)
 {
-    int ret = mData.size ();
-    mData.insert (mData.end (), (const char*) ptr, ((const char*)ptr) + len);
-    return ret;
+    return append (ptr, len);
 }
 
 bool Serializer::get16 (std::uint16_t& o, int offset) const
@@ -184,35 +180,35 @@ uint256 Serializer::get256 (int offset) const
 
 int Serializer::addFieldID (int type, int name)
 {
-    int ret = mData.size ();
     assert ((type > 0) && (type < 256) && (name > 0) && (name < 256));
 
     if (type < 16)
     {
         if (name < 16) // common type, common name
-            mData.push_back (static_cast<unsigned char> ((type << 4) | name));
-        else
-        {
-            // common type, uncommon name
-            mData.push_back (static_cast<unsigned char> (type << 4));
-            mData.push_back (static_cast<unsigned char> (name));
-        }
+            return add8 (static_cast<unsigned char> ((type << 4) | name));
+
+        // common type, uncommon name
+        unsigned char const id[2] = {
+            static_cast<unsigned char> (type << 4),
+            static_cast<unsigned char> (name) };
+        return append (id, sizeof (id));
     }
-    else if (name < 16)
+
+    if (name < 16)
     {
         // uncommon type, common name
-        mData.push_back (static_cast<unsigned char> (name));
-        mData.push_back (static_cast<unsigned char> (type));
-    }
-    else
-    {
-        // uncommon type, uncommon name
-        mData.push_back (static_cast<unsigned char> (0));
-        mData.push_back (static_cast<unsigned char> (type));
-        mData.push_back (static_cast<unsigned char> (name));
+        unsigned char const id[2] = {
+            static_cast<unsigned char> (name),
+            static_cast<unsigned char> (type) };
+        return append (id, sizeof (id));
     }
 
-    return ret;
+    // uncommon type, uncommon name
+    unsigned char const id[3] = {
+        static_cast<unsigned char> (0),
+        static_cast<unsigned char> (type),
+        static_cast<unsigned char> (name) };
+    return append (id, sizeof (id));
 }
 
 bool Serializer::getFieldID (int& type, int& name, int offset) const
@@ -257,9 +253,7 @@ bool Serializer::getFieldID (int& type, int& name, int offset) const
 
 int Serializer::add8 (unsigned char byte)
 {
-    int ret = mData.size ();
-    mData.push_back (byte);
-    return ret;
+    return append (&byte, 1);
 }
 
 bool Serializer::get8 (int& byte, int offset) const
@@ -323,7 +317,7 @@ int Serializer::addVL (Blob const& vector)
 {
     int ret = addEncoded (vector.size ());
     addRaw (vector);
-    assert (mData.size () == (ret + vector.size () + encodeLengthLength (vector.size ())));
+    assert (mHasher || mData.size () == (ret + vector.size () + encodeLengthLength (vector.size ())));
     return ret;
 }
 
@@ -358,7 +358,21 @@ typedef std::mutex StaticLockType;
 typedef std::lock_guard <StaticLockType> StaticScopedLockType;
 
 static StaticLockType s_lock;
-static hash_map <Blob, std::string> rncMapOld, rncMapNew;
+// Two generations of recently rendered account IDs, bounding the
+// cache at twice the generation size
+static std::size_t const rncGeneration = 128000;
+static hash_map <Account, std::string> rncMapOld, rncMapNew;
+
+// Caller must hold s_lock
+static void rotateCache ()
+{
+    if (rncMapNew.size () >= rncGeneration)
+    {
+        rncMapOld = std::move (rncMapNew);
+        rncMapNew.clear ();
+        rncMapNew.reserve (rncGeneration);
+    }
+}
 
 void SkywellAddress::clearCache ()
 {
@@ -377,41 +391,37 @@ std::string SkywellAddress::humanAccountID () const
 
     case VER_ACCOUNT_ID:
     {
-        std::string ret;
+        Account const account (vchData);
 
         {
             StaticScopedLockType sl (s_lock);
 
-            auto it = rncMapNew.find (vchData);
+            auto it = rncMapNew.find (account);
 
             if (it != rncMapNew.end ())
             {
                 // Found in new map, nothing to do
-                ret = it->second;
+                return it->second;
             }
-            else
+
+            it = rncMapOld.find (account);
+
+            if (it != rncMapOld.end ())
             {
-                it = rncMapOld.find (vchData);
-
-                if (it != rncMapOld.end ())
-                {
-                    ret = it->second;
-                    rncMapOld.erase (it);
-                }
-                else
-                    ret = ToString ();
-
-                if (rncMapNew.size () >= 128000)
-                {
-                    rncMapOld = std::move (rncMapNew);
-                    rncMapNew.clear ();
-                    rncMapNew.reserve (128000);
-                }
-
-                rncMapNew[vchData] = ret;
+                std::string ret = std::move (it->second);
+                rncMapOld.erase (it);
+                rotateCache ();
+                rncMapNew.emplace (account, ret);
+                return ret;
             }
         }
 
+        // Encode without holding the lock
+        std::string ret = ToString ();
+
+        StaticScopedLockType sl (s_lock);
+        rotateCache ();
+        rncMapNew.emplace (account, ret);
         return ret;
     }
 
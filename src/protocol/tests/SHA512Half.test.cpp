@@ -0,0 +1,179 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <protocol/SHA512Half.h>
+#include <beast/unit_test/suite.h>
+#include <openssl/sha.h>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <sstream>
+
+namespace skywell {
+
+class SHA512Half_test : public beast::unit_test::suite
+{
+public:
+    // SHA-512Half of prefix | data [| tag], computed in one piece
+    static uint256 reference (std::uint32_t prefix,
+        std::vector<std::uint8_t> const& data, uint256 const* tag)
+    {
+        std::vector<std::uint8_t> m;
+        m.push_back (static_cast<std::uint8_t> (prefix >> 24));
+        m.push_back (static_cast<std::uint8_t> ((prefix >> 16) & 0xff));
+        m.push_back (static_cast<std::uint8_t> ((prefix >> 8) & 0xff));
+        m.push_back (static_cast<std::uint8_t> (prefix & 0xff));
+        m.insert (m.end (), data.begin (), data.end ());
+        if (tag)
+            m.insert (m.end (), tag->begin (), tag->end ());
+
+        unsigned char digest[64];
+        SHA512 (m.data (), m.size (), digest);
+        uint256 result;
+        std::memcpy (result.begin (), digest, 32);
+        return result;
+    }
+
+    void testHasher ()
+    {
+        testcase ("hasher");
+
+        std::vector<std::uint8_t> data (300);
+        for (std::size_t i = 0; i < data.size (); ++i)
+            data[i] = static_cast<std::uint8_t> (i * 7);
+
+        sha512_half_hasher h;
+        h.add32 (0x4D4C4E00);
+        h.append (data.data (), data.size ());
+        expect (static_cast<uint256> (h) ==
+            reference (0x4D4C4E00, data, nullptr));
+    }
+
+    // Batches of every size up to a few times the lane count, with
+    // message lengths around the SHA-512 block and padding boundaries.
+    void testBatch ()
+    {
+        testcase ("batch");
+
+        std::mt19937 gen (1);
+        std::uniform_int_distribution<int> byte (0, 255);
+        std::uniform_int_distribution<int> length (0, 600);
+
+        for (int batchSize = 1; batchSize <= 3 * 8 + 1; ++batchSize)
+        {
+            std::vector<std::vector<std::uint8_t>> data (batchSize);
+            std::vector<uint256> tags (batchSize);
+            std::vector<uint256> results (batchSize);
+            std::vector<std::uint32_t> prefixes (batchSize);
+
+            SHA512HalfBatch batch;
+            for (int i = 0; i < batchSize; ++i)
+            {
+                // Lengths straddling 111/112 and 239/240 bytes move the
+                // length field into an extra block
+                int const n = (i % 4 == 0) ? length (gen) :
+                    ((i % 4 == 1) ? 107 + batchSize % 6 : 235 + batchSize % 6);
+                data[i].resize (n);
+                for (auto& b : data[i])
+                    b = static_cast<std::uint8_t> (byte (gen));
+                for (auto& b : tags[i])
+                    b = static_cast<std::uint8_t> (byte (gen));
+                prefixes[i] = static_cast<std::uint32_t> (gen ());
+
+                if (i % 2)
+                    batch.add (results[i], prefixes[i],
+                        data[i].data (), data[i].size (), tags[i]);
+                else
+                    batch.add (results[i], prefixes[i],
+                        data[i].data (), data[i].size ());
+            }
+
+            expect (batch.size () == static_cast<std::size_t> (batchSize));
+            batch.finish ();
+
+            bool ok = true;
+            for (int i = 0; i < batchSize; ++i)
+                ok = ok && results[i] == reference (prefixes[i], data[i],
+                    (i % 2) ? &tags[i] : nullptr);
+            expect (ok, "batch of " + std::to_string (batchSize));
+        }
+
+        expect (SHA512HalfBatch::lanes () >= 1);
+    }
+
+    void run ()
+    {
+        testHasher ();
+        testBatch ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(SHA512Half,protocol,skywell);
+
+//------------------------------------------------------------------------------
+
+// Hashes 512 byte messages, the size of a serialized inner node, one at a
+// time and in batches. Run with --unittest=SHA512Half_bench
+class SHA512Half_bench_test : public beast::unit_test::suite
+{
+public:
+    void run ()
+    {
+        using clock_type = std::chrono::steady_clock;
+        int const count = 200000;
+
+        std::vector<std::uint8_t> data (512, 0x5a);
+        std::vector<uint256> results (count);
+
+        auto start = clock_type::now ();
+        for (int i = 0; i < count; ++i)
+        {
+            data[0] = static_cast<std::uint8_t> (i);
+            sha512_half_hasher h;
+            h.add32 (0x4D494E00);
+            h.append (data.data (), data.size ());
+            results[i] = static_cast<uint256> (h);
+        }
+        auto const single = std::chrono::duration<double> (
+            clock_type::now () - start).count ();
+
+        start = clock_type::now ();
+        {
+            SHA512HalfBatch batch;
+            for (int i = 0; i < count; ++i)
+                batch.add (results[i], 0x4D494E00, data.data (), data.size ());
+            batch.finish ();
+        }
+        auto const batched = std::chrono::duration<double> (
+            clock_type::now () - start).count ();
+
+        std::stringstream ss;
+        ss << "one at a time " << static_cast<int> (count / single) <<
+            " nodes/s, batched (" << SHA512HalfBatch::lanes () << " lanes) " <<
+            static_cast<int> (count / batched) << " nodes/s";
+        log << ss.str ();
+        pass ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(SHA512Half_bench,protocol,skywell);
+
+}
@@ -0,0 +1,193 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <crypto/CBigNum.h>
+#include <protocol/STAmount.h>
+#include <beast/unit_test/suite.h>
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace skywell {
+
+// (a * b + c) / d the way STAmount computed it before detail::mulDiv
+static
+std::uint64_t
+bigMulDiv (std::uint64_t a, std::uint64_t b, std::uint64_t c, std::uint64_t d)
+{
+    CBigNum v;
+
+    if ((BN_add_word64 (&v, a) != 1) ||
+            (BN_mul_word64 (&v, b) != 1) ||
+            (BN_add_word64 (&v, c) != 1) ||
+            (BN_div_word64 (&v, d) == ((std::uint64_t) - 1)))
+    {
+        throw std::runtime_error ("internal bn error");
+    }
+
+    return v.getuint64 ();
+}
+
+static std::uint64_t const tenTo14 = 100000000000000ull;
+static std::uint64_t const tenTo15 = 1000000000000000ull;
+static std::uint64_t const tenTo16 = 10000000000000000ull;
+static std::uint64_t const tenTo17 = 100000000000000000ull;
+
+class STAmount_test : public beast::unit_test::suite
+{
+public:
+    // Mantissas at and next to the ends of the canonical range
+    static std::vector<std::uint64_t> edges ()
+    {
+        return {
+            tenTo15, tenTo15 + 1, tenTo15 + 2,
+            2 * tenTo15, 3162277660168379ull, 5 * tenTo15 - 1,
+            tenTo16 - 3, tenTo16 - 2, tenTo16 - 1 };
+    }
+
+    bool check (std::uint64_t a, std::uint64_t b,
+        std::uint64_t c, std::uint64_t d)
+    {
+        return detail::mulDiv (a, b, c, d) == bigMulDiv (a, b, c, d);
+    }
+
+    // multiply and mulRound: (v1 * v2 [+ 10^14 - 1]) / 10^14
+    // divide and divRound:   (num * 10^17 [+ den - 1]) / den
+    void testEdges ()
+    {
+        testcase ("edges");
+
+        auto const values = edges ();
+        std::size_t mismatches = 0;
+
+        for (auto a : values)
+        {
+            for (auto b : values)
+            {
+                if (! check (a, b, 0, tenTo14))
+                    ++mismatches;
+                if (! check (a, b, tenTo14 - 1, tenTo14))
+                    ++mismatches;
+                if (! check (a, tenTo17, 0, b))
+                    ++mismatches;
+                if (! check (a, tenTo17, b - 1, b))
+                    ++mismatches;
+            }
+        }
+
+        expect (mismatches == 0,
+            std::to_string (mismatches) + " mismatches");
+    }
+
+    void testRandom ()
+    {
+        testcase ("random");
+
+        std::mt19937_64 gen (42);
+        std::uniform_int_distribution<std::uint64_t> mantissa (
+            tenTo15, tenTo16 - 1);
+
+        std::size_t mismatches = 0;
+        for (int i = 0; i < 250000; ++i)
+        {
+            std::uint64_t const a = mantissa (gen);
+            std::uint64_t const b = mantissa (gen);
+
+            if (! check (a, b, 0, tenTo14))
+                ++mismatches;
+            if (! check (a, b, tenTo14 - 1, tenTo14))
+                ++mismatches;
+            if (! check (a, tenTo17, 0, b))
+                ++mismatches;
+            if (! check (a, tenTo17, b - 1, b))
+                ++mismatches;
+        }
+
+        expect (mismatches == 0,
+            std::to_string (mismatches) + " mismatches");
+    }
+
+    void run ()
+    {
+        testEdges ();
+        testRandom ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(STAmount,protocol,skywell);
+
+//------------------------------------------------------------------------------
+
+// Times detail::mulDiv against the CBigNum arithmetic it replaced.
+// Run with --unittest=STAmount_bench
+class STAmount_bench_test : public beast::unit_test::suite
+{
+public:
+    template <class F>
+    double nanoseconds (std::vector<std::uint64_t> const& v, F f)
+    {
+        using clock_type = std::chrono::steady_clock;
+        std::uint64_t sum = 0;
+
+        auto const start = clock_type::now ();
+        for (std::size_t i = 0; i + 1 < v.size (); ++i)
+            sum += f (v[i], v[i + 1]);
+        auto const elapsed = clock_type::now () - start;
+
+        // Keep the loop from being optimized away
+        expect (sum != 0);
+        return std::chrono::duration<double, std::nano> (
+            elapsed).count () / (v.size () - 1);
+    }
+
+    void run ()
+    {
+        std::mt19937_64 gen (42);
+        std::uniform_int_distribution<std::uint64_t> mantissa (
+            tenTo15, tenTo16 - 1);
+
+        std::vector<std::uint64_t> v (1000000);
+        for (auto& x : v)
+            x = mantissa (gen);
+
+        auto const native = nanoseconds (v,
+            [](std::uint64_t a, std::uint64_t b)
+            {
+                return detail::mulDiv (a, b, tenTo14 - 1, tenTo14);
+            });
+
+        auto const big = nanoseconds (v,
+            [](std::uint64_t a, std::uint64_t b)
+            {
+                return bigMulDiv (a, b, tenTo14 - 1, tenTo14);
+            });
+
+        std::stringstream ss;
+        ss << "mulDiv " << native << " ns/op, CBigNum " << big << " ns/op";
+        log << ss.str ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(STAmount_bench,protocol,skywell);
+
+}
@@ -0,0 +1,246 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+
+#include <BeastConfig.h>
+#include <protocol/HashPrefix.h>
+#include <protocol/LedgerFormats.h>
+#include <protocol/STObject.h>
+#include <protocol/TxFormats.h>
+#include <beast/unit_test/suite.h>
+#include <chrono>
+#include <sstream>
+
+namespace skywell {
+
+class STObject_test : public beast::unit_test::suite
+{
+public:
+    static std::vector<SOTemplate const*> templates ()
+    {
+        std::vector<SOTemplate const*> result;
+        for (int type = 0; type < 256; ++type)
+        {
+            if (auto item = TxFormats::getInstance ().findByType (
+                    static_cast<TxType> (type)))
+                result.push_back (&item->elements);
+            if (auto item = LedgerFormats::getInstance ().findByType (
+                    static_cast<LedgerEntryType> (type)))
+                result.push_back (&item->elements);
+        }
+        return result;
+    }
+
+    static bool contains (SOTemplate const& t, SField const& f)
+    {
+        for (auto const& e : t.peek ())
+            if (e->e_field == f)
+                return true;
+        return false;
+    }
+
+    // A templated object resolves every field through the template's
+    // index table. Check it against the element order, and against the
+    // fields of every other template for absent ones.
+    void testTemplateIndex ()
+    {
+        testcase ("template index");
+
+        auto const all = templates ();
+        expect (! all.empty ());
+
+        for (auto t : all)
+        {
+            STObject const obj (*t, sfGeneric);
+            expect (! obj.isFree ());
+
+            int i = 0;
+            for (auto const& e : t->peek ())
+            {
+                expect (obj.getFieldIndex (e->e_field) == i,
+                    e->e_field.getName ());
+                expect (obj.getFieldSType (i) == e->e_field,
+                    e->e_field.getName ());
+                ++i;
+            }
+
+            for (auto other : all)
+            {
+                for (auto const& e : other->peek ())
+                {
+                    if (! contains (*t, e->e_field))
+                        expect (obj.getFieldIndex (e->e_field) == -1,
+                            e->e_field.getName ());
+                }
+            }
+        }
+    }
+
+    static STObject makePayment ()
+    {
+        STObject obj (TxFormats::getInstance ().findByType (
+            ttPAYMENT)->elements, sfTransaction);
+        obj.setFieldU16 (sfTransactionType, ttPAYMENT);
+        obj.setFieldU32 (sfFlags, 0x80000000);
+        obj.setFieldU32 (sfSequence, 17);
+        obj.setFieldU32 (sfDestinationTag, 42);
+        obj.setFieldAmount (sfAmount, STAmount (1000000));
+        obj.setFieldAmount (sfFee, STAmount (10));
+        obj.setFieldAccount (sfAccount, Account (1));
+        obj.setFieldAccount (sfDestination, Account (2));
+        return obj;
+    }
+
+    // A free object parsed from the same bytes searches its elements.
+    // Both must agree on every present field.
+    void testFreeIndex ()
+    {
+        testcase ("free index");
+
+        STObject const payment (makePayment ());
+        Serializer s;
+        payment.add (s);
+        SerialIter sit (s);
+        STObject const free (sit, sfTransaction);
+        expect (free.isFree ());
+
+        for (auto const& e : TxFormats::getInstance ().findByType (
+            ttPAYMENT)->elements.peek ())
+        {
+            SField const& f = e->e_field;
+            int const index = free.getFieldIndex (f);
+            if (payment.isFieldPresent (f))
+            {
+                expect (index >= 0 && free.getFieldSType (index) == f,
+                    f.getName ());
+                expect (free.peekAtField (f) == payment.peekAtField (f),
+                    f.getName ());
+            }
+            else
+            {
+                expect (index == -1, f.getName ());
+            }
+        }
+    }
+
+    static uint256 bufferedHash (STObject const& obj, std::uint32_t prefix,
+        bool withSigningFields)
+    {
+        Serializer s;
+        s.add32 (prefix);
+        obj.add (s, withSigningFields);
+        return s.getSHA512Half ();
+    }
+
+    // Hashes stream the canonical form into the hasher. They must match
+    // hashing the serialized bytes, whatever order the fields were set in.
+    void testHash ()
+    {
+        testcase ("hash");
+
+        STObject const payment (makePayment ());
+
+        // The same fields set in reverse, on a free object
+        STObject reversed (sfTransaction);
+        reversed.setFieldAccount (sfDestination, Account (2));
+        reversed.setFieldAccount (sfAccount, Account (1));
+        reversed.setFieldAmount (sfFee, STAmount (10));
+        reversed.setFieldAmount (sfAmount, STAmount (1000000));
+        reversed.setFieldU32 (sfDestinationTag, 42);
+        reversed.setFieldU32 (sfSequence, 17);
+        reversed.setFieldU32 (sfFlags, 0x80000000);
+        reversed.setFieldU16 (sfTransactionType, ttPAYMENT);
+        reversed.setFieldVL (sfTxnSignature, Blob (70, 0x30));
+
+        expect (reversed.getSigningHash (HashPrefix::txSign) ==
+            payment.getSigningHash (HashPrefix::txSign));
+
+        STObject const* const objects[] = {&payment, &reversed};
+        for (auto const obj : objects)
+        {
+            expect (obj->getHash (HashPrefix::transactionID) ==
+                bufferedHash (*obj, HashPrefix::transactionID, true));
+            expect (obj->getSigningHash (HashPrefix::txSign) ==
+                bufferedHash (*obj, HashPrefix::txSign, false));
+        }
+    }
+
+    void run ()
+    {
+        testTemplateIndex ();
+        testFreeIndex ();
+        testHash ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(STObject,protocol,skywell);
+
+//------------------------------------------------------------------------------
+
+// Field reads in the order the Payment transactor makes them, on a
+// templated and on a free object. Run with --unittest=STObject_bench
+class STObject_bench_test : public beast::unit_test::suite
+{
+public:
+    template <class Clock = std::chrono::steady_clock>
+    double measure (STObject const& tx, int count, std::uint64_t& sink)
+    {
+        auto const start = Clock::now ();
+        for (int i = 0; i < count; ++i)
+        {
+            sink += tx.getFieldU32 (sfFlags);
+            sink += tx.getFieldAccount160 (sfAccount).begin ()[0];
+            sink += tx.getFieldAccount160 (sfDestination).begin ()[0];
+            sink += tx.getFieldAmount (sfAmount).mantissa ();
+            sink += tx.isFieldPresent (sfSendMax);
+            sink += tx.isFieldPresent (sfPaths);
+            sink += tx.isFieldPresent (sfInvoiceID);
+            sink += tx.getFieldU32 (sfDestinationTag);
+            sink += tx.getFieldU32 (sfSequence);
+            sink += tx.getFieldAmount (sfFee).mantissa ();
+        }
+        std::chrono::duration<double> const elapsed = Clock::now () - start;
+        return elapsed.count () * 1e9 / (count * 10.0);
+    }
+
+    void run ()
+    {
+        int const count = 5000000;
+
+        STObject const payment (STObject_test::makePayment ());
+        Serializer s;
+        payment.add (s);
+        SerialIter sit (s);
+        STObject const free (sit, sfTransaction);
+
+        std::uint64_t sink = 0;
+        double const templated = measure (payment, count, sink);
+        double const searched = measure (free, count, sink);
+
+        std::stringstream ss;
+        ss << "templated " << templated << " ns/field, free " <<
+            searched << " ns/field (" << (sink & 1) << ")";
+        log << ss.str ();
+        pass ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(STObject_bench,protocol,skywell);
+
+}
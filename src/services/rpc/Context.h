@@ -32,6 +32,8 @@ class NetworkOPs;
 
 namespace RPC {
 
+class LedgerCache;
+
 /** The context of information needed to call an RPC. */
 struct Context
 {
@@ -42,6 +44,9 @@ struct Context
     InfoSub::pointer infoSub;
     RPC::Yield yield;
     NodeStore::ScopedMetrics metrics;
+
+    // When set, named ledgers are looked up through this cache
+    LedgerCache* ledgers;
 };
 
 } // RPC
@@ -41,7 +41,7 @@ Json::Value doAccountInfo (RPC::Context& context)
     auto& params = context.params;
 
     Ledger::pointer ledger;
-    Json::Value result = RPC::lookupLedger (params, ledger, context.netOps);
+    Json::Value result = RPC::lookupLedger (params, ledger, context);
 
     if (!ledger)
         return result;
@@ -86,7 +86,7 @@ Json::Value doNicknameInfo(RPC::Context& context)
 {
 	auto& params = context.params;
 	Ledger::pointer ledger;
-	Json::Value result = RPC::lookupLedger(params, ledger, context.netOps);
+	Json::Value result = RPC::lookupLedger(params, ledger, context);
 	if (!ledger)
 		return result;
 
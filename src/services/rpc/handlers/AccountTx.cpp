@@ -30,6 +30,7 @@
 #include <services/rpc/impl/LookupLedger.h>
 #include <network/resource/Fees.h>
 #include <services/rpc/RPCHandler.h>
+#include <services/rpc/handlers/AccountTx.h>
 #include <common/json/to_string.h>
 
 namespace skywell {
@@ -126,21 +127,16 @@ namespace skywell {
     //   limit: integer,                 // optional
     //   marker: opaque                  // optional, resume previous query
     // }
-    Json::Value doAccountTx(RPC::Context& context)
+    Json::Value parseAccountTx(RPC::Context& context, AccountTxRequest& request)
     {
         auto& params = context.params;
 
-        SkywellAddress   raAccount;
-        int limit = params.isMember(jss::limit) ?
+        request.limit = params.isMember(jss::limit) ?
             params[jss::limit].asUInt() : -1;
-        bool bBinary = params.isMember(jss::binary) && params[jss::binary].asBool();
-        bool bForward = params.isMember(jss::forward) && params[jss::forward].asBool();
-        std::uint32_t   uLedgerMin;
-        std::uint32_t   uLedgerMax;
-        std::uint32_t   uValidatedMin;
-        std::uint32_t   uValidatedMax;
+        request.binary = params.isMember(jss::binary) && params[jss::binary].asBool();
+        request.forward = params.isMember(jss::forward) && params[jss::forward].asBool();
         bool bValidated = context.netOps.getValidatedRange(
-            uValidatedMin, uValidatedMax);
+            request.validatedMin, request.validatedMax);
 
         if (!bValidated)
         {
@@ -151,7 +147,7 @@ namespace skywell {
         if (!params.isMember(jss::account))
             return rpcError(rpcINVALID_PARAMS);
 
-        if (!raAccount.setAccountID(params[jss::account].asString()))
+        if (!request.account.setAccountID(params[jss::account].asString()))
             return rpcError(rpcACT_MALFORMED);
 
         context.loadType = Resource::feeMediumBurdenRPC;
@@ -164,29 +160,49 @@ namespace skywell {
             std::int64_t iLedgerMax = params.isMember(jss::ledger_index_max)
                 ? params[jss::ledger_index_max].asInt() : -1;
 
-            uLedgerMin = iLedgerMin == -1 ? uValidatedMin :
-                ((iLedgerMin >= uValidatedMin) ? iLedgerMin : uValidatedMin);
-            uLedgerMax = iLedgerMax == -1 ? uValidatedMax :
-                ((iLedgerMax <= uValidatedMax) ? iLedgerMax : uValidatedMax);
+            request.ledgerMin = iLedgerMin == -1 ? request.validatedMin :
+                ((iLedgerMin >= request.validatedMin) ? iLedgerMin : request.validatedMin);
+            request.ledgerMax = iLedgerMax == -1 ? request.validatedMax :
+                ((iLedgerMax <= request.validatedMax) ? iLedgerMax : request.validatedMax);
 
-            if (uLedgerMax < uLedgerMin)
+            if (request.ledgerMax < request.ledgerMin)
                 return rpcError(rpcLGR_IDXS_INVALID);
         }
         else
         {
             Ledger::pointer l;
-            Json::Value ret = RPC::lookupLedger(params, l, context.netOps);
+            Json::Value ret = RPC::lookupLedger(params, l, context);
 
             if (!l)
                 return ret;
 
-            uLedgerMin = uLedgerMax = l->getLedgerSeq();
+            request.ledgerMin = request.ledgerMax = l->getLedgerSeq();
         }
 
-        Json::Value resumeToken;
-
         if (params.isMember(jss::marker))
-            resumeToken = params[jss::marker];
+            request.marker = params[jss::marker];
+
+        return Json::Value();
+    }
+
+    Json::Value doAccountTx(RPC::Context& context)
+    {
+        auto& params = context.params;
+
+        AccountTxRequest request;
+        Json::Value error = parseAccountTx(context, request);
+
+        if (!error.isNull())
+            return error;
+
+        SkywellAddress const& raAccount = request.account;
+        int limit = request.limit;
+        bool bBinary = request.binary;
+        bool bForward = request.forward;
+        std::uint32_t   uLedgerMin = request.ledgerMin;
+        std::uint32_t   uLedgerMax = request.ledgerMax;
+
+        Json::Value resumeToken = request.marker;
 
 #ifndef BEAST_DEBUG
 
@@ -214,9 +230,9 @@ namespace skywell {
                     std::uint32_t uLedgerIndex = std::get<2>(it);
 
                     jvObj[jss::ledger_index] = uLedgerIndex;
-                    jvObj[jss::validated] = bValidated &&
-                        uValidatedMin <= uLedgerIndex &&
-                        uValidatedMax >= uLedgerIndex;
+                    jvObj[jss::validated] =
+                        request.validatedMin <= uLedgerIndex &&
+                        request.validatedMax >= uLedgerIndex;
                 }
             }
             else
@@ -259,9 +275,9 @@ namespace skywell {
 
                         std::uint32_t uLedgerIndex = it.second->getLgrSeq();
 
-                        jvObj[jss::validated] = bValidated &&
-                            uValidatedMin <= uLedgerIndex &&
-                            uValidatedMax >= uLedgerIndex;
+                        jvObj[jss::validated] =
+                            request.validatedMin <= uLedgerIndex &&
+                            request.validatedMax >= uLedgerIndex;
                     }
                 }
             }
@@ -286,4 +302,50 @@ namespace skywell {
 #endif
     }
 
+namespace RPC {
+
+    Status AccountTxHandler::check()
+    {
+        auto const& params = context_.params;
+
+        // Binary requests in the current form are streamed
+        if (!isAccountTxOld(params) &&
+            params.isMember(jss::binary) && params[jss::binary].asBool())
+        {
+            result_ = parseAccountTx(context_, request_);
+            stream_ = result_.isNull();
+        }
+
+        if (stream_)
+        {
+            AccountTxRequest const& r = request_;
+            token_ = r.marker;
+
+            try
+            {
+                context_.netOps.visitTxsAccountB(r.account, r.ledgerMin,
+                    r.ledgerMax, r.forward, token_, r.limit,
+                    context_.role == Role::ADMIN,
+                    [&](std::uint32_t ledgerIndex,
+                        std::string const& rawTxn,
+                        std::string const& rawMeta)
+                    {
+                        rows_.push_back({ledgerIndex, rawTxn, rawMeta});
+                    });
+            }
+            catch (std::exception const& e)
+            {
+                WriteLog(lsINFO, AccountTx) << "Caught throw: " << e.what();
+                return rpcINTERNAL;
+            }
+        }
+
+        if (!stream_ && result_.isNull())
+            result_ = doAccountTxSwitch(context_);
+
+        return Status();
+    }
+
+} // RPC
+
 } // skywell
@@ -0,0 +1,165 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012-2014 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef SKYWELL_RPC_HANDLERS_ACCOUNTTX_H_INCLUDED
+#define SKYWELL_RPC_HANDLERS_ACCOUNTTX_H_INCLUDED
+
+#include <common/base/strHex.h>
+#include <common/json/Object.h>
+#include <common/misc/NetworkOPs.h>
+#include <protocol/JsonFields.h>
+#include <protocol/SkywellAddress.h>
+#include <services/rpc/Context.h>
+#include <services/rpc/Status.h>
+#include <services/rpc/impl/Handler.h>
+#include <string>
+#include <vector>
+
+namespace skywell {
+
+/** The parameters of an account_tx request. */
+struct AccountTxRequest
+{
+    SkywellAddress account;
+    int limit = -1;
+    bool binary = false;
+    bool forward = false;
+    std::uint32_t ledgerMin = 0;
+    std::uint32_t ledgerMax = 0;
+    std::uint32_t validatedMin = 0;
+    std::uint32_t validatedMax = 0;
+    Json::Value marker;
+};
+
+/** Parse and check the parameters of an account_tx request.
+    Returns a null value on success, otherwise the error to report.
+*/
+Json::Value parseAccountTx (RPC::Context&, AccountTxRequest&);
+
+/** Returns `true` if the request uses the parameters of the old account_tx. */
+bool isAccountTxOld (Json::Value const& params);
+
+Json::Value doAccountTxSwitch (RPC::Context&);
+
+namespace RPC {
+
+/** account_tx.
+
+    Binary requests read the raw rows of the page in check (), so a
+    database error is reported as rpcINTERNAL instead of a partial result.
+    writeResult then hex encodes one transaction at a time: with a
+    streaming server the encoded blobs go directly into the response and
+    no encoded copy of the page is held in memory. All other requests are
+    answered by doAccountTxSwitch.
+*/
+class AccountTxHandler
+{
+public:
+    explicit AccountTxHandler (Context& context)
+        : context_ (context)
+    {
+    }
+
+    Status check ();
+
+    template <class Object>
+    void writeResult (Object&);
+
+    static char const* name ()
+    {
+        return "account_tx";
+    }
+
+    static Role role ()
+    {
+        return Role::USER;
+    }
+
+    static Condition condition ()
+    {
+        return NO_CONDITION;
+    }
+
+private:
+    struct Row
+    {
+        std::uint32_t ledgerIndex;
+        std::string txn;
+        std::string meta;
+    };
+
+    Context& context_;
+    bool stream_ = false;
+    AccountTxRequest request_;
+    Json::Value result_;
+    Json::Value token_;
+    std::vector <Row> rows_;
+};
+
+template <class Object>
+void AccountTxHandler::writeResult (Object& object)
+{
+    if (! stream_)
+    {
+        copyFrom (object, result_);
+        return;
+    }
+
+    AccountTxRequest const& r = request_;
+
+    object[jss::account] = r.account.humanAccountID ();
+
+    {
+        auto&& transactions = Json::setArray (object, jss::transactions);
+
+        // Reused for every blob, so encoding does not allocate per row
+        std::string hex;
+
+        for (auto const& row : rows_)
+        {
+            auto&& tx = Json::appendObject (transactions);
+
+            hex.clear ();
+            appendHex (hex, row.txn.data (), row.txn.size ());
+            tx[jss::tx_blob] = hex;
+
+            hex.clear ();
+            appendHex (hex, row.meta.data (), row.meta.size ());
+            tx[jss::meta] = hex;
+
+            tx[jss::ledger_index] = row.ledgerIndex;
+            tx[jss::validated] = r.validatedMin <= row.ledgerIndex &&
+                r.validatedMax >= row.ledgerIndex;
+        }
+    }
+
+    object[jss::ledger_index_min] = r.ledgerMin;
+    object[jss::ledger_index_max] = r.ledgerMax;
+
+    if (context_.params.isMember (jss::limit))
+        object[jss::limit] = r.limit;
+
+    if (! token_.isNull ())
+        object[jss::marker] = token_;
+}
+
+} // RPC
+} // skywell
+
+#endif
@@ -110,7 +110,7 @@ Json::Value doAccountTxOld (RPC::Context& context)
     else
     {
         Ledger::pointer l;
-        Json::Value ret = RPC::lookupLedger (context.params, l, context.netOps);
+        Json::Value ret = RPC::lookupLedger (context.params, l, context);
 
         if (!l)
             return ret;
@@ -21,17 +21,23 @@
 #include <services/rpc/Context.h>
 #include <protocol/JsonFields.h>
 #include <services/rpc/handlers/Handlers.h>
+#include <services/rpc/handlers/AccountTx.h>
 
 namespace skywell {
 
+bool isAccountTxOld (Json::Value const& params)
+{
+    return params.isMember(jss::offset) ||
+        params.isMember(jss::count) ||
+        params.isMember(jss::descending) ||
+        params.isMember(jss::ledger_max) ||
+        params.isMember(jss::ledger_min);
+}
+
 // Temporary switching code until the old account_tx is removed
 Json::Value doAccountTxSwitch (RPC::Context& context)
 {
-    if (context.params.isMember(jss::offset) ||
-        context.params.isMember(jss::count) ||
-        context.params.isMember(jss::descending) ||
-        context.params.isMember(jss::ledger_max) ||
-        context.params.isMember(jss::ledger_min))
+    if (isAccountTxOld (context.params))
     {
         return doAccountTxOld(context);
     }
@@ -29,6 +29,9 @@ Json::Value doLedgerCleaner         (RPC::Context&);
 Json::Value doLedgerClosed          (RPC::Context&);
 Json::Value doLedgerCurrent         (RPC::Context&);
 Json::Value doLedgerData            (RPC::Context&);
+Json::Value doLedgerMemory          (RPC::Context&);
+Json::Value doLedgerSnapshot        (RPC::Context&);
+Json::Value doLedgerTiming          (RPC::Context&);
 Json::Value doServerInfo            (RPC::Context&); // for humans
 Json::Value doServerState           (RPC::Context&); // for machines
 Json::Value doStop                  (RPC::Context&);
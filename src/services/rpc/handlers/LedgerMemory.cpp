@@ -0,0 +1,39 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012-2014 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <services/rpc/Context.h>
+#include <main/Application.h>
+#include <ledger/LedgerMaster.h>
+
+namespace skywell {
+
+// {
+// }
+//
+// Reports the memory held by each ledger in the history cache: the tree
+// nodes no other retained ledger holds, and the nodes releasing it frees
+// once the older ledgers are released too. The pinned ledgers (validated
+// and published) are listed separately.
+Json::Value doLedgerMemory (RPC::Context&)
+{
+    return getApp().getLedgerMaster().getHistoryMemoryJson ();
+}
+
+} // skywell
@@ -0,0 +1,133 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012-2014 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <ledger/LedgerSnapshot.h>
+#include <protocol/JsonFields.h>
+#include <protocol/ErrorCodes.h>
+#include <services/rpc/Context.h>
+#include <services/rpc/impl/LookupLedger.h>
+#include <common/core/ConfigSections.h>
+#include <common/core/JobQueue.h>
+#include <main/Application.h>
+#include <boost/filesystem.hpp>
+#include <fstream>
+
+namespace skywell {
+
+// A bare file name: no directories, nothing that could step out of the
+// snapshot directory
+static bool isSnapshotName (std::string const& name)
+{
+    return !name.empty () &&
+        name.find_first_of ("/\\:") == std::string::npos &&
+        name.find ("..") == std::string::npos;
+}
+
+// Written to a temporary file that is renamed when complete, so a reader
+// never sees a partial snapshot.
+static void writeLedgerSnapshot (Ledger::pointer const& ledger,
+    boost::filesystem::path const& path, bool compress)
+{
+    boost::filesystem::path const temp = path.string () + ".partial";
+
+    try
+    {
+        {
+            std::ofstream out (temp.string ().c_str (),
+                std::ios::out | std::ios::binary | std::ios::trunc);
+
+            if (!out)
+                throw std::runtime_error ("Unable to open " + temp.string ());
+
+            exportLedgerSnapshot (*ledger, out, compress);
+        }
+
+        boost::filesystem::rename (temp, path);
+
+        WriteLog (lsINFO, LedgerSnapshot) << "Wrote ledger "
+            << ledger->getLedgerSeq () << " to " << path.string ();
+    }
+    catch (std::exception const& e)
+    {
+        WriteLog (lsWARNING, LedgerSnapshot) << "Unable to write "
+            << path.string () << ": " << e.what ();
+
+        boost::system::error_code ec;
+        boost::filesystem::remove (temp, ec);
+    }
+}
+
+// {
+//   ledger_hash : <ledger>
+//   ledger_index : <ledger_index>
+//   path : <file name, in [ledger_snapshot_dir]>
+//   compress : <bool>              // optional, defaults to true
+// }
+//
+// The snapshot is written by a background job; the file appears under its
+// name once it is complete.
+Json::Value doLedgerSnapshot (RPC::Context& context)
+{
+    boost::filesystem::path const dir = getConfig ().getLedgerSnapshotDir ();
+
+    if (dir.empty ())
+        return RPC::make_error (rpcNOT_ENABLED,
+            "No [" SECTION_LEDGER_SNAPSHOT_DIR "] configured.");
+
+    if (!context.params.isMember (jss::path))
+        return RPC::missing_field_error (jss::path);
+
+    if (!context.params[jss::path].isString () ||
+        !isSnapshotName (context.params[jss::path].asString ()))
+        return RPC::invalid_field_error (jss::path);
+
+    Ledger::pointer ledger;
+    Json::Value jvResult = RPC::lookupLedger (
+        context.params, ledger, context);
+
+    if (!ledger)
+        return jvResult;
+
+    if (!ledger->isClosed ())
+        return RPC::make_param_error ("Ledger is not closed.");
+
+    bool const compress = !context.params.isMember (jss::compress) ||
+        context.params[jss::compress].asBool ();
+    boost::filesystem::path const path =
+        dir / context.params[jss::path].asString ();
+
+    boost::system::error_code ec;
+    boost::filesystem::create_directories (dir, ec);
+
+    if (ec)
+        return RPC::make_error (rpcINTERNAL,
+            "Unable to create " + dir.string ());
+
+    getApp ().getJobQueue ().addJob (jtADMIN, "ledgerSnapshot",
+        [ledger, path, compress] (Job&)
+        {
+            writeLedgerSnapshot (ledger, path, compress);
+        });
+
+    jvResult[jss::path] = path.string ();
+    return jvResult;
+}
+
+} // skywell
@@ -20,6 +20,7 @@
 #include <BeastConfig.h>
 #include <services/rpc/impl/Handler.h>
 #include <services/rpc/handlers/Handlers.h>
+#include <services/rpc/handlers/AccountTx.h>
 #include <services/rpc/handlers/Ledger.h>
 #include <services/rpc/handlers/Version.h>
 
@@ -67,6 +68,7 @@ class HandlerTable {
         }
 
         // This is where the new-style handlers are added.
+        addHandler<AccountTxHandler>();
         addHandler<LedgerHandler>();
         addHandler<VersionHandler>();
     }
@@ -99,11 +101,13 @@ HandlerTable HANDLERS({
     // Some handlers not specified here are added to the table via addHandler()
     // Request-response methods
     {   "account_info",         byRef (&doAccountInfo),         Role::USER,  NO_CONDITION  },
-    {   "account_tx",           byRef (&doAccountTxSwitch),     Role::USER,  NO_CONDITION  },
     {   "ledger_accept",        byRef (&doLedgerAccept),        Role::ADMIN,   NEEDS_CURRENT_LEDGER  },
     {   "ledger_cleaner",       byRef (&doLedgerCleaner),       Role::ADMIN,   NEEDS_NETWORK_CONNECTION  },
     {   "ledger_closed",        byRef (&doLedgerClosed),        Role::USER,  NO_CONDITION   },
     {   "ledger_current",       byRef (&doLedgerCurrent),       Role::USER,  NEEDS_CURRENT_LEDGER  },
+    {   "ledger_memory",        byRef (&doLedgerMemory),        Role::ADMIN,   NO_CONDITION  },
+    {   "ledger_snapshot",      byRef (&doLedgerSnapshot),      Role::ADMIN,   NO_CONDITION  },
+    {   "ledger_timing",        byRef (&doLedgerTiming),        Role::ADMIN,   NO_CONDITION  },
     {   "submit",               byRef (&doSubmit),              Role::USER,  NEEDS_CURRENT_LEDGER  },
     {   "server_info",          byRef (&doServerInfo),          Role::USER,  NO_CONDITION     },
     {   "server_state",         byRef (&doServerState),         Role::USER,  NO_CONDITION     },
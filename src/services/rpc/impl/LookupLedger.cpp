@@ -34,6 +34,7 @@
 #include <services/rpc/impl/LegacyPathFind.h>
 #include <services/net/RPCErr.h>
 #include <services/rpc/Status.h>
+#include <services/rpc/impl/LookupLedger.h>
 #include <main/Application.h>
 
 
@@ -54,7 +55,8 @@ bool isValidatedOld ()
 Status ledgerFromRequest (
     Json::Value const& params,
     Ledger::pointer& ledger,
-    NetworkOPs& netOps)
+    NetworkOPs& netOps,
+    LedgerCache* cache)
 {
     static auto const minSequenceGap = 10;
 
@@ -107,7 +109,8 @@ Status ledgerFromRequest (
         auto const index = indexValue.asString ();
         if (index == "validated")
         {
-            ledger = netOps.getValidatedLedger ();
+            ledger = cache ? cache->getValidatedLedger ()
+                : netOps.getValidatedLedger ();
             if (ledger == nullptr)
                 return {rpcNO_NETWORK, "InsufficientNetworkMode"};
 
@@ -117,12 +120,14 @@ Status ledgerFromRequest (
         {
             if (index.empty () || index == "current")
             {
-                ledger = netOps.getCurrentLedger ();
+                ledger = cache ? cache->getCurrentLedger ()
+                    : netOps.getCurrentLedger ();
                 assert (! ledger->isClosed ());
             }
             else if (index == "closed")
             {
-                ledger = netOps.getClosedLedger ();
+                ledger = cache ? cache->getClosedLedger ()
+                    : netOps.getClosedLedger ();
                 assert (ledger->isClosed ());
             }
             else
@@ -177,8 +182,59 @@ bool isValidated (Ledger& ledger)
     return true;
 }
 
+Status lookupLedger (
+    Json::Value const& params,
+    Ledger::pointer& ledger,
+    NetworkOPs& netOps,
+    LedgerCache* cache,
+    Json::Value& jsonResult)
+{
+    if (auto status = ledgerFromRequest (params, ledger, netOps, cache))
+        return status;
+
+    if (ledger->isClosed ())
+    {
+        jsonResult[jss::ledger_hash] = to_string (ledger->getHash());
+        jsonResult[jss::ledger_index] = ledger->getLedgerSeq();
+    }
+    else
+    {
+        jsonResult[jss::ledger_current_index] = ledger->getLedgerSeq();
+    }
+    jsonResult[jss::validated] = isValidated (*ledger);
+    return Status::OK;
+}
+
 } // namespace
 
+Ledger::pointer
+LedgerCache::get (Ledger::pointer& slot,
+    Ledger::pointer (NetworkOPs::*fetch) ())
+{
+    std::lock_guard <std::mutex> lock (mutex_);
+    if (! slot)
+        slot = (netOps_.*fetch) ();
+    return slot;
+}
+
+Ledger::pointer
+LedgerCache::getCurrentLedger ()
+{
+    return get (current_, &NetworkOPs::getCurrentLedger);
+}
+
+Ledger::pointer
+LedgerCache::getClosedLedger ()
+{
+    return get (closed_, &NetworkOPs::getClosedLedger);
+}
+
+Ledger::pointer
+LedgerCache::getValidatedLedger ()
+{
+    return get (validated_, &NetworkOPs::getValidatedLedger);
+}
+
 // The previous version of the lookupLedger command would accept the
 // "ledger_index" argument as a string and silently treat it as a request to
 // return the current ledger which, while not strictly wrong, could cause a lot
@@ -204,20 +260,17 @@ Status lookupLedger (
     NetworkOPs& netOps,
     Json::Value& jsonResult)
 {
-    if (auto status = ledgerFromRequest (params, ledger, netOps))
-        return status;
+    return lookupLedger (params, ledger, netOps, nullptr, jsonResult);
+}
 
-    if (ledger->isClosed ())
-    {
-        jsonResult[jss::ledger_hash] = to_string (ledger->getHash());
-        jsonResult[jss::ledger_index] = ledger->getLedgerSeq();
-    }
-    else
-    {
-        jsonResult[jss::ledger_current_index] = ledger->getLedgerSeq();
-    }
-    jsonResult[jss::validated] = isValidated (*ledger);
-    return Status::OK;
+Status lookupLedger (
+    Json::Value const& params,
+    Ledger::pointer& ledger,
+    Context& context,
+    Json::Value& jsonResult)
+{
+    return lookupLedger (
+        params, ledger, context.netOps, context.ledgers, jsonResult);
 }
 
 Json::Value lookupLedger (
@@ -232,5 +285,17 @@ Json::Value lookupLedger (
     return value;
 }
 
+Json::Value lookupLedger (
+    Json::Value const& params,
+    Ledger::pointer& ledger,
+    Context& context)
+{
+    Json::Value value (Json::objectValue);
+    if (auto status = lookupLedger (params, ledger, context, value))
+        status.inject (value);
+
+    return value;
+}
+
 } // RPC
 } // skywell
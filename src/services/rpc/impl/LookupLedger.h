@@ -20,12 +20,48 @@
 #ifndef SKYWELL_RPC_LOOKUPLEDGER_H_INCLUDED
 #define SKYWELL_RPC_LOOKUPLEDGER_H_INCLUDED
 
+#include <services/rpc/Context.h>
 #include <services/rpc/Status.h>
 #include <ledger/Ledger.h>
 #include <common/misc/NetworkOPs.h>
+#include <mutex>
+
 namespace skywell {
 namespace RPC {
 
+/** The current, closed and validated ledgers, each fetched once.
+
+    The requests of a JSON-RPC batch share one of these, through their
+    Context, so they all see the same ledgers and only the first request
+    naming a ledger pays for looking it up.
+*/
+class LedgerCache
+{
+public:
+    explicit
+    LedgerCache (NetworkOPs& netOps)
+        : netOps_ (netOps)
+    {
+    }
+
+    LedgerCache (LedgerCache const&) = delete;
+    LedgerCache& operator= (LedgerCache const&) = delete;
+
+    Ledger::pointer getCurrentLedger ();
+    Ledger::pointer getClosedLedger ();
+    Ledger::pointer getValidatedLedger ();
+
+private:
+    Ledger::pointer get (Ledger::pointer& slot,
+        Ledger::pointer (NetworkOPs::*fetch) ());
+
+    NetworkOPs& netOps_;
+    std::mutex mutex_;
+    Ledger::pointer current_;
+    Ledger::pointer closed_;
+    Ledger::pointer validated_;
+};
+
 /** Look up a ledger from a request and fill a Json::Result with either
     an error, or data representing a ledger.
 
@@ -45,6 +81,18 @@ Status lookupLedger (
     NetworkOPs&,
     Json::Value& result);
 
+/** Look up a ledger as above, through the context's ledger cache if it
+    has one.
+*/
+Json::Value lookupLedger (
+    Json::Value const& request, Ledger::pointer&, Context&);
+
+Status lookupLedger (
+    Json::Value const& request,
+    Ledger::pointer&,
+    Context&,
+    Json::Value& result);
+
 } // RPC
 } // skywell
 
@@ -69,6 +69,18 @@ public:
         overlay_t overlay;
         RPC::YieldStrategy yieldStrategy;
 
+        // Limits on JSON-RPC batch requests
+        struct batch_t
+        {
+            // Most requests in one batch
+            std::size_t limit = 100;
+
+            // Most load, in Resource::Charge units, one batch may cost
+            int costLimit = 1000;
+        };
+
+        batch_t batch;
+
         void
         makeContexts();
     };
@@ -0,0 +1,176 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <services/server/impl/JSONRPCBatch.h>
+#include <protocol/ErrorCodes.h>
+#include <protocol/JsonFields.h>
+
+namespace skywell {
+
+JSONRPCBatch::JSONRPCBatch (Json::Value& requests, int costLimit)
+    : next_ (0)
+    , cost_ (0)
+    , costLimit_ (costLimit)
+    , done_ (0)
+{
+    requests_.reserve (requests.size ());
+    for (Json::UInt i = 0; i < requests.size (); ++i)
+        requests_.push_back (std::move (requests[i]));
+    replies_.resize (requests_.size ());
+}
+
+void
+JSONRPCBatch::run (Process const& process)
+{
+    auto const size = requests_.size ();
+
+    for (;;)
+    {
+        auto const i = next_++;
+        if (i >= size)
+            return;
+
+        replies_[i] = runOne (requests_[i], process);
+
+        std::function <void ()> resume;
+        {
+            std::lock_guard <std::mutex> lock (mutex_);
+            if (++done_ != size)
+                continue;
+
+            cond_.notify_all ();
+            resume = std::move (resume_);
+            resume_ = nullptr;
+        }
+
+        if (resume)
+            resume ();
+    }
+}
+
+// What would be an HTTP error for a single request is an RPC error in the
+// request's reply
+Json::Value
+JSONRPCBatch::runOne (Json::Value& request, Process const& process)
+{
+    Json::Value reply (Json::objectValue);
+
+    auto error = [&] (Json::Value result) -> Json::Value
+    {
+        result[jss::status] = jss::error;
+        result[jss::request] = std::move (request);
+        reply[jss::result] = std::move (result);
+        return std::move (reply);
+    };
+
+    if (! request.isObject ())
+        return error (RPC::make_param_error ("request is not an object"));
+
+    // Look members up through a const reference, which does not add them
+    Json::Value const& fields = request;
+
+    if (fields.isMember (jss::id))
+        reply[jss::id] = fields[jss::id];
+
+    Json::Value const& method = fields[jss::method];
+
+    if (method.isNull ())
+        return error (RPC::make_param_error ("Null method"));
+
+    if (! method.isString ())
+        return error (RPC::make_param_error ("method is not string"));
+
+    Request r;
+    r.method = method.asString ();
+    if (r.method.empty ())
+        return error (RPC::make_param_error ("method is empty"));
+
+    Json::Value const& params = fields[jss::params];
+
+    if (params.isNull () || params.empty ())
+        r.params = Json::Value (Json::objectValue);
+    else if (! params.isArray () || params.size () != 1 ||
+            ! params[0u].isObject ())
+        return error (RPC::make_param_error ("params unparseable"));
+    else
+        r.params = std::move (request[jss::params][0u]);
+
+    Json::Value result = process (r);
+
+    if (result.isMember (jss::error))
+    {
+        result[jss::status] = jss::error;
+        result[jss::request] = std::move (r.params);
+    }
+    else
+    {
+        result[jss::status] = jss::success;
+    }
+
+    reply[jss::result] = std::move (result);
+    return reply;
+}
+
+bool
+JSONRPCBatch::reserve (int cost)
+{
+    // Reserving before the check keeps concurrent requests from all
+    // passing it and going over the limit together
+    if (cost_.fetch_add (cost) + cost > costLimit_)
+    {
+        cost_ -= cost;
+        return false;
+    }
+    return true;
+}
+
+void
+JSONRPCBatch::settle (int reserved, int charged)
+{
+    cost_ += charged - reserved;
+}
+
+bool
+JSONRPCBatch::finished (std::function <void ()> const& resume)
+{
+    std::lock_guard <std::mutex> lock (mutex_);
+    if (done_ == requests_.size ())
+        return true;
+    resume_ = resume;
+    return false;
+}
+
+void
+JSONRPCBatch::wait ()
+{
+    std::unique_lock <std::mutex> lock (mutex_);
+    cond_.wait (lock, [this] { return done_ == requests_.size (); });
+}
+
+Json::Value
+JSONRPCBatch::replies ()
+{
+    Json::Value reply (Json::arrayValue);
+    for (auto& r : replies_)
+        reply.append (std::move (r));
+    return reply;
+}
+
+} // skywell
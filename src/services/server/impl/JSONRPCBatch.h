@@ -0,0 +1,118 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef SKYWELL_SERVER_JSONRPCBATCH_H_INCLUDED
+#define SKYWELL_SERVER_JSONRPCBATCH_H_INCLUDED
+
+#include <common/json/json_value.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace skywell {
+
+/** The requests of a JSON-RPC batch and their replies.
+
+    Any number of threads may run the batch; each claims the next request
+    not yet taken. A reply goes in the slot of its request, so the replies
+    are in request order whatever order the requests finish in. A request
+    that is malformed or fails gets an error reply in its slot and the
+    rest of the batch still runs.
+*/
+class JSONRPCBatch
+{
+public:
+    /** A well formed request: its method and its params object. */
+    struct Request
+    {
+        std::string method;
+        Json::Value params;
+    };
+
+    /** Runs one request and returns its result. */
+    using Process = std::function <Json::Value (Request&)>;
+
+    /** Take the requests out of a JSON array.
+
+        @param costLimit The most load the batch may reserve, see reserve().
+    */
+    JSONRPCBatch (Json::Value& requests, int costLimit);
+
+    JSONRPCBatch (JSONRPCBatch const&) = delete;
+    JSONRPCBatch& operator= (JSONRPCBatch const&) = delete;
+
+    std::size_t
+    size () const
+    {
+        return requests_.size ();
+    }
+
+    /** Run requests until none are left unclaimed. */
+    void
+    run (Process const& process);
+
+    /** Reserve load for a request about to run.
+
+        @return `false`, reserving nothing, if the batch would go over
+                its cost limit.
+    */
+    bool
+    reserve (int cost);
+
+    /** Replace a reservation with the load the request was charged. */
+    void
+    settle (int reserved, int charged);
+
+    /** Returns `true` if every request has run. Otherwise `resume` is
+        called, once, by the thread that finishes the last request.
+    */
+    bool
+    finished (std::function <void ()> const& resume);
+
+    /** Block until every request has run. */
+    void
+    wait ();
+
+    /** Move the replies into a JSON array. */
+    Json::Value
+    replies ();
+
+private:
+    Json::Value
+    runOne (Json::Value& request, Process const& process);
+
+    std::vector <Json::Value> requests_;
+    std::vector <Json::Value> replies_;
+    std::atomic <std::size_t> next_;
+    std::atomic <int> cost_;
+    int const costLimit_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::size_t done_;
+    std::function <void ()> resume_;
+};
+
+} // skywell
+
+#endif
@@ -32,19 +32,38 @@ unsigned int const gMaxHTTPHeaderSize = 0x02000000;
 
 std::string getHTTPHeaderTimestamp ()
 {
-    // CHECKME This is probably called often enough that optimizing it makes
-    //         sense. There's no point in doing all this work if this function
-    //         gets called multiple times a second.
-    char buffer[96];
+    // Every reply carries this header, so each thread formats it at most
+    // once a second.
+    static thread_local time_t lastWhen = 0;
+    static thread_local std::string lastHeader;
+
     time_t now;
     time (&now);
-	//struct tm now_gmt;
-	struct tm *now_gmt = gmtime(&now);
-	//gmtime_s( &now_gmt, &now);
-    strftime (buffer, sizeof (buffer),
-        "Date: %a, %d %b %Y %H:%M:%S +0000\r\n",
-        now_gmt);
-    return std::string (buffer);
+
+    if (now != lastWhen || lastHeader.empty ())
+    {
+        char buffer[96];
+        struct tm now_gmt;
+#ifdef _WIN32
+        gmtime_s (&now_gmt, &now);
+#else
+        gmtime_r (&now, &now_gmt);
+#endif
+        strftime (buffer, sizeof (buffer),
+            "Date: %a, %d %b %Y %H:%M:%S +0000\r\n",
+            &now_gmt);
+        lastHeader = buffer;
+        lastWhen = now;
+    }
+
+    return lastHeader;
+}
+
+static std::string const& getHTTPServerHeader ()
+{
+    static std::string const header ("Server: " + systemName () +
+        "-json-rpc/" + BuildInfo::getFullVersionString () + "\r\n");
+    return header;
 }
 
 void HTTPReply (
@@ -110,12 +129,28 @@ void HTTPReply (
     output ("\r\n"
             "Content-Type: application/json; charset=UTF-8\r\n");
 
-    output ("Server: " + systemName () + "-json-rpc/");
-    output (BuildInfo::getFullVersionString ());
-    output ("\r\n"
-            "\r\n");
+    output (getHTTPServerHeader ());
+    output ("\r\n");
     output (content);
     output ("\r\n");
 }
 
+void HTTPReplyContent (std::string const& content,
+    std::string const& contentType, Json::Output const& output)
+{
+    output ("HTTP/1.1 200 OK\r\n");
+    output (getHTTPHeaderTimestamp ());
+    output ("Connection: Keep-Alive\r\n"
+            "Content-Length: ");
+    output (std::to_string (content.size ()));
+    output ("\r\n"
+            "Content-Type: ");
+    output (contentType);
+    output ("\r\n");
+
+    output (getHTTPServerHeader ());
+    output ("\r\n");
+    output (content);
+}
+
 } // skywell
@@ -27,6 +27,10 @@ namespace skywell {
 
 void HTTPReply (int nStatus, std::string const& strMsg, Json::Output const&);
 
+/** Reply 200 with a body that is not JSON. */
+void HTTPReplyContent (std::string const& content,
+    std::string const& contentType, Json::Output const&);
+
 } // skywell
 
 #endif
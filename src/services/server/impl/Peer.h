@@ -23,12 +23,14 @@
 #include <services/server/impl/Door.h>
 #include <services/server/Session.h>
 #include <services/server/impl/ServerImpl.h>
+#include <services/server/impl/WriteQueue.h>
 #include <beast/http/message.h>
 #include <beast/http/parser.h>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/ssl/stream.hpp>
 #include <boost/asio/streambuf.hpp>
 #include <boost/asio/spawn.hpp>
+#include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <chrono>
@@ -65,21 +67,6 @@ protected:
 
     };
 
-    struct buffer
-    {
-        buffer (void const* ptr, std::size_t len)
-            : data (new char[len])
-            , bytes (len)
-            , used (0)
-        {
-            memcpy (data.get(), ptr, len);
-        }
-
-        std::unique_ptr <char[]> data;
-        std::size_t bytes;
-        std::size_t used;
-    };
-
     boost::asio::io_service::work work_;
     boost::asio::io_service::strand strand_;
     waitable_timer timer_;
@@ -92,8 +79,7 @@ protected:
     boost::asio::streambuf read_buf_;
     beast::http::message message_;
     beast::http::body body_;
-    std::list <buffer> write_queue_;
-    std::mutex mutex_;
+    WriteQueue write_queue_;
     bool graceful_ = false;
     bool complete_ = false;
     boost::system::error_code ec_;
@@ -225,6 +211,7 @@ Peer<Impl>::Peer (Door& door,
     , timer_ (io_service)
     , remote_address_ (remote_address)
     , journal_ (journal)
+    , write_queue_ (bufferSize)
 {
     read_buf_.commit(boost::asio::buffer_copy(read_buf_.prepare (boost::asio::buffer_size (buffers)), buffers));
 
@@ -409,38 +396,19 @@ void
 Peer<Impl>::do_write (yield_context yield)
 {
     error_code ec;
-    std::size_t bytes = 0;
-    for(;;)
+    std::size_t sent = 0;
+    void const* data;
+    std::size_t bytes;
+    while (write_queue_.next (sent, data, bytes))
     {
-        bytes_out_ += bytes;
-        void const* data;
-        {
-            std::lock_guard <std::mutex> lock (mutex_);
-            assert(! write_queue_.empty());
-            buffer& b1 = write_queue_.front();
-            b1.used += bytes;
-            if (b1.used >= b1.bytes)
-            {
-                write_queue_.pop_front();
-                if (write_queue_.empty())
-                    break;
-                buffer& b2 = write_queue_.front();
-                data = b2.data.get();
-                bytes = b2.bytes;
-            }
-            else
-            {
-                data = b1.data.get() + b1.used;
-                bytes = b1.bytes - b1.used;
-            }
-        }
-
         start_timer();
-        bytes = boost::asio::async_write (impl().stream_, boost::asio::buffer (data, bytes), boost::asio::transfer_at_least(1), yield[ec]);
+        sent = boost::asio::async_write (impl().stream_, boost::asio::buffer (data, bytes), boost::asio::transfer_at_least(1), yield[ec]);
         cancel_timer();
 
         if (ec)
             return fail (ec, "write");
+
+        bytes_out_ += sent;
     }
 
     if (! complete_)
@@ -502,17 +470,7 @@ template <class Impl>
 void
 Peer<Impl>::write (void const* buffer, std::size_t bytes)
 {
-    if (bytes == 0)
-        return;
-
-    bool empty;
-    {
-        std::lock_guard <std::mutex> lock (mutex_);
-        empty = write_queue_.empty();
-        write_queue_.emplace_back (buffer, bytes);
-    }
-
-    if (empty)
+    if (write_queue_.write (buffer, bytes))
         boost::asio::spawn (strand_, std::bind (&Peer<Impl>::do_write, impl().shared_from_this(), std::placeholders::_1));
 }
 
@@ -548,11 +506,8 @@ Peer<Impl>::complete()
     message_ = beast::http::message{};
     complete_ = true;
 
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (! write_queue_.empty())
-            return;
-    }
+    if (! write_queue_.empty())
+        return;
 
     // keep-alive
     boost::asio::spawn (strand_, std::bind (&Peer<Impl>::do_read,
@@ -574,11 +529,8 @@ Peer<Impl>::close (bool graceful)
     if (graceful)
     {
         graceful_ = true;
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            if (! write_queue_.empty())
-                return;
-        }
+        if (! write_queue_.empty())
+            return;
         return do_close();
     }
 
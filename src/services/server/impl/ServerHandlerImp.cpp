@@ -29,18 +29,25 @@
 #include <common/core/JobQueue.h>
 #include <services/server/JsonWriter.h>
 #include <services/server/make_ServerHandler.h>
+#include <services/server/impl/JSONRPCBatch.h>
 #include <services/server/impl/JSONRPCUtil.h>
 #include <services/server/impl/ServerHandlerImp.h>
 #include <services/server/make_Server.h>
 #include <services/rpc/Coroutine.h>
 #include <network/overlay/Overlay.h>
 #include <services/rpc/RPCHandler.h>
+#include <services/rpc/impl/LookupLedger.h>
+#include <protocol/ErrorCodes.h>
 #include <boost/algorithm/string.hpp>
 #include <boost/type_traits.hpp>
 #include <boost/optional.hpp>
 #include <boost/regex.hpp>
 #include <algorithm>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 #include <common/misc/Utility.h>
 #include <common/misc/std_rfc2616.h>
 #include <common/misc/base64.h>
@@ -63,6 +70,7 @@ ServerHandlerImp::ServerHandlerImp (Stoppable& parent,
                                     CollectorManager& cm)
     : ServerHandler (parent)
     , m_resourceManager (resourceManager)
+    , m_collectorManager (cm)
     , m_journal (deprecatedLogs().journal("Server"))
     , m_jobQueue (jobQueue)
     , m_networkOPs (networkOPs)
@@ -159,24 +167,83 @@ Json::Output makeOutput (HTTP::Session& session)
 
 namespace {
 
-void runCoroutine (RPC::Coroutine coroutine, JobQueue& jobQueue)
+// Runs a coroutine on the job queue, one job per step. After it yields
+// it is rescheduled at once, unless it suspended itself first; then the
+// next step is scheduled when it is resumed.
+class CoroutineRunner
+    : public std::enable_shared_from_this <CoroutineRunner>
 {
-    if (!coroutine)
-        return;
+public:
+    explicit CoroutineRunner (JobQueue& jobQueue)
+        : jobQueue_ (jobQueue)
+    {
+    }
 
-    coroutine();
+    void start (RPC::Coroutine::YieldFunction const& yieldFunction)
+    {
+        coroutine_ = std::make_shared <RPC::Coroutine> (yieldFunction);
+        step ();
+    }
 
-    if (!coroutine)
-        return;
+    // Called by the coroutine: its next yield waits for resume()
+    void suspend ()
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        suspended_ = true;
+    }
 
-    // Reschedule the job on the job queue.
-    jobQueue.addJob (
-        jtCLIENT, "RPC-Coroutine",
-        [coroutine, &jobQueue] (Job&)
+    void resume ()
+    {
         {
-            runCoroutine (coroutine, jobQueue);
-        });
-}
+            std::lock_guard <std::mutex> lock (mutex_);
+            suspended_ = false;
+            if (! parked_)
+                return;
+            parked_ = false;
+        }
+        schedule ();
+    }
+
+private:
+    void step ()
+    {
+        auto& coroutine = *coroutine_;
+        if (!coroutine)
+            return;
+
+        coroutine();
+
+        if (!coroutine)
+            return;
+
+        {
+            std::lock_guard <std::mutex> lock (mutex_);
+            if (suspended_)
+            {
+                parked_ = true;
+                return;
+            }
+        }
+        schedule ();
+    }
+
+    void schedule ()
+    {
+        auto self = shared_from_this ();
+        jobQueue_.addJob (
+            jtCLIENT, "RPC-Coroutine",
+            [self] (Job&)
+            {
+                self->step ();
+            });
+    }
+
+    JobQueue& jobQueue_;
+    std::shared_ptr <RPC::Coroutine> coroutine_;
+    std::mutex mutex_;
+    bool suspended_ = false;
+    bool parked_ = false;
+};
 
 } // namespace
 
@@ -202,19 +269,37 @@ ServerHandlerImp::onRequest (HTTP::Session& session)
         return;
     }
 
+    if (! m_collectorManager.path ().empty () &&
+        session.request().url() == m_collectorManager.path ())
+    {
+        processMetrics (session);
+        return;
+    }
+
     auto detach = session.detach();
 
     if (setup_.yieldStrategy.useCoroutines == RPC::YieldStrategy::UseCoroutines::yes)
     {
-        RPC::Coroutine::YieldFunction yieldFunction = [this, detach] (Yield const& y) { processSession (detach, y); };
+        auto runner = std::make_shared <CoroutineRunner> (m_jobQueue);
+        std::weak_ptr <CoroutineRunner> weak (runner);
+
+        // The resume function keeps the runner alive while it is parked
+        Suspend suspend = [weak] () -> std::function <void ()>
+        {
+            auto const r = weak.lock ();
+            r->suspend ();
+            return [r] () { r->resume (); };
+        };
+
+        RPC::Coroutine::YieldFunction yieldFunction = [this, detach, suspend] (Yield const& y) { processSession (detach, y, suspend); };
 
-        runCoroutine (RPC::Coroutine (yieldFunction), m_jobQueue);
+        runner->start (yieldFunction);
     }
     else
     {
         m_jobQueue.addJob (
             jtCLIENT, "RPC-Client",
-            [=] (Job&) { processSession (detach, RPC::Yield{}); });
+            [=] (Job&) { processSession (detach, RPC::Yield{}, Suspend{}); });
     }
 }
 
@@ -232,9 +317,201 @@ ServerHandlerImp::onStopped (HTTP::Server&)
 
 //------------------------------------------------------------------------------
 
+// Reading the metrics takes no locks that are held for long, so this is
+// answered on the I/O thread rather than queued behind the RPC jobs
+void
+ServerHandlerImp::processMetrics (HTTP::Session& session)
+{
+    boost::asio::ip::tcp::endpoint end;
+    end.address(session.remoteAddress().address());
+    end.port(0);
+
+    if (requestRole (Role::ADMIN, session.port(),
+            Json::objectValue, end) != Role::ADMIN)
+    {
+        HTTPReply (403, "Forbidden", makeOutput (session));
+        session.close (true);
+        return;
+    }
+
+    std::string text;
+    m_collectorManager.write (text);
+    HTTPReplyContent (text, "text/plain; version=0.0.4", makeOutput (session));
+
+    if (session.request().keep_alive())
+        session.complete();
+    else
+        session.close (true);
+}
+
+//------------------------------------------------------------------------------
+
+// The shared state of a JSON-RPC batch. Requests are claimed in turn by
+// the thread that received the batch and by helper jobs, so a request
+// never waits for a helper to be scheduled.
+struct ServerHandlerImp::Batch
+{
+    Batch (HTTP::Port const& port_,
+            boost::asio::ip::tcp::endpoint const& remote_,
+            Resource::Consumer const& usage_,
+            NetworkOPs& netOps,
+            Json::Value& requests_,
+            int costLimit)
+        : port (port_)
+        , remote (remote_)
+        , usage (usage_)
+        , ledgers (netOps)
+        , requests (requests_, costLimit)
+    {
+    }
+
+    HTTP::Port const& port;
+    boost::asio::ip::tcp::endpoint const remote;
+    Resource::Consumer usage;
+    RPC::LedgerCache ledgers;
+    JSONRPCBatch requests;
+};
+
+void
+ServerHandlerImp::processBatch (
+    HTTP::Port const& port,
+    Json::Value& requests,
+    boost::asio::ip::tcp::endpoint const& remoteIPAddress,
+    Output output,
+    Yield yield,
+    Suspend const& suspend)
+{
+    auto const size = requests.size ();
+
+    if (size == 0)
+    {
+        HTTPReply (400, "batch is empty", output);
+        return;
+    }
+
+    if (size > setup_.batch.limit)
+    {
+        HTTPReply (400, "batch is too large", output);
+        return;
+    }
+
+    Resource::Consumer usage;
+
+    if (requestRole (Role::ADMIN, port, Json::objectValue,
+            remoteIPAddress) == Role::ADMIN)
+        usage = m_resourceManager.newAdminEndpoint (convert_endpoint_to_string(remoteIPAddress));
+    else
+        usage = m_resourceManager.newInboundEndpoint(remoteIPAddress);
+
+    if (usage.disconnect ())
+    {
+        HTTPReply (503, "Server is overloaded", output);
+        return;
+    }
+
+    auto const batch = std::make_shared<Batch> (
+        port, remoteIPAddress, usage, m_networkOPs, requests,
+        setup_.batch.costLimit);
+
+    auto const helpers = std::min<std::size_t> (
+        size - 1, std::thread::hardware_concurrency ());
+
+    for (std::size_t i = 0; i < helpers; ++i)
+    {
+        m_jobQueue.addJob (
+            jtCLIENT, "RPC-Batch",
+            [this, batch] (Job&) { runBatch (batch, RPC::Yield{}); });
+    }
+
+    runBatch (batch, yield);
+
+    // Wait for the requests the helpers are still running. A coroutine
+    // gives up its thread and is resumed by the helper that finishes the
+    // last request; otherwise the job thread blocks.
+    if (yield && suspend)
+    {
+        auto const resume = suspend ();
+        if (batch->requests.finished (resume))
+            resume ();
+        else
+            yield ();
+    }
+    else
+    {
+        batch->requests.wait ();
+    }
+
+    std::string response = to_string (batch->requests.replies ());
+
+    rpc_size_.notify (static_cast <beast::insight::Event::value_type> (response.size ()));
+
+    response += '\n';
+
+    HTTPReply (200, response, output);
+}
+
+void
+ServerHandlerImp::runBatch (std::shared_ptr<Batch> const& batch,
+    Yield const& yield)
+{
+    batch->requests.run ([&] (JSONRPCBatch::Request& request)
+        {
+            return processBatchRequest (*batch, request, yield);
+        });
+}
+
+// Runs one well formed request of a batch and returns its result
+Json::Value
+ServerHandlerImp::processBatchRequest (Batch& batch,
+    JSONRPCBatch::Request& request, Yield const& yield)
+{
+    Json::Value& params = request.params;
+
+    auto const role = requestRole (RPC::roleRequired (request.method),
+        batch.port, params, batch.remote);
+
+    if (role == Role::FORBID)
+        return RPC::make_error (rpcFORBIDDEN);
+
+    // Handlers may charge more, the difference is settled afterwards
+    Resource::Charge loadType = Resource::feeReferenceRPC;
+    int const reserved = loadType.cost ();
+
+    if (batch.usage.disconnect ())
+        return RPC::make_error (rpcSLOW_DOWN);
+
+    if (! batch.requests.reserve (reserved))
+        return RPC::make_error (rpcSLOW_DOWN);
+
+    params[jss::command] = request.method;
+
+    auto const start (std::chrono::high_resolution_clock::now ());
+    RPC::Context context {params, loadType, m_networkOPs, role, nullptr, yield};
+    context.ledgers = &batch.ledgers;
+
+    Json::Value result;
+    RPC::doCommand (context, result, setup_.yieldStrategy);
+
+    rpc_time_.notify (static_cast <beast::insight::Event::value_type> (
+                                        std::chrono::duration_cast <std::chrono::milliseconds> (
+                                            std::chrono::high_resolution_clock::now () - start)));
+
+    ++rpc_requests_;
+
+    rpc_io_.notify (static_cast <beast::insight::Event::value_type> (context.metrics.fetches));
+
+    batch.usage.charge (loadType);
+    batch.requests.settle (reserved, loadType.cost ());
+
+    return result;
+}
+
+//------------------------------------------------------------------------------
+
 // Dispatched on the job queue
 void
-ServerHandlerImp::processSession (std::shared_ptr<HTTP::Session> const& session, Yield const& yield)
+ServerHandlerImp::processSession (std::shared_ptr<HTTP::Session> const& session,
+    Yield const& yield, Suspend const& suspend)
 {
     auto output = makeOutput (*session);
     if (auto byteYieldCount = setup_.yieldStrategy.byteYieldCount)
@@ -245,10 +522,11 @@ ServerHandlerImp::processSession (std::shared_ptr<HTTP::Session> const& session,
     end.port(0);
     processRequest (
         session->port(),
-        to_string (session->body()),
+        session->body(),
         end,
         output,
-        yield);
+        yield,
+        suspend);
 
     if (session->request().keep_alive())
         session->complete();
@@ -259,24 +537,37 @@ ServerHandlerImp::processSession (std::shared_ptr<HTTP::Session> const& session,
 void
 ServerHandlerImp::processRequest (
     HTTP::Port const& port,
-    std::string const& request,
+    beast::http::body const& request,
     boost::asio::ip::tcp::endpoint const& remoteIPAddress,
     Output output,
-    Yield yield)
+    Yield yield,
+    Suspend const& suspend)
 {
     Json::Value jsonRPC;
     {
+        // The body is held in a single buffer, so it is parsed in place
+        // rather than copied out into a string first.
+        auto const data = request.data ();
+        auto const begin = boost::asio::buffer_cast <char const*> (data);
+        auto const size = boost::asio::buffer_size (data);
+
         Json::Reader reader;
-        if ((request.size () > 1000000) ||
-            ! reader.parse (request, jsonRPC) ||
+        if ((size > 1000000) ||
+            ! reader.parse (begin, begin + size, jsonRPC) ||
             jsonRPC.isNull () ||
-            ! jsonRPC.isObject ())
+            ! (jsonRPC.isObject () || jsonRPC.isArray ()))
         {
             HTTPReply (400, "Unable to parse request", output);
             return;
         }
     }
 
+    if (jsonRPC.isArray ())
+    {
+        processBatch (port, jsonRPC, remoteIPAddress, output, yield, suspend);
+        return;
+    }
+
     // Parse id now so errors from here on will have the id
     //
     //  NOTE Except that "id" isn't included in the following errors.
@@ -299,13 +590,15 @@ ServerHandlerImp::processRequest (
     auto role = Role::FORBID;
     auto required = RPC::roleRequired(id.asString());
 
-    if (jsonRPC.isObject() && 
-        jsonRPC.isMember("params") &&
-        jsonRPC["params"].isArray() && 
-        jsonRPC["params"].size() > 0 &&
-        jsonRPC["params"][Json::UInt(0)].isObject())
+    // Indexing the non-const request would add a null params member
+    Json::Value const& jsonParams = jsonRPC.isMember (jss::params)
+        ? jsonRPC [jss::params] : Json::Value::null;
+
+    if (jsonParams.isArray() &&
+        jsonParams.size() > 0 &&
+        jsonParams[Json::UInt(0)].isObject())
     {
-        role = requestRole(required, port, jsonRPC["params"][Json::UInt(0)], remoteIPAddress);
+        role = requestRole(required, port, jsonParams[Json::UInt(0)], remoteIPAddress);
     }
     else
     {
@@ -338,7 +631,7 @@ ServerHandlerImp::processRequest (
     //
     // Otherwise, that field must be an array of length 1 (why?)
     // and we take that first entry and validate that it's an object.
-    Json::Value params = jsonRPC [jss::params];
+    Json::Value params = std::move (jsonRPC [jss::params]);
 
     if (params.isNull () || params.empty())
         params = Json::Value (Json::objectValue);
@@ -788,6 +1081,10 @@ setup_ServerHandler (BasicConfig const& config, std::ostream& log)
     ServerHandler::Setup setup;
     setup.ports = detail::parse_Ports (config, log);
     setup.yieldStrategy = RPC::makeYieldStrategy (config["server"]);
+    setup.batch.limit = get<std::size_t> (config["server"],
+        "batch_limit", setup.batch.limit);
+    setup.batch.costLimit = get<int> (config["server"],
+        "batch_cost_limit", setup.batch.costLimit);
 
     detail::setup_Client(setup);
     detail::setup_Overlay(setup);
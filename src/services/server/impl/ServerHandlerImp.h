@@ -26,6 +26,7 @@
 #include <services/server/Session.h>
 #include <services/rpc/RPCHandler.h>
 #include <services/server/Handler.h>
+#include <services/server/impl/JSONRPCBatch.h>
 #include <services/rpc/handlers/RPCInfo.h>
 #include <main/CollectorManager.h>
 #include <boost/asio.hpp>
@@ -40,6 +41,7 @@ class ServerHandlerImp
 {
 private:
     Resource::Manager& m_resourceManager;
+    CollectorManager& m_collectorManager;
     beast::Journal m_journal;
     JobQueue& m_jobQueue;
     NetworkOPs& m_networkOPs;
@@ -64,6 +66,10 @@ private:
     using Output = Json::Output;
     using Yield  = RPC::Yield;
 
+    // Makes the coroutine running a request wait, at its next yield, for
+    // the returned function to be called. Empty when not on a coroutine.
+    using Suspend = std::function <std::function <void ()> ()>;
+
     void
     setup (Setup const& setup, beast::Journal journal) override;
 
@@ -114,14 +120,36 @@ private:
     //--------------------------------------------------------------------------
 
     void
-    processSession (std::shared_ptr<HTTP::Session> const&, Yield const&);
+    processSession (std::shared_ptr<HTTP::Session> const&, Yield const&,
+                    Suspend const&);
+
+    void
+    processMetrics (HTTP::Session& session);
+
+    struct Batch;
+
+    void
+    processBatch (HTTP::Port const& port,
+                  Json::Value& requests,
+                  boost::asio::ip::tcp::endpoint const& remoteIPAddress,
+                  Output,
+                  Yield,
+                  Suspend const&);
+
+    void
+    runBatch (std::shared_ptr<Batch> const& batch, Yield const&);
+
+    Json::Value
+    processBatchRequest (Batch& batch, JSONRPCBatch::Request& request,
+                         Yield const&);
 
     void
-    processRequest (HTTP::Port const& port, 
-                    std::string const& request,
+    processRequest (HTTP::Port const& port,
+                    beast::http::body const& request,
                     boost::asio::ip::tcp::endpoint const& remoteIPAddress,
                     Output,
-                    Yield);
+                    Yield,
+                    Suspend const&);
 
     //
     // PropertyStream
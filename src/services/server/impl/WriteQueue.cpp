@@ -0,0 +1,117 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <services/server/impl/WriteQueue.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace skywell {
+namespace HTTP {
+
+WriteQueue::buffer::buffer (std::size_t len)
+    : data (new char[len])
+    , capacity (len)
+    , bytes (0)
+    , used (0)
+{
+}
+
+void
+WriteQueue::buffer::append (void const* ptr, std::size_t len)
+{
+    std::memcpy (data.get () + bytes, ptr, len);
+    bytes += len;
+}
+
+WriteQueue::WriteQueue (std::size_t bufferSize)
+    : bufferSize_ (bufferSize)
+{
+}
+
+bool
+WriteQueue::write (void const* data, std::size_t bytes)
+{
+    if (bytes == 0)
+        return false;
+
+    std::lock_guard <std::mutex> lock (mutex_);
+    bool const empty = queue_.empty ();
+
+    // The writer only reads below the tail's current size, so the free
+    // space after it can be filled while a write is pending.
+    if (! empty && queue_.back ().capacity - queue_.back ().bytes >= bytes)
+    {
+        queue_.back ().append (data, bytes);
+        return false;
+    }
+
+    if (! spare_.empty () && bytes <= bufferSize_)
+        queue_.splice (queue_.end (), spare_, spare_.begin ());
+    else
+        queue_.emplace_back (std::max (bytes, bufferSize_));
+    queue_.back ().append (data, bytes);
+
+    return empty;
+}
+
+bool
+WriteQueue::next (std::size_t sent, void const*& data, std::size_t& bytes)
+{
+    std::lock_guard <std::mutex> lock (mutex_);
+    assert (! queue_.empty ());
+
+    buffer& b1 = queue_.front ();
+    b1.used += sent;
+    assert (b1.used <= b1.bytes);
+
+    if (b1.used < b1.bytes)
+    {
+        data = b1.data.get () + b1.used;
+        bytes = b1.bytes - b1.used;
+        return true;
+    }
+
+    // Keep one buffer of the usual size for the next response
+    b1.bytes = 0;
+    b1.used = 0;
+    if (spare_.empty () && b1.capacity == bufferSize_)
+        spare_.splice (spare_.end (), queue_, queue_.begin ());
+    else
+        queue_.pop_front ();
+
+    if (queue_.empty ())
+        return false;
+
+    buffer& b2 = queue_.front ();
+    data = b2.data.get ();
+    bytes = b2.bytes;
+    return true;
+}
+
+bool
+WriteQueue::empty () const
+{
+    std::lock_guard <std::mutex> lock (mutex_);
+    return queue_.empty ();
+}
+
+} // HTTP
+} // skywell
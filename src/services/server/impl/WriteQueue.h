@@ -0,0 +1,95 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef SKYWELL_SERVER_WRITEQUEUE_H_INCLUDED
+#define SKYWELL_SERVER_WRITEQUEUE_H_INCLUDED
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+
+namespace skywell {
+namespace HTTP {
+
+/** The bytes a connection has yet to send.
+
+    Any thread may add to the queue while one writer, at a time, sends
+    from its front. Small writes are appended to the last queued buffer,
+    even while the writer is sending from it, and a drained buffer is kept
+    for the next response, so a keep-alive connection writing the usual
+    small replies does not allocate per request.
+*/
+class WriteQueue
+{
+public:
+    /** @param bufferSize The capacity of the buffers small writes share. */
+    explicit
+    WriteQueue (std::size_t bufferSize);
+
+    WriteQueue (WriteQueue const&) = delete;
+    WriteQueue& operator= (WriteQueue const&) = delete;
+
+    /** Copy bytes to the end of the queue.
+
+        @return `true` if the queue was empty, in which case the caller
+                must start a writer.
+    */
+    bool
+    write (void const* data, std::size_t bytes);
+
+    /** Account for bytes sent and find the next bytes to send.
+
+        @param sent The number of bytes sent from the last range returned,
+                    zero on the first call.
+        @param data, bytes Set to the next range to send. The range stays
+                    valid, and unchanged, until the next call.
+        @return `false` once the queue is empty; the writer then stops.
+    */
+    bool
+    next (std::size_t sent, void const*& data, std::size_t& bytes);
+
+    bool
+    empty () const;
+
+private:
+    struct buffer
+    {
+        explicit
+        buffer (std::size_t len);
+
+        void
+        append (void const* ptr, std::size_t len);
+
+        std::unique_ptr <char[]> data;
+        std::size_t capacity;
+        std::size_t bytes;
+        std::size_t used;
+    };
+
+    std::size_t const bufferSize_;
+    std::mutex mutable mutex_;
+    std::list <buffer> queue_;
+    std::list <buffer> spare_;
+};
+
+} // HTTP
+} // skywell
+
+#endif
@@ -0,0 +1,258 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <services/server/impl/JSONRPCUtil.h>
+#include <common/json/json_reader.h>
+#include <common/json/to_string.h>
+#include <beast/http/body.h>
+#include <beast/unit_test/suite.h>
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace skywell {
+namespace tests {
+
+// Measures the HTTP JSON-RPC path.
+//
+// With no argument, times parsing a request body, either in place or after
+// copying it into a string, and formatting the reply, in this process.
+//
+// With an argument, acts as a load generator against a running server:
+// --unittest=JSONRPC_bench --unittest-arg=<host:port>[,connections[,seconds]]
+// Each connection POSTs server_info over keep-alive and waits for the reply.
+class JSONRPC_bench_test : public beast::unit_test::suite
+{
+public:
+    using clock_type = std::chrono::steady_clock;
+
+    static
+    std::string
+    requestBody ()
+    {
+        return "{\"method\":\"server_info\",\"params\":[{}],\"id\":1}";
+    }
+
+    static
+    std::string
+    replyBody ()
+    {
+        Json::Value result (Json::objectValue);
+        Json::Value& info = result["result"]["info"];
+        info["build_version"] = "0.28.0";
+        info["complete_ledgers"] = "32570-9876543";
+        info["hostid"] = "SKYWELL";
+        info["io_latency_ms"] = 1;
+        info["last_close"]["converge_time_s"] = 2.001;
+        info["last_close"]["proposers"] = 5;
+        info["load_factor"] = 1;
+        info["peers"] = 21;
+        info["pubkey_node"] =
+            "n9KUjqxCr5FKThSNXdzb7oqN8rYwScB2dUnNqxQxbEA17JkaWy5x";
+        info["server_state"] = "full";
+        info["validated_ledger"]["age"] = 5;
+        info["validated_ledger"]["hash"] = std::string (64, 'A');
+        info["validated_ledger"]["seq"] = 9876543;
+        info["validation_quorum"] = 3;
+        result["result"]["status"] = "success";
+        return Json::to_string (result);
+    }
+
+    template <class Function>
+    double
+    rate (std::size_t iterations, Function&& f)
+    {
+        auto const start = clock_type::now ();
+        for (std::size_t i = 0; i < iterations; ++i)
+            f ();
+        auto const us = std::chrono::duration_cast <
+            std::chrono::microseconds> (clock_type::now () - start).count ();
+        return iterations * 1e6 / std::max <long long> (1, us);
+    }
+
+    void
+    inProcess ()
+    {
+        std::size_t const iterations = 200000;
+
+        beast::http::body body;
+        std::string const text = requestBody ();
+        body.write (text.data (), text.size ());
+
+        std::size_t parsed = 0;
+
+        double const copied = rate (iterations, [&]
+        {
+            Json::Value v;
+            Json::Reader reader;
+            if (reader.parse (beast::http::to_string (body), v))
+                ++parsed;
+        });
+
+        double const inPlace = rate (iterations, [&]
+        {
+            auto const data = body.data ();
+            auto const begin = boost::asio::buffer_cast <char const*> (data);
+            auto const size = boost::asio::buffer_size (data);
+
+            Json::Value v;
+            Json::Reader reader;
+            if (reader.parse (begin, begin + size, v))
+                ++parsed;
+        });
+
+        expect (parsed == 2 * iterations);
+
+        std::string const content = replyBody ();
+        std::size_t bytes = 0;
+        double const replies = rate (iterations, [&]
+        {
+            HTTPReply (200, content, [&](boost::string_ref const& s)
+            {
+                bytes += s.size ();
+            });
+        });
+
+        std::stringstream ss;
+        ss.setf (std::ios::fixed);
+        ss.precision (0);
+        ss << "parse after copy: " << copied << "/s, parse in place: " <<
+            inPlace << "/s, HTTPReply: " << replies << "/s";
+        log << ss.str ();
+    }
+
+    // One keep-alive connection; returns the number of replies received
+    std::size_t
+    drive (std::string const& host, std::string const& port,
+        clock_type::time_point until)
+    {
+        using namespace boost::asio;
+
+        io_service ios;
+        ip::tcp::resolver resolver (ios);
+        ip::tcp::socket socket (ios);
+        connect (socket, resolver.resolve (ip::tcp::resolver::query (
+            host, port)));
+        socket.set_option (ip::tcp::no_delay (true));
+
+        std::string const body = requestBody ();
+        std::string const request =
+            "POST / HTTP/1.1\r\n"
+            "Host: " + host + "\r\n"
+            "Content-Type: application/json\r\n"
+            "Connection: keep-alive\r\n"
+            "Content-Length: " + std::to_string (body.size ()) + "\r\n"
+            "\r\n" + body;
+
+        streambuf in;
+        std::size_t replies = 0;
+
+        while (clock_type::now () < until)
+        {
+            write (socket, buffer (request));
+
+            std::size_t const n = read_until (socket, in, "\r\n\r\n");
+            std::string header (buffers_begin (in.data ()),
+                buffers_begin (in.data ()) + n);
+            in.consume (n);
+
+            std::size_t length = 0;
+            auto const pos = header.find ("Content-Length: ");
+            if (pos != std::string::npos)
+                length = std::stoul (header.substr (pos + 16));
+
+            if (in.size () < length)
+                read (socket, in, transfer_exactly (length - in.size ()));
+            in.consume (length);
+
+            ++replies;
+        }
+
+        return replies;
+    }
+
+    void
+    loadGenerator (std::string const& spec)
+    {
+        std::vector <std::string> fields;
+        std::stringstream ss (spec);
+        for (std::string field; std::getline (ss, field, ',');)
+            fields.push_back (field);
+
+        auto const colon = fields[0].rfind (':');
+        if (colon == std::string::npos)
+        {
+            fail ("expected host:port");
+            return;
+        }
+        std::string const host = fields[0].substr (0, colon);
+        std::string const port = fields[0].substr (colon + 1);
+        int const connections = (fields.size () > 1) ?
+            std::stoi (fields[1]) : 32;
+        int const seconds = (fields.size () > 2) ? std::stoi (fields[2]) : 10;
+
+        auto const until = clock_type::now () + std::chrono::seconds (seconds);
+
+        std::atomic <std::size_t> replies (0);
+        std::atomic <int> errors (0);
+        std::vector <std::thread> threads;
+        for (int i = 0; i < connections; ++i)
+        {
+            threads.emplace_back ([&]
+            {
+                try
+                {
+                    replies += drive (host, port, until);
+                }
+                catch (std::exception const&)
+                {
+                    ++errors;
+                }
+            });
+        }
+        for (auto& t : threads)
+            t.join ();
+
+        expect (errors == 0, "connection errors");
+
+        std::stringstream out;
+        out << connections << " connections, " << seconds << "s: " <<
+            replies.load () << " replies, " << (replies.load () / seconds) <<
+            " requests/s";
+        log << out.str ();
+    }
+
+    void
+    run ()
+    {
+        if (arg ().empty ())
+            inProcess ();
+        else
+            loadGenerator (arg ());
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(JSONRPC_bench,server,skywell);
+
+}
+}
@@ -0,0 +1,323 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <services/server/impl/JSONRPCBatch.h>
+#include <common/json/json_reader.h>
+#include <protocol/ErrorCodes.h>
+#include <protocol/JsonFields.h>
+#include <beast/unit_test/suite.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace skywell {
+namespace tests {
+
+class JSONRPCBatch_test : public beast::unit_test::suite
+{
+public:
+    Json::Value
+    parse (std::string const& text)
+    {
+        Json::Value v;
+        Json::Reader reader;
+        expect (reader.parse (text, v), text);
+        return v;
+    }
+
+    // Replies with the params it was given
+    static
+    Json::Value
+    echo (JSONRPCBatch::Request& request)
+    {
+        Json::Value result (request.params);
+        result["method"] = request.method;
+        return result;
+    }
+
+    void
+    testOrder ()
+    {
+        testcase ("order");
+
+        int const size = 200;
+        Json::Value requests (Json::arrayValue);
+        for (int i = 0; i < size; ++i)
+        {
+            Json::Value r (Json::objectValue);
+            r[jss::method] = "echo";
+            r[jss::params][0u]["n"] = i;
+            requests.append (r);
+        }
+
+        JSONRPCBatch batch (requests, 1000);
+        expect (batch.size () == size);
+
+        // Requests finish out of order on several threads
+        auto const process = [] (JSONRPCBatch::Request& request)
+        {
+            thread_local std::minstd_rand rng (std::hash <std::thread::id> () (
+                std::this_thread::get_id ()));
+            std::this_thread::sleep_for (
+                std::chrono::microseconds (rng () % 200));
+            return echo (request);
+        };
+
+        std::vector <std::thread> threads;
+        for (int t = 0; t < 3; ++t)
+            threads.emplace_back ([&] { batch.run (process); });
+        batch.run (process);
+        for (auto& t : threads)
+            t.join ();
+
+        batch.wait ();
+        Json::Value const replies = batch.replies ();
+
+        expect (replies.isArray () && replies.size () == size);
+
+        bool ordered = true;
+        for (int i = 0; i < size; ++i)
+        {
+            Json::Value const& result = replies[i][jss::result];
+            if (result["n"].asInt () != i ||
+                    result[jss::status].asString () != "success")
+                ordered = false;
+        }
+        expect (ordered, "replies are not in request order");
+    }
+
+    void
+    testIds ()
+    {
+        testcase ("ids");
+
+        Json::Value requests = parse (
+            "[{\"method\":\"a\",\"id\":7},"
+            " {\"method\":\"b\",\"id\":\"x\"},"
+            " {\"method\":\"c\"},"
+            " {\"method\":5,\"id\":9}]");
+
+        JSONRPCBatch batch (requests, 1000);
+        batch.run (echo);
+        expect (batch.finished (nullptr));
+
+        Json::Value const replies = batch.replies ();
+        expect (replies[0u][jss::id] == 7);
+        expect (replies[1u][jss::id] == "x");
+        expect (! replies[2u].isMember (jss::id));
+        expect (replies[3u][jss::id] == 9, "id is kept on errors");
+    }
+
+    void
+    expectParamError (Json::Value const& reply, std::string const& message)
+    {
+        Json::Value const& result = reply[jss::result];
+        expect (result[jss::status] == "error", message);
+        expect (result[jss::error] == "invalidParams", message);
+        expect (result.isMember (jss::request), message);
+    }
+
+    void
+    testErrors ()
+    {
+        testcase ("per request errors");
+
+        Json::Value requests = parse (
+            "[3,"
+            " {\"id\":1},"
+            " {\"method\":[]},"
+            " {\"method\":\"\"},"
+            " {\"method\":\"a\",\"params\":{\"x\":1}},"
+            " {\"method\":\"a\",\"params\":[{},{}]},"
+            " {\"method\":\"a\",\"params\":[1]},"
+            " {\"method\":\"fail\",\"params\":[{\"x\":1}]},"
+            " {\"method\":\"a\",\"params\":[{\"x\":2}]},"
+            " {\"method\":\"a\",\"params\":[]}]");
+
+        JSONRPCBatch batch (requests, 1000);
+        batch.run ([] (JSONRPCBatch::Request& request)
+            {
+                if (request.method == "fail")
+                    return RPC::make_error (rpcINTERNAL);
+                return echo (request);
+            });
+
+        Json::Value const replies = batch.replies ();
+        expect (replies.size () == 10);
+
+        expectParamError (replies[0u], "not an object");
+        expect (replies[0u][jss::result][jss::request] == 3);
+
+        expectParamError (replies[1u], "no method");
+        expect (! replies[1u][jss::result][jss::request].isMember (
+            jss::method), "the echoed request gained a member");
+
+        expectParamError (replies[2u], "method not a string");
+        expectParamError (replies[3u], "empty method");
+        expectParamError (replies[4u], "params not an array");
+        expectParamError (replies[5u], "two params");
+        expectParamError (replies[6u], "params not an object");
+
+        Json::Value const& failed = replies[7u][jss::result];
+        expect (failed[jss::status] == "error");
+        expect (failed[jss::error] == "internal");
+        expect (failed[jss::request]["x"] == 1, "params are echoed");
+
+        Json::Value const& ok = replies[8u][jss::result];
+        expect (ok[jss::status] == "success");
+        expect (ok["x"] == 2);
+
+        expect (replies[9u][jss::result][jss::status] == "success",
+            "empty params");
+    }
+
+    void
+    testLimits ()
+    {
+        testcase ("cost limit");
+
+        {
+            Json::Value requests (Json::arrayValue);
+            JSONRPCBatch batch (requests, 25);
+            expect (batch.reserve (10));
+            expect (batch.reserve (10));
+            expect (! batch.reserve (10));
+            batch.settle (10, 5);
+            expect (batch.reserve (10));
+            expect (! batch.reserve (1));
+        }
+
+        {
+            // Concurrent reservations never go over the limit together
+            Json::Value requests (Json::arrayValue);
+            JSONRPCBatch batch (requests, 100);
+            std::atomic <int> granted (0);
+            std::vector <std::thread> threads;
+            for (int t = 0; t < 8; ++t)
+            {
+                threads.emplace_back ([&]
+                {
+                    for (int i = 0; i < 1000; ++i)
+                    {
+                        if (batch.reserve (1))
+                            ++granted;
+                    }
+                });
+            }
+            for (auto& t : threads)
+                t.join ();
+            expect (granted == 100);
+        }
+
+        {
+            // Requests past the limit get errors, the others still run
+            Json::Value requests (Json::arrayValue);
+            for (int i = 0; i < 5; ++i)
+                requests.append (parse ("{\"method\":\"a\"}"));
+
+            JSONRPCBatch batch (requests, 30);
+            batch.run ([&] (JSONRPCBatch::Request& request)
+                {
+                    if (! batch.reserve (10))
+                        return RPC::make_error (rpcSLOW_DOWN);
+                    return echo (request);
+                });
+
+            Json::Value const replies = batch.replies ();
+            int slowed = 0;
+            for (auto const& r : replies)
+            {
+                if (r[jss::result][jss::error] == "slowDown")
+                    ++slowed;
+            }
+            expect (slowed == 2);
+        }
+    }
+
+    void
+    testResume ()
+    {
+        testcase ("resume");
+
+        Json::Value requests (Json::arrayValue);
+        for (int i = 0; i < 4; ++i)
+            requests.append (parse ("{\"method\":\"a\"}"));
+
+        JSONRPCBatch batch (requests, 1000);
+
+        std::mutex m;
+        std::condition_variable cond;
+        bool claimed = false;
+        bool release = false;
+
+        // The helper finishes the last request after the caller asked to
+        // be resumed
+        std::thread helper ([&]
+        {
+            batch.run ([&] (JSONRPCBatch::Request& request)
+                {
+                    std::unique_lock <std::mutex> lock (m);
+                    claimed = true;
+                    cond.notify_all ();
+                    cond.wait (lock, [&] { return release; });
+                    return echo (request);
+                });
+        });
+
+        {
+            std::unique_lock <std::mutex> lock (m);
+            cond.wait (lock, [&] { return claimed; });
+        }
+        batch.run (echo);
+
+        std::atomic <int> resumed (0);
+        expect (! batch.finished ([&] { ++resumed; }));
+        expect (resumed == 0);
+
+        {
+            std::lock_guard <std::mutex> lock (m);
+            release = true;
+        }
+        cond.notify_all ();
+        helper.join ();
+
+        expect (resumed == 1);
+        expect (batch.finished (nullptr));
+    }
+
+    void
+    run ()
+    {
+        testOrder ();
+        testIds ();
+        testErrors ();
+        testLimits ();
+        testResume ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(JSONRPCBatch,server,skywell);
+
+}
+}
@@ -0,0 +1,206 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <main/Application.h>
+#include <main/CollectorManager.h>
+#include <services/server/make_ServerHandler.h>
+#include <beast/insight/NullCollector.h>
+#include <beast/unit_test/suite.h>
+#include <boost/asio.hpp>
+#include <boost/optional.hpp>
+#include <boost/regex.hpp>
+#include <string>
+#include <thread>
+
+namespace skywell {
+namespace tests {
+
+// Sends JSON-RPC requests over one keep-alive connection to a real
+// ServerHandler, with bodies on both sides of the 64KB that a session
+// body keeps its storage for.
+class ServerHandler_test : public beast::unit_test::suite
+{
+public:
+    struct Reply
+    {
+        std::string status;
+        std::string header;
+        std::string content;
+    };
+
+    static
+    std::uint16_t
+    freePort (boost::asio::io_service& ios)
+    {
+        using namespace boost::asio;
+        ip::tcp::acceptor acceptor (ios,
+            ip::tcp::endpoint (ip::address_v4::loopback (), 0));
+        return acceptor.local_endpoint ().port ();
+    }
+
+    static
+    Reply
+    post (boost::asio::ip::tcp::socket& socket,
+        boost::asio::streambuf& in, std::string const& body)
+    {
+        using namespace boost::asio;
+
+        std::string const request =
+            "POST / HTTP/1.1\r\n"
+            "Host: localhost\r\n"
+            "Content-Type: application/json\r\n"
+            "Connection: keep-alive\r\n"
+            "Content-Length: " + std::to_string (body.size ()) + "\r\n"
+            "\r\n" + body;
+        write (socket, buffer (request));
+
+        std::size_t const n = read_until (socket, in, "\r\n\r\n");
+        std::string const header (buffers_begin (in.data ()),
+            buffers_begin (in.data ()) + n);
+        in.consume (n);
+
+        std::size_t length = 0;
+        auto const pos = header.find ("Content-Length: ");
+        if (pos != std::string::npos)
+            length = std::stoul (header.substr (pos + 16));
+
+        if (in.size () < length)
+            read (socket, in, transfer_exactly (length - in.size ()));
+
+        Reply reply;
+        reply.status = header.substr (0, header.find ("\r\n"));
+        reply.header = header;
+        reply.content.assign (buffers_begin (in.data ()),
+            buffers_begin (in.data ()) + length);
+        in.consume (length);
+        return reply;
+    }
+
+    void
+    check (Reply const& reply, std::string const& status,
+        std::string const& content)
+    {
+        static boost::regex const date (
+            "\r\nDate: [A-Z][a-z]{2}, [0-9]{2} [A-Z][a-z]{2} [0-9]{4} "
+            "[0-9]{2}:[0-9]{2}:[0-9]{2} \\+0000\r\n");
+
+        expect (reply.status == "HTTP/1.1 " + status, reply.status);
+        expect (boost::regex_search (reply.header, date),
+            "missing or malformed Date header");
+        expect (reply.header.find ("\r\nConnection: Keep-Alive\r\n") !=
+            std::string::npos, "not kept alive");
+        expect (reply.content.find (content) != std::string::npos,
+            reply.content.substr (0, 200));
+    }
+
+    // A ping whose params carry `pad` bytes of padding
+    static
+    std::string
+    ping (std::size_t pad, int id)
+    {
+        return "{\"method\":\"ping\",\"params\":[{\"pad\":\"" +
+            std::string (pad, 'x') + "\"}],\"id\":" + std::to_string (id) +
+            "}";
+    }
+
+    void
+    testKeepAlive ()
+    {
+        testcase ("keep alive");
+
+        boost::asio::io_service ios;
+        boost::optional <boost::asio::io_service::work> work (ios);
+        std::thread thread ([&ios] { ios.run (); });
+
+        beast::RootStoppable root ("root");
+        auto const jobQueue = make_JobQueue (
+            beast::insight::NullCollector::New (), root, beast::Journal ());
+        jobQueue->setThreadCount (2, false);
+
+        auto handler = make_ServerHandler (root, ios, *jobQueue,
+            getApp ().getOPs (), getApp ().getResourceManager (),
+            getApp ().getCollectorManager ());
+
+        HTTP::Port port;
+        port.name = "rpc";
+        port.ip = boost::asio::ip::address_v4::loopback ();
+        port.port = freePort (ios);
+        port.protocol.insert ("http");
+        port.admin_ip.push_back (port.ip);
+
+        ServerHandler::Setup setup;
+        setup.ports.push_back (port);
+        handler->setup (setup, beast::Journal ());
+
+        root.start ();
+
+        {
+            using namespace boost::asio;
+
+            ip::tcp::socket socket (ios);
+            socket.connect (ip::tcp::endpoint (port.ip, port.port));
+            boost::asio::streambuf in;
+
+            std::size_t const large = 100 * 1024;
+
+            // Over 64KB: the session drops the body's storage afterwards
+            auto const invalidLarge =
+                "{\"method\":\"ping\",\"params\":[{\"pad\":\"" +
+                std::string (large, 'x') + "\"},{}],\"id\":1}";
+            check (post (socket, in, invalidLarge), "400 Bad Request",
+                "params unparseable");
+            check (post (socket, in, ping (0, 2)), "200 OK",
+                "\"status\":\"success\"");
+
+            // Small bodies reuse the storage of the one before
+            check (post (socket, in, "{\"method\":5}"), "400 Bad Request",
+                "method is not string");
+            check (post (socket, in, ping (1000, 3)), "200 OK",
+                "\"status\":\"success\"");
+            check (post (socket, in, "{\"method\":"), "400 Bad Request",
+                "Unable to parse request");
+
+            // A large body after a small one is read and parsed in full
+            check (post (socket, in, ping (large, 4)), "200 OK",
+                "\"status\":\"success\"");
+            check (post (socket, in, "{\"id\":5}"), "400 Bad Request",
+                "Null method");
+
+            socket.close ();
+        }
+
+        root.stop (beast::Journal ());
+        handler.reset ();
+
+        work = boost::none;
+        thread.join ();
+    }
+
+    void
+    run ()
+    {
+        testKeepAlive ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(ServerHandler,server,skywell);
+
+}
+}
@@ -0,0 +1,276 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of skywelld: https://github.com/skywell/skywelld
+    Copyright (c) 2012, 2013 Skywell Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <BeastConfig.h>
+#include <services/server/impl/WriteQueue.h>
+#include <beast/unit_test/suite.h>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+namespace skywell {
+namespace tests {
+
+class WriteQueue_test : public beast::unit_test::suite
+{
+public:
+    using WriteQueue = HTTP::WriteQueue;
+
+    static std::size_t const bufferSize = 64;
+
+    // Mostly the small fragments of a reply, sometimes a large body
+    static
+    std::string
+    makeChunk (std::mt19937& rng, char& next)
+    {
+        std::size_t size;
+        auto const pick = rng () % 100;
+        if (pick < 5)
+            size = 0;
+        else if (pick < 85)
+            size = 1 + rng () % 24;
+        else if (pick < 95)
+            size = bufferSize - 8 + rng () % 16;
+        else
+            size = 1 + rng () % (8 * bufferSize);
+
+        std::string chunk (size, 0);
+        for (auto& c : chunk)
+            c = next++;
+        return chunk;
+    }
+
+    // The writer's steps are interleaved with writes: asking for the next
+    // range, and later sending part of it. Bytes are copied out only when
+    // sent, so a write that overwrote a range being sent would show up.
+    void
+    testInterleaved (std::uint32_t seed)
+    {
+        std::mt19937 rng (seed);
+        WriteQueue queue (bufferSize);
+
+        std::string in;
+        std::string out;
+        char next = 0;
+
+        bool running = false;
+        bool pending = false;
+        std::size_t sent = 0;
+        void const* data = nullptr;
+        std::size_t bytes = 0;
+        int mistakes = 0;
+
+        for (int step = 0; step < 200000; ++step)
+        {
+            if (rng () % 2 == 0)
+            {
+                auto const chunk = makeChunk (rng, next);
+                in += chunk;
+
+                // A writer is started exactly when none is running
+                bool const start = queue.write (chunk.data (), chunk.size ());
+                if (start == running || (start && chunk.empty ()))
+                    ++mistakes;
+                if (start)
+                {
+                    running = true;
+                    sent = 0;
+                }
+            }
+            else if (running && !pending)
+            {
+                if (queue.next (sent, data, bytes))
+                {
+                    pending = true;
+                    if (bytes == 0)
+                        ++mistakes;
+                }
+                else
+                {
+                    running = false;
+                }
+            }
+            else if (pending)
+            {
+                // Send part of the range, as a short write would
+                sent = 1 + rng () % bytes;
+                out.append (static_cast <char const*> (data), sent);
+                pending = false;
+            }
+
+            // With no writer running nothing may be left queued
+            if (!running && !queue.empty ())
+                ++mistakes;
+        }
+
+        // Drain what is left
+        while (running)
+        {
+            if (pending)
+            {
+                out.append (static_cast <char const*> (data), bytes);
+                sent = bytes;
+                pending = false;
+            }
+            if (queue.next (sent, data, bytes))
+                pending = true;
+            else
+                running = false;
+        }
+
+        expect (queue.empty ());
+        expect (mistakes == 0, "writer started or fed wrongly");
+        expect (out.size () == in.size (), "lost or extra bytes");
+        expect (out == in, "bytes out of order");
+    }
+
+    void
+    testReuse ()
+    {
+        testcase ("buffer reuse");
+
+        WriteQueue queue (bufferSize);
+        void const* data;
+        std::size_t bytes;
+
+        expect (queue.empty ());
+        expect (! queue.write ("", 0));
+        expect (queue.empty ());
+
+        // Small writes share one buffer
+        expect (queue.write ("abc", 3));
+        expect (! queue.write ("def", 3));
+        expect (queue.next (0, data, bytes));
+        expect (bytes == 6 && std::memcmp (data, "abcdef", 6) == 0);
+        void const* const first = data;
+
+        // Appending to the buffer being sent leaves the range alone
+        expect (! queue.write ("gh", 2));
+        expect (std::memcmp (data, "abcdef", 6) == 0);
+        expect (queue.next (6, data, bytes));
+        expect (bytes == 2 && std::memcmp (data, "gh", 2) == 0);
+        expect (! queue.next (2, data, bytes));
+        expect (queue.empty ());
+
+        // The drained buffer serves the next reply
+        expect (queue.write ("ij", 2));
+        expect (queue.next (0, data, bytes));
+        expect (data == first);
+        expect (! queue.next (2, data, bytes));
+
+        // A large write gets a buffer of its own, which is not kept
+        std::string const large (3 * bufferSize, 'x');
+        expect (queue.write (large.data (), large.size ()));
+        expect (queue.next (0, data, bytes));
+        expect (bytes == large.size () && data != first);
+        expect (! queue.write ("k", 1));
+        expect (queue.next (large.size (), data, bytes));
+        expect (bytes == 1 && data == first);
+        expect (! queue.next (1, data, bytes));
+        expect (queue.empty ());
+    }
+
+    // A thread writing while another sends, as a handler writing a reply
+    // while the peer's strand sends it
+    void
+    testConcurrent ()
+    {
+        testcase ("concurrent");
+
+        WriteQueue queue (bufferSize);
+        std::mutex mutex;
+        std::condition_variable cond;
+        int starts = 0;
+        bool done = false;
+
+        std::string in;
+        std::string out;
+
+        std::thread writer ([&]
+        {
+            std::mt19937 rng (11);
+            for (;;)
+            {
+                {
+                    std::unique_lock <std::mutex> lock (mutex);
+                    cond.wait (lock, [&] { return starts > 0 || done; });
+                    if (starts == 0)
+                        return;
+                    --starts;
+                }
+
+                std::size_t sent = 0;
+                void const* data;
+                std::size_t bytes;
+                while (queue.next (sent, data, bytes))
+                {
+                    sent = 1 + rng () % bytes;
+                    out.append (static_cast <char const*> (data), sent);
+                }
+            }
+        });
+
+        std::mt19937 rng (7);
+        char next = 0;
+        for (int i = 0; i < 200000; ++i)
+        {
+            auto const chunk = makeChunk (rng, next);
+            in += chunk;
+            if (queue.write (chunk.data (), chunk.size ()))
+            {
+                std::lock_guard <std::mutex> lock (mutex);
+                ++starts;
+                cond.notify_one ();
+            }
+        }
+
+        // Wait for the writer to drain the queue
+        while (! queue.empty ())
+            std::this_thread::yield ();
+        {
+            std::lock_guard <std::mutex> lock (mutex);
+            done = true;
+            cond.notify_one ();
+        }
+        writer.join ();
+
+        expect (starts == 0);
+        expect (out.size () == in.size (), "lost or extra bytes");
+        expect (out == in, "bytes out of order");
+    }
+
+    void
+    run ()
+    {
+        testcase ("interleaved");
+        for (std::uint32_t seed = 1; seed <= 4; ++seed)
+            testInterleaved (seed);
+
+        testReuse ();
+        testConcurrent ();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(WriteQueue,server,skywell);
+
+}
+}